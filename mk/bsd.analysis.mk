@@ -12,6 +12,10 @@
 #		The resulting graph may be quite large, so you may like to filter it
 #		using scripts from https://github.com/trombonehero/dot-tools.
 #
+#	soaap:
+#		Run SOAAP over all of the program's bitcode files. They are linked
+#		by SOAAP itself, so no _callgraph_.bc is needed.
+#
 
 .include <bsd.init.mk>
 .include <bsd.llvm.mk>
@@ -23,13 +27,17 @@ CFLAGS+=-I/home/khilan/workspace/soaap/include
 .SUFFIXES: .dot .cg .soaap
 
 DOTFILES=  ${LLVM_BC:R:S/$/.dot/g}
-CLEANFILES+= ${DOTFILES} _callgraph_.dot _callgraph_.bc *.pll* *.soaap
+CLEANFILES+= ${DOTFILES} _callgraph_.dot _callgraph_.bc _soaap_.rsp *.pll* *.soaap
 
 callgraph: _callgraph_.dot
 
 _callgraph_.bc: ${LLVM_BC}
 	llvm-link -o $@ $?
 
+soaap: ${LLVM_BC}
+	echo ${LLVM_BC} > _soaap_.rsp
+	$(SOAAP_BUILD_DIR)/bin/soaap ${SOAAP_FLAGS} @_soaap_.rsp
+
 # Extract static call graph from LLVM IR (binary .bc or textual .ll).
 .bc.dot:
 	opt -analyze -dot-callgraph $<
@@ -1,5 +1,6 @@
 import callgraph
 import collections
+import json
 
 
 
@@ -42,6 +43,55 @@ analyses = {
 }
 
 
+class NDJSONReport(object):
+    """
+    A streamed SOAAP report (--soaap-report-output-formats=ndjson), which
+    can be used in place of the 'soaap' object of a JSON report.
+
+    Records are read lazily, one line at a time, and trace references
+    are resolved as they are encountered.
+    """
+
+    def __init__(self, filename):
+        self.filename = filename
+
+    def __getitem__(self, analysis):
+        nodes = {}
+
+        with open(self.filename, 'r') as f:
+            for line in f:
+                record = json.loads(line)
+                kind = record.pop('type')
+
+                if kind == 'trace_node':
+                    nodes[record['id']] = record
+
+                elif kind == analysis:
+                    if 'trace_id' in record:
+                        record['trace'] = trace(nodes, record['trace_id'])
+
+                    yield record
+
+
+def trace(nodes, trace_id):
+    """
+    Reconstruct a trace (innermost call first) from the trace nodes that
+    SOAAP defines the first time they are used.
+    """
+
+    calls = []
+
+    while trace_id != -1:
+        node = nodes[trace_id]
+        calls.append({
+            'function': node['function'],
+            'location': node['location'],
+        })
+        trace_id = node['parent']
+
+    return calls
+
+
 def parse(soaap, analysis = 'vulnerabilities'):
     """
     Parse the results of a SOAAP analysis.
@@ -52,7 +102,21 @@ def parse(soaap, analysis = 'vulnerabilities'):
 
     (key_fn, get_details) = analyses[analysis]
 
+    # Trace nodes can be defined by any earlier warning, of any analysis.
+    nodes = {}
+    if isinstance(soaap, dict):
+        for warnings in soaap.values():
+            if not isinstance(warnings, list):
+                continue
+
+            for warning in warnings:
+                for node in warning.get('trace_node', []):
+                    nodes[node['id']] = node
+
     for warning in soaap[analysis]:
+        if 'trace_id' in warning and 'trace' not in warning:
+            warning['trace'] = trace(nodes, warning['trace_id'])
+
         fn = warning['function']
         details = get_details(warning)
 
@@ -1,23 +1,59 @@
 #ifndef SOAAP_ADT_QUEUESET_H
 #define SOAAP_ADT_QUEUESET_H
 
+#include <functional>
+#include <queue>
 #include <set>
 #include <list>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
 namespace soaap {
 
+  // The order in which a QueueSet's elements are dequeued:
+  //   FIFO   - in the order they were enqueued
+  //   LIFO   - most recently enqueued first
+  //   Hybrid - elements enqueued before the first dequeue (the seeds) in
+  //            FIFO order, but everything enqueued since is dequeued LIFO
+  //            first, so each seed's effects are chased depth-first
+  //   RPO    - lowest priority first (e.g. reverse post-order index), FIFO
+  //            among equal priorities
+  //   SCC    - as RPO, but priorities are topological indices of strongly
+  //            connected components
+  enum class WorklistPolicy {
+    FIFO, LIFO, Hybrid, RPO, SCC
+  };
+
+  // A worklist that holds each element at most once
   template<typename T>
   class QueueSet {
     public:
+      typedef std::function<unsigned(const T&)> PriorityFn;
+      QueueSet(WorklistPolicy policy = WorklistPolicy::FIFO, PriorityFn priority = PriorityFn())
+        : policy(policy), priority(priority), started(false), seq(0), numEnqueued(0), numDequeued(0) { }
       bool enqueue(T elem);
       T dequeue();
       bool empty();
       int size();
       void clear();
+      // the elements currently held, in no particular order
+      const std::set<T>& getElements() { return set; }
+      WorklistPolicy getPolicy() { return policy; }
+      unsigned getNumEnqueued() { return numEnqueued; }
+      unsigned getNumDequeued() { return numDequeued; }
 
     protected:
+      typedef pair<pair<unsigned,unsigned long>,T> HeapEntry;
+      WorklistPolicy policy;
+      PriorityFn priority;
+      bool started;
+      unsigned long seq;
+      unsigned numEnqueued;
+      unsigned numDequeued;
+      std::list<T> stack;
+      std::priority_queue<HeapEntry,std::vector<HeapEntry>,std::greater<HeapEntry> > heap;
       set<T> set;
       list<T> list;
   };
@@ -25,7 +61,27 @@ namespace soaap {
   template<typename T>
   bool QueueSet<T>::enqueue(T elem) {
     if (set.insert(elem).second) {
-      list.push_back(elem);
+      numEnqueued++;
+      switch (policy) {
+        case WorklistPolicy::FIFO:
+          list.push_back(elem);
+          break;
+        case WorklistPolicy::LIFO:
+          list.push_front(elem);
+          break;
+        case WorklistPolicy::Hybrid:
+          if (started) {
+            stack.push_front(elem);
+          }
+          else {
+            list.push_back(elem);
+          }
+          break;
+        case WorklistPolicy::RPO:
+        case WorklistPolicy::SCC:
+          heap.push(make_pair(make_pair(priority ? priority(elem) : 0, seq++), elem));
+          break;
+      }
       return true;
     }
     return false;
@@ -33,26 +89,42 @@ namespace soaap {
 
   template<typename T>
   T QueueSet<T>::dequeue() {
-    T elem = list.front();
-    list.pop_front();
+    T elem;
+    if (!heap.empty()) {
+      elem = heap.top().second;
+      heap.pop();
+    }
+    else if (!stack.empty()) {
+      elem = stack.front();
+      stack.pop_front();
+    }
+    else {
+      elem = list.front();
+      list.pop_front();
+    }
     set.erase(elem);
+    started = true;
+    numDequeued++;
     return elem;
   }
 
   template<typename T>
   bool QueueSet<T>::empty() {
-    return list.empty();
+    return list.empty() && stack.empty() && heap.empty();
   }
 
   template<typename T>
   int QueueSet<T>::size() {
-    return list.size();
+    return list.size() + stack.size() + heap.size();
   }
 
   template<typename T>
   void QueueSet<T>::clear() {
     list.clear();
+    stack.clear();
+    heap = std::priority_queue<HeapEntry,std::vector<HeapEntry>,std::greater<HeapEntry> >();
     set.clear();
+    started = false;
   }
 
 }
@@ -28,6 +28,7 @@
 #include "Util/DebugUtils.h"
 #include "Util/LLVMAnalyses.h"
 #include "Util/SandboxUtils.h"
+#include "Util/WorklistUtils.h"
 
 using namespace std;
 using namespace llvm;
@@ -37,29 +38,53 @@ namespace soaap {
   template<class FactType>
   class CFGFlowAnalysis : public Analysis {
     public:
+      CFGFlowAnalysis() : widened(false) { }
       virtual void doAnalysis(Module& M, SandboxVector& sandboxes);
 
     protected:
       map<Instruction*,FactType> state;
+      string budgetExceeded;
+      bool widened;
       virtual void initialise(QueueSet<BasicBlock*>& worklist, Module& M, SandboxVector& sandboxes) = 0;
       virtual void performDataFlowAnalysis(QueueSet<BasicBlock*>&, SandboxVector& sandboxes, Module& M);
       virtual void updateStateAndPropagate(Instruction* I, FactType val, QueueSet<BasicBlock*>& worklist);
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes) = 0;
       virtual FactType bottomValue() = 0;
       virtual string stringifyFact(FactType& f) = 0;
+      // Name of the analysis in reports of precision loss
+      virtual string getName() = 0;
+      // Set fact to a conservative summary of every fact that a basic block
+      // could start with, so that it need not change again. Return false if
+      // the analysis has no such summary.
+      virtual bool widen(FactType& fact) { return false; }
   };
 
   template <class FactType>
   void CFGFlowAnalysis<FactType>::doAnalysis(Module& M, SandboxVector& sandboxes) {
-    QueueSet<BasicBlock*> worklist;
+    QueueSet<BasicBlock*> worklist(CmdLineOpts::Worklist, [&M](BasicBlock* const& BB) {
+      return WorklistUtils::getPriority(BB, M);
+    });
     initialise(worklist, M, sandboxes);
     performDataFlowAnalysis(worklist, sandboxes, M);
+    WorklistUtils::recordStats(worklist.getPolicy(), worklist.getNumEnqueued(), worklist.getNumDequeued());
     postDataFlowAnalysis(M, sandboxes);
+    if (widened) {
+      WorklistUtils::noteOverBudget(getName(), budgetExceeded);
+    }
   }
 
   template <typename FactType>
   void CFGFlowAnalysis<FactType>::performDataFlowAnalysis(QueueSet<BasicBlock*>& worklist, SandboxVector& sandboxes, Module& M) {
+    // Once the run is over budget, the entry fact of every block dequeued
+    // is widened, so that each block changes at most once more.
+    unsigned popped = 0;
     while (!worklist.empty()) {
+      string budget;
+      if (popped++ % 1024 == 0 && budgetExceeded.empty()
+          && WorklistUtils::isOverBudget(budget)) {
+        SDEBUG("soaap.analysis.cfgflow", 1, dbgs() << INDENT_1 << "Over " << budget << " budget with " << worklist.size() << " blocks on the worklist, widening\n")
+        budgetExceeded = budget;
+      }
       BasicBlock* BB = worklist.dequeue();
 
       SDEBUG("soaap.analysis.cfgflow", 3, dbgs() << INDENT_3 << "BB: " << *BB << "\n");
@@ -72,6 +97,9 @@ namespace soaap {
         TerminatorInst* T = PredBB->getTerminator();
         entryBB |= state[T];
       }
+      if (!budgetExceeded.empty() && widen(entryBB)) {
+        widened = true;
+      }
 
       SDEBUG("soaap.analysis.cfgflow", 3, dbgs() << INDENT_4 << "Computed entry: " << stringifyFact(entryBB) << "\n");
       SDEBUG("soaap.analysis.cfgflow", 3, dbgs() << INDENT_4 << "Propagating through current BB (" << BB->getParent()->getName() << ")\n");
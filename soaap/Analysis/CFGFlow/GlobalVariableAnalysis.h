@@ -16,6 +16,8 @@ namespace soaap {
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
       virtual int bottomValue() { return 0; }
       virtual string stringifyFact(int& fact) { return SandboxUtils::stringifySandboxNames(fact); }
+      virtual string getName() { return "globals"; }
+      virtual bool widen(int& fact) { fact |= SandboxUtils::getAllSandboxNames(); return true; }
 
     private:
       FunctionSet privilegedMethods;
@@ -5,6 +5,8 @@
 #include "Common/Debug.h"
 #include "Common/Sandbox.h"
 #include "Common/XO.h"
+#include "OS/Sandbox/SeccompBPF.h"
+#include "OS/Sandbox/SeccompFilterGenerator.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/DebugUtils.h"
 #include "Util/InstUtils.h"
@@ -16,12 +18,12 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <fstream>
 #include <sstream>
 
 using namespace soaap;
 
 void SysCallsAnalysis::initialise(QueueSet<BasicBlock*>& worklist, Module& M, SandboxVector& sandboxes) {
-  freeBSDSysCallProvider.initSysCalls();
   for (Sandbox* S : sandboxes) {
     CallInstVector sysCallLimitPoints = S->getSysCallLimitPoints();
     for (CallInst* C : sysCallLimitPoints) {
@@ -33,7 +35,7 @@ void SysCallsAnalysis::initialise(QueueSet<BasicBlock*>& worklist, Module& M, Sa
       for (Function* F : allowedSysCalls) {
         string sysCallName = F->getName();
         SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "setting bit for " << sysCallName << "\n")
-        int idx = freeBSDSysCallProvider.getIdx(sysCallName);
+        int idx = sysCallProvider->getIdx(F);
         if (idx == -1) {
           errs() << "WARNING: \"" << sysCallName << "\" does not appear to be a system call\n";
           continue;
@@ -61,14 +63,15 @@ void SysCallsAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes)
       if (shouldOutputWarningFor(C)) {
         SDEBUG("soaap.analysis.cfgflow.syscalls", 4, dbgs() << "call: " << *C << "\n")
         for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
-          string funcName = Callee->getName();
-          SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "callee: " << funcName << "\n")
-          if (freeBSDSysCallProvider.isSysCall(funcName)) {
+          SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "callee: " << Callee->getName() << "\n")
+          int idx = sysCallProvider->getIdx(Callee);
+          if (idx != -1) {
+            string funcName = Callee->getName();
             SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "syscall " << funcName << " found\n")
             bool sysCallAllowed = false;
             if (sandboxPlatform) {
               // sandbox platform dictates if the system call is allowed
-              sysCallAllowed = sandboxPlatform->isSysCallPermitted(funcName);
+              sysCallAllowed = sandboxPlatform->isSysCallPermittedAtCall(funcName, C);
             }
             else if (state.find(C) == state.end()) { // no annotations, so disallow by default
               sysCallAllowed = false;
@@ -77,7 +80,6 @@ void SysCallsAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes)
               // We distinguish an empty vector from C not appearing in state
               // to avoid blowing up the state map
               BitVector& vector = state[C];
-              int idx = freeBSDSysCallProvider.getIdx(funcName);
               SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "syscall idx: " << idx << "\n")
               SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "allowed sys calls vector size and count: " << vector.size() << "," << vector.count() << "\n")
               sysCallAllowed = vector.size() > idx && vector.test(idx);
@@ -105,14 +107,142 @@ void SysCallsAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes)
     }
   }
   XO::close_list("syscall_warning");
+
+  if (CmdLineOpts::EmitSeccompFilters) {
+    emitSeccompFilters(M, sandboxes);
+  }
 }
 
-bool SysCallsAnalysis::allowedToPerformNamedSystemCallAtSandboxedPoint(Instruction* I, string sysCall) {
+// System calls that glibc's wrappers make on x86-64 in place of the one they
+// are named after. The wrapper's argument i is argument argMap[i] of the
+// system call, or is not passed if that is -1.
+static const struct {
+  const char* wrapper;
+  const char* sysCall;
+  int argMap[6];
+} libcSysCalls[] = {
+  { "open",  "openat",     { 1, 2, 3, -1, -1, -1 } },
+  { "fork",  "clone",      { -1, -1, -1, -1, -1, -1 } },
+  { "stat",  "newfstatat", { 1, 2, -1, -1, -1, -1 } },
+  { "lstat", "newfstatat", { 1, 2, -1, -1, -1, -1 } },
+  { "fstat", "newfstatat", { 0, 2, -1, -1, -1, -1 } },
+};
+
+// Generate a seccomp-bpf filter for each sandbox that permits only the system
+// calls that it performs. A call to a libc wrapper also permits the system
+// call that the wrapper actually makes (see libcSysCalls), with the
+// predicates moved to the corresponding arguments; the wrapper's own system
+// call stays permitted for C libraries that still make it. If the sandbox
+// platform is seccomp-bpf, then the filter is further restricted to those
+// argument predicates of the policy that are satisfied by the calls. System
+// calls are ordered by their frequency in the dynamic profile if one was
+// given, otherwise by their number of call sites within the sandbox.
+void SysCallsAnalysis::emitSeccompFilters(Module& M, SandboxVector& sandboxes) {
+  if (CmdLineOpts::OperatingSystem != OperatingSystemName::Linux) {
+    errs() << "WARNING: seccomp-bpf filters can only be generated for Linux (-soaap-os=linux)\n";
+    return;
+  }
+  SeccompBPF* seccompBPF = NULL;
+  if (sandboxPlatform && CmdLineOpts::SandboxPlatform == SandboxPlatformName::SeccompBPF) {
+    seccompBPF = static_cast<SeccompBPF*>(sandboxPlatform.get());
+  }
+  StringMap<uint64_t> profile;
+  bool profiled = loadSysCallProfile(profile);
+
+  for (Sandbox* S : sandboxes) {
+    SeccompFilterGenerator generator;
+    map<int,uint64_t> callSiteCounts;
+    for (CallInst* C : S->getCalls()) {
+      for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
+        int idx = sysCallProvider->getIdx(Callee);
+        if (idx == -1) {
+          continue;
+        }
+        int number = sysCallProvider->getSysCallNumber(idx);
+        string funcName = Callee->getName();
+        SeccompRuleVector rules;
+        if (seccompBPF) {
+          // calls violating the policy have already been warned about
+          rules = seccompBPF->getRulesSatisfiedAtCall(funcName, C);
+          if (rules.empty()) {
+            continue;
+          }
+        }
+        else {
+          rules.push_back(SeccompRule());
+        }
+        for (SeccompRule& rule : rules) {
+          generator.allowSysCall(number, funcName, rule);
+        }
+        callSiteCounts[number]++;
+        generator.setWeight(number, profiled ? profile.lookup(funcName) : callSiteCounts[number]);
+
+        for (auto& libcSysCall : libcSysCalls) {
+          if (funcName != libcSysCall.wrapper) {
+            continue;
+          }
+          int libcIdx = sysCallProvider->getIdx(libcSysCall.sysCall);
+          if (libcIdx == -1) {
+            continue;
+          }
+          int libcNumber = sysCallProvider->getSysCallNumber(libcIdx);
+          for (SeccompRule& rule : rules) {
+            SeccompRule libcRule;
+            for (SeccompArgPredicate pred : rule) {
+              // predicates on arguments that aren't passed on can be dropped,
+              // as that only permits more
+              if (pred.argIdx < 6 && libcSysCall.argMap[pred.argIdx] != -1) {
+                pred.argIdx = libcSysCall.argMap[pred.argIdx];
+                libcRule.push_back(pred);
+              }
+            }
+            generator.allowSysCall(libcNumber, libcSysCall.sysCall, libcRule);
+          }
+          callSiteCounts[libcNumber]++;
+          generator.setWeight(libcNumber, profiled ? profile.lookup(libcSysCall.sysCall) : callSiteCounts[libcNumber]);
+        }
+      }
+    }
+
+    string filename = SandboxUtils::getPolicyFilename(S, "seccomp.h");
+    SDEBUG("soaap.analysis.cfgflow.syscalls", 3, dbgs() << "writing seccomp-bpf filter for sandbox " << S->getName() << " to " << filename << "\n")
+    ofstream out(filename.c_str());
+    if (!out) {
+      errs() << "WARNING: unable to write seccomp-bpf filter to \"" << filename << "\"\n";
+      continue;
+    }
+    out << generator.generate("soaap_" + SandboxUtils::getIdentifierForSandbox(S));
+  }
+}
+
+// The profile consists of lines of the form "<syscall> <count>", such as can
+// be obtained from the calls column of "strace -c".
+bool SysCallsAnalysis::loadSysCallProfile(StringMap<uint64_t>& profile) {
+  if (CmdLineOpts::SysCallProfile.empty()) {
+    return false;
+  }
+  ifstream in(CmdLineOpts::SysCallProfile.c_str());
+  if (!in) {
+    errs() << "WARNING: unable to read system call profile \"" << CmdLineOpts::SysCallProfile << "\"\n";
+    return false;
+  }
+  string sysCall;
+  uint64_t count;
+  while (in >> sysCall >> count) {
+    profile[sysCall] += count;
+  }
+  return true;
+}
+
+bool SysCallsAnalysis::allowedToPerformSystemCallAtSandboxedPoint(Instruction* I, Function* sysCall) {
   if (sandboxPlatform) {
-    return sandboxPlatform->isSysCallPermitted(sysCall);
+    if (CallInst* C = dyn_cast<CallInst>(I)) {
+      return sandboxPlatform->isSysCallPermittedAtCall(sysCall->getName(), C);
+    }
+    return sandboxPlatform->isSysCallPermitted(sysCall->getName());
   }
   else if (state.find(I) != state.end()) {
-    int idx = freeBSDSysCallProvider.getIdx(sysCall);
+    int idx = sysCallProvider->getIdx(sysCall);
     BitVector& vector = state[I];
     return vector.size() > idx && vector.test(idx);
   }
@@ -125,7 +255,7 @@ string SysCallsAnalysis::stringifyFact(BitVector& vector) {
   int idx = 0;
   for (int i=0; i<vector.count(); i++) {
     idx = (i == 0) ? vector.find_first() : vector.find_next(idx);
-    ss << ((i > 0) ? "," : "") << freeBSDSysCallProvider.getSysCall(idx);
+    ss << ((i > 0) ? "," : "") << sysCallProvider->getSysCall(idx);
   }
   ss << "]";
   return ss.str();
@@ -2,27 +2,31 @@
 #define SOAAP_ANALYSIS_CFGFLOW_SYSCALLSANALYSIS_H
 
 #include "Analysis/CFGFlow/CFGFlowAnalysis.h"
-#include "OS/FreeBSDSysCallProvider.h"
+#include "OS/SysCallProvider.h"
 #include "OS/Sandbox/SandboxPlatform.h"
 
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/StringMap.h"
 
 namespace soaap {
 
   class SysCallsAnalysis : public CFGFlowAnalysis<BitVector> {
     public:
-      SysCallsAnalysis(shared_ptr<SandboxPlatform>& platform) : sandboxPlatform(platform) { }
-      bool allowedToPerformNamedSystemCallAtSandboxedPoint(Instruction* I, string sysCall);
+      SysCallsAnalysis(shared_ptr<SandboxPlatform>& platform) : sysCallProvider(SysCallProvider::getProvider()), sandboxPlatform(platform) { }
+      bool allowedToPerformSystemCallAtSandboxedPoint(Instruction* I, Function* sysCall);
 
     protected:
       virtual void initialise(QueueSet<BasicBlock*>& worklist, Module& M, SandboxVector& sandboxes);
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
       virtual BitVector bottomValue() { return BitVector(); }
       virtual string stringifyFact(BitVector& fact);
+      virtual string getName() { return "syscalls"; }
 
     private:
-      FreeBSDSysCallProvider freeBSDSysCallProvider;
+      SysCallProvider* sysCallProvider;
       shared_ptr<SandboxPlatform> sandboxPlatform;
+      void emitSeccompFilters(Module& M, SandboxVector& sandboxes);
+      bool loadSysCallProfile(StringMap<uint64_t>& profile);
   };
 
 }
@@ -21,6 +21,7 @@ namespace soaap {
       virtual bool performUnion(int from, int& to);
       virtual int bottomValue() { return 0; }
       virtual string stringifyFact(int fact);
+      virtual string getName() { return "access-origin"; }
 
     private:
       FunctionSet privilegedMethods;
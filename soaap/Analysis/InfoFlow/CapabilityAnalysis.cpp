@@ -13,11 +13,10 @@
 using namespace soaap;
 
 void CapabilityAnalysis::initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes) {
-  freeBSDSysCallProvider.initSysCalls();
   for (Sandbox* S : sandboxes) {
     ValueFunctionSetMap caps = S->getCapabilities();
     for (pair<const Value*,FunctionSet> cap : caps) {
-      function<int (Function*)> func = [&](Function* F) -> int { return freeBSDSysCallProvider.getIdx(F->getName()); };
+      function<int (Function*)> func = [&](Function* F) -> int { return sysCallProvider->getIdx(F); };
       state[S][cap.first] = TypeUtils::convertFunctionSetToBitVector(cap.second, func);
       addToWorklist(cap.first, S, worklist);
     }
@@ -45,13 +44,13 @@ void CapabilityAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxe
         if (CallInst* C = dyn_cast<CallInst>(&*I)) {
           SDEBUG("soaap.analysis.infoflow.capability", 3, dbgs() << "call: " << *C << "\n")
           for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
-            string funcName = Callee->getName();
-            SDEBUG("soaap.analysis.infoflow.capability", 3, dbgs() << "callee: " << funcName << "\n")
-            if (freeBSDSysCallProvider.isSysCall(funcName) && freeBSDSysCallProvider.hasFdArg(funcName)) {
+            SDEBUG("soaap.analysis.infoflow.capability", 3, dbgs() << "callee: " << Callee->getName() << "\n")
+            int sysCallIdx = sysCallProvider->getIdx(Callee);
+            if (sysCallProvider->hasFdArg(sysCallIdx)) {
+              string funcName = Callee->getName();
               SDEBUG("soaap.analysis.infoflow.capability", 3, dbgs() << "syscall " << funcName << " found\n")
               // this is a system call
-              int fdArgIdx = freeBSDSysCallProvider.getFdArgIdx(funcName);
-              int sysCallIdx = freeBSDSysCallProvider.getIdx(funcName);
+              int fdArgIdx = sysCallProvider->getFdArgIdx(sysCallIdx);
               Value* fdArg = C->getArgOperand(fdArgIdx);
               
               BitVector& vector = state[S][fdArg];
@@ -85,7 +84,7 @@ string CapabilityAnalysis::stringifyFact(BitVector vector) {
   int idx = 0;
   for (int i=0; i<vector.count(); i++) {
     idx = (i == 0) ? vector.find_first() : vector.find_next(idx);
-    ss << ((i > 0) ? "," : "") << freeBSDSysCallProvider.getSysCall(idx);
+    ss << ((i > 0) ? "," : "") << sysCallProvider->getSysCall(idx);
   }
   ss << "]";
   return ss.str();
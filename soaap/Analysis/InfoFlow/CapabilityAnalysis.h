@@ -3,7 +3,7 @@
 
 #include "Analysis/InfoFlow/InfoFlowAnalysis.h"
 #include "Common/Typedefs.h"
-#include "OS/FreeBSDSysCallProvider.h"
+#include "OS/SysCallProvider.h"
 
 #include <string>
 
@@ -14,7 +14,7 @@ namespace soaap {
 
   class CapabilityAnalysis : public InfoFlowAnalysis<BitVector> {
     public:
-      CapabilityAnalysis(bool contextInsensitive) : InfoFlowAnalysis<BitVector>(contextInsensitive, true) { }
+      CapabilityAnalysis(bool contextInsensitive) : InfoFlowAnalysis<BitVector>(contextInsensitive, true), sysCallProvider(SysCallProvider::getProvider()) { }
 
     protected:
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes);
@@ -23,9 +23,10 @@ namespace soaap {
       virtual bool performUnion(BitVector fromVal, BitVector& toVal);
       virtual BitVector bottomValue() { return BitVector(); }
       virtual string stringifyFact(BitVector vector);
+      virtual string getName() { return "capability"; }
 
     private:
-      FreeBSDSysCallProvider freeBSDSysCallProvider;
+      SysCallProvider* sysCallProvider;
       void validateDescriptorAccesses(Module& M, SandboxVector& sandboxes, string syscall, int requiredPerm);
   };
 }
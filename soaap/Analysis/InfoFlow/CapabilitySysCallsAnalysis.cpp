@@ -4,26 +4,29 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/InstIterator.h"
 
+#include <cctype>
+#include <fstream>
+#include <set>
 #include <sstream>
 
 #include "Analysis/InfoFlow/CapabilitySysCallsAnalysis.h"
 #include "Common/XO.h"
+#include "OS/Sandbox/Capsicum.h"
 #include "Util/InstUtils.h"
 #include "Util/LLVMAnalyses.h"
 #include "Util/PrettyPrinters.h"
+#include "Util/SandboxUtils.h"
 #include "Util/TypeUtils.h"
 #include "soaap.h"
 
 using namespace soaap;
 
 void CapabilitySysCallsAnalysis::initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes) {
-  freeBSDSysCallProvider.initSysCalls();
-  
   // Add annotations on file descriptor parameters to sandbox entry point
   for (Sandbox* S : sandboxes) {
     ValueFunctionSetMap caps = S->getCapabilities();
     for (pair<const Value*,FunctionSet> cap : caps) {
-      function<int (Function*)> func = [&](Function* F) -> int { return freeBSDSysCallProvider.getIdx(F->getName()); };
+      function<int (Function*)> func = [&](Function* F) -> int { return sysCallProvider->getIdx(F); };
       state[S][cap.first] = TypeUtils::convertFunctionSetToBitVector(cap.second, func);
       SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << INDENT_2 << "Adding " << *(cap.first) << "\n");
       addToWorklist(cap.first, S, worklist);
@@ -79,7 +82,8 @@ void CapabilitySysCallsAnalysis::initialise(ValueContextPairList& worklist, Modu
 
             addToWorklist(annotatedVar, ContextUtils::NO_CONTEXT, worklist);
             ValueSet visited;
-            propagateToAggregate(annotatedVar, ContextUtils::NO_CONTEXT, annotatedVar, visited, worklist, sandboxes, M);
+            propagateToMemory(annotatedVar, ContextUtils::NO_CONTEXT, annotatedVar, worklist, sandboxes, M);
+            propagateToCallerArgs(annotatedVar, ContextUtils::NO_CONTEXT, annotatedVar, visited, worklist, sandboxes, M);
             if (ConstantInt* CI = dyn_cast<ConstantInt>(annotatedVar)) {
               SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << INDENT_3 << "Constant integer, val: " << CI->getSExtValue() << ", recording in intFdToAllowedSysCalls");
               intFdToAllowedSysCalls[CI->getSExtValue()] = sysCallsVector;
@@ -161,15 +165,15 @@ void CapabilitySysCallsAnalysis::postDataFlowAnalysis(Module& M, SandboxVector&
       if (shouldOutputWarningFor(C)) {
         SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "call: " << *C << "\n")
         for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
-          string funcName = Callee->getName();
-          SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "callee: " << funcName << "\n")
-          if (freeBSDSysCallProvider.isSysCall(funcName) && freeBSDSysCallProvider.hasFdArg(funcName) && sysCallsAnalysis.allowedToPerformNamedSystemCallAtSandboxedPoint(C, funcName)) {
+          SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "callee: " << Callee->getName() << "\n")
+          int sysCallIdx = sysCallProvider->getIdx(Callee);
+          if (sysCallProvider->hasFdArg(sysCallIdx) && sysCallsAnalysis.allowedToPerformSystemCallAtSandboxedPoint(C, Callee)) {
+            string funcName = Callee->getName();
             // This is an allowed system call. If the sandbox platform does not
             // permit it then SysCallsAnalysis will output an error, so we can
             // ignore that case here.
             SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "syscall " << funcName << " found and takes fd arg\n")
-            int fdArgIdx = freeBSDSysCallProvider.getFdArgIdx(funcName);
-            int sysCallIdx = freeBSDSysCallProvider.getIdx(funcName);
+            int fdArgIdx = sysCallProvider->getFdArgIdx(sysCallIdx);
             Value* fdArg = C->getArgOperand(fdArgIdx);
             
             SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "syscall idx: " << sysCallIdx << "\n")
@@ -217,6 +221,193 @@ void CapabilitySysCallsAnalysis::postDataFlowAnalysis(Module& M, SandboxVector&
     }
   }
   XO::close_list("cap_rights_warning");
+
+  if (CmdLineOpts::EmitSandboxPolicies) {
+    emitCapsicumRights(M, sandboxes);
+  }
+}
+
+// For each sandbox, emit functions that limit each file descriptor it uses to
+// the Capsicum rights required by the system calls performed on it.
+void CapabilitySysCallsAnalysis::emitCapsicumRights(Module& M, SandboxVector& sandboxes) {
+  if (CmdLineOpts::OperatingSystem != OperatingSystemName::FreeBSD) {
+    return;
+  }
+  for (Sandbox* S : sandboxes) {
+    // fd -> system calls performed on it and the rights they need, in order
+    // of first use
+    vector<Value*> fds;
+    map<Value*,set<string> > fdToSysCalls;
+    map<Value*,set<string> > fdToRights;
+    for (CallInst* C : S->getCalls()) {
+      for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
+        int sysCallIdx = sysCallProvider->getIdx(Callee);
+        if (sysCallIdx == -1 || !sysCallProvider->hasFdArg(sysCallIdx)
+            || !sysCallsAnalysis.allowedToPerformSystemCallAtSandboxedPoint(C, Callee)) {
+          continue;
+        }
+        string funcName = Callee->getName();
+        if (sandboxPlatform && !sandboxPlatform->doesSysCallRequireFDRights(funcName)) {
+          continue;
+        }
+        vector<string> sysCallRights;
+        if (Capsicum::getRightsForSysCall(funcName, C, sysCallRights)) {
+          SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << funcName << " needs " << sysCallRights.size() << " right(s) at " << *C << "\n")
+        }
+        else {
+          funcName += "(unknown rights)";
+        }
+        // attribute the system call to every descriptor that may reach it
+        vector<Value*> origins;
+        ValueSet visited;
+        getOriginatingFds(getFd(C->getArgOperand(sysCallProvider->getFdArgIdx(sysCallIdx))), S, M, origins, visited);
+        for (Value* fd : origins) {
+          if (!fdToSysCalls.count(fd)) {
+            fds.push_back(fd);
+          }
+          fdToSysCalls[fd].insert(funcName);
+          fdToRights[fd].insert(sysCallRights.begin(), sysCallRights.end());
+        }
+      }
+    }
+
+    // Names are only needed for the output. Variables with the same name
+    // in different functions are qualified with the function's name, and
+    // any that still clash (e.g. shadowed variables) are numbered.
+    map<string,int> nameCounts;
+    for (Value* fd : fds) {
+      nameCounts[getFdName(fd)]++;
+    }
+    map<string,Value*> namedFds;
+    for (Value* fd : fds) {
+      string name = getFdName(fd);
+      if (nameCounts[name] > 1) {
+        if (Function* F = getFdFunction(fd)) {
+          name = F->getName().str() + "_" + name;
+        }
+      }
+      string uniqueName = name;
+      for (int i=2; namedFds.count(uniqueName); i++) {
+        uniqueName = name + "_" + to_string(i);
+      }
+      namedFds[uniqueName] = fd;
+    }
+
+    string filename = SandboxUtils::getPolicyFilename(S, "capsicum.h");
+    SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "writing Capsicum rights for sandbox " << S->getName() << " to " << filename << "\n")
+    ofstream out(filename.c_str());
+    if (!out) {
+      errs() << "WARNING: unable to write Capsicum rights to \"" << filename << "\"\n";
+      continue;
+    }
+    string sandboxId = SandboxUtils::getIdentifierForSandbox(S);
+    out << "/*\n"
+        << " * Capsicum rights generated by SOAAP for sandbox \"" << S->getName() << "\".\n"
+        << " * Each function limits a file descriptor to the rights required by the\n"
+        << " * system calls that the sandbox performs on it.\n"
+        << " */\n"
+        << "#include <sys/capsicum.h>\n";
+    for (pair<const string,Value*>& p : namedFds) {
+      out << "\n/*";
+      for (const string& sysCall : fdToSysCalls[p.second]) {
+        out << " " << sysCall;
+      }
+      out << " */\n"
+          << "static inline int soaap_" << sandboxId << "_limit_" << p.first << "(int fd) {\n"
+          << "  cap_rights_t rights;\n"
+          << "  cap_rights_init(&rights";
+      for (const string& right : fdToRights[p.second]) {
+        out << ", " << right;
+      }
+      out << ");\n"
+          << "  return cap_rights_limit(fd, &rights);\n"
+          << "}\n";
+    }
+  }
+}
+
+// File descriptors are identified by the storage they are loaded from (or
+// their value if constant), which is what the programmer will recognise. A
+// parameter's stack slot is identified with the parameter itself.
+Value* CapabilitySysCallsAnalysis::getFd(Value* fdArg) {
+  if (ConstantInt* CI = dyn_cast<ConstantInt>(fdArg)) {
+    // equal constants are the same descriptor
+    return ConstantInt::get(CI->getType()->getContext(), APInt(64, CI->getSExtValue(), true));
+  }
+  if (LoadInst* LI = dyn_cast<LoadInst>(fdArg)) {
+    fdArg = LI->getPointerOperand()->stripPointerCasts();
+  }
+  if (AllocaInst* AI = dyn_cast<AllocaInst>(fdArg)) {
+    Value* stored = NULL;
+    int numStores = 0;
+    for (User* U : AI->users()) {
+      if (StoreInst* SI = dyn_cast<StoreInst>(U)) {
+        stored = SI->getValueOperand();
+        numStores++;
+      }
+    }
+    if (numStores == 1 && isa<Argument>(stored)) {
+      return stored;
+    }
+  }
+  return fdArg;
+}
+
+// A parameter holds whichever descriptors its callers within the sandbox
+// pass in, so rights needed on it are needed on those descriptors. Tracing
+// stops at the sandbox's entry point, whose parameters are the descriptors
+// handed to the sandbox.
+void CapabilitySysCallsAnalysis::getOriginatingFds(Value* fd, Sandbox* S, Module& M, vector<Value*>& origins, ValueSet& visited) {
+  if (visited.count(fd)) {
+    return;
+  }
+  visited.insert(fd);
+  if (Argument* A = dyn_cast<Argument>(fd)) {
+    Function* F = A->getParent();
+    if (F != S->getEntryPoint()) {
+      CallInstSet callers = CallGraphUtils::getCallers(F, S, M);
+      if (!callers.empty()) {
+        for (CallInst* C : callers) {
+          if (A->getArgNo() < C->getNumArgOperands()) {
+            SDEBUG("soaap.analysis.infoflow.capsyscalls", 3, dbgs() << "param " << A->getName() << " of " << F->getName() << " is passed at " << *C << "\n")
+            getOriginatingFds(getFd(C->getArgOperand(A->getArgNo())), S, M, origins, visited);
+          }
+        }
+        return;
+      }
+    }
+  }
+  origins.push_back(fd);
+}
+
+Function* CapabilitySysCallsAnalysis::getFdFunction(Value* fd) {
+  if (Argument* A = dyn_cast<Argument>(fd)) {
+    return A->getParent();
+  }
+  if (Instruction* I = dyn_cast<Instruction>(fd)) {
+    return I->getParent()->getParent();
+  }
+  return NULL;
+}
+
+string CapabilitySysCallsAnalysis::getFdName(Value* fd) {
+  if (ConstantInt* CI = dyn_cast<ConstantInt>(fd)) {
+    stringstream ss;
+    ss << "fd" << CI->getSExtValue();
+    return ss.str();
+  }
+  StringRef nameRef = fd->hasName() ? fd->getName() : "fd";
+  if (nameRef.endswith(".addr")) {
+    // stack slot of a parameter
+    nameRef = nameRef.drop_back(strlen(".addr"));
+  }
+  string name = nameRef.str();
+  for (char& c : name) {
+    if (!isalnum(c)) {
+      c = '_';
+    }
+  }
+  return name;
 }
 
 string CapabilitySysCallsAnalysis::stringifyFact(BitVector vector) {
@@ -225,7 +416,7 @@ string CapabilitySysCallsAnalysis::stringifyFact(BitVector vector) {
   int idx = 0;
   for (int i=0; i<vector.count(); i++) {
     idx = (i == 0) ? vector.find_first() : vector.find_next(idx);
-    ss << ((i > 0) ? "," : "") << freeBSDSysCallProvider.getSysCall(idx);
+    ss << ((i > 0) ? "," : "") << sysCallProvider->getSysCall(idx);
   }
   ss << "]";
   return ss.str();
@@ -234,7 +425,7 @@ string CapabilitySysCallsAnalysis::stringifyFact(BitVector vector) {
 BitVector CapabilitySysCallsAnalysis::convertFunctionSetToBitVector(FunctionSet sysCalls) {
   BitVector vector;
   for (Function* F : sysCalls) {
-    int idx = freeBSDSysCallProvider.getIdx(F->getName());
+    int idx = sysCallProvider->getIdx(F);
     if (vector.size() <= idx) {
       vector.resize(idx+1);
     }
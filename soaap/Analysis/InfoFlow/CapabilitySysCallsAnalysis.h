@@ -4,7 +4,7 @@
 #include "Analysis/CFGFlow/SysCallsAnalysis.h"
 #include "Analysis/InfoFlow/InfoFlowAnalysis.h"
 #include "Common/Typedefs.h"
-#include "OS/FreeBSDSysCallProvider.h"
+#include "OS/SysCallProvider.h"
 #include "OS/Sandbox/SandboxPlatform.h"
 
 #include <string>
@@ -16,10 +16,10 @@ namespace soaap {
 
   class CapabilitySysCallsAnalysis : public InfoFlowAnalysis<BitVector> {
     public:
-      CapabilitySysCallsAnalysis(bool contextInsensitive, shared_ptr<SandboxPlatform>& platform, SysCallsAnalysis& analysis) : InfoFlowAnalysis<BitVector>(contextInsensitive, true), sandboxPlatform(platform), sysCallsAnalysis(analysis) { }
+      CapabilitySysCallsAnalysis(bool contextInsensitive, shared_ptr<SandboxPlatform>& platform, SysCallsAnalysis& analysis) : InfoFlowAnalysis<BitVector>(contextInsensitive, true), sysCallProvider(SysCallProvider::getProvider()), sandboxPlatform(platform), sysCallsAnalysis(analysis) { }
 
     protected:
-      FreeBSDSysCallProvider freeBSDSysCallProvider;
+      SysCallProvider* sysCallProvider;
       shared_ptr<SandboxPlatform> sandboxPlatform;
       SysCallsAnalysis& sysCallsAnalysis;
       map<int,BitVector> intFdToAllowedSysCalls;
@@ -30,7 +30,13 @@ namespace soaap {
       virtual bool performUnion(BitVector fromVal, BitVector& toVal);
       virtual BitVector bottomValue() { return BitVector(); }
       virtual string stringifyFact(BitVector fact);
+      virtual string getName() { return "capability-syscalls"; }
       virtual BitVector convertFunctionSetToBitVector(FunctionSet sysCalls);
+      void emitCapsicumRights(Module& M, SandboxVector& sandboxes);
+      Value* getFd(Value* fdArg);
+      void getOriginatingFds(Value* fd, Sandbox* S, Module& M, vector<Value*>& origins, ValueSet& visited);
+      Function* getFdFunction(Value* fd);
+      string getFdName(Value* fd);
 
   };
 }
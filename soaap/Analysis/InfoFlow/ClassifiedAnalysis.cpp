@@ -4,6 +4,7 @@
 #include "Util/DebugUtils.h"
 #include "Util/InstUtils.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "soaap.h"
 
@@ -63,6 +64,25 @@ void ClassifiedAnalysis::initialise(ValueContextPairList& worklist, Module& M, S
 
 }
 
+// The values read and written by sandboxed code (see postDataFlowAnalysis)
+bool ClassifiedAnalysis::findSinks(ValueSet& sinks, Module& M, SandboxVector& sandboxes) {
+  for (Sandbox* S : sandboxes) {
+    for (Function* F : S->getFunctions()) {
+      if (shouldOutputWarningFor(F)) {
+        for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+          if (LoadInst* load = dyn_cast<LoadInst>(&*I)) {
+            sinks.insert(load->getPointerOperand());
+          }
+          else if (StoreInst* store = dyn_cast<StoreInst>(&*I)) {
+            sinks.insert(store->getValueOperand());
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
 void ClassifiedAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes) {
   // validate that classified data is never accessed inside sandboxed contexts that
   // don't have clearance for its class.
@@ -136,6 +156,12 @@ bool ClassifiedAnalysis::performUnion(int from, int& to) {
   return to != oldTo;
 }
 
+// V may hold data of any class
+bool ClassifiedAnalysis::widen(const Value* V, int& fact) {
+  fact |= ClassifiedUtils::getAllClassNames();
+  return true;
+}
+
 string ClassifiedAnalysis::stringifyFact(int fact) {
   return ClassifiedUtils::stringifyClassNames(fact);
 }
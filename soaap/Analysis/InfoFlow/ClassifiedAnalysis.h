@@ -15,10 +15,13 @@ namespace soaap {
     protected:
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes);
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
+      virtual bool findSinks(ValueSet& sinks, Module& M, SandboxVector& sandboxes);
       virtual bool performMeet(int from, int& to);
       virtual bool performUnion(int from, int& to);
       virtual int bottomValue() { return 0; }
       virtual string stringifyFact(int fact);
+      virtual string getName() { return "classified"; }
+      virtual bool widen(const Value* V, int& fact);
   };
 }
 
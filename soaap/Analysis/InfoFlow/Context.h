@@ -1,14 +1,22 @@
 #ifndef SOAAP_ANALYSIS_INFOFLOW_CONTEXT_H
 #define SOAAP_ANALYSIS_INFOFLOW_CONTEXT_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 
+namespace llvm {
+  class CallInst;
+}
+
 namespace soaap {
   class Context {
     public:
       enum ContextKind {
         CK_CONTEXT,
-        CK_SANDBOX
+        CK_SANDBOX,
+        CK_CALLSTRING
       };
       ContextKind getKind() const { return Kind; }
       Context(ContextKind K) : Kind(K) { }
@@ -18,6 +26,31 @@ namespace soaap {
     private:
       const ContextKind Kind;
   };
+
+  // A sandbox (or privileged) context refined by the most recent call sites
+  // through which it was entered, innermost last. Call strings are hash-consed
+  // by ContextUtils, so two call-string contexts are equal iff they are the
+  // same object.
+  class CallStringContext : public Context, public llvm::FoldingSetNode {
+    public:
+      CallStringContext(Context* Base, llvm::ArrayRef<llvm::CallInst*> Calls)
+        : Context(CK_CALLSTRING), Base(Base), Calls(Calls.begin(), Calls.end()) { }
+      Context* getBase() const { return Base; }
+      llvm::ArrayRef<llvm::CallInst*> getCalls() const { return Calls; }
+      llvm::CallInst* getLastCall() const { return Calls.back(); }
+      void Profile(llvm::FoldingSetNodeID& ID) const { Profile(ID, Base, Calls); }
+      static void Profile(llvm::FoldingSetNodeID& ID, Context* Base, llvm::ArrayRef<llvm::CallInst*> Calls) {
+        ID.AddPointer(Base);
+        for (llvm::CallInst* C : Calls) {
+          ID.AddPointer(C);
+        }
+      }
+      static bool classof(const Context* C) { return C->getKind() == CK_CALLSTRING; }
+
+    private:
+      Context* Base;
+      llvm::SmallVector<llvm::CallInst*,4> Calls;
+  };
 }
 
 #endif
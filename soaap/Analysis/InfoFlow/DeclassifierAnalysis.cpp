@@ -25,12 +25,12 @@ void DeclassifierAnalysis::initialise(ValueContextPairList& worklist, Module& M,
             // at the moment we only handle allocas and not fields
             if (AllocaInst* alloca = dyn_cast<AllocaInst>(declassifiedLoad->getPointerOperand())) {
               // collect all instructions starting from the annotation to the end of the current function
-              findAllFollowingInstructions(call, alloca);
+              CodeRegion declassifiedRegion(call);
               // mark all loaded values of alloca within the declassified region
               // as being declassified (this will then propagate throughout the 
               // program)
               SDEBUG("soaap.analysis.infoflow.declassify", 3, dbgs() << "Declassified code region\n");
-              for (Instruction* I : valueToDeclassifiedRegion[alloca]) {
+              for (Instruction* I : declassifiedRegion.getInstructions()) {
                 SDEBUG("soaap.analysis.infoflow.declassify", 3, dbgs() << "I: " << *I << "\n");
                 if (LoadInst* L = dyn_cast<LoadInst>(I)) {
                   if (L->getPointerOperand() == alloca) {
@@ -52,26 +52,6 @@ void DeclassifierAnalysis::initialise(ValueContextPairList& worklist, Module& M,
   }
 }
 
-void DeclassifierAnalysis::findAllFollowingInstructions(Instruction* I, Value* V) {
-  BasicBlock* BB = I->getParent();
-  
-  // If I is not the start of BB, then fast-forward iterator to it
-  BasicBlock::iterator BI = BB->begin();
-  while (&*BI != I) { BI++; }
-
-  for (BasicBlock::iterator BE = BB->end(); BI != BE; BI++) {
-    I = &*BI;
-    SDEBUG("soaap.analysis.infoflow.declassify", 3, I->dump());
-    valueToDeclassifiedRegion[V].push_back(I);
-  }
-
-  // recurse on successor BBs
-  for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; SI++) {
-    BasicBlock* SBB = *SI;
-    findAllFollowingInstructions(SBB->begin(), V);
-  }
-}
-
 void DeclassifierAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes) {
   SDEBUG("soaap.analysis.infoflow.declassify", 3, dbgs() << "Finished declassifier analysis\n");
 }
@@ -2,6 +2,7 @@
 #define SOAAP_ANALYSIS_INFOFLOW_DECLASSIFIERANALYSIS_H
 
 #include "Analysis/InfoFlow/InfoFlowAnalysis.h"
+#include "Common/CodeRegion.h"
 #include "Common/Typedefs.h"
 
 #include <map>
@@ -17,14 +18,13 @@ namespace soaap {
       virtual bool isDeclassified(const Value* V);
 
     protected:
-      map<Value*, InstVector> valueToDeclassifiedRegion;
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes);
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
       virtual bool performMeet(bool from, bool& to);
       virtual bool performUnion(bool from, bool& to);
       virtual bool bottomValue() { return false; }
       virtual string stringifyFact(bool fact);
-      virtual void findAllFollowingInstructions(Instruction* I, Value* V);
+      virtual string getName() { return "declassifier"; }
   };
 }
 
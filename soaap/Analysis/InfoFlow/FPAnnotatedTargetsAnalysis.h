@@ -13,6 +13,7 @@ namespace soaap {
 
     protected:
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes);
+      virtual string getName() { return "fp-annotated-targets"; }
   };
 }
 
@@ -1,5 +1,6 @@
 #include "Analysis/InfoFlow/FPInferredTargetsAnalysis.h"
 #include "Util/DebugUtils.h"
+#include "Util/SliceUtils.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/DebugInfo.h"
@@ -30,7 +31,7 @@ void FPInferredTargetsAnalysis::initialise(ValueContextPairList& worklist, Modul
     long loadInsts = 0;
     long storeInsts = 0;
     long intrinsInsts = 0;
-    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    for (Function* F : SliceUtils::getFunctions(M)) {
       if (F->hasAddressTaken()) numAddFuncs++;
       bool hasFPcall = false;
       for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; I++) {
@@ -56,7 +57,7 @@ void FPInferredTargetsAnalysis::initialise(ValueContextPairList& worklist, Modul
       }
       numFuncs++;
     }
-    dbgs() << "Num of funcs (total): " << numFuncs << "\n";
+    dbgs() << "Num of funcs (in slice): " << numFuncs << "\n";
     dbgs() << "Num of funcs (w/ fp calls): " << numFPFuncs << "\n";
     dbgs() << "Num of funcs (addr. taken): " << numAddFuncs << "\n";
     dbgs() << "Num of fp calls: " << numFPcalls << "\n";
@@ -66,7 +67,7 @@ void FPInferredTargetsAnalysis::initialise(ValueContextPairList& worklist, Modul
     dbgs() << INDENT_1 << "intrinsics: " << intrinsInsts << "\n";
   }
   
-  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+  for (Function* F : SliceUtils::getFunctions(M)) {
     if (F->isDeclaration()) continue;
     SDEBUG("soaap.analysis.infoflow.fp.infer", 3, dbgs() << F->getName() << "\n");
     for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
@@ -77,17 +78,12 @@ void FPInferredTargetsAnalysis::initialise(ValueContextPairList& worklist, Modul
         if (Function* T = dyn_cast<Function>(Rval)) {
           fpTargetsUniv.insert(T);
           // we are assigning a function
-          Value* Lvar = S->getPointerOperand()->stripInBoundsConstantOffsets();
+          Value* Lvar = S->getPointerOperand()->stripPointerCasts();
           for (Context* C : contexts) {
             setBitVector(state[C][Lvar], T);
             SDEBUG("soaap.analysis.infoflow.fp.infer", 3, dbgs() << "Adding " << Lvar->getName() << " to worklist\n");
             addToWorklist(Lvar, C, worklist);
-
-            if (isa<GetElementPtrInst>(Lvar)) {
-              SDEBUG("soaap.analysis.infoflow.fp.infer", 3, dbgs() << "Rewinding back to alloca\n");
-              ValueSet visited;
-              propagateToAggregate(Lvar, C, Lvar, visited, worklist, sandboxes, M);
-            }
+            propagateToMemory(Lvar, C, Lvar, worklist, sandboxes, M);
           }
         }
       }
@@ -1,5 +1,6 @@
 #include "Analysis/InfoFlow/FPTargetsAnalysis.h"
 #include "Util/DebugUtils.h"
+#include "Util/SliceUtils.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -11,12 +12,17 @@ using namespace soaap;
 
 map<Function*,int> FPTargetsAnalysis::funcToIdx;
 map<int,Function*> FPTargetsAnalysis::idxToFunc;
+DenseMap<FunctionType*,BitVector> FPTargetsAnalysis::typeToFuncs;
 
 void FPTargetsAnalysis::initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes) {
+  indexFunctions(M);
+}
+
+void FPTargetsAnalysis::indexFunctions(Module& M) {
   // iniitalise funcToIdx and idxToFunc maps (once)
   if (funcToIdx.empty()) {
     int nextIdx = 0;
-    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    for (Function* F : SliceUtils::getFunctions(M)) {
       if (F->hasAddressTaken()) { // limit to only those funcs that could be fp targets
         SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "Adding " << F->getName() << " as address taken\n");
         funcToIdx[F] = nextIdx;
@@ -27,6 +33,14 @@ void FPTargetsAnalysis::initialise(ValueContextPairList& worklist, Module& M, Sa
         SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "Skipping " << F->getName() << " as address not taken\n");
       }
     }
+
+    // index the address-taken funcs by (canonical) type, so that the targets
+    // compatible with a function pointer can be found with a single AND
+    for (pair<Function*,int> p : funcToIdx) {
+      BitVector& funcs = typeToFuncs[getCanonicalType(p.first->getFunctionType())];
+      funcs.resize(nextIdx);
+      funcs.set(p.second);
+    }
   }
 }
 
@@ -85,34 +99,9 @@ string FPTargetsAnalysis::stringifyFact(BitVector fact) {
 void FPTargetsAnalysis::stateChangedForFunctionPointer(CallInst* CI, const Value* FP, Context* C, BitVector& newState) {
   // Filter out those callees that aren't compatible with FP's function type
   SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "bits set (before): " << newState.count() << "\n");
-  FunctionType* FT = NULL;
-  if (PointerType* PT = dyn_cast<PointerType>(FP->getType())) {
-    if (PointerType* PT2 = dyn_cast<PointerType>(PT->getElementType())) {
-      FT = dyn_cast<FunctionType>(PT2->getElementType());
-    }
-    else {
-      FT = dyn_cast<FunctionType>(PT->getElementType());
-    }
-  }
-  
+  FunctionType* FT = getFunctionType(FP);
   if (FT != NULL) {
-    int idx;
-    int numSetBits = newState.count();
-    for (int i=0; i<numSetBits; i++) {
-      idx = (i == 0) ? newState.find_first() : newState.find_next(idx);
-      Function* F = idxToFunc[idx];
-      SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "F: " << F->getName() << "\n");
-      SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "FT: " << *FT << "\n");
-      if (!areTypeCompatible(F->getFunctionType(), FT)) {
-        newState.reset(idx);
-        FunctionType* FT2 = F->getFunctionType();
-        SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "Function types don't match: " << *FT2 << "\n");
-        SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "FT2.return: " << *(FT2->getReturnType()) << "\n");
-        SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "FT2.params: " << FT2->getNumParams() << "\n");
-        SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "FT2.varargs: " << FT2->isVarArg() << "\n");
-        SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "FT.vararg: " << FT->isVarArg() << "\n");
-      }
-    }
+    newState &= getTypeCompatibleFuncs(FT);
   }
   else {
     dbgs() << "Unrecognised FP: " << *FP->getType() << "\n";
@@ -122,28 +111,54 @@ void FPTargetsAnalysis::stateChangedForFunctionPointer(CallInst* CI, const Value
   CallGraphUtils::addCallees(CI, C, newFuncs, true);
 }
 
+FunctionType* FPTargetsAnalysis::getFunctionType(const Value* FP) {
+  if (PointerType* PT = dyn_cast<PointerType>(FP->getType())) {
+    if (PointerType* PT2 = dyn_cast<PointerType>(PT->getElementType())) {
+      return dyn_cast<FunctionType>(PT2->getElementType());
+    }
+    return dyn_cast<FunctionType>(PT->getElementType());
+  }
+  return NULL;
+}
+
+// Two function types are compatible if they are the same, or if at least
+// one has varargs and they have the same return and parameter types. That
+// is, if they are the same once varargs are ignored.
+FunctionType* FPTargetsAnalysis::getCanonicalType(FunctionType* FT) {
+  if (!FT->isVarArg()) {
+    return FT;
+  }
+  return FunctionType::get(FT->getReturnType(), FT->params(), false);
+}
+
 bool FPTargetsAnalysis::areTypeCompatible(FunctionType* FT1, FunctionType* FT2) {
-  SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "checking " << *FT1 << " with " << *FT2 << "\n");
-  if (FT1 == FT2) {
-    SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "same\n");
-    return true;
+  return getCanonicalType(FT1) == getCanonicalType(FT2);
+}
+
+const BitVector& FPTargetsAnalysis::getTypeCompatibleFuncs(FunctionType* FT) {
+  static BitVector none;
+  DenseMap<FunctionType*,BitVector>::iterator I = typeToFuncs.find(getCanonicalType(FT));
+  return I == typeToFuncs.end() ? none : I->second;
+}
+
+FunctionSet FPTargetsAnalysis::getTypeCompatibleTargets(CallInst* CI) {
+  indexFunctions(*CI->getParent()->getParent()->getParent());
+  if (FunctionType* FT = getFunctionType(CI->getCalledValue())) {
+    return convertBitVectorToFunctionSet(getTypeCompatibleFuncs(FT));
   }
-  else if (FT1->isVarArg() || FT2->isVarArg()) {
-    // check return and parameter types
-    SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "at least one has varargs, checking return type and param types\n");
-    if (FT1->getReturnType() == FT2->getReturnType()
-           && FT1->getNumParams() == FT2->getNumParams()) {
-      int i=0;
-      for (Type* T : FT1->params()) {
-        if (T != FT1->getParamType(i)) {
-          SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "mismatch at index " << i << "\n");
-          return false;
-        }
-        i++;
-      }
-      return true;
-    }
+  return FunctionSet();
+}
+
+// V may point to any address-taken function compatible with its type, or
+// to any address-taken function at all if it does not have a function
+// pointer type (e.g. a struct holding function pointers)
+bool FPTargetsAnalysis::widen(const Value* V, BitVector& fact) {
+  if (FunctionType* FT = getFunctionType(V)) {
+    fact |= getTypeCompatibleFuncs(FT);
+  }
+  else {
+    fact.resize(funcToIdx.size());
+    fact.set();
   }
-  SDEBUG("soaap.analysis.infoflow.fp", 3, dbgs() << "not type compatible\n");
-  return false;
+  return true;
 }
@@ -5,6 +5,7 @@
 #include "Common/Typedefs.h"
 
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 
 using namespace llvm;
 
@@ -14,21 +15,31 @@ namespace soaap {
       FPTargetsAnalysis(bool contextInsens) : InfoFlowAnalysis<BitVector>(contextInsens, false) { }
       virtual FunctionSet getTargets(Value* FP, Context* C);
       virtual bool hasTargets() { return !state.empty(); } // TODO: should we be looking inside state?
+      // All address-taken funcs whose type is compatible with CI's called
+      // value (a fallback for when no targets are known).
+      FunctionSet getTypeCompatibleTargets(CallInst* CI);
+      // Number the address-taken funcs and index them by type (once).
+      static void indexFunctions(Module& M);
 
     protected:
       static map<Function*,int> funcToIdx;
       static map<int,Function*> idxToFunc;
+      static DenseMap<FunctionType*,BitVector> typeToFuncs;
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes) = 0;
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
       virtual bool performMeet(BitVector from, BitVector& to);
       virtual bool performUnion(BitVector from, BitVector& to);
       virtual BitVector bottomValue() { return BitVector(); }
       virtual string stringifyFact(BitVector fact);
+      virtual bool widen(const Value* V, BitVector& fact);
       virtual void stateChangedForFunctionPointer(CallInst* CI, const Value* FP, Context* C, BitVector& newState);
       virtual FunctionSet convertBitVectorToFunctionSet(BitVector vector);
       virtual BitVector convertFunctionSetToBitVector(FunctionSet funcs);
       virtual void setBitVector(BitVector& vector, Function* F);
       virtual bool areTypeCompatible(FunctionType* FT1, FunctionType* FT2);
+      static FunctionType* getFunctionType(const Value* FP);
+      static FunctionType* getCanonicalType(FunctionType* FT);
+      static const BitVector& getTypeCompatibleFuncs(FunctionType* FT);
   };
 }
 
@@ -6,6 +6,7 @@
 #include <unordered_map>
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Pass.h"
@@ -25,11 +26,16 @@
 #include "Analysis/InfoFlow/InfoFlowAnalysis.h"
 #include "Common/CmdLineOpts.h"
 #include "Common/Debug.h"
+#include "Common/XO.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/ContextUtils.h"
 #include "Util/DebugUtils.h"
 #include "Util/LLVMAnalyses.h"
+#include "Util/PointsToUtils.h"
 #include "Util/SandboxUtils.h"
+#include "Util/TaintUtils.h"
+#include "Util/ValueFlowUtils.h"
+#include "Util/WorklistUtils.h"
 
 using namespace std;
 using namespace llvm;
@@ -45,15 +51,29 @@ namespace soaap {
       typedef DenseMap<const Value*, FactType> DataflowFacts;
       typedef pair<const Value*, Context*> ValueContextPair;
       typedef QueueSet<ValueContextPair> ValueContextPairList;
-      InfoFlowAnalysis(bool c = false, bool m = false) : contextInsensitive(c), mustAnalysis(m) { }
+      InfoFlowAnalysis(bool c = false, bool m = false) : contextInsensitive(c), mustAnalysis(m), demandDriven(false), callStrings(false) { }
       virtual void doAnalysis(Module& M, SandboxVector& sandboxes);
 
     protected:
       map<Context*, DataflowFacts> state;
       bool contextInsensitive;
       bool mustAnalysis;
+      bool demandDriven;
+      bool callStrings;
       map<Function*,map<Context*,CallInstSet> > inContextCallers;
+      // Pointers whose facts all came from stores into fields of the objects
+      // they point to. The whole object (e.g. when passed to an extern
+      // function) carries those facts, but its other fields do not.
+      DenseSet<ValueContextPair> enclosingOnly;
+      DenseMap<ValueContextPair,unsigned> updateCounts;
+      DenseSet<const Value*> widenedValues;
+      map<string,int> widenedPerFunction;
+      string budgetExceeded;
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes) = 0;
+      // Add the values whose facts postDataFlowAnalysis checks to sinks. If
+      // an analysis returns true, then in demand-driven mode only values
+      // that may flow to one of its sinks are propagated.
+      virtual bool findSinks(ValueSet& sinks, Module& M, SandboxVector& sandboxes) { return false; }
       virtual void performDataFlowAnalysis(ValueContextPairList&, SandboxVector& sandboxes, Module& M);
       // performMeet: toVal = fromVal /\ toVal. return true <-> toVal != fromVal /\ toVal
       virtual bool performMeet(FactType fromVal, FactType& toVal) = 0;
@@ -68,17 +88,44 @@ namespace soaap {
       virtual FactType bottomValue() = 0;
       virtual string stringifyFact(FactType f) = 0;
       virtual string stringifyValue(const Value* V);
+      // Name of the analysis in reports of precision loss
+      virtual string getName() = 0;
       virtual void stateChangedForFunctionPointer(CallInst* CI, const Value* FP, Context* C, FactType& newState);
       virtual CallInstSet getCallersInContext(Function* callee, Context* C, SandboxVector& sandboxes, Module& M);
-      virtual void propagateToAggregate(const Value* V, Context* C, Value* Agg, ValueSet& visited, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M);
+      virtual void propagateToMemory(const Value* V, Context* C, const Value* Ptr, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M);
+      virtual void propagateToCallerArgs(const Value* V, Context* C, Value* Var, ValueSet& visited, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M);
+      virtual void foldCallStrings();
+      // Set fact to a conservative summary of every fact that V could have
+      // (e.g. all labels), so that it need not change again. Return false if
+      // the analysis has no such summary.
+      virtual bool widen(const Value* V, FactType& fact) { return false; }
+      virtual void noteUpdate(const Value* V, Context* C);
+      virtual bool widenValue(const Value* V, Context* C);
+      virtual void notePrecisionLoss();
   };
 
   template <class FactType>
   void InfoFlowAnalysis<FactType>::doAnalysis(Module& M, SandboxVector& sandboxes) {
-    ValueContextPairList worklist;
+    PointsToUtils::requirePointsTo(M);
+    ValueContextPairList worklist(CmdLineOpts::Worklist, [&M](const ValueContextPair& P) {
+      return WorklistUtils::getPriority(P.first, M);
+    });
+    if (CmdLineOpts::DemandDriven) {
+      ValueSet sinks;
+      if (findSinks(sinks, M, sandboxes)) {
+        TaintUtils::findValuesFlowingTo(sinks, M);
+        demandDriven = true;
+      }
+    }
+    // must analyses take the meet over all callers in a context, so they
+    // are not refined by call strings
+    callStrings = CmdLineOpts::CallStringDepth > 0 && !contextInsensitive && !mustAnalysis;
     initialise(worklist, M, sandboxes);
     performDataFlowAnalysis(worklist, sandboxes, M);
+    WorklistUtils::recordStats(worklist.getPolicy(), worklist.getNumEnqueued(), worklist.getNumDequeued());
+    WorklistUtils::recordWidened(widenedValues.size());
     postDataFlowAnalysis(M, sandboxes);
+    notePrecisionLoss();
   }
 
   template <typename FactType>
@@ -100,8 +147,21 @@ namespace soaap {
       }
     }
 
-    // perform propagation until fixed point is reached
+    // perform propagation until fixed point is reached. Once the run is
+    // over budget, the facts of every value on the worklist, and of every
+    // value updated from then on, are widened. A widened fact can't change
+    // again, so the fixed point is then reached quickly, and remains sound.
+    unsigned popped = 0;
     while (!worklist.empty()) {
+      string budget;
+      if (popped++ % 1024 == 0 && budgetExceeded.empty()
+          && WorklistUtils::isOverBudget(budget)) {
+        SDEBUG("soaap.analysis.infoflow", 1, dbgs() << INDENT_1 << "Over " << budget << " budget with " << worklist.size() << " values on the worklist, widening\n")
+        budgetExceeded = budget;
+        for (const ValueContextPair& Pending : worklist.getElements()) {
+          widenValue(Pending.first, Pending.second);
+        }
+      }
       ValueContextPair P = worklist.dequeue();
       const Value* V = P.first;
       Context* C = P.second;
@@ -109,14 +169,16 @@ namespace soaap {
       SDEBUG("soaap.analysis.infoflow", 3,
             dbgs() << "\n" << INDENT_1 << "Popped (" << stringifyValue(V) << ", "
                    << ContextUtils::stringifyContext(C) << ")\n"); 
+      EdgeRange R = ValueFlowUtils::getSuccessors(V);
       SDEBUG("soaap.analysis.infoflow", 3,
             dbgs() << INDENT_1 << "state[C][V]: " << stringifyFact(state[C][V]) << "\n" 
-                   << INDENT_2 << "Finding uses (" << V->getNumUses() << ")\n");
-      for (User* U : ((Value*)V)->users()) {
-        SDEBUG("soaap.analysis.infoflow" ,4, dbgs() << INDENT_3 << "Use: " << stringifyValue(U) << "\n")
-        const Value* V2 = NULL;
-        if (Constant* CS = dyn_cast<Constant>(U)) {
-          V2 = CS;
+                   << INDENT_2 << "Finding uses (" << (R.second - R.first) << ")\n");
+      for (unsigned i = R.first; i != R.second; i++) {
+        // copied, as visiting may add edges for other values
+        FlowEdge E = ValueFlowUtils::getEdge(i);
+        const Value* V2 = E.to;
+        Instruction* I = E.user;
+        if (E.kind == FlowConstant) {
           if (propagateToValue(V, V2, C, C, M, true)) { // propagate taint from (V,C) to (V2,C)
             SDEBUG("soaap.analysis.infoflow" , 3,
                   dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
@@ -124,81 +186,71 @@ namespace soaap {
                     << ", " << ContextUtils::stringifyContext(C) << ")\n");
             addToWorklist(V2, C, worklist);
           }
+          continue;
         }
-        else if (Instruction* I = dyn_cast<Instruction>(U)) {
-          SDEBUG("soaap.analysis.infoflow", 5, dbgs() << "Instruction\n");
-          if (C == ContextUtils::NO_CONTEXT) {
-            // update the taint value for the correct context and put the new pair on the worklist
-            ContextVector C2s = ContextUtils::getContextsForInstruction(I, contextInsensitive, sandboxes, M);
-            for (Context* C2 : C2s) {
-              SDEBUG("soaap.analysis.infoflow", 3,
-                  dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
-                    << ", " << ContextUtils::stringifyContext(C) << ") to (" << stringifyValue(V)
-                    << ", " << ContextUtils::stringifyContext(C2) << ")\n");
-              propagateToValue(V, V, C, C2, M, true); 
-              addToWorklist(V, C2, worklist);
-            }
+        if (I == NULL) {
+          continue;
+        }
+        SDEBUG("soaap.analysis.infoflow" ,4, dbgs() << INDENT_3 << "Use: " << stringifyValue(I) << "\n")
+        if (C == ContextUtils::NO_CONTEXT) {
+          // update the taint value for the correct context and put the new pair on the worklist
+          ContextVector C2s = ContextUtils::getContextsForInstruction(I, contextInsensitive, sandboxes, M);
+          for (Context* C2 : C2s) {
+            SDEBUG("soaap.analysis.infoflow", 3,
+                dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
+                  << ", " << ContextUtils::stringifyContext(C) << ") to (" << stringifyValue(V)
+                  << ", " << ContextUtils::stringifyContext(C2) << ")\n");
+            propagateToValue(V, V, C, C2, M, true); 
+            addToWorklist(V, C2, worklist);
           }
-          else if (ContextUtils::isInContext(I, C, contextInsensitive, sandboxes, M)) { // check if using instruction is in context C
-            SDEBUG("soaap.analysis.infoflow", 5, dbgs() << "in context\n");
-            if (StoreInst* SI = dyn_cast<StoreInst>(I)) {
-              SDEBUG("soaap.analysis.infoflow", 5, dbgs() << "store\n");
-              if (V == SI->getPointerOperand()) { // to avoid infinite looping
-                // TODO: Are we clobbering V's dataflow state?
-                continue;
-              }
-              V2 = SI->getPointerOperand();
-              SDEBUG("soaap.analysis.infoflow", 5, dbgs() << "obtained store pointer operand\n");
-            }
-            else if (IntrinsicInst* II = dyn_cast<IntrinsicInst>(I)) {
-              if (II->getIntrinsicID() == Intrinsic::ptr_annotation) { // covers llvm.ptr.annotation.p0i8
-                SDEBUG("soaap.analysis.infoflow", 4, II->dump());
-                V2 = II;
-              }
-            }
-            else if (CallInst* CI = dyn_cast<CallInst>(I)) {
-              // propagate to the callee(s)
-              SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_4 << "Call instruction; propagating to callees\n");
-              if (CallGraphUtils::isExternCall(CI)) { // no function body, so we approximate effects of known funcs
-                V2 = propagateForExternCall(CI, V);
-              }
-              else {
-                bool propagateAllArgs = false;
-                if (CI->getCalledValue() == V) {
-                  // subclasses might want to be informed when
-                  // the state of a function pointer changed
-                  SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_5 << "state changed for function pointer\n");
-                  stateChangedForFunctionPointer(CI, V, C, state[C][V]);
-                  
-                  // if callee information has changed, we should propagate all
-                  // args to callees in case this is the first time for some
-                  propagateAllArgs = true;
-                }
-                propagateToCallees(CI, V, C, propagateAllArgs, worklist, sandboxes, M);
-                continue;
-              }
-            }
-            else if (ReturnInst* RI = dyn_cast<ReturnInst>(I)) {
-              if (Value* RetVal = RI->getReturnValue()) {
-                SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_4 << "Return instruction; propagating to callers\n");
-                propagateToCallers(RI, RetVal, C, worklist, sandboxes, M);
-              }
-              continue;
+          continue;
+        }
+        if (E.kind == FlowNone || !ContextUtils::isInContext(I, C, contextInsensitive, sandboxes, M)) { // check if using instruction is in context C
+          continue;
+        }
+        switch (E.kind) {
+          case FlowCall: {
+            // propagate to the callee(s)
+            SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_4 << "Call instruction; propagating to callees\n");
+            CallInst* CI = cast<CallInst>(I);
+            bool propagateAllArgs = false;
+            if (CI->getCalledValue() == V) {
+              // subclasses might want to be informed when
+              // the state of a function pointer changed
+              SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_5 << "state changed for function pointer\n");
+              stateChangedForFunctionPointer(CI, V, ContextUtils::getBaseContext(C), state[C][V]);
+              
+              // if callee information has changed, we should propagate all
+              // args to callees in case this is the first time for some
+              propagateAllArgs = true;
             }
-            else if (I->isBinaryOp()) {
-              // The resulting value is a combination of its operands and we do not combine
-              // dataflow facts in this way. So we do not propagate the dataflow-value of V
-              // but actually set it to the bottom value.
-              SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_4 << "Binary operator, propagating bottom to " << *I << "\n");
-              state[C][I] = bottomValue();
-              addToWorklist(I, C, worklist);
+            propagateToCallees(CI, V, C, propagateAllArgs, worklist, sandboxes, M);
+            continue;
+          }
+          case FlowReturn:
+            SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_4 << "Return instruction; propagating to callers\n");
+            propagateToCallers(cast<ReturnInst>(I), V2, C, worklist, sandboxes, M);
+            continue;
+          case FlowBottom:
+            // The resulting value is a combination of its operands and we do not combine
+            // dataflow facts in this way. So we do not propagate the dataflow-value of V
+            // but actually set it to the bottom value.
+            SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_4 << "Binary operator, propagating bottom to " << *I << "\n");
+            state[C][I] = bottomValue();
+            addToWorklist(I, C, worklist);
+            continue;
+          case FlowField:
+            if (enclosingOnly.count(P)) {
+              // the facts were stored into one field, so need not be in this one
               continue;
             }
-            else if (PHINode* PHI = dyn_cast<PHINode>(I)) {
+            break;
+          case FlowMerge:
+            if (mustAnalysis) {
               // take the meet of all incoming values
-              if (mustAnalysis) {
-                FactType meet;
-                bool first = true;
+              FactType meet;
+              bool first = true;
+              if (PHINode* PHI = dyn_cast<PHINode>(I)) {
                 for (int i=0; i<PHI->getNumIncomingValues(); i++) {
                   Value* IV = PHI->getIncomingValue(i);
                   if (first) {
@@ -209,63 +261,53 @@ namespace soaap {
                     performMeet(state[C][IV], meet);
                   }
                 }
-                if (propagateToValue(meet, PHI, C, M)) {
-                  addToWorklist(PHI, C, worklist);
-                }
-              }
-              else {
-                V2 = PHI;
-              }
-            }
-            else if (SelectInst* SI = dyn_cast<SelectInst>(I)) {
-              if (mustAnalysis) {
-                Value* SV1 = SI->getTrueValue();
-                Value* SV2 = SI->getFalseValue();
-                FactType meet = state[C][SV1];
-                performMeet(state[C][SV2], meet);
-                if (propagateToValue(meet, SI, C, M)) {
-                  addToWorklist(SI, C, worklist);
-                }
               }
               else {
-                V2 = SI;
-              }
-            }
-            else {
-              //debugs() << "Unaccounted-for instruction: " << *I << "\n";
-              V2 = I; // this covers gep instructions
-            }
-            if (V2 != NULL) {
-              SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "V2: " << *V2 << "\n");
-            }
-            if (V2 != NULL && propagateToValue(V, V2, C, C, M, false)) { // propagate taint from (V,C) to (V2,C)
-              SDEBUG("soaap.analysis.infoflow", 3,
-                    dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
-                       << ", " << ContextUtils::stringifyContext(C) << ") to (" << stringifyValue(V2)
-                       << ", " << ContextUtils::stringifyContext(C) << ")\n");
-              addToWorklist(V2, C, worklist);
-
-              // special case for GEP (propagate to the aggregate, if we stored to it)
-              if (isa<StoreInst>(U) && isa<GetElementPtrInst>(V2)) {
-                SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_2 << "storing to GEP\n");
-                // rewind to the aggregate and propagate
-                ValueSet visited;
-                propagateToAggregate(V2, C, (Value*)V2, visited, worklist, sandboxes, M);
+                SelectInst* SI = cast<SelectInst>(I);
+                meet = state[C][SI->getTrueValue()];
+                performMeet(state[C][SI->getFalseValue()], meet);
               }
-              else if (CallInst* CI = dyn_cast<CallInst>(I)) {
-                if (CallGraphUtils::isExternCall(CI) && V2 != CI) {
-                  // propagating to one of the args, and not the return value. we propagate back
-                  // as much as possible
-                  ValueSet visited;
-                  propagateToAggregate(V2, C, (Value*)V2, visited, worklist, sandboxes, M);
-                }
+              if (propagateToValue(meet, I, C, M)) {
+                addToWorklist(I, C, worklist);
               }
+              continue;
             }
+            break;
+          case FlowExternCall:
+            // no function body, so we approximate effects of known funcs
+            V2 = propagateForExternCall(cast<CallInst>(I), V);
+            break;
+          default:
+            break;
+        }
+        if (V2 != NULL) {
+          SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "V2: " << *V2 << "\n");
+        }
+        if (V2 != NULL && propagateToValue(V, V2, C, C, M, false)) { // propagate taint from (V,C) to (V2,C)
+          SDEBUG("soaap.analysis.infoflow", 3,
+                dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
+                   << ", " << ContextUtils::stringifyContext(C) << ") to (" << stringifyValue(V2)
+                   << ", " << ContextUtils::stringifyContext(C) << ")\n");
+          addToWorklist(V2, C, worklist);
+
+          // the memory written to by a store, or by an extern call
+          // through one of its args, may also be read through other
+          // pointers
+          if (E.kind == FlowStore || (E.kind == FlowExternCall && V2 != I)) {
+            propagateToMemory(V2, C, V2, worklist, sandboxes, M);
           }
         }
       }
     }
 
+    if (callStrings) {
+      SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_1 << "Call-string contexts: " << ContextUtils::getNumCallStringContexts() << "\n")
+      foldCallStrings();
+    }
+
+    SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_1 << "Value-flow graph: " << ValueFlowUtils::getNumEdges() << " edges, "
+                                                << ValueFlowUtils::getNumMemoryEdges() << " memory edges\n")
+
     // unmerge contexts if this is a context-insensitive analysis
     if (contextInsensitive) {
       SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_1 << "Unmerging contexts\n");
@@ -282,116 +324,130 @@ namespace soaap {
 
   }
 
+  // Propagate V's fact to every pointer that may point to the memory that
+  // Ptr points to, to a field within it, or to an object enclosing it, so
+  // that loads through any of them see it, as does code using the enclosing
+  // object as a whole. Memory is modelled by PointsToUtils as allocation
+  // sites and the struct fields within them, so storing to one field of a
+  // struct does not reach loads of its other fields (see enclosingOnly).
   template<typename FactType>
-  void InfoFlowAnalysis<FactType>::propagateToAggregate(const Value* V, Context* C, Value* Agg, ValueSet& visited, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M) {
-    SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "Agg: " << *Agg << "\n");
-    Agg = Agg->stripInBoundsOffsets();
-    if (visited.count(Agg) == 0) {
-      visited.insert(Agg);
-      if (isa<AllocaInst>(Agg) || isa<GlobalVariable>(Agg) || isa<Argument>(Agg)) {
-        if (propagateToValue(V, Agg, C, C, M, true)) { 
-          SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_3 << "propagating to aggregate\n");
-          addToWorklist(Agg, C, worklist);
-        }
+  void InfoFlowAnalysis<FactType>::propagateToMemory(const Value* V, Context* C, const Value* Ptr, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M) {
+    EdgeRange R = ValueFlowUtils::getAliases(Ptr);
+    for (unsigned i = R.first; i != R.second; i++) {
+      MemoryEdge E = ValueFlowUtils::getMemoryEdge(i);
+      // aliases in other functions are propagated to in the contexts that
+      // they are in
+      ContextVector C2s;
+      if (C == ContextUtils::NO_CONTEXT || contextInsensitive || E.aliasInst == NULL || E.sameFunction) {
+        C2s.push_back(C);
       }
       else {
-        if (GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(Agg)) {
-          propagateToAggregate(V, C, gep->getPointerOperand(), visited, worklist, sandboxes, M);
+        C2s = ContextUtils::getContextsForInstruction(E.aliasInst, contextInsensitive, sandboxes, M);
+      }
+      for (Context* C2 : C2s) {
+        ValueContextPair P2 = make_pair(E.alias, C2);
+        bool onlyEnclosing = E.enclosing && (state[C2].find(E.alias) == state[C2].end() || enclosingOnly.count(P2));
+        bool changed = propagateToValue(V, E.alias, C, C2, M, true);
+        if (onlyEnclosing) {
+          enclosingOnly.insert(P2);
         }
-        else if (LoadInst* load = dyn_cast<LoadInst>(Agg)) {
-          propagateToAggregate(V, C, load->getPointerOperand(), visited, worklist, sandboxes, M);
+        if (changed) {
+          SDEBUG("soaap.analysis.infoflow", 3,
+                dbgs() << INDENT_4 << "Propagating (" << stringifyValue(V)
+                   << ", " << ContextUtils::stringifyContext(C) << ") to alias (" << stringifyValue(E.alias)
+                   << ", " << ContextUtils::stringifyContext(C2) << ")\n");
+          addToWorklist(E.alias, C2, worklist);
         }
-        else if (IntrinsicInst* intrins = dyn_cast<IntrinsicInst>(Agg)) {
-          if (intrins->getIntrinsicID() == Intrinsic::ptr_annotation) { // covers llvm.ptr.annotation.p0i8
-            propagateToAggregate(V, C, intrins->getArgOperand(0), visited, worklist, sandboxes, M);
-          }
-          else {
-            SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "WARNING: unexpected intrinsic instruction: " << *Agg << "\n");
-          }
-        }
-        else if (CallInst* call = dyn_cast<CallInst>(Agg)) {
-          // in this case, we need to rewind back to the local/global Value*
-          // that flows to the return value of call's callee. This would
-          // involve doing more information flow analysis. However, for now
-          // we hardcode the specific cases:
-          //TODO: replace!
-          if (Function* F = call->getCalledFunction()) {
-            if (F->getName() == "buffer_ptr") {
-              propagateToAggregate(V, C, call->getArgOperand(0), visited, worklist, sandboxes, M);
+      }
+    }
+  }
+
+  // If Var is a parameter (or the local variable holding one), propagate V's
+  // fact back to the corresponding args of its callers, and so on up the
+  // call graph.
+  template<typename FactType>
+  void InfoFlowAnalysis<FactType>::propagateToCallerArgs(const Value* V, Context* C, Value* Var, ValueSet& visited, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M) {
+    Var = Var->stripInBoundsOffsets();
+    if (LoadInst* load = dyn_cast<LoadInst>(Var)) {
+      Var = load->getPointerOperand()->stripInBoundsOffsets();
+    }
+    if (visited.count(Var) != 0) {
+      return;
+    }
+    visited.insert(Var);
+    if (propagateToValue(V, Var, C, C, M, true)) {
+      addToWorklist(Var, C, worklist);
+    }
+
+    Argument* A = dyn_cast<Argument>(Var);
+    Function* enclosingFunc = (A == NULL) ? NULL : A->getParent();
+    if (A == NULL) { // if Var is an AllocaInst then obtain the corresponding param
+      if (AllocaInst* AI = dyn_cast<AllocaInst>(Var)) {
+        if (DbgDeclareInst* dbgDecl = FindAllocaDbgDeclare(AI)) {
+          enclosingFunc = AI->getParent()->getParent();
+          DIVariable varDbg(dbgDecl->getVariable());
+          int argNum = varDbg.getArgNumber(); // arg nums start from 1
+          if (argNum > 0) {
+            // Var is a param
+            string argName = varDbg.getName().str();
+            for (Argument &arg : enclosingFunc->getArgumentList()) {
+              if (arg.getName().str() == argName) {
+                A = &arg;
+                break;
+              }
             }
           }
-          else {
-            SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "WARNING: unexpected call instruction: " << *Agg << "\n");
-          }
-        }
-        else if (SelectInst* select = dyn_cast<SelectInst>(Agg)) {
-          propagateToAggregate(V, C, select->getTrueValue(), visited, worklist, sandboxes, M);
-          propagateToAggregate(V, C, select->getFalseValue(), visited, worklist, sandboxes, M);
-        }
-        else if (PHINode* phi = dyn_cast<PHINode>(Agg)) {
-          for (int i=0; i<phi->getNumIncomingValues(); i++) {
-            propagateToAggregate(V, C, phi->getIncomingValue(i), visited, worklist, sandboxes, M);
-          }
-        }
-        else {
-          SDEBUG("soaap.analysis.infoflow", 4,
-                dbgs() << "WARNING: unexpected value: " << *Agg << "\n"
-                       << "Value type: " << Agg->getValueID() << "\n");
-        }
-        // propagate to this Value*
-        if (propagateToValue(V, Agg, C, C, M, true)) { 
-          addToWorklist(Agg, C, worklist);
         }
       }
-      
-      // if Agg is a struct parameter, then it probably outlives this function and
-      // so we should propagate the targets of function pointers it contains to the 
-      // calling context (i.e. to the corresponding caller's arg value)
-      //TODO: how do we know A is specifically a struct parameter?
-      Argument* A = dyn_cast<Argument>(Agg);
-      Function* enclosingFunc = (A == NULL) ? NULL : A->getParent();
-      if (A == NULL) { // if Agg is an AllocaInst then obtain the corresponding 
-        if (AllocaInst* AI = dyn_cast<AllocaInst>(Agg)) {
-          if (DbgDeclareInst* dbgDecl = FindAllocaDbgDeclare(AI)) {
-            enclosingFunc = AI->getParent()->getParent();
-            DIVariable varDbg(dbgDecl->getVariable());
-            int argNum = varDbg.getArgNumber(); // arg nums start from 1
-            if (argNum > 0) {
-              // Agg is a param 
-              string argName = varDbg.getName().str();
-              for (Argument &arg : enclosingFunc->getArgumentList()) {
-                if (arg.getName().str() == argName) {
-                  A = &arg;
-                  break;
-                }
-              }
-            }
+    }
+    if (A != NULL) {
+      // we found the param index, propagate back to all caller args
+      int argIdx = A->getArgNo();
+      for (CallInst* caller : CallGraphUtils::getCallers(enclosingFunc, ContextUtils::getBaseContext(C), M)) {
+        ContextVector callerContexts = ContextUtils::getContextsForInstruction(caller, contextInsensitive, sandboxes, M);
+        Value* arg = caller->getArgOperand(argIdx);
+        SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_2 << "Adding arg " << *arg << " to worklist\n");
+        for (Context* C2 : callerContexts) {
+          if (propagateToValue(V, arg, C, C2, M, true)) {
+            addToWorklist(arg, C2, worklist);
           }
+          propagateToCallerArgs(arg, C2, arg, visited, worklist, sandboxes, M);
         }
       }
-      if (A != NULL) {
-        // we found the param index, propagate back to all caller args
-        int argIdx = A->getArgNo();
-        for (CallInst* caller : CallGraphUtils::getCallers(enclosingFunc, C, M)) {
-          ContextVector callerContexts = ContextUtils::getContextsForInstruction(caller, contextInsensitive, sandboxes, M);
-          Value* arg = caller->getArgOperand(argIdx);
-          Function* callerFunc = caller->getParent()->getParent();
-          //debugs() << "Propagating arg " << *A << " to caller " << callerFunc->getName() << "\n";
-          SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_2 << "Adding arg " << *arg << " to worklist\n");
-          for (Context* C2 : callerContexts) {
-            //TODO:
-            if (propagateToValue(V, arg, C, C2, M, true)) {
-              addToWorklist(arg, C2, worklist);
-            }
-            propagateToAggregate(arg, C2, arg, visited, worklist, sandboxes, M);
+    }
+  }
+
+  // Merge the facts found in each call-string context into its sandbox (or
+  // privileged) context, which is what the call graph and subclasses'
+  // postDataFlowAnalysis are keyed by.
+  template <typename FactType>
+  void InfoFlowAnalysis<FactType>::foldCallStrings() {
+    for (typename map<Context*,DataflowFacts>::iterator I=state.begin(); I != state.end(); ) {
+      if (CallStringContext* CS = dyn_cast<CallStringContext>(I->first)) {
+        DataflowFacts& baseFacts = state[CS->getBase()];
+        for (typename DataflowFacts::iterator DI=I->second.begin(), DE=I->second.end(); DI != DE; DI++) {
+          typename DataflowFacts::iterator BI = baseFacts.find(DI->first);
+          if (BI == baseFacts.end()) {
+            baseFacts[DI->first] = DI->second;
+          }
+          else {
+            performUnion(DI->second, BI->second);
           }
         }
+        state.erase(I++);
+      }
+      else {
+        I++;
       }
     }
   }
 
   template <typename FactType>
   void InfoFlowAnalysis<FactType>::addToWorklist(const Value* V, Context* C, ValueContextPairList& worklist) {
+    if (demandDriven && !TaintUtils::mayFlowToSink(V)) {
+      // V's fact cannot reach any value that will be checked
+      return;
+    }
     ValueContextPair P = make_pair(V, C);
     worklist.enqueue(P);
   }
@@ -402,7 +458,22 @@ namespace soaap {
     bool result = false;
     FactType toState;
 
-    if (state[cTo].find(to) == state[cTo].end()) {
+    // a value reached from one that is only enclosing is too, unless it
+    // already had facts of its own
+    bool fresh = state[cTo].find(to) == state[cTo].end();
+    if (!enclosingOnly.empty()) {
+      ValueContextPair P = make_pair(to, cTo);
+      if (enclosingOnly.count(make_pair(from, cFrom))) {
+        if (fresh) {
+          enclosingOnly.insert(P);
+        }
+      }
+      else if (enclosingOnly.erase(P)) {
+        result = true; // its fields must now be revisited
+      }
+    }
+
+    if (fresh) {
       state[cTo][to] = state[cFrom][from];
       SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "fromVal: " << stringifyFact(state[cFrom][from]) << ", old toVal: [], new toVal: " << stringifyFact(state[cTo][to]) << "\n");
       result = true; // return true to allow state to propagate through
@@ -413,10 +484,10 @@ namespace soaap {
       //state[cTo][to] = performMeet(state[cFrom][from], old);
       toState = state[cTo][to];
       if (additive) {
-        result = performUnion(state[cFrom][from], state[cTo][to]);
+        result |= performUnion(state[cFrom][from], state[cTo][to]);
       }
       else {
-        result = performMeet(state[cFrom][from], state[cTo][to]);
+        result |= performMeet(state[cFrom][from], state[cTo][to]);
       }
     }
     if (result) {
@@ -424,6 +495,7 @@ namespace soaap {
                                                   << *from << " " << stringifyFact(state[cFrom][from]) << "\n"
                                                   << INDENT_2 << " -> "
                                                   << *to << " " << stringifyFact(toState) << ", " << stringifyFact(state[cTo][to]) << "\n");
+      noteUpdate(to, cTo);
     }
     return result;
   }
@@ -432,7 +504,59 @@ namespace soaap {
   bool InfoFlowAnalysis<FactType>::propagateToValue(FactType fact, const Value* to, Context* C, Module& M) {
     FactType oldFact = state[C][to];
     state[C][to] = fact;
-    return oldFact != fact;
+    if (oldFact != fact) {
+      noteUpdate(to, C);
+      return true;
+    }
+    return false;
+  }
+
+  // Widen V's fact in context C once it has changed -soaap-widen-after
+  // times, or as soon as it changes once the run is over budget.
+  template <typename FactType>
+  void InfoFlowAnalysis<FactType>::noteUpdate(const Value* V, Context* C) {
+    int threshold = budgetExceeded.empty() ? CmdLineOpts::WidenAfter : 1;
+    if (threshold <= 0) {
+      return;
+    }
+    unsigned& updates = updateCounts[make_pair(V, C)];
+    if (++updates >= (unsigned)threshold) {
+      widenValue(V, C);
+    }
+  }
+
+  template <typename FactType>
+  bool InfoFlowAnalysis<FactType>::widenValue(const Value* V, Context* C) {
+    if (!widen(V, state[C][V])) {
+      return false;
+    }
+    SDEBUG("soaap.analysis.infoflow", 3, dbgs() << INDENT_4 << "Widened (" << stringifyValue(V) << ", "
+                                                << ContextUtils::stringifyContext(C) << ") to "
+                                                << stringifyFact(state[C][V]) << "\n")
+    if (widenedValues.insert(V).second) {
+      string funcName;
+      if (const Instruction* I = dyn_cast<Instruction>(V)) {
+        funcName = I->getParent()->getParent()->getName().str();
+      }
+      else if (const Argument* A = dyn_cast<Argument>(V)) {
+        funcName = A->getParent()->getName().str();
+      }
+      widenedPerFunction[funcName]++;
+    }
+    return true;
+  }
+
+  // Note where widening (see noteUpdate) or running over budget lost
+  // precision, for the report at the end of the run. Running over budget
+  // only loses precision if the analysis could widen something.
+  template <typename FactType>
+  void InfoFlowAnalysis<FactType>::notePrecisionLoss() {
+    if (!budgetExceeded.empty() && !widenedValues.empty()) {
+      WorklistUtils::noteOverBudget(getName(), budgetExceeded);
+    }
+    for (pair<const string,int>& p : widenedPerFunction) {
+      WorklistUtils::noteWidened(getName(), p.first, p.second);
+    }
   }
 
   template <typename FactType>
@@ -441,7 +565,7 @@ namespace soaap {
     SDEBUG("soaap.analysis.infoflow", 4, dbgs() << "Call instruction: " << *CI << "\n"
               << "Calling-context C: " << ContextUtils::stringifyContext(C) << "\n");
 
-    FunctionSet callees = CallGraphUtils::getCallees(CI, C, M);
+    FunctionSet callees = CallGraphUtils::getCallees(CI, ContextUtils::getBaseContext(C), M);
     SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_5 << "callees: " << CallGraphUtils::stringifyFunctionSet(callees) << "\n");
     
     DataflowFacts& contextFacts = state[C];
@@ -450,6 +574,10 @@ namespace soaap {
         for (Function* callee : callees) {
           if (callee->isDeclaration()) continue;
           Context* C2 = ContextUtils::calleeContext(C, contextInsensitive, callee, sandboxes, M);
+          if (callStrings && C2 == C) {
+            // the callee runs in the same sandbox (or privileged) context
+            C2 = ContextUtils::pushCallString(C, CI);
+          }
           SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_5 << "Propagating to callee " << callee->getName() << "\n"
                     << INDENT_6 << "Callee-context C2: " << ContextUtils::stringifyContext(C2) << "\n");
           Function::ArgumentListType& params = callee->getArgumentList();
@@ -558,7 +686,7 @@ namespace soaap {
   template <typename FactType>
   void InfoFlowAnalysis<FactType>::propagateToCallers(ReturnInst* RI, const Value* V, Context* C, ValueContextPairList& worklist, SandboxVector& sandboxes, Module& M) {
     Function* F = RI->getParent()->getParent();
-    for (CallInst* CI : CallGraphUtils::getCallers(F, C, M)) {
+    for (CallInst* CI : CallGraphUtils::getCallers(F, ContextUtils::getBaseContext(C), M)) {
       SDEBUG("soaap.analysis.infoflow", 4, dbgs() << INDENT_5 << "Propagating to caller " << stringifyValue(CI));
       ContextVector C2s = ContextUtils::callerContexts(RI, CI, C, contextInsensitive, sandboxes, M);
       for (Context* C2 : C2s) {
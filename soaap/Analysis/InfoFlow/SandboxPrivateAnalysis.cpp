@@ -6,6 +6,7 @@
 #include "Util/SandboxUtils.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
 #include "soaap.h"
 
 using namespace soaap;
@@ -46,6 +47,45 @@ void SandboxPrivateAnalysis::initialise(ValueContextPairList& worklist, Module&
 
 }
 
+// The values that postDataFlowAnalysis checks: those read by privileged or
+// sandboxed code and those that may leak out of a sandbox.
+bool SandboxPrivateAnalysis::findSinks(ValueSet& sinks, Module& M, SandboxVector& sandboxes) {
+  for (Function* F : privilegedMethods) {
+    if (shouldOutputWarningFor(F)) {
+      for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+        if (LoadInst* load = dyn_cast<LoadInst>(&*I)) {
+          sinks.insert(load->getPointerOperand()->stripPointerCasts());
+        }
+      }
+    }
+  }
+  for (Sandbox* S : sandboxes) {
+    for (Function* F : S->getFunctions()) {
+      if (shouldOutputWarningFor(F)) {
+        for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+          if (LoadInst* load = dyn_cast<LoadInst>(&*I)) {
+            sinks.insert(load->getPointerOperand()->stripPointerCasts());
+          }
+          else if (StoreInst* store = dyn_cast<StoreInst>(&*I)) {
+            sinks.insert(store->getValueOperand());
+          }
+          else if (CallInst* call = dyn_cast<CallInst>(&*I)) {
+            for (Use& U : call->operands()) {
+              sinks.insert(U.get());
+            }
+          }
+          else if (ReturnInst* ret = dyn_cast<ReturnInst>(&*I)) {
+            if (Value* retVal = ret->getReturnValue()) {
+              sinks.insert(retVal);
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
 void SandboxPrivateAnalysis::postDataFlowAnalysis(Module& M, SandboxVector& sandboxes) {
   XO::open_list("private_access");
   // validate that sandbox-private data is never accessed in other contexts
@@ -368,6 +408,12 @@ bool SandboxPrivateAnalysis::performUnion(int from, int& to) {
   return to != oldTo;
 }
 
+// V may hold data private to any sandbox
+bool SandboxPrivateAnalysis::widen(const Value* V, int& fact) {
+  fact |= SandboxUtils::getAllSandboxNames();
+  return true;
+}
+
 string SandboxPrivateAnalysis::stringifyFact(int fact) {
   return SandboxUtils::stringifySandboxNames(fact);
 }
@@ -16,11 +16,14 @@ namespace soaap {
     protected:
       virtual void initialise(ValueContextPairList& worklist, Module& M, SandboxVector& sandboxes);
       virtual void postDataFlowAnalysis(Module& M, SandboxVector& sandboxes);
+      virtual bool findSinks(ValueSet& sinks, Module& M, SandboxVector& sandboxes);
       virtual bool propagateToValue(const Value* from, const Value* to, Context* cFrom, Context* cTo, Module& M);
       virtual bool performMeet(int from, int& to);
       virtual bool performUnion(int from, int& to);
       virtual int bottomValue() { return 0; }
       virtual string stringifyFact(int fact);
+      virtual string getName() { return "sandbox-private"; }
+      virtual bool widen(const Value* V, int& fact);
 
     private:
       FunctionSet privilegedMethods;
@@ -0,0 +1,313 @@
+#include "Analysis/QueryAnalysis.h"
+
+#include "Common/Debug.h"
+#include "Common/XO.h"
+#include "Util/CallGraphUtils.h"
+#include "Util/ClassifiedUtils.h"
+#include "Util/DebugUtils.h"
+#include "Util/InstUtils.h"
+#include "Util/PointsToUtils.h"
+#include "Util/SandboxUtils.h"
+#include "Util/SliceUtils.h"
+#include "Util/TaintUtils.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/raw_ostream.h"
+#include "soaap.h"
+
+#include <map>
+
+using namespace soaap;
+
+SandboxVector QueryAnalysis::getSandboxesReaching(Function* F) {
+  return SandboxUtils::getSandboxesContainingMethod(F, sandboxes);
+}
+
+FunctionSet QueryAnalysis::getSysCalls(Sandbox* S) {
+  FunctionSet sysCalls;
+  for (CallInst* C : S->getCalls()) {
+    for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
+      if (sysCallProvider->isSysCall(Callee)) {
+        sysCalls.insert(Callee);
+      }
+    }
+  }
+  return sysCalls;
+}
+
+FdUseVector QueryAnalysis::getFdUses(Sandbox* S) {
+  FdUseVector uses;
+  for (CallInst* C : S->getCalls()) {
+    for (Function* Callee : CallGraphUtils::getCallees(C, S, M)) {
+      int idx = sysCallProvider->getIdx(Callee);
+      if (idx == -1 || !sysCallProvider->hasFdArg(idx)) {
+        continue;
+      }
+      unsigned fdArgIdx = sysCallProvider->getFdArgIdx(idx);
+      if (fdArgIdx < C->getNumArgOperands()) {
+        FdUse use = { C->getArgOperand(fdArgIdx), C, Callee };
+        uses.push_back(use);
+      }
+    }
+  }
+  return uses;
+}
+
+void QueryAnalysis::findClassifiedSources() {
+  if (foundClassifiedSources) {
+    return;
+  }
+  foundClassifiedSources = true;
+
+  // As ClassifiedAnalysis::initialise: annotated local variables and fields
+  // are annotated using llvm.ptr.annotation, and global variables in
+  // llvm.global.annotations
+  if (Function* F = M.getFunction("llvm.ptr.annotation.p0i8")) {
+    for (User* U : F->users()) {
+      if (IntrinsicInst* annotateCall = dyn_cast<IntrinsicInst>(U)) {
+        if (GlobalVariable* annotationStrVar = dyn_cast<GlobalVariable>(annotateCall->getOperand(1)->stripPointerCasts())) {
+          if (ConstantDataArray* annotationStrValArray = dyn_cast<ConstantDataArray>(annotationStrVar->getInitializer())) {
+            addClassifiedSource(annotateCall->getOperand(0)->stripPointerCasts(), annotationStrValArray->getAsCString());
+          }
+        }
+      }
+    }
+  }
+  if (GlobalVariable* lga = M.getNamedGlobal("llvm.global.annotations")) {
+    if (ConstantArray* lgaArray = dyn_cast<ConstantArray>(lga->getInitializer()->stripPointerCasts())) {
+      for (Use& U : lgaArray->operands()) {
+        ConstantStruct* lgaArrayElement = dyn_cast<ConstantStruct>(U.get());
+        if (lgaArrayElement == NULL) {
+          continue;
+        }
+        GlobalVariable* annotatedVar = dyn_cast<GlobalVariable>(lgaArrayElement->getOperand(0)->stripPointerCasts());
+        GlobalVariable* annotationStrVar = dyn_cast<GlobalVariable>(lgaArrayElement->getOperand(1)->stripPointerCasts());
+        if (annotatedVar && annotationStrVar) {
+          if (ConstantDataArray* annotationStrArray = dyn_cast<ConstantDataArray>(annotationStrVar->getInitializer())) {
+            addClassifiedSource(annotatedVar, annotationStrArray->getAsCString());
+          }
+        }
+      }
+    }
+  }
+}
+
+void QueryAnalysis::addClassifiedSource(Value* V, StringRef annotation) {
+  if (annotation.startswith(CLASSIFY)) {
+    StringRef className = annotation.substr(strlen(CLASSIFY)+1); //+1 because of _
+    ClassifiedUtils::assignBitIdxToClassName(className);
+    classifiedSources[V] |= (1 << ClassifiedUtils::getBitIdxFromClassName(className));
+  }
+}
+
+// Walks backwards from V over the values that can flow to it (see
+// TaintUtils::getPredecessors). Only this backward slice of V is visited,
+// rather than propagating forwards from every classified source.
+int QueryAnalysis::getClassificationsReaching(Value* V) {
+  DenseMap<const Value*,int>::iterator CI = classificationsCache.find(V);
+  if (CI != classificationsCache.end()) {
+    return CI->second;
+  }
+  findClassifiedSources();
+  PointsToUtils::requirePointsTo(M);
+
+  int classes = 0;
+  SmallPtrSet<const Value*,32> visited;
+  SmallVector<Value*,32> worklist;
+  worklist.push_back(V);
+  while (!worklist.empty()) {
+    Value* Curr = worklist.pop_back_val();
+    if (!visited.insert(Curr).second) {
+      continue;
+    }
+    DenseMap<const Value*,int>::iterator SI = classifiedSources.find(Curr);
+    if (SI != classifiedSources.end()) {
+      classes |= SI->second;
+    }
+    TaintUtils::getPredecessors(Curr, worklist, M);
+  }
+
+  classificationsCache[V] = classes;
+  return classes;
+}
+
+InstVector QueryAnalysis::findInstructionsAt(StringRef file, unsigned line) {
+  InstVector insts;
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      if (MDNode* N = I->getMetadata("dbg")) {
+        DILocation Loc(N);
+        if (Loc.getLineNumber() == line && Loc.getFilename().endswith(file)) {
+          insts.push_back(&*I);
+        }
+      }
+    }
+  }
+  return insts;
+}
+
+void QueryAnalysis::answer(StringRef query) {
+  pair<StringRef,StringRef> kindAndArg = query.split(':');
+  StringRef kind = kindAndArg.first;
+  StringRef arg = kindAndArg.second;
+  XO::open_instance("query");
+  XO::emit("Query \"{:query/%s}\":\n", query.str().c_str());
+  if (kind == "sandboxes") {
+    answerSandboxes(arg);
+  }
+  else if (kind == "syscalls") {
+    answerSysCalls(arg);
+  }
+  else if (kind == "classified") {
+    answerClassified(arg);
+  }
+  else if (kind == "path") {
+    answerPath(arg);
+  }
+  else {
+    XO::emit(" {:error/unknown query kind}\n");
+    errs() << "WARNING: unknown query kind \"" << kind << "\" (expected sandboxes, syscalls, classified or path)\n";
+  }
+  XO::emit("\n");
+  XO::close_instance("query");
+}
+
+void QueryAnalysis::answerSandboxes(StringRef funcName) {
+  Function* F = lookupFunction(funcName);
+  if (F == NULL) {
+    return;
+  }
+  SandboxVector reaching = getSandboxesReaching(F);
+  XO::emit(" Function \"{:function/%s}\" can run in {:num_sandboxes/%d} sandbox(es)\n",
+           F->getName().str().c_str(), (int)reaching.size());
+  XO::open_list("sandbox");
+  for (Sandbox* S : reaching) {
+    XO::open_instance("sandbox");
+    XO::emit("   {:name/%s}\n", S->getName().c_str());
+    XO::close_instance("sandbox");
+  }
+  XO::close_list("sandbox");
+  if (SandboxUtils::isPrivilegedMethod(F, M)) {
+    XO::emit(" It can also run with privileges{e:privileged/%s}\n", "true");
+  }
+}
+
+void QueryAnalysis::answerSysCalls(StringRef sandboxName) {
+  Sandbox* S = lookupSandbox(sandboxName);
+  if (S == NULL) {
+    return;
+  }
+
+  // order by name, so that answers are stable
+  map<string,Function*> sysCalls;
+  for (Function* F : getSysCalls(S)) {
+    sysCalls[F->getName()] = F;
+  }
+  XO::emit(" Sandbox \"{:sandbox/%s}\" performs {:num_syscalls/%d} system call(s):\n",
+           S->getName().c_str(), (int)sysCalls.size());
+  XO::open_list("syscall");
+  for (pair<const string,Function*>& p : sysCalls) {
+    XO::open_instance("syscall");
+    XO::emit("   {:name/%s}\n", p.first.c_str());
+    XO::close_instance("syscall");
+  }
+  XO::close_list("syscall");
+
+  XO::emit(" File descriptors used:\n");
+  XO::open_list("fd");
+  for (FdUse& use : getFdUses(S)) {
+    Value* fd = use.fd->stripPointerCasts();
+    if (LoadInst* L = dyn_cast<LoadInst>(fd)) {
+      fd = L->getPointerOperand()->stripPointerCasts();
+    }
+    string name = fd->hasName() ? fd->getName().str() : "<unnamed>";
+    if (isa<Constant>(fd) && !isa<GlobalValue>(fd)) {
+      raw_string_ostream ss(name);
+      name = "";
+      fd->printAsOperand(ss, false);
+      ss.flush();
+    }
+    XO::open_instance("fd");
+    XO::emit("   \"{:name/%s}\" passed to {:syscall/%s}\n",
+             name.c_str(), use.sysCall->getName().str().c_str());
+    InstUtils::emitInstLocation(use.call);
+    XO::close_instance("fd");
+  }
+  XO::close_list("fd");
+}
+
+void QueryAnalysis::answerClassified(StringRef location) {
+  pair<StringRef,StringRef> fileAndLine = location.rsplit(':');
+  unsigned line;
+  if (fileAndLine.second.getAsInteger(10, line)) {
+    XO::emit(" {:error/expected <file>:<line>}\n");
+    errs() << "WARNING: expected <file>:<line> but got \"" << location << "\"\n";
+    return;
+  }
+  InstVector insts = findInstructionsAt(fileAndLine.first, line);
+  if (insts.empty()) {
+    XO::emit(" {:error/no instructions found}\n");
+    return;
+  }
+  int classes = 0;
+  for (Instruction* I : insts) {
+    classes |= getClassificationsReaching(I);
+  }
+  XO::emit(" Classified data that can flow to line {:line/%d} of file {:file/%s}: {d:data_classes/%s}\n",
+           line, fileAndLine.first.str().c_str(),
+           classes ? ClassifiedUtils::stringifyClassNames(classes).c_str() : "none");
+  XO::open_list("data_class");
+  for (string className : ClassifiedUtils::convertNamesToVector(classes)) {
+    XO::open_instance("data_class");
+    XO::emit("{e:name/%s}", className.c_str());
+    XO::close_instance("data_class");
+  }
+  XO::close_list("data_class");
+}
+
+void QueryAnalysis::answerPath(StringRef arg) {
+  Sandbox* S = NULL;
+  StringRef funcName = arg;
+  if (arg.count(':') > 0) {
+    pair<StringRef,StringRef> sandboxAndFunc = arg.split(':');
+    S = lookupSandbox(sandboxAndFunc.first);
+    if (S == NULL) {
+      return;
+    }
+    funcName = sandboxAndFunc.second;
+  }
+  Function* F = lookupFunction(funcName);
+  if (F == NULL) {
+    return;
+  }
+  if (S ? !S->containsFunction(F) : !SandboxUtils::isPrivilegedMethod(F, M)) {
+    XO::emit(" \"{:function/%s}\" is not reachable {d:context/%s}\n",
+             F->getName().str().c_str(),
+             S ? ("in sandbox \"" + S->getName() + "\"").c_str() : "with privileges");
+    return;
+  }
+  XO::emit(" Shortest path to \"{:function/%s}\"\n", F->getName().str().c_str());
+  CallGraphUtils::emitCallTrace(F, S, M);
+}
+
+Function* QueryAnalysis::lookupFunction(StringRef name) {
+  Function* F = M.getFunction(name);
+  if (F == NULL || F->isDeclaration()) {
+    XO::emit(" {:error/no such function}\n");
+    errs() << "WARNING: no definition of function \"" << name << "\"\n";
+    return NULL;
+  }
+  return F;
+}
+
+Sandbox* QueryAnalysis::lookupSandbox(StringRef name) {
+  Sandbox* S = SandboxUtils::getSandboxWithName(name, sandboxes);
+  if (S == NULL) {
+    XO::emit(" {:error/no such sandbox}\n");
+    errs() << "WARNING: no sandbox named \"" << name << "\"\n";
+  }
+  return S;
+}
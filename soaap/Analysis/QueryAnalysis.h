@@ -0,0 +1,75 @@
+#ifndef SOAAP_ANALYSIS_QUERYANALYSIS_H
+#define SOAAP_ANALYSIS_QUERYANALYSIS_H
+
+#include "Common/Sandbox.h"
+#include "Common/Typedefs.h"
+#include "OS/SysCallProvider.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // A file descriptor passed to a system call made within a sandbox
+  struct FdUse {
+    Value* fd;
+    CallInst* call;
+    Function* sysCall;
+  };
+  typedef SmallVector<FdUse,16> FdUseVector;
+
+  // Answers questions about the SOAAP model of a program on demand. Only the
+  // sandboxes and the call graph need to have been found: each answer is
+  // computed from the part of the program that it depends on, rather than by
+  // running the whole-program analyses, so that an editor (or the daemon's
+  // clients) can ask about one function or instruction at a time.
+  //
+  // Queries are given with -soaap-query=<kind>:<argument>:
+  //   sandboxes:<function>          sandboxes in which <function> can run
+  //   syscalls:<sandbox>            system calls <sandbox> makes, and the
+  //                                 file descriptors that it passes to them
+  //   classified:<file>:<line>      classes of classified data that can flow
+  //                                 to the instructions at <file>:<line>
+  //   path:<function>               shortest privileged call path to
+  //                                 <function>
+  //   path:<sandbox>:<function>     shortest call path to <function> within
+  //                                 <sandbox>
+  class QueryAnalysis {
+    public:
+      QueryAnalysis(Module& M, SandboxVector& sandboxes)
+        : M(M), sandboxes(sandboxes), sysCallProvider(SysCallProvider::getProvider()), foundClassifiedSources(false) { }
+
+      SandboxVector getSandboxesReaching(Function* F);
+      FunctionSet getSysCalls(Sandbox* S);
+      FdUseVector getFdUses(Sandbox* S);
+      // Bitset of the classes (see ClassifiedUtils) of classified data that
+      // can flow to V. Declassification is not taken into account.
+      int getClassificationsReaching(Value* V);
+      InstVector findInstructionsAt(StringRef file, unsigned line);
+
+      // Answer a query given as <kind>:<argument>, reporting the answer.
+      void answer(StringRef query);
+
+    private:
+      Module& M;
+      SandboxVector& sandboxes;
+      SysCallProvider* sysCallProvider;
+      bool foundClassifiedSources;
+      DenseMap<const Value*,int> classifiedSources;
+      DenseMap<const Value*,int> classificationsCache;
+      void findClassifiedSources();
+      void addClassifiedSource(Value* V, StringRef annotation);
+      void answerSandboxes(StringRef funcName);
+      void answerSysCalls(StringRef sandboxName);
+      void answerClassified(StringRef location);
+      void answerPath(StringRef arg);
+      Function* lookupFunction(StringRef name);
+      Sandbox* lookupSandbox(StringRef name);
+  };
+}
+
+#endif
@@ -0,0 +1,252 @@
+#include "Analysis/SummaryAnalysis.h"
+
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Common/XO.h"
+#include "OS/Sandbox/Capsicum.h"
+#include "OS/Sandbox/NoSandboxPlatform.h"
+#include "OS/Sandbox/Seccomp.h"
+#include "OS/Sandbox/SeccompBPF.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include "soaap.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace soaap;
+
+void SummaryAnalysis::add(ModuleSummary& summary) {
+  for (StringMap<string>::iterator I=summary.definedFunctions.begin(), E=summary.definedFunctions.end(); I!=E; I++) {
+    funcToFile[I->getKey()] = I->getValue();
+  }
+  for (SummaryCall& call : summary.calls) {
+    calls[call.caller].push_back(call);
+  }
+  for (SummaryIndirectCall& call : summary.indirectCalls) {
+    indirectCalls[call.caller].push_back(call);
+  }
+  for (StringMap<string>::iterator I=summary.escapingTypes.begin(), E=summary.escapingTypes.end(); I!=E; I++) {
+    escapingByType[I->getValue()].insert(I->getKey());
+  }
+  for (StringSet<>::iterator I=summary.definedGlobals.begin(), E=summary.definedGlobals.end(); I!=E; I++) {
+    definedGlobals.insert(I->getKey());
+  }
+  for (SummaryGlobalAccess& access : summary.globalAccesses) {
+    globalAccesses[access.function].push_back(access);
+  }
+  for (SummarySysCall& sysCall : summary.sysCalls) {
+    sysCalls[sysCall.function].push_back(sysCall);
+  }
+  for (pair<string,string>& callgate : summary.callgates) {
+    callgates[callgate.first].insert(callgate.second);
+  }
+  for (pair<string,string>& annotation : summary.annotations) {
+    StringRef annot = annotation.second;
+    if (annot.startswith(SANDBOX_PERSISTENT)) {
+      sandboxEntries[annot.substr(strlen(SANDBOX_PERSISTENT)+1)] = annotation.first;
+    }
+    else if (annot.startswith(SANDBOX_EPHEMERAL)) {
+      sandboxEntries[annot.substr(strlen(SANDBOX_EPHEMERAL)+1)] = annotation.first;
+    }
+    else if (annot == SOAAP_PRIVILEGED) {
+      privileged.insert(annotation.first);
+    }
+    else if (annot.startswith(VAR_READ)) {
+      globalPerms[annot.substr(strlen(VAR_READ)+1).str() + ":" + annotation.first] |= VAR_READ_MASK;
+    }
+    else if (annot.startswith(VAR_WRITE)) {
+      globalPerms[annot.substr(strlen(VAR_WRITE)+1).str() + ":" + annotation.first] |= VAR_WRITE_MASK;
+    }
+  }
+}
+
+void SummaryAnalysis::doAnalysis() {
+  bool all = CmdLineOpts::SoaapAnalyses.empty()
+             || CmdLineOpts::isSelected(SoaapAnalysis::All, CmdLineOpts::SoaapAnalyses);
+  map<string,vector<string> > sandboxedFuncs;
+  for (SandboxEntryMap::iterator I=sandboxEntries.begin(), E=sandboxEntries.end(); I!=E; I++) {
+    outs() << "  Found sandbox \"" << I->first << "\" (entrypoint " << ModuleSummary::getName(I->second) << ")\n";
+    sandboxedFuncs[I->first] = findSandboxedFunctions(I->first, I->second);
+  }
+
+  if (all || CmdLineOpts::isSelected(SoaapAnalysis::Globals, CmdLineOpts::SoaapAnalyses)) {
+    outs() << "* Checking global variable accesses\n";
+    XO::open_list("global_access_warning");
+    for (map<string,vector<string> >::iterator I=sandboxedFuncs.begin(), E=sandboxedFuncs.end(); I!=E; I++) {
+      checkGlobalAccesses(I->first, I->second);
+    }
+    XO::close_list("global_access_warning");
+  }
+
+  if (all || CmdLineOpts::isSelected(SoaapAnalysis::PrivCalls, CmdLineOpts::SoaapAnalyses)) {
+    outs() << "* Checking for calls to privileged functions from sandboxes\n";
+    XO::open_list("privileged_call");
+    for (map<string,vector<string> >::iterator I=sandboxedFuncs.begin(), E=sandboxedFuncs.end(); I!=E; I++) {
+      checkPrivilegedCalls(I->first, I->second);
+    }
+    XO::close_list("privileged_call");
+  }
+
+  if (all || CmdLineOpts::isSelected(SoaapAnalysis::SysCalls, CmdLineOpts::SoaapAnalyses)) {
+    unique_ptr<SandboxPlatform> platform(createSandboxPlatform());
+    if (platform) {
+      outs() << "* Checking system calls made by sandboxes\n";
+      XO::open_list("syscall_warning");
+      for (map<string,vector<string> >::iterator I=sandboxedFuncs.begin(), E=sandboxedFuncs.end(); I!=E; I++) {
+        checkSysCalls(I->first, I->second, platform.get());
+      }
+      XO::close_list("syscall_warning");
+    }
+  }
+}
+
+// Limits placed on system calls with __soaap_limit_syscalls depend on where
+// they are in the control flow, which summaries do not record, so system
+// calls are only checked against a sandbox platform chosen explicitly.
+SandboxPlatform* SummaryAnalysis::createSandboxPlatform() {
+  switch (CmdLineOpts::SandboxPlatform) {
+    case SandboxPlatformName::None: {
+      return new NoSandboxPlatform;
+    }
+    case SandboxPlatformName::Capsicum: {
+      return new Capsicum;
+    }
+    case SandboxPlatformName::Seccomp: {
+      return new Seccomp;
+    }
+    case SandboxPlatformName::SeccompBPF: {
+      if (CmdLineOpts::SeccompPolicy.empty()) {
+        report_fatal_error("-soaap-sandbox-platform=seccomp-bpf requires -soaap-seccomp-policy");
+      }
+      return new SeccompBPF(CmdLineOpts::SeccompPolicy);
+    }
+    default: {
+      return NULL;
+    }
+  }
+}
+
+// The functions reachable from the sandbox's entrypoint, without passing
+// through one of its callgates (which run with privilege). Indirect calls
+// that no escaping function is compatible with may call something outside
+// the program's summaries, so the sandbox may do more than is checked.
+vector<string> SummaryAnalysis::findSandboxedFunctions(const string& sandbox, const string& entry) {
+  StringSet<>& sandboxCallgates = callgates[sandbox];
+  StringSet<> visited;
+  vector<string> funcs;
+  vector<string> worklist;
+  int numUnresolved = 0;
+  worklist.push_back(entry);
+  while (!worklist.empty()) {
+    string key = worklist.back();
+    worklist.pop_back();
+    if (visited.count(key) || sandboxCallgates.count(key)) {
+      continue;
+    }
+    visited.insert(key);
+    if (funcToFile.count(key)) {
+      funcs.push_back(key);
+    }
+    for (SummaryCall& call : calls[key]) {
+      worklist.push_back(call.callee);
+    }
+    for (SummaryIndirectCall& call : indirectCalls[key]) {
+      StringMap<StringSet<> >::iterator I = escapingByType.find(call.type);
+      if (I == escapingByType.end()) {
+        numUnresolved++;
+        continue;
+      }
+      for (StringSet<>::iterator J=I->getValue().begin(), JE=I->getValue().end(); J!=JE; J++) {
+        worklist.push_back(J->getKey().str());
+      }
+    }
+  }
+  if (numUnresolved > 0) {
+    errs() << "WARNING: " << numUnresolved << " indirect call(s) in sandbox \"" << sandbox
+           << "\" have no known targets, so what they call is not checked\n";
+  }
+  // report in a deterministic order
+  sort(funcs.begin(), funcs.end());
+  SDEBUG("soaap.analysis.summary", 3, dbgs() << "Sandbox \"" << sandbox << "\" has " << funcs.size() << " functions\n")
+  return funcs;
+}
+
+void SummaryAnalysis::checkGlobalAccesses(const string& sandbox, vector<string>& funcs) {
+  for (string& func : funcs) {
+    StringSet<> alreadyReported;
+    for (SummaryGlobalAccess& access : globalAccesses[func]) {
+      if (access.write && !definedGlobals.count(access.global)) {
+        continue; // not concerned with externs defined outside the program
+      }
+      int perms = globalPerms.lookup(sandbox + ":" + access.global);
+      int mask = access.write ? VAR_WRITE_MASK : VAR_READ_MASK;
+      string reportKey = (access.write ? "w:" : "r:") + access.global;
+      if ((perms & mask) || (!CmdLineOpts::Pedantic && alreadyReported.count(reportKey))) {
+        continue;
+      }
+      alreadyReported.insert(reportKey);
+      XO::open_instance("global_access_warning");
+      XO::emit(
+        " *** Sandboxed method \"{:function/%s}\" [{:sandbox/%s}] "
+        "{:access_type/%s} global variable \"{:var_name/%s}\" "
+        "but is not allowed to. If the access is intended, the variable "
+        "needs to be annotated with {d:annotation/%s}.\n",
+        ModuleSummary::getName(func).str().c_str(),
+        sandbox.c_str(),
+        access.write ? "wrote to" : "read",
+        ModuleSummary::getName(access.global).str().c_str(),
+        access.write ? "__soaap_var_write" : "__soaap_var_read");
+      emitLocation(func, access.line);
+      XO::emit("\n");
+      XO::close_instance("global_access_warning");
+    }
+  }
+}
+
+void SummaryAnalysis::checkPrivilegedCalls(const string& sandbox, vector<string>& funcs) {
+  StringSet<>& sandboxCallgates = callgates[sandbox];
+  for (string& func : funcs) {
+    for (SummaryCall& call : calls[func]) {
+      if (privileged.count(call.callee) && !sandboxCallgates.count(call.callee)) {
+        XO::open_instance("privileged_call");
+        XO::emit(" *** Sandbox \"{:sandbox}\" calls privileged function "
+                 "\"{:privileged_func/%s}\" that they are not allowed to. "
+                 "If intended, annotate this permission using the "
+                 "__soaap_callgates annotation.\n",
+                 sandbox.c_str(),
+                 ModuleSummary::getName(call.callee).str().c_str());
+        emitLocation(func, call.line);
+        XO::close_instance("privileged_call");
+      }
+    }
+  }
+}
+
+void SummaryAnalysis::checkSysCalls(const string& sandbox, vector<string>& funcs, SandboxPlatform* platform) {
+  for (string& func : funcs) {
+    for (SummarySysCall& sysCall : sysCalls[func]) {
+      if (!platform->isSysCallPermitted(sysCall.sysCall)) {
+        XO::open_instance("syscall_warning");
+        XO::emit(" *** Sandbox \"{:sandbox/%s}\" performs system call "
+                 "\"{:syscall/%s}\" but it is not allowed to,\n"
+                 " *** based on the current sandboxing restrictions.\n",
+                 sandbox.c_str(),
+                 sysCall.sysCall.c_str());
+        emitLocation(func, sysCall.line);
+        XO::emit("\n");
+        XO::close_instance("syscall_warning");
+      }
+    }
+  }
+}
+
+void SummaryAnalysis::emitLocation(const string& func, unsigned line) {
+  if (line == 0) {
+    return;
+  }
+  XO::open_container("location");
+  XO::emit(" +++ Line {:line/%d} of file {:file/%s}\n",
+           line, funcToFile.lookup(func).c_str());
+  XO::close_container("location");
+}
@@ -0,0 +1,56 @@
+#ifndef SOAAP_ANALYSIS_SUMMARYANALYSIS_H
+#define SOAAP_ANALYSIS_SUMMARYANALYSIS_H
+
+#include "Common/ModuleSummary.h"
+#include "OS/Sandbox/SandboxPlatform.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Runs the SOAAP checks that only need module summaries, rather than IR,
+  // over the summaries of a whole program: accesses to globals from sandboxes
+  // (as GlobalVariableAnalysis), calls from sandboxes to privileged
+  // functions (as PrivilegedCallAnalysis) and system calls that the sandbox
+  // platform selected with -soaap-sandbox-platform does not permit (as
+  // SysCallsAnalysis, but without __soaap_limit_syscalls annotations). Only function-level sandboxes are
+  // found, and the checks are flow-insensitive, so this is a fast link-time
+  // approximation of the whole-program pass rather than a replacement for it.
+  // Indirect calls (through function pointers and vtables) may call any
+  // escaping function of a compatible type.
+  class SummaryAnalysis {
+    public:
+      void add(ModuleSummary& summary);
+      void doAnalysis();
+
+    private:
+      typedef map<string,string> SandboxEntryMap; // sandbox -> entrypoint key
+      SandboxEntryMap sandboxEntries;
+      StringMap<vector<SummaryCall> > calls;     // by caller
+      StringMap<vector<SummaryIndirectCall> > indirectCalls; // by caller
+      StringMap<StringSet<> > escapingByType;    // type key -> escaping functions
+      StringMap<vector<SummaryGlobalAccess> > globalAccesses; // by function
+      StringMap<vector<SummarySysCall> > sysCalls; // by function
+      StringSet<> definedGlobals;                // defined in any summary
+      StringMap<string> funcToFile;
+      StringSet<> privileged;
+      map<string,StringSet<> > callgates;        // sandbox -> callgate keys
+      StringMap<int> globalPerms;                // "<sandbox>:<global key>" -> VAR_*_MASK
+      vector<string> findSandboxedFunctions(const string& sandbox, const string& entry);
+      void checkGlobalAccesses(const string& sandbox, vector<string>& funcs);
+      void checkPrivilegedCalls(const string& sandbox, vector<string>& funcs);
+      void checkSysCalls(const string& sandbox, vector<string>& funcs, SandboxPlatform* platform);
+      SandboxPlatform* createSandboxPlatform();
+      void emitLocation(const string& func, unsigned line);
+  };
+}
+
+#endif
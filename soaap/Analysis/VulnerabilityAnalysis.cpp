@@ -4,6 +4,7 @@
 #include "Common/XO.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/PrettyPrinters.h"
+#include "Util/SliceUtils.h"
 #include "soaap.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfo.h"
@@ -140,8 +141,8 @@ void VulnerabilityAnalysis::findVulnerableVendorFuncs(Module& M) {
 }
 
 void VulnerabilityAnalysis::findVulnerableLibFuncs(Module& M) {
-  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
-    string library = DebugUtils::getEnclosingLibrary(&*F);
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    string library = DebugUtils::getEnclosingLibrary(F);
     if (!library.empty()) {
       if (find(CmdLineOpts::VulnerableLibs.begin(), CmdLineOpts::VulnerableLibs.end(), library) != CmdLineOpts::VulnerableLibs.end()) {
         SDEBUG("soaap.analysis.vulnerability", 3, dbgs() << "Vulnerable library func: " << F->getName() << " (library " << library << ")\n");
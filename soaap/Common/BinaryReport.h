@@ -0,0 +1,87 @@
+#ifndef SOAAP_COMMON_BINARYREPORT_H
+#define SOAAP_COMMON_BINARYREPORT_H
+
+// Layout of the binary report (-soaap-report-output-formats=binary). It is
+// shared between the SOAAP pass, which writes it, and soaap-query, which
+// mmaps it, so it only depends on the C standard headers.
+//
+// The file is a header followed by tables of fixed-size entries, all in host
+// byte order and 4-byte aligned:
+//
+//   strings      NUL-terminated strings, referred to by their byte offset.
+//                Offset 0 is always the empty string.
+//   warnings     one entry per top-level instance of the report (i.e. each
+//                warning), in the order they were emitted.
+//   fields       the encoded fields of each warning, as (name, value) string
+//                pairs. Nested containers are flattened into dotted names,
+//                e.g. "location.line".
+//   trace nodes  the call-trace trie, indexed by trace node id. A warning
+//                refers to the innermost node of its trace.
+//   indexes      for sandboxes, functions, files and labels: entries sorted
+//                by key string, each referring to a run of warning indices in
+//                the postings table. A warning is indexed under every
+//                function and file on its trace, as well as its own
+//                location's file, and under each class of classified data
+//                that it reports (its "data_class.name" fields).
+//
+// Files are indexed by their base name.
+
+#include <stdint.h>
+
+namespace soaap {
+  namespace binary_report {
+    static const char Magic[8] = { 'S', 'O', 'A', 'A', 'P', 'B', 'I', 'N' };
+    static const uint32_t Version = 2;
+    static const int32_t NoTrace = -1;
+
+    struct Table {
+      uint32_t offset; // from the start of the file
+      uint32_t count;  // of entries (bytes for the string table)
+    };
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      Table strings;
+      Table warnings;
+      Table fields;
+      Table traceNodes;
+      Table sandboxIndex;
+      Table functionIndex;
+      Table fileIndex;
+      Table labelIndex;
+      Table postings;
+    };
+
+    struct Warning {
+      uint32_t type;      // name of the enclosing list, e.g. "syscall_warning"
+      uint32_t sandbox;
+      uint32_t file;
+      uint32_t line;
+      int32_t traceId;
+      uint32_t firstField;
+      uint32_t numFields;
+    };
+
+    struct Field {
+      uint32_t name;
+      uint32_t value;
+    };
+
+    struct TraceNode {
+      int32_t parent;
+      uint32_t function;
+      uint32_t file;
+      uint32_t line;
+      uint32_t library;
+    };
+
+    struct IndexEntry {
+      uint32_t key;
+      uint32_t firstPosting;
+      uint32_t numPostings;
+    };
+  }
+}
+
+#endif
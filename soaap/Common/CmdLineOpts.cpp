@@ -34,6 +34,13 @@ static cl::opt<bool, true> ClContextInsens("soaap-context-insens",
        cl::desc("Don't use context-sensitive analysis"),
        cl::location(CmdLineOpts::ContextInsens));
 
+bool CmdLineOpts::DemandDriven;
+static cl::opt<bool, true> ClDemandDriven("soaap-demand-driven",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Only propagate classified and sandbox-private data that "
+                "can reach a value checked for leaks"),
+       cl::location(CmdLineOpts::DemandDriven));
+
 bool CmdLineOpts::ListSandboxedFuncs;
 static cl::opt<bool, true> ClListSandboxedFuncs("soaap-list-sandboxed-funcs",
        cl::cat(CmdLineOpts::SoaapCategory),
@@ -58,6 +65,20 @@ static cl::opt<bool, true> ClInferFPTargets("soaap-infer-fp-targets",
        cl::desc("Infer function-pointer targets by tracking assignments"),
        cl::location(CmdLineOpts::InferFPTargets));
 
+bool CmdLineOpts::PointsToFPTargets;
+static cl::opt<bool, true> ClPointsToFPTargets("soaap-points-to-fp-targets",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Resolve function-pointer targets using points-to analysis "
+                "(instead of -soaap-infer-fp-targets)"),
+       cl::location(CmdLineOpts::PointsToFPTargets));
+
+bool CmdLineOpts::FPTypeFallback;
+static cl::opt<bool, true> ClFPTypeFallback("soaap-fp-type-fallback",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Resolve function-pointer calls with no known targets to "
+                "all address-taken functions of a compatible type"),
+       cl::location(CmdLineOpts::FPTypeFallback));
+
 bool CmdLineOpts::ListFPTargets;
 static cl::opt<bool, true> ClListFPTargets("soaap-list-fp-targets",
        cl::cat(CmdLineOpts::SoaapCategory),
@@ -76,6 +97,13 @@ static cl::opt<bool, true> ClSkipGlobalVariableAnalysis("soaap-skip-global-varia
        cl::desc("Skip the analysis of global variable reads/writes"),
        cl::location(CmdLineOpts::SkipGlobalVariableAnalysis));
 
+bool CmdLineOpts::NoSlicing;
+static cl::opt<bool, true> ClNoSlicing("soaap-no-slicing",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Analyse every function in the module, rather than only "
+                "those reachable from main(), the sandboxes and callgates"),
+       cl::location(CmdLineOpts::NoSlicing));
+
 bool CmdLineOpts::Pedantic;
 static cl::opt<bool, true> ClPedantic("soaap-pedantic",
        cl::cat(CmdLineOpts::SoaapCategory),
@@ -106,6 +134,12 @@ static cl::opt<int, true> ClSummariseTraces("soaap-summarise-traces",
        cl::desc("Summarise stack traces so that atmost the specified number of calls are shown from the top and the same number from the bottom of the trace"),
        cl::location(CmdLineOpts::SummariseTraces));
 
+bool CmdLineOpts::CollapseTraces;
+static cl::opt<bool, true> ClCollapseTraces("soaap-collapse-traces",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Stop displaying a stack trace once it reaches a call that was displayed in an earlier trace"),
+       cl::location(CmdLineOpts::CollapseTraces));
+
 bool CmdLineOpts::DumpRPCGraph;
 static cl::opt<bool, true> ClDumpRPCGraph("soaap-dump-rpc-graph",
        cl::cat(CmdLineOpts::SoaapCategory),
@@ -121,10 +155,22 @@ static cl::opt<SandboxPlatformName, true> ClSandboxPlatform("soaap-sandbox-platf
          clEnumValN(SandboxPlatformName::Annotated, "annotated", "Annotated"),
          clEnumValN(SandboxPlatformName::Capsicum, "capsicum", "Capsicum (default)"),
          clEnumValN(SandboxPlatformName::Seccomp, "seccomp", "Secure Computing Mode (Seccomp)"),
+         clEnumValN(SandboxPlatformName::SeccompBPF, "seccomp-bpf", "Seccomp-BPF (policy given by -soaap-seccomp-policy)"),
        clEnumValEnd),
        cl::location(CmdLineOpts::SandboxPlatform),
        cl::init(SandboxPlatformName::Capsicum)); // default value is Capsicum
 
+OperatingSystemName CmdLineOpts::OperatingSystem;
+static cl::opt<OperatingSystemName, true> ClOperatingSystem("soaap-os",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Operating system whose system calls to model"),
+       cl::values(
+         clEnumValN(OperatingSystemName::FreeBSD, "freebsd", "FreeBSD (default)"),
+         clEnumValN(OperatingSystemName::Linux, "linux", "Linux (x86-64)"),
+       clEnumValEnd),
+       cl::location(CmdLineOpts::OperatingSystem),
+       cl::init(OperatingSystemName::FreeBSD)); // default value is FreeBSD
+
 bool CmdLineOpts::DumpDOTCallGraph;
 static cl::opt<bool, true> ClDumpDOTCallGraph("soaap-dump-dot-callgraph",
        cl::cat(CmdLineOpts::SoaapCategory),
@@ -145,8 +191,10 @@ static cl::list<ReportOutputFormat, list<ReportOutputFormat> > ClReportOutputFor
        cl::values(
          clEnumValN(ReportOutputFormat::Text, "text", "Text (on stdout)"),
          clEnumValN(ReportOutputFormat::JSON, "json", "JSON"),
+         clEnumValN(ReportOutputFormat::NDJSON, "ndjson", "Newline-delimited JSON, streamed as results are produced"),
          clEnumValN(ReportOutputFormat::XML, "xml", "XML"),
          clEnumValN(ReportOutputFormat::HTML, "html", "HTML"),
+         clEnumValN(ReportOutputFormat::Binary, "binary", "Indexed binary, for querying with soaap-query"),
        clEnumValEnd),
        cl::CommaSeparated,
        cl::location(CmdLineOpts::ReportOutputFormats));
@@ -231,3 +279,127 @@ static cl::list<string, list<string> > ClNoWarnLibs("soaap-nowarn-libs",
        cl::value_desc("list of libraries"),
        cl::CommaSeparated,
        cl::location(CmdLineOpts::NoWarnLibs));
+
+int CmdLineOpts::Threads;
+static cl::opt<int, true> ClThreads("soaap-threads",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Number of worker threads to use for parallel phases (default: number of hardware threads)"),
+       cl::location(CmdLineOpts::Threads),
+       cl::init(0));
+
+string CmdLineOpts::SeccompPolicy;
+static cl::opt<string, true> ClSeccompPolicy("soaap-seccomp-policy",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Policy file listing the system calls (and argument "
+                "predicates) permitted by the seccomp-bpf sandbox platform"),
+       cl::value_desc("filename"),
+       cl::location(CmdLineOpts::SeccompPolicy));
+
+bool CmdLineOpts::EmitSeccompFilters;
+static cl::opt<bool, true> ClEmitSeccompFilters("soaap-emit-seccomp-filters",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Emit a seccomp-bpf filter for each sandbox that only permits "
+                "the system calls it performs"),
+       cl::location(CmdLineOpts::EmitSeccompFilters));
+
+bool CmdLineOpts::EmitSandboxPolicies;
+static cl::opt<bool, true> ClEmitSandboxPolicies("soaap-emit-sandbox-policies",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Emit a least-privilege policy for each sandbox: Capsicum "
+                "rights for each file descriptor (FreeBSD) or a seccomp-bpf "
+                "filter (Linux)"),
+       cl::location(CmdLineOpts::EmitSandboxPolicies));
+
+string CmdLineOpts::SysCallProfile;
+static cl::opt<string, true> ClSysCallProfile("soaap-syscall-profile",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Dynamic profile of system call frequencies (lines of the "
+                "form \"<syscall> <count>\") used to order generated "
+                "seccomp-bpf filters"),
+       cl::value_desc("filename"),
+       cl::location(CmdLineOpts::SysCallProfile));
+
+bool CmdLineOpts::Summary;
+static cl::opt<bool, true> ClSummary("soaap-summary",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Write a SOAAP summary of each translation unit as it is "
+                "compiled (e.g. -mllvm -soaap-summary), to <output "
+                "file>.soaap.summary, where soaap and soaap-aggregate look "
+                "for it"),
+       cl::location(CmdLineOpts::Summary));
+
+string CmdLineOpts::SummaryFile;
+static cl::opt<string, true> ClSummaryFile("soaap-summary-file",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Write the SOAAP summary to this file rather than next to "
+                "the output file (implies -soaap-summary)"),
+       cl::value_desc("filename"),
+       cl::location(CmdLineOpts::SummaryFile));
+
+list<string> CmdLineOpts::Queries;
+static cl::list<string, list<string> > ClQueries("soaap-query",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Answer a query about the sandboxes, instead of running the "
+                "analyses: sandboxes:<function>, syscalls:<sandbox>, "
+                "classified:<file>:<line>, path:<function> or "
+                "path:<sandbox>:<function>"),
+       cl::value_desc("query"),
+       cl::location(CmdLineOpts::Queries));
+
+int CmdLineOpts::MaxFieldDepth;
+static cl::opt<int, true> ClMaxFieldDepth("soaap-max-field-depth",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Maximum depth of nested struct fields that are told apart "
+                "when modelling memory (default: 3)"),
+       cl::location(CmdLineOpts::MaxFieldDepth),
+       cl::init(3));
+
+int CmdLineOpts::CallStringDepth;
+static cl::opt<int, true> ClCallStringDepth("soaap-call-string-depth",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Tell apart up to this many of the most recent call sites "
+                "within each sandbox (or privileged) context during "
+                "information-flow analysis (default: 0)"),
+       cl::location(CmdLineOpts::CallStringDepth),
+       cl::init(0));
+
+WorklistPolicy CmdLineOpts::Worklist;
+static cl::opt<WorklistPolicy, true> ClWorklist("soaap-worklist",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Order in which the data-flow analyses visit their worklists"),
+       cl::values(
+         clEnumValN(WorklistPolicy::FIFO, "fifo", "First in, first out (default)"),
+         clEnumValN(WorklistPolicy::LIFO, "lifo", "Last in, first out"),
+         clEnumValN(WorklistPolicy::Hybrid, "hybrid", "Sources first in, first out; what they reach last in, first out"),
+         clEnumValN(WorklistPolicy::RPO, "rpo", "Reverse post-order within each function"),
+         clEnumValN(WorklistPolicy::SCC, "scc", "Topological order of strongly connected components of the value-flow graph (or interprocedural CFG)"),
+       clEnumValEnd),
+       cl::location(CmdLineOpts::Worklist),
+       cl::init(WorklistPolicy::FIFO));
+
+int CmdLineOpts::WidenAfter;
+static cl::opt<int, true> ClWidenAfter("soaap-widen-after",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Widen a value's information-flow fact to a conservative "
+                "summary once it has changed this many times in a context "
+                "(default: 0, never)"),
+       cl::location(CmdLineOpts::WidenAfter),
+       cl::init(0));
+
+int CmdLineOpts::TimeBudget;
+static cl::opt<int, true> ClTimeBudget("soaap-time-budget",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Seconds SOAAP may run for before its solvers widen every "
+                "pending fact and every fact they update (default: 0, "
+                "unlimited)"),
+       cl::location(CmdLineOpts::TimeBudget),
+       cl::init(0));
+
+int CmdLineOpts::MemoryBudget;
+static cl::opt<int, true> ClMemoryBudget("soaap-memory-budget",
+       cl::cat(CmdLineOpts::SoaapCategory),
+       cl::desc("Megabytes of memory (peak resident set size) that SOAAP "
+                "may use before its solvers widen every pending fact and "
+                "every fact they update (default: 0, unlimited)"),
+       cl::location(CmdLineOpts::MemoryBudget),
+       cl::init(0));
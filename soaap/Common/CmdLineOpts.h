@@ -1,6 +1,7 @@
 #ifndef SOAAP_CMDLINEOPTS_H
 #define SOAAP_CMDLINEOPTS_H
 
+#include "ADT/QueueSet.h"
 #include "llvm/Support/CommandLine.h"
 
 #include <list>
@@ -10,10 +11,13 @@ using namespace std;
 
 namespace soaap {
   enum class SandboxPlatformName {
-    None, Annotated, Capsicum, Seccomp
+    None, Annotated, Capsicum, Seccomp, SeccompBPF
+  };
+  enum class OperatingSystemName {
+    FreeBSD, Linux
   };
   enum class ReportOutputFormat {
-    Text, HTML, JSON, XML
+    Text, HTML, JSON, NDJSON, XML, Binary
   };
   enum class SoaapMode {
     Null, Vuln, Correct, InfoFlow, Custom, All
@@ -27,20 +31,26 @@ namespace soaap {
       static list<string> VulnerableVendors;
       static list<string> VulnerableLibs;
       static bool ContextInsens;
+      static bool DemandDriven;
       static bool ListSandboxedFuncs;
       static bool ListPrivilegedFuncs;
       static bool ListFPCalls;
       static bool InferFPTargets;
+      static bool PointsToFPTargets;
+      static bool FPTypeFallback;
       static bool ListFPTargets;
       static bool ListAllFuncs;
       static bool SkipGlobalVariableAnalysis;
+      static bool NoSlicing;
       static bool Pedantic;
       static string DebugModule;
       static string DebugFunction;
       static int DebugVerbosity;
       static int SummariseTraces;
+      static bool CollapseTraces;
       static bool DumpRPCGraph;
       static SandboxPlatformName SandboxPlatform;
+      static OperatingSystemName OperatingSystem;
       static bool DumpDOTCallGraph;
       static bool PrintCallGraph;
       static list<ReportOutputFormat> ReportOutputFormats;
@@ -52,6 +62,20 @@ namespace soaap {
       static list<SoaapAnalysis> SoaapAnalyses;
       static list<string> NoWarnLibs;
       static list<string> WarnLibs;
+      static int Threads;
+      static string SeccompPolicy;
+      static bool EmitSeccompFilters;
+      static bool EmitSandboxPolicies;
+      static string SysCallProfile;
+      static bool Summary;
+      static string SummaryFile;
+      static list<string> Queries;
+      static int MaxFieldDepth;
+      static int CallStringDepth;
+      static WorklistPolicy Worklist;
+      static int WidenAfter;
+      static int TimeBudget;
+      static int MemoryBudget;
   
       template<typename T>
       static bool isSelected(T opt, list<T> optsList) {
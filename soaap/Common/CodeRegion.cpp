@@ -0,0 +1,75 @@
+#include "Common/CodeRegion.h"
+
+#include "Common/Debug.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+
+using namespace soaap;
+
+CodeRegion::CodeRegion(Instruction* start, EndPredicate isEnd) : F(start->getParent()->getParent()) {
+  unsigned numBlocks = 0;
+  for (BasicBlock& BB : F->getBasicBlockList()) {
+    blockIdx[&BB] = numBlocks++;
+  }
+  wholeBlocks.resize(numBlocks);
+
+  // blocks that have been entered from the top, rather than from the start
+  // instruction
+  BitVector entered(numBlocks);
+  SmallVector<BasicBlock*,16> worklist;
+  BasicBlock* StartBB = start->getParent();
+  if (scan(StartBB, BasicBlock::iterator(start), false, isEnd)) {
+    worklist.append(succ_begin(StartBB), succ_end(StartBB));
+  }
+  while (!worklist.empty()) {
+    BasicBlock* BB = worklist.pop_back_val();
+    unsigned idx = blockIdx[BB];
+    if (entered.test(idx)) {
+      continue;
+    }
+    entered.set(idx);
+    if (scan(BB, BB->begin(), true, isEnd)) {
+      worklist.append(succ_begin(BB), succ_end(BB));
+    }
+  }
+  SDEBUG("soaap.common.region", 3, dbgs() << "Region in " << F->getName() << " has " << insts.size() << " instructions\n")
+}
+
+// Add the instructions of BB from BI onwards, stopping after an end
+// instruction. Returns whether the end of BB was reached, i.e. whether the
+// region continues into BB's successors.
+bool CodeRegion::scan(BasicBlock* BB, BasicBlock::iterator BI, bool fromTop, EndPredicate& isEnd) {
+  BasicBlock::iterator First = BI;
+  bool ended = false;
+  for (BasicBlock::iterator BE = BB->end(); BI != BE; ++BI) {
+    Instruction* I = &*BI;
+    if (!boundaryInsts.count(I)) {
+      insts.push_back(I);
+    }
+    if (isEnd && isEnd(I)) {
+      ended = true;
+      ++BI;
+      break;
+    }
+  }
+  if (fromTop && !ended) {
+    wholeBlocks.set(blockIdx[BB]);
+  }
+  else {
+    for (BasicBlock::iterator I = First; I != BI; ++I) {
+      boundaryInsts.insert(&*I);
+    }
+  }
+  return !ended;
+}
+
+bool CodeRegion::contains(const Instruction* I) const {
+  if (F == NULL || I->getParent()->getParent() != F) {
+    return false;
+  }
+  DenseMap<const BasicBlock*,unsigned>::const_iterator BI = blockIdx.find(I->getParent());
+  if (BI != blockIdx.end() && wholeBlocks.test(BI->second)) {
+    return true;
+  }
+  return boundaryInsts.count(I) > 0;
+}
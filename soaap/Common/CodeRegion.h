@@ -0,0 +1,49 @@
+#ifndef SOAAP_COMMON_CODEREGION_H
+#define SOAAP_COMMON_CODEREGION_H
+
+#include "Common/Typedefs.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Instructions.h"
+
+#include <functional>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // A region of a function's code: the instructions that can be executed
+  // from a start instruction onwards, up to and including the first end
+  // instruction (if any) on each path. Sandboxed code regions end at the
+  // matching __soaap_sandboxed_region_end annotation; declassified regions
+  // run to the end of the function.
+  //
+  // Each block is visited at most once, so a region is found in time linear
+  // in the size of its function. Blocks that lie wholly within the region
+  // are recorded in a bitset, indexed by their position in the function, and
+  // only the instructions of the blocks in which the region starts or ends
+  // are recorded individually, so membership tests take constant time.
+  class CodeRegion {
+    public:
+      typedef function<bool(Instruction*)> EndPredicate;
+
+      CodeRegion() : F(NULL) { }
+      CodeRegion(Instruction* start, EndPredicate isEnd = EndPredicate());
+      bool contains(const Instruction* I) const;
+      bool empty() const { return insts.empty(); }
+      Function* getFunction() const { return F; }
+      // in the order they were found, starting with the start instruction
+      InstVector& getInstructions() { return insts; }
+
+    private:
+      Function* F;
+      DenseMap<const BasicBlock*,unsigned> blockIdx;
+      BitVector wholeBlocks;
+      DenseSet<const Instruction*> boundaryInsts;
+      InstVector insts;
+      bool scan(BasicBlock* BB, BasicBlock::iterator BI, bool fromTop, EndPredicate& isEnd);
+  };
+}
+
+#endif
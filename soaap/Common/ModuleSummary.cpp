@@ -0,0 +1,437 @@
+#include "Common/ModuleSummary.h"
+
+#include "Common/Debug.h"
+#include "OS/SysCallProvider.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+
+using namespace soaap;
+
+static const char* SummaryMagic = "SOAAP-SUMMARY";
+static const int SummaryVersion = 3;
+
+string ModuleSummary::getKey(const GlobalValue* GV, StringRef moduleId) {
+  if (GV->hasLocalLinkage()) {
+    return moduleId.str() + ":" + GV->getName().str();
+  }
+  return GV->getName();
+}
+
+StringRef ModuleSummary::getName(StringRef key) {
+  return key.substr(key.rfind(':')+1);
+}
+
+static void printTypeKey(Type* T, raw_ostream& os) {
+  if (T->isPointerTy()) {
+    os << "ptr";
+  }
+  else {
+    T->print(os);
+  }
+}
+
+string ModuleSummary::getTypeKey(FunctionType* FT) {
+  string key;
+  raw_string_ostream os(key);
+  printTypeKey(FT->getReturnType(), os);
+  os << "(";
+  for (unsigned i=0; i<FT->getNumParams(); i++) {
+    if (i > 0) {
+      os << ",";
+    }
+    printTypeKey(FT->getParamType(i), os);
+  }
+  os << ")";
+  return os.str();
+}
+
+ModuleSummary* ModuleSummary::build(Module& M, StringRef moduleId) {
+  ModuleSummary* summary = new ModuleSummary(moduleId);
+  for (Function& F : M.getFunctionList()) {
+    if (F.isDeclaration()) {
+      continue;
+    }
+    bool wasMaterializable = F.isMaterializable();
+    if (wasMaterializable) {
+      if (error_code EC = M.materialize(&F)) {
+        errs() << "WARNING: could not materialize \"" << F.getName() << "\" in " << moduleId << ": " << EC.message() << "\n";
+        continue;
+      }
+    }
+    summary->summariseFunction(F);
+    if (wasMaterializable) {
+      // release the body again
+      M.Dematerialize(&F);
+    }
+  }
+  for (GlobalVariable& G : M.getGlobalList()) {
+    if (!G.hasInitializer()) {
+      continue;
+    }
+    if (!G.getName().startswith("llvm.")) {
+      summary->definedGlobals.insert(getKey(&G, moduleId));
+    }
+    if (G.getName() == "llvm.global.annotations") {
+      summary->summariseAnnotations(G.getInitializer());
+    }
+    else if (G.getName().startswith("_ZTV")) {
+      summary->collectFunctions(G.getInitializer(), summary->vtableFunctions);
+    }
+    else {
+      // e.g. tables of function pointers, llvm.global_ctors
+      summary->collectFunctions(G.getInitializer(), summary->addressTaken);
+    }
+  }
+  for (GlobalAlias& A : M.getAliasList()) {
+    if (const Constant* Aliasee = A.getAliasee()) {
+      summary->collectFunctions(Aliasee, summary->addressTaken);
+    }
+  }
+  SDEBUG("soaap.modulesummary", 3, dbgs() << moduleId << ": " << summary->definedFunctions.size() << " functions, " << summary->calls.size() << " calls, " << summary->addressTaken.size() << " address-taken\n")
+  return summary;
+}
+
+void ModuleSummary::summariseFunction(Function& F) {
+  string key = getKey(&F, moduleId);
+  string file;
+  if (F.getName() == "main" && !F.hasLocalLinkage()) {
+    definesMain = true;
+  }
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    DILocation Loc(I->getMetadata("dbg"));
+    unsigned line = Loc ? Loc.getLineNumber() : 0;
+    if (file.empty() && Loc) {
+      file = Loc.getFilename();
+    }
+    ImmutableCallSite CS(&*I);
+    const Function* Callee = CS ? dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts()) : NULL;
+    if (Callee && Callee->isDeclaration() && SysCallProvider::getProvider()->isSysCall(Callee)) {
+      SummarySysCall sysCall = { key, Callee->getName().str(), line };
+      sysCalls.push_back(sysCall);
+    }
+    if (CS && !Callee && !CS.isInlineAsm()) {
+      FunctionType* FT = cast<FunctionType>(cast<PointerType>(CS.getCalledValue()->getType())->getElementType());
+      SummaryIndirectCall call = { key, getTypeKey(FT), line };
+      indirectCalls.push_back(call);
+    }
+    StringRef callgateSandbox;
+    if (Callee && Callee->getName().startswith("__soaap_declare_callgates_helper_")) {
+      callgateSandbox = Callee->getName().substr(strlen("__soaap_declare_callgates_helper")+1);
+    }
+    for (unsigned i=0; i<I->getNumOperands(); i++) {
+      const Value* V = I->getOperand(i);
+      if (const Function* G = dyn_cast<Function>(V->stripPointerCasts())) {
+        if (G->isIntrinsic()) {
+          continue;
+        }
+        if (CS && CS.isCallee(&I->getOperandUse(i))) {
+          SummaryCall call = { key, getKey(G, moduleId), line };
+          calls.push_back(call);
+        }
+        else {
+          // e.g. stored or passed as a function pointer
+          addEscaping(G, addressTaken);
+          if (!callgateSandbox.empty()) {
+            callgates.push_back(make_pair(callgateSandbox.str(), getKey(G, moduleId)));
+          }
+        }
+      }
+      else if (const Constant* C = dyn_cast<Constant>(V)) {
+        if (!isa<GlobalValue>(C)) {
+          collectFunctions(C, addressTaken);
+        }
+      }
+    }
+    // accesses to globals, as checked by GlobalVariableAnalysis
+    const Value* Ptr = NULL;
+    bool write = false;
+    if (const LoadInst* L = dyn_cast<LoadInst>(&*I)) {
+      Ptr = L->getPointerOperand();
+    }
+    else if (const StoreInst* S = dyn_cast<StoreInst>(&*I)) {
+      Ptr = S->getPointerOperand();
+      write = true;
+    }
+    if (Ptr) {
+      Ptr = Ptr->stripPointerCasts();
+      if (const GEPOperator* GEP = dyn_cast<GEPOperator>(Ptr)) {
+        Ptr = GEP->getPointerOperand();
+      }
+      if (const GlobalVariable* GV = dyn_cast<GlobalVariable>(Ptr)) {
+        SummaryGlobalAccess access = { key, getKey(GV, moduleId), write, !GV->isDeclaration(), line };
+        globalAccesses.push_back(access);
+      }
+    }
+  }
+  definedFunctions[key] = file;
+}
+
+// llvm.global.annotations is an array of { value, annotation, file, line }
+void ModuleSummary::summariseAnnotations(const Constant* C) {
+  const ConstantArray* CA = dyn_cast<ConstantArray>(C);
+  if (!CA) {
+    return;
+  }
+  for (const Use& U : CA->operands()) {
+    const ConstantStruct* CS = dyn_cast<ConstantStruct>(U.get());
+    if (!CS || CS->getNumOperands() < 2) {
+      continue;
+    }
+    const GlobalValue* Annotated = dyn_cast<GlobalValue>(CS->getOperand(0)->stripPointerCasts());
+    const GlobalVariable* StrVar = dyn_cast<GlobalVariable>(CS->getOperand(1)->stripPointerCasts());
+    if (!Annotated || !StrVar || !StrVar->hasInitializer()) {
+      continue;
+    }
+    if (const ConstantDataArray* Str = dyn_cast<ConstantDataArray>(StrVar->getInitializer())) {
+      annotations.push_back(make_pair(getKey(Annotated, moduleId), Str->getAsCString().str()));
+    }
+  }
+}
+
+// Add the functions referred to by C to funcs. Other globals' initializers
+// are summarised separately, so are not followed.
+void ModuleSummary::collectFunctions(const Constant* C, StringSet<>& funcs) {
+  SmallPtrSet<const Constant*,16> visited;
+  SmallVector<const Constant*,16> worklist;
+  worklist.push_back(C);
+  while (!worklist.empty()) {
+    const Constant* Curr = worklist.pop_back_val();
+    if (!visited.insert(Curr).second) {
+      continue;
+    }
+    if (const Function* F = dyn_cast<Function>(Curr)) {
+      if (!F->isIntrinsic()) {
+        addEscaping(F, funcs);
+      }
+    }
+    else if (!isa<GlobalValue>(Curr)) {
+      for (const Use& U : Curr->operands()) {
+        if (const Constant* Op = dyn_cast<Constant>(U.get())) {
+          worklist.push_back(Op);
+        }
+      }
+    }
+  }
+}
+
+void ModuleSummary::addEscaping(const Function* F, StringSet<>& funcs) {
+  string key = getKey(F, moduleId);
+  funcs.insert(key);
+  escapingTypes[key] = getTypeKey(F->getFunctionType());
+}
+
+// Keys of local values are written relative to the module, so that a
+// summary can be reused whatever the module is called when it is read.
+string ModuleSummary::toRelativeKey(StringRef key) {
+  if (key.startswith(moduleId + ":")) {
+    return key.substr(moduleId.size());
+  }
+  return key;
+}
+
+string ModuleSummary::fromRelativeKey(StringRef key) {
+  if (key.startswith(":")) {
+    return moduleId + key.str();
+  }
+  return key;
+}
+
+string ModuleSummary::getSummaryFilename(StringRef filename) {
+  return filename.str() + ".soaap.summary";
+}
+
+error_code ModuleSummary::write(StringRef filename) {
+  error_code EC;
+  raw_fd_ostream out(filename, EC, sys::fs::F_Text);
+  if (EC) {
+    return EC;
+  }
+  out << SummaryMagic << "\t" << SummaryVersion << "\n";
+  if (definesMain) {
+    out << "main\n";
+  }
+  for (StringMap<string>::iterator I=definedFunctions.begin(), E=definedFunctions.end(); I!=E; I++) {
+    out << "func\t" << toRelativeKey(I->getKey()) << "\t" << I->getValue() << "\n";
+  }
+  for (SummaryCall& call : calls) {
+    out << "call\t" << toRelativeKey(call.caller) << "\t" << toRelativeKey(call.callee) << "\t" << call.line << "\n";
+  }
+  for (SummaryIndirectCall& call : indirectCalls) {
+    out << "icall\t" << toRelativeKey(call.caller) << "\t" << call.type << "\t" << call.line << "\n";
+  }
+  for (StringSet<>::iterator I=addressTaken.begin(), E=addressTaken.end(); I!=E; I++) {
+    out << "addr\t" << toRelativeKey(I->getKey()) << "\t" << escapingTypes.lookup(I->getKey()) << "\n";
+  }
+  for (StringSet<>::iterator I=vtableFunctions.begin(), E=vtableFunctions.end(); I!=E; I++) {
+    out << "vtable\t" << toRelativeKey(I->getKey()) << "\t" << escapingTypes.lookup(I->getKey()) << "\n";
+  }
+  for (pair<string,string>& annotation : annotations) {
+    out << "annot\t" << toRelativeKey(annotation.first) << "\t" << annotation.second << "\n";
+  }
+  for (pair<string,string>& callgate : callgates) {
+    out << "callgate\t" << callgate.first << "\t" << toRelativeKey(callgate.second) << "\n";
+  }
+  for (StringSet<>::iterator I=definedGlobals.begin(), E=definedGlobals.end(); I!=E; I++) {
+    out << "gvar\t" << toRelativeKey(I->getKey()) << "\n";
+  }
+  for (SummaryGlobalAccess& access : globalAccesses) {
+    out << "global\t" << toRelativeKey(access.function) << "\t" << toRelativeKey(access.global)
+        << "\t" << (access.write ? "w" : "r") << "\t" << (access.defined ? "1" : "0") << "\t" << access.line << "\n";
+  }
+  for (SummarySysCall& sysCall : sysCalls) {
+    out << "syscall\t" << toRelativeKey(sysCall.function) << "\t" << sysCall.sysCall << "\t" << sysCall.line << "\n";
+  }
+  return EC;
+}
+
+ModuleSummary* ModuleSummary::read(StringRef filename, StringRef moduleId, string& error) {
+  ErrorOr<unique_ptr<MemoryBuffer> > bufferOrErr = MemoryBuffer::getFile(filename);
+  if (error_code EC = bufferOrErr.getError()) {
+    error = filename.str() + ": " + EC.message();
+    return NULL;
+  }
+  StringRef contents = bufferOrErr.get()->getBuffer();
+  pair<StringRef,StringRef> firstAndRest = contents.split('\n');
+  string expected = string(SummaryMagic) + "\t" + to_string(SummaryVersion);
+  if (firstAndRest.first != expected) {
+    error = filename.str() + ": not a SOAAP summary, or an unsupported version";
+    return NULL;
+  }
+  ModuleSummary* summary = new ModuleSummary(moduleId);
+  SmallVector<StringRef,6> lines;
+  firstAndRest.second.split(lines, "\n", -1, false);
+  for (StringRef line : lines) {
+    SmallVector<StringRef,6> fields;
+    pair<StringRef,StringRef> kindAndRest = line.split('\t');
+    StringRef kind = kindAndRest.first;
+    // annotations may contain anything, so are always the last field
+    int maxSplit = kind == "annot" ? 1 : -1;
+    kindAndRest.second.split(fields, "\t", maxSplit);
+    unsigned num = 0;
+    if (kind == "main") {
+      summary->definesMain = true;
+    }
+    else if (kind == "func" && fields.size() == 2) {
+      summary->definedFunctions[summary->fromRelativeKey(fields[0])] = fields[1];
+    }
+    else if (kind == "call" && fields.size() == 3 && !fields[2].getAsInteger(10, num)) {
+      SummaryCall call = { summary->fromRelativeKey(fields[0]), summary->fromRelativeKey(fields[1]), num };
+      summary->calls.push_back(call);
+    }
+    else if (kind == "icall" && fields.size() == 3 && !fields[2].getAsInteger(10, num)) {
+      SummaryIndirectCall call = { summary->fromRelativeKey(fields[0]), fields[1].str(), num };
+      summary->indirectCalls.push_back(call);
+    }
+    else if (kind == "addr" && fields.size() == 2) {
+      string key = summary->fromRelativeKey(fields[0]);
+      summary->addressTaken.insert(key);
+      summary->escapingTypes[key] = fields[1];
+    }
+    else if (kind == "vtable" && fields.size() == 2) {
+      string key = summary->fromRelativeKey(fields[0]);
+      summary->vtableFunctions.insert(key);
+      summary->escapingTypes[key] = fields[1];
+    }
+    else if (kind == "annot" && fields.size() == 2) {
+      summary->annotations.push_back(make_pair(summary->fromRelativeKey(fields[0]), fields[1].str()));
+    }
+    else if (kind == "callgate" && fields.size() == 2) {
+      summary->callgates.push_back(make_pair(fields[0].str(), summary->fromRelativeKey(fields[1])));
+    }
+    else if (kind == "global" && fields.size() == 5 && !fields[4].getAsInteger(10, num)) {
+      SummaryGlobalAccess access = {
+        summary->fromRelativeKey(fields[0]), summary->fromRelativeKey(fields[1]),
+        fields[2] == "w", fields[3] == "1", num
+      };
+      summary->globalAccesses.push_back(access);
+    }
+    else if (kind == "gvar" && fields.size() == 1) {
+      summary->definedGlobals.insert(summary->fromRelativeKey(fields[0]));
+    }
+    else if (kind == "syscall" && fields.size() == 3 && !fields[2].getAsInteger(10, num)) {
+      SummarySysCall sysCall = { summary->fromRelativeKey(fields[0]), fields[1].str(), num };
+      summary->sysCalls.push_back(sysCall);
+    }
+    else {
+      errs() << "WARNING: ignoring malformed line in " << filename << ": \"" << line << "\"\n";
+    }
+  }
+  return summary;
+}
+
+void SummaryGraph::add(ModuleSummary& summary) {
+  hasMain |= summary.definesMain;
+  for (StringMap<string>::iterator I=summary.definedFunctions.begin(), E=summary.definedFunctions.end(); I!=E; I++) {
+    defined.insert(I->getKey());
+  }
+  StringSet<>* escaping[] = { &summary.addressTaken, &summary.vtableFunctions };
+  for (StringSet<>* funcs : escaping) {
+    for (StringSet<>::iterator I=funcs->begin(), E=funcs->end(); I!=E; I++) {
+      roots.insert(I->getKey());
+    }
+  }
+  for (pair<string,string>& annotation : summary.annotations) {
+    roots.insert(annotation.first);
+  }
+  for (SummaryCall& call : summary.calls) {
+    callees[call.caller].push_back(call.callee);
+  }
+}
+
+void SummaryGraph::computeLiveFunctions() {
+  vector<string> worklist;
+  if (hasMain) {
+    worklist.push_back("main");
+    for (StringSet<>::iterator I=roots.begin(), E=roots.end(); I!=E; I++) {
+      worklist.push_back(I->getKey());
+    }
+  }
+  else {
+    // a library: any of its externally visible functions may be called, as
+    // may local ones whose address escapes. Local functions are keyed by
+    // "moduleId:name", which no external name contains.
+    for (StringSet<>::iterator I=defined.begin(), E=defined.end(); I!=E; I++) {
+      if (I->getKey().find(':') == StringRef::npos) {
+        worklist.push_back(I->getKey());
+      }
+    }
+    for (StringSet<>::iterator I=roots.begin(), E=roots.end(); I!=E; I++) {
+      worklist.push_back(I->getKey());
+    }
+  }
+  while (!worklist.empty()) {
+    string key = worklist.back();
+    worklist.pop_back();
+    if (live.count(key)) {
+      continue;
+    }
+    live.insert(key);
+    StringMap<vector<string> >::iterator I = callees.find(key);
+    if (I != callees.end()) {
+      for (string& callee : I->getValue()) {
+        if (!live.count(callee)) {
+          worklist.push_back(callee);
+        }
+      }
+    }
+  }
+  SDEBUG("soaap.modulesummary", 3, dbgs() << live.size() << " of " << defined.size() << " functions are live\n")
+}
+
+bool SummaryGraph::isLive(const Function* F, StringRef moduleId) {
+  return live.count(ModuleSummary::getKey(F, moduleId));
+}
@@ -0,0 +1,130 @@
+#ifndef SOAAP_COMMON_MODULESUMMARY_H
+#define SOAAP_COMMON_MODULESUMMARY_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/Constant.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  struct SummaryCall {
+    string caller;
+    string callee;
+    unsigned line;
+  };
+
+  // A call through a function pointer or vtable, whose callees are the
+  // escaping functions of a compatible type (see getTypeKey).
+  struct SummaryIndirectCall {
+    string caller;
+    string type;
+    unsigned line;
+  };
+
+  struct SummaryGlobalAccess {
+    string function;
+    string global;
+    bool write;
+    bool defined; // whether the global is defined rather than extern
+    unsigned line;
+  };
+
+  struct SummarySysCall {
+    string function;
+    string sysCall;
+    unsigned line;
+  };
+
+  // What SOAAP needs to know about a module without its IR: the direct call
+  // edges, the indirect call sites and the types they call, the functions
+  // whose addresses escape (stored function pointers, vtable entries and
+  // annotated functions) and their types, annotations, callgates, the
+  // globals it defines, accesses to globals and system call sites.
+  // Functions and globals are identified by key (see getKey) so that
+  // summaries of modules in different LLVMContexts, or compiled separately,
+  // can be merged.
+  //
+  // Summaries can be written alongside each translation unit at compile time
+  // (see the soaap-summary pass) and read back in place of the module.
+  class ModuleSummary {
+    public:
+      string moduleId;
+      bool definesMain;
+      StringMap<string> definedFunctions; // key -> file
+      vector<SummaryCall> calls;
+      vector<SummaryIndirectCall> indirectCalls;
+      llvm::StringSet<> addressTaken;
+      llvm::StringSet<> vtableFunctions;
+      StringMap<string> escapingTypes; // key -> type, of the two above
+      vector<pair<string,string> > annotations; // key, annotation
+      vector<pair<string,string> > callgates;   // sandbox, key
+      llvm::StringSet<> definedGlobals;
+      vector<SummaryGlobalAccess> globalAccesses;
+      vector<SummarySysCall> sysCalls;
+
+      ModuleSummary(StringRef moduleId) : moduleId(moduleId), definesMain(false) { }
+
+      // Summarise M. If M was loaded lazily, each function body is
+      // materialized only while it is being summarised.
+      static ModuleSummary* build(Module& M, StringRef moduleId);
+
+      // Read a summary written by write(). Keys local to the summarised
+      // module are rebased onto moduleId. Returns null, and sets error, if
+      // the summary could not be read.
+      static ModuleSummary* read(StringRef filename, StringRef moduleId, string& error);
+      error_code write(StringRef filename);
+      // Where the summary of the module in the bitcode file filename is
+      // written at compile time, and looked for when filename is analysed.
+      static string getSummaryFilename(StringRef filename);
+
+      // Values with local linkage are only visible within their module, so
+      // their keys are qualified with the module's id.
+      static string getKey(const GlobalValue* GV, StringRef moduleId);
+      static StringRef getName(StringRef key);
+      // A key for FT under which all the function types that a call of type
+      // FT may call are the same: pointer types (such as the "this" of a
+      // virtual method) are not told apart, nor are varargs.
+      static string getTypeKey(FunctionType* FT);
+
+    private:
+      void summariseFunction(Function& F);
+      void summariseAnnotations(const Constant* C);
+      void collectFunctions(const Constant* C, llvm::StringSet<>& funcs);
+      void addEscaping(const Function* F, llvm::StringSet<>& funcs);
+      string toRelativeKey(StringRef key);
+      string fromRelativeKey(StringRef key);
+  };
+
+  // The merged call graph of a set of module summaries, used to find the
+  // function bodies that are live: those reachable from main() or from a
+  // function whose address escapes (which covers sandbox entrypoints, since
+  // they are annotated, and indirect call targets).
+  class SummaryGraph {
+    public:
+      SummaryGraph() : hasMain(false) { }
+      void add(ModuleSummary& summary);
+      void computeLiveFunctions();
+      bool isLive(const Function* F, StringRef moduleId);
+      bool isLive(StringRef key) { return live.count(key); }
+      int getNumLiveFunctions() { return live.size(); }
+
+    private:
+      bool hasMain;
+      llvm::StringSet<> defined;
+      llvm::StringSet<> roots;
+      StringMap<vector<string> > callees;
+      llvm::StringSet<> live;
+  };
+}
+
+#endif
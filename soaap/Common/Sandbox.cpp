@@ -4,7 +4,6 @@
 #include "Util/ContextUtils.h"
 #include "Util/DebugUtils.h"
 #include "Util/LLVMAnalyses.h"
-#include "Util/PrettyPrinters.h"
 #include "Util/SandboxUtils.h"
 #include "soaap.h"
 
@@ -24,7 +23,7 @@ Sandbox::Sandbox(string n, int i, Function* entry, bool p, Module& m, int o, int
   : Context(CK_SANDBOX), name(n), nameIdx(i), entryPoint(entry), persistent(p), module(m), overhead(o), clearances(c) {
 }
 
-Sandbox::Sandbox(string n, int i, InstVector& r, bool p, Module& m) 
+Sandbox::Sandbox(string n, int i, CodeRegion& r, bool p, Module& m) 
   : Context(CK_SANDBOX), name(n), nameIdx(i), region(r), entryPoint(NULL), persistent(p), module(m), overhead(0), clearances(0) {
 }
 
@@ -71,21 +70,13 @@ Function* Sandbox::getEntryPoint() {
 
 Function* Sandbox::getEnclosingFunc() {
   if (entryPoint == NULL) {
-    Instruction* firstI = region.front();
-    return firstI->getParent()->getParent();
+    return region.getFunction(); // NULL for empty sandboxes
   }
   return NULL;
 } 
 
 bool Sandbox::isRegionWithin(Function* F) {
-  if (entryPoint == NULL) {
-    if (!region.empty()) {
-      Instruction* firstI = region.front();
-      Function* enclosingFunc = firstI->getParent()->getParent();
-      return enclosingFunc == F;
-    }
-  }
-  return false;
+  return entryPoint == NULL && !region.empty() && region.getFunction() == F;
 }
 
 string Sandbox::getName() {
@@ -160,7 +151,7 @@ bool Sandbox::containsInstruction(Instruction* I) {
   if (entryPoint == NULL) {
     // This is a sandboxed region; first search the top-level
     // instructions in it.
-    if (find(region.begin(), region.end(), I) != region.end()) {
+    if (region.contains(I)) {
       return true;
     }
   }
@@ -177,7 +168,7 @@ void Sandbox::findSandboxedFunctions() {
   FunctionVector initialFuncs;
   if (entryPoint == NULL) {
     // scan the code region for the set of top-level functions being called
-    for (Instruction* I : region) {
+    for (Instruction* I : region.getInstructions()) {
       if (CallInst* C  = dyn_cast<CallInst>(I)) {
         for (Function* F : CallGraphUtils::getCallees(C, this, module)) {
           if (F->isDeclaration()) continue;
@@ -231,7 +222,7 @@ void Sandbox::findSandboxedCalls() {
   // if this sandbox doesn't have an entrypoint then search region instructions also
   // At the same time also record top-level call insts
   if (entryPoint == NULL) {
-    for (Instruction* I : region) {
+    for (Instruction* I : region.getInstructions()) {
       if (CallInst* C = dyn_cast<CallInst>(I)) {
         callInsts.push_back(C);
         tlCallInsts.push_back(C);
@@ -535,13 +526,8 @@ void Sandbox::findAllowedSysCalls() {
           // is this annotate call within this sandbox?
           bool inThisSandbox = false;
           if (entryPoint == NULL) {
-            // first scan the code region for annotateCall
-            for (Instruction* I : region) {
-              if (I == annotateCall) {
-                inThisSandbox = true;
-                break;
-              }
-            }
+            // first check the code region for annotateCall
+            inThisSandbox = region.contains(annotateCall);
           }
           if (!inThisSandbox) {
             // check called functions
@@ -585,72 +571,6 @@ void Sandbox::findAllowedSysCalls() {
 
 
 // check that all entrypoint calls are dominated by a creation call
-void Sandbox::validateCreationPoints() {
-  // We traverse the whole-program CFG starting from main, treating sandbox 
-  // creation-point calls as leaves (i.e. we don't traverse past them). If
-  // after this, an entrypoint call is still reached, then a path has been
-  // found without going through a creation-point call.
-  if (Function* MainFunc = module.getFunction("main")) {
-    BasicBlock& EntryBB = MainFunc->getEntryBlock();
-    BasicBlockVector visited;
-    InstTrace trace;
-    validateCreationPointsHelper(&EntryBB, visited, trace);
-  }
-}
-
-bool Sandbox::validateCreationPointsHelper(BasicBlock* BB, BasicBlockVector& visited, InstTrace& trace) {
-  if (find(visited.begin(), visited.end(), BB) != visited.end()) {
-    return false;
-  }
-  else {
-    // Check instructions in BB (in order):
-    //  - if a creation-point call, then stop.
-    //  - if an entrypoint call, then flag an error.
-    //  - if a function call, recurse on callee's entry bb
-    // Otherwise, recurse on BB's successors
-    visited.push_back(BB);
-    for (Instruction& I : *BB) {
-      if (find(creationPoints.begin(), creationPoints.end(), &I) != creationPoints.end()) {
-        return true;
-      }
-      else if (CallInst* CI = dyn_cast<CallInst>(&I)) {
-        trace.push_front(CI);
-        FunctionSet callees = CallGraphUtils::getCallees(CI, ContextUtils::PRIV_CONTEXT, module);
-        for (Function* callee : callees) {
-          if (callee->isDeclaration()) continue;
-          if (callee == entryPoint) {
-            // error
-            outs() << "\n";
-            outs() << " *** Found call to sandbox entrypoint \"" << entryPoint->getName() << "\" that is not preceded by sandbox creation\n";
-            outs() << " Possible trace:\n";
-            PrettyPrinters::ppTrace(trace);
-            outs() << "\n";
-            trace.pop_front();
-            return false;
-          }
-          else if (!callee->isDeclaration()) {
-            // recurse on callee's entry bb
-            if (validateCreationPointsHelper(&callee->getEntryBlock(), visited, trace)) {
-              trace.pop_front();
-              return true; // all paths through callee have a creation-point
-            }
-          }
-        }
-        trace.pop_front();
-      }
-    }
-
-    // Recurse on BB's successors
-    bool creationOnAllPaths = (succ_begin(BB) != succ_end(BB)); // true <-> at least one successor bb
-    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI) {
-      BasicBlock* SuccBB = *SI;
-      creationOnAllPaths = creationOnAllPaths && validateCreationPointsHelper(SuccBB, visited, trace);
-    }
-
-    return creationOnAllPaths;
-  }
-}
-
 void Sandbox::findPrivateData() {
   
   // initialise with pointers to annotated fields and uses of annotated global variables
@@ -730,6 +650,10 @@ ValueSet Sandbox::getPrivateData() {
   return privateData;
 }
 
-InstVector Sandbox::getRegion() {
-  return region;
+InstVector& Sandbox::getRegion() {
+  return region.getInstructions();
+}
+
+bool Sandbox::isInRegion(Instruction* I) {
+  return entryPoint == NULL && region.contains(I);
 }
@@ -2,6 +2,7 @@
 #define SOAAP_COMMON_SANDBOX_H
 
 #include "Analysis/InfoFlow/Context.h"
+#include "Common/CodeRegion.h"
 #include "Common/Typedefs.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/Analysis/CallGraph.h"
@@ -13,7 +14,7 @@ namespace soaap {
   class Sandbox : public Context {
     public:
       Sandbox(string n, int i, Function* entry, bool p, Module& m, int o, int c);
-      Sandbox(string n, int i, InstVector& region, bool p, Module& m);
+      Sandbox(string n, int i, CodeRegion& region, bool p, Module& m);
       string getName();
       int getNameIdx();
       Function* getEntryPoint();
@@ -22,7 +23,8 @@ namespace soaap {
       FunctionVector getFunctions();
       CallInstVector getCalls();
       CallInstVector getTopLevelCalls();
-      InstVector getRegion();
+      InstVector& getRegion();
+      bool isInRegion(Instruction* I);
       GlobalVariableIntMap getGlobalVarPerms();
       ValueFunctionSetMap getCapabilities();
       bool isAllowedToReadGlobalVar(GlobalVariable* gv);
@@ -38,7 +40,6 @@ namespace soaap {
       bool containsFunction(Function* F);
       bool containsInstruction(Instruction* I);
       bool hasCallgate(Function* F);
-      void validateCreationPoints();
       void reinit();
       static bool classof(const Context* C) { return C->getKind() == CK_SANDBOX; }
 
@@ -47,7 +48,7 @@ namespace soaap {
       string name;
       int nameIdx;
       Function* entryPoint;
-      InstVector region;
+      CodeRegion region;
       bool persistent;
       int clearances;
       FunctionVector callgates;
@@ -73,7 +74,6 @@ namespace soaap {
       void findAllowedSysCalls();
       void findCreationPoints();
       void findPrivateData();
-      bool validateCreationPointsHelper(BasicBlock* BB, BasicBlockVector& visited, InstTrace& trace);
   };
   typedef SmallVector<Sandbox*,16> SandboxVector;
 }
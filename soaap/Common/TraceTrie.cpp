@@ -0,0 +1,20 @@
+#include "Common/TraceTrie.h"
+
+using namespace soaap;
+
+int TraceTrie::insert(InstTrace& trace) {
+  int parent = ROOT;
+  for (InstTrace::reverse_iterator I=trace.rbegin(), E=trace.rend(); I!=E; I++) {
+    pair<int,Instruction*> key(parent, *I);
+    DenseMap<pair<int,Instruction*>,int>::iterator child = children.find(key);
+    if (child == children.end()) {
+      nodes.push_back(make_pair(*I, parent));
+      parent = nodes.size()-1;
+      children[key] = parent;
+    }
+    else {
+      parent = child->second;
+    }
+  }
+  return parent;
+}
@@ -0,0 +1,35 @@
+#ifndef SOAAP_COMMON_TRACETRIE_H
+#define SOAAP_COMMON_TRACETRIE_H
+
+#include "Common/Typedefs.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Stores call traces once, sharing common suffixes (i.e. the calls nearest
+  // to main(), which most traces have in common). Each node is a call
+  // instruction and its parent is the call that led to it. A trace is
+  // identified by the id of its innermost node.
+  class TraceTrie {
+    public:
+      static const int ROOT = -1;
+
+      // trace is ordered innermost call first
+      int insert(InstTrace& trace);
+      Instruction* getInst(int id) { return nodes[id].first; }
+      int getParent(int id) { return nodes[id].second; }
+      int size() { return nodes.size(); }
+
+    private:
+      vector<pair<Instruction*,int> > nodes;
+      DenseMap<pair<int,Instruction*>,int> children;
+  };
+}
+
+#endif
@@ -1,83 +1,332 @@
 #include "Common/XO.h"
 
 #include "Common/Debug.h"
+#include "Common/XOSinks.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 
 using namespace llvm;
 using namespace soaap;
 
-list<xo_handle_t*> XO::handles;
+list<XOSink*> XO::sinks;
+bool XO::buffering = false;
+vector<XORecord> XO::records;
+BumpPtrAllocator XO::arena;
 
-// use llvm's output stream for stdout to get consistent buffering behaviour
-int llvm_write(void* opaque, const char* str) {
-  outs() << str;
-  return 0;
+void XO::create(ReportOutputFormat format) {
+  SDEBUG("soaap.xo", 3, dbgs() << "Creating stdout sink\n");
+  // use llvm's output stream for stdout to get consistent buffering
+  // behaviour with the rest of SOAAP's output
+  XOSink* sink = XOSink::create(format, &outs(), false);
+  buffering |= !sink->isStreaming();
+  sinks.push_back(sink);
 }
 
-void XO::create(int style, int flags) {
-  SDEBUG("soaap.xo", 3, dbgs() << "Creating non-file handle with style "
-                               << style << " and flags " << flags << "\n");
-  xo_handle_t* handle = xo_create(style, flags);
-  handles.push_back(handle);
-  // use llvm's output stream for stdout
-  xo_set_writer(handle, NULL, llvm_write, NULL, NULL);
+error_code XO::create_to_file(ReportOutputFormat format, string filename) {
+  SDEBUG("soaap.xo", 3, dbgs() << "Creating file sink for \"" << filename << "\"\n");
+  error_code EC;
+  sys::fs::OpenFlags flags = format == ReportOutputFormat::Binary ? sys::fs::F_None : sys::fs::F_Text;
+  raw_fd_ostream* out = new raw_fd_ostream(filename, EC, flags);
+  if (EC) {
+    delete out;
+    return EC;
+  }
+  // reports can be large, so write them in big chunks
+  out->SetBufferSize(1 << 20);
+  XOSink* sink = XOSink::create(format, out, true);
+  buffering |= !sink->isStreaming();
+  sinks.push_back(sink);
+  return EC;
 }
 
-void XO::create_to_file(FILE* fp, int style, int flags) {
-  SDEBUG("soaap.xo", 3, dbgs() << "Creating file handle with style "
-                               << style << " and flags " << flags << "\n");
-  handles.push_back(xo_create_to_file(fp, style, flags));
+void XO::create_for_formats(list<ReportOutputFormat>& formats, string prefix) {
+  for (ReportOutputFormat format : formats) {
+    string extension, name;
+    switch (format) {
+      case ReportOutputFormat::Text: {
+        SDEBUG("soaap.xo", 3, dbgs() << "Text selected\n");
+        create(format);
+        continue;
+      }
+      case ReportOutputFormat::HTML: extension = ".html"; name = "HTML"; break;
+      case ReportOutputFormat::JSON: extension = ".json"; name = "JSON"; break;
+      case ReportOutputFormat::NDJSON: extension = ".ndjson"; name = "NDJSON"; break;
+      case ReportOutputFormat::XML: extension = ".xml"; name = "XML"; break;
+      case ReportOutputFormat::Binary: extension = ".soaap.bin"; name = "binary"; break;
+    }
+    string filename = prefix + extension;
+    SDEBUG("soaap.xo", 3, dbgs() << name << " selected, opening file \"" << filename << "\"\n");
+    if (error_code EC = create_to_file(format, filename)) {
+      errs() << "Error creating " << name << " report file: " << EC.message() << "\n";
+    }
+  }
+}
+
+// Serialise buffered records to the sinks that don't stream them as they
+// are emitted, and reclaim their memory.
+void XO::flush() {
+  SDEBUG("soaap.xo", 3, dbgs() << "Flushing " << records.size() << " records\n");
+  for (XOSink* sink : sinks) {
+    if (!sink->isStreaming()) {
+      for (XORecord& record : records) {
+        sink->write(record);
+      }
+    }
+  }
+  records.clear();
+  arena.Reset();
 }
 
 void XO::finish() {
-  for (xo_handle_t* handle : handles) {
-    xo_finish_h(handle);
+  flush();
+  for (XOSink* sink : sinks) {
+    sink->finish();
+    delete sink;
   }
+  sinks.clear();
+  buffering = false;
 }
 
-void XO::open_container(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_open_container_h(handle, name);
+StringRef XO::save(StringRef str) {
+  char* buf = arena.Allocate<char>(str.size());
+  memcpy(buf, str.data(), str.size());
+  return StringRef(buf, str.size());
+}
+
+void XO::append(XORecordKind kind, const char* name) {
+  XORecord record = { kind, save(name), NULL, 0 };
+  append(record);
+}
+
+void XO::append(XORecord& record) {
+  // stdout is shared with SOAAP's progress output, so streaming sinks write
+  // each record as soon as it is emitted to keep the two in order.
+  for (XOSink* sink : sinks) {
+    if (sink->isStreaming()) {
+      sink->write(record);
+    }
   }
+  if (buffering) {
+    records.push_back(record);
+    if (records.size() >= FlushThreshold) {
+      flush();
+    }
+  }
+  else {
+    // all the sinks are streaming, so the record is no longer needed
+    arena.Reset();
+  }
+}
+
+void XO::open_container(const char* name) {
+  append(XORecordKind::OpenContainer, name);
 }
 
 void XO::close_container(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_close_container_h(handle, name);
-  }
+  append(XORecordKind::CloseContainer, name);
 }
 
 void XO::open_list(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_open_list_h(handle, name);
-  }
+  append(XORecordKind::OpenList, name);
 }
 
 void XO::close_list(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_close_list_h(handle, name);
-  }
+  append(XORecordKind::CloseList, name);
 }
 
 void XO::open_instance(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_open_instance_h(handle, name);
-  }
+  append(XORecordKind::OpenInstance, name);
 }
 
 void XO::close_instance(const char* name) {
-  for (xo_handle_t* handle : handles) {
-    xo_close_instance_h(handle, name);
+  append(XORecordKind::CloseInstance, name);
+}
+
+// Format the value of a field using its printf-style format, consuming the
+// corresponding arguments, and type the field by its conversion.
+static void formatValue(StringRef fmt, va_list* args, XOField& field, string& text) {
+  int numConversions = 0;
+  bool hasLiteralText = false;
+  char buf[128];
+  field.kind = XOFieldKind::String;
+  for (size_t i=0; i<fmt.size(); i++) {
+    if (fmt[i] != '%') {
+      text += fmt[i];
+      hasLiteralText = true;
+      continue;
+    }
+    if (i+1 < fmt.size() && fmt[i+1] == '%') {
+      text += '%';
+      hasLiteralText = true;
+      i++;
+      continue;
+    }
+    // %[flags][width][.precision][length]conversion
+    size_t start = i++;
+    while (i < fmt.size() && strchr("-+ #0123456789.", fmt[i])) i++;
+    size_t lengthStart = i;
+    while (i < fmt.size() && strchr("hlLqjzt", fmt[i])) i++;
+    if (i == fmt.size()) {
+      break;
+    }
+    StringRef length = fmt.slice(lengthStart, i);
+    string spec = fmt.slice(start, i+1).str();
+    char conversion = fmt[i];
+    numConversions++;
+    switch (conversion) {
+      case 'd':
+      case 'i': {
+        field.kind = XOFieldKind::Integer;
+        if (length == "ll" || length == "q" || length == "j") {
+          field.intValue = va_arg(*args, long long);
+          snprintf(buf, sizeof(buf), spec.c_str(), (long long)field.intValue);
+        }
+        else if (length == "l" || length == "z" || length == "t") {
+          field.intValue = va_arg(*args, long);
+          snprintf(buf, sizeof(buf), spec.c_str(), (long)field.intValue);
+        }
+        else {
+          field.intValue = va_arg(*args, int);
+          snprintf(buf, sizeof(buf), spec.c_str(), (int)field.intValue);
+        }
+        text += buf;
+        break;
+      }
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o': {
+        field.kind = XOFieldKind::Unsigned;
+        if (length == "ll" || length == "q" || length == "j") {
+          field.unsignedValue = va_arg(*args, unsigned long long);
+          snprintf(buf, sizeof(buf), spec.c_str(), (unsigned long long)field.unsignedValue);
+        }
+        else if (length == "l" || length == "z" || length == "t") {
+          field.unsignedValue = va_arg(*args, unsigned long);
+          snprintf(buf, sizeof(buf), spec.c_str(), (unsigned long)field.unsignedValue);
+        }
+        else {
+          field.unsignedValue = va_arg(*args, unsigned int);
+          snprintf(buf, sizeof(buf), spec.c_str(), (unsigned int)field.unsignedValue);
+        }
+        text += buf;
+        break;
+      }
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G': {
+        field.kind = XOFieldKind::Real;
+        field.realValue = va_arg(*args, double);
+        snprintf(buf, sizeof(buf), spec.c_str(), field.realValue);
+        text += buf;
+        break;
+      }
+      case 'c': {
+        field.kind = XOFieldKind::String;
+        snprintf(buf, sizeof(buf), spec.c_str(), va_arg(*args, int));
+        text += buf;
+        break;
+      }
+      case 'p': {
+        field.kind = XOFieldKind::String;
+        snprintf(buf, sizeof(buf), spec.c_str(), va_arg(*args, void*));
+        text += buf;
+        break;
+      }
+      case 's': {
+        field.kind = XOFieldKind::String;
+        const char* str = va_arg(*args, const char*);
+        if (spec == "%s") {
+          text += str ? str : "(null)";
+        }
+        else {
+          int len = snprintf(NULL, 0, spec.c_str(), str);
+          vector<char> strBuf(len+1);
+          snprintf(strBuf.data(), len+1, spec.c_str(), str);
+          text += strBuf.data();
+        }
+        break;
+      }
+      default: {
+        errs() << "ERROR: unsupported conversion \"" << spec << "\" in XO format string\n";
+      }
+    }
+  }
+  if (numConversions != 1 || hasLiteralText) {
+    // only the text is meaningful
+    field.kind = XOFieldKind::String;
   }
 }
 
+// Literal text, displayed but not encoded
+static XOField makeTextField(StringRef text) {
+  XOField field;
+  field.kind = XOFieldKind::Text;
+  field.text = text;
+  field.intValue = 0;
+  field.display = true;
+  field.encode = false;
+  return field;
+}
+
 void XO::emit(const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  for (xo_handle_t* handle : handles) {
-    SDEBUG("soaap.xo", 3, dbgs() << "Emitting format string to handle\n");
-    xo_emit_hv(handle, fmt, args);
+
+  SmallVector<XOField,8> fields;
+  StringRef fmtRef(fmt);
+  string text;
+  for (size_t i=0; i<fmtRef.size(); i++) {
+    char c = fmtRef[i];
+    if ((c == '{' || c == '}') && i+1 < fmtRef.size() && fmtRef[i+1] == c) {
+      // escaped brace
+      text += c;
+      i++;
+    }
+    else if (c == '{') {
+      if (!text.empty()) {
+        fields.push_back(makeTextField(save(text)));
+        text.clear();
+      }
+      // {modifiers:name/format}
+      size_t end = fmtRef.find('}', i);
+      StringRef fieldStr = fmtRef.slice(i+1, end);
+      i = (end == StringRef::npos) ? fmtRef.size() : end;
+      size_t colon = fieldStr.find(':');
+      StringRef modifiers = colon == StringRef::npos ? StringRef() : fieldStr.substr(0, colon);
+      StringRef rest = colon == StringRef::npos ? fieldStr : fieldStr.substr(colon+1);
+      pair<StringRef,StringRef> nameAndFormat = rest.split('/');
+      StringRef format = nameAndFormat.second.empty() ? "%s" : nameAndFormat.second;
+      XOField field;
+      field.intValue = 0;
+      string value;
+      formatValue(format, &args, field, value);
+      field.name = save(nameAndFormat.first);
+      field.text = save(value);
+      field.display = !modifiers.count('e');
+      field.encode = !modifiers.count('d');
+      fields.push_back(field);
+    }
+    else {
+      text += c;
+    }
+  }
+  if (!text.empty()) {
+    fields.push_back(makeTextField(save(text)));
   }
   va_end(args);
+
+  XOField* fieldsInArena = arena.Allocate<XOField>(fields.size());
+  copy(fields.begin(), fields.end(), fieldsInArena);
+  XORecord record = { XORecordKind::Emit, StringRef(), fieldsInArena, (unsigned)fields.size() };
+  append(record);
 }
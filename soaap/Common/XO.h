@@ -1,36 +1,92 @@
 #ifndef SOAAP_COMMON_XO_H
 #define SOAAP_COMMON_XO_H
 
-#include <cstdio>
+#include "Common/CmdLineOpts.h"
 
-extern "C" {
-#include <libxo/xo.h>
-}
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
 
 #include <list>
+#include <string>
+#include <system_error>
+#include <vector>
 
+using namespace llvm;
 using namespace std;
 
 namespace soaap {
+  class XOSink;
+
+  enum class XORecordKind {
+    OpenContainer, CloseContainer, OpenList, CloseList, OpenInstance,
+    CloseInstance, Emit
+  };
+
+  enum class XOFieldKind {
+    Text,       // literal text, which has no name
+    String, Integer, Unsigned, Real
+  };
+
+  // A single piece of an emitted record, typed by its format's conversion
+  // when the record is built so that sinks never reparse it. Fields whose
+  // format has several conversions (or literal text) are strings. As with
+  // libxo's field roles, "d" fields are only displayed (text and HTML) and
+  // "e" fields are only encoded (JSON, XML and binary).
+  struct XOField {
+    XOFieldKind kind;
+    StringRef name;
+    StringRef text; // as displayed, i.e. formatted using the field's format
+    union {
+      int64_t intValue;
+      uint64_t unsignedValue;
+      double realValue;
+    };
+    bool display;
+    bool encode;
+  };
+
+  // Records are formatted once, when they are emitted, and then serialised by
+  // each of the sinks. Their strings live in XO's arena until the next flush.
+  struct XORecord {
+    XORecordKind kind;
+    StringRef name;       // of the container, list or instance
+    XOField* fields;      // for Emit records
+    unsigned numFields;
+  };
+
+  // Structured report output, using libxo-style format strings, e.g.:
+  //   XO::emit(" *** Sandbox \"{:sandbox/%s}\" at {e:line/%d}\n", name, line);
+  // Only the %s, %d, %u, %x, %c, %f and %p conversions (with the usual
+  // flags and length modifiers) are supported.
   class XO {
     public:
-      static void create(int style, int flags);
-      static void create_to_file(FILE* fp, int style, int flags);
+      static void create(ReportOutputFormat format);
+      static error_code create_to_file(ReportOutputFormat format, string filename);
+      // text goes to stdout and the other formats to <prefix>.<extension>
+      static void create_for_formats(list<ReportOutputFormat>& formats, string prefix);
+      static void flush();
       static void finish();
 
       static void open_container(const char* name);
       static void close_container(const char* name);
-      
+
       static void open_list(const char* name);
       static void close_list(const char* name);
       static void open_instance(const char* name);
       static void close_instance(const char* name);
-      
+
       static void emit(const char* fmt, ...);
 
     private:
-      static list<xo_handle_t*> handles;
-      
+      static list<XOSink*> sinks;
+      static bool buffering;
+      static vector<XORecord> records;
+      static BumpPtrAllocator arena;
+      static const unsigned FlushThreshold = 16384;
+
+      static void append(XORecordKind kind, const char* name);
+      static void append(XORecord& record);
+      static StringRef save(StringRef str);
   };
 }
 
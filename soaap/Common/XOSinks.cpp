@@ -0,0 +1,682 @@
+#include "Common/XOSinks.h"
+
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+
+#include <cstring>
+
+using namespace llvm;
+using namespace soaap;
+
+XOSink* XOSink::create(ReportOutputFormat format, raw_ostream* out, bool ownsStream) {
+  switch (format) {
+    case ReportOutputFormat::Text: return new XOTextSink(out, ownsStream);
+    case ReportOutputFormat::JSON: return new XOJSONSink(out, ownsStream);
+    case ReportOutputFormat::NDJSON: return new XONDJSONSink(out, ownsStream);
+    case ReportOutputFormat::XML: return new XOXMLSink(out, ownsStream);
+    case ReportOutputFormat::HTML: return new XOHTMLSink(out, ownsStream);
+    case ReportOutputFormat::Binary: return new XOBinarySink(out, ownsStream);
+    default: {
+      report_fatal_error("Unrecognised report output format");
+    }
+  }
+}
+
+XOSink::~XOSink() {
+  if (ownsStream) {
+    delete out;
+  }
+}
+
+void XOSink::writeEscaped(raw_ostream& os, StringRef str, bool json) {
+  for (char c : str) {
+    if (json) {
+      switch (c) {
+        case '"': os << "\\\""; break;
+        case '\\': os << "\\\\"; break;
+        case '\n': os << "\\n"; break;
+        case '\t': os << "\\t"; break;
+        default: {
+          if ((unsigned char)c < 0x20) {
+            os << format("\\u%04x", c);
+          }
+          else {
+            os << c;
+          }
+        }
+      }
+    }
+    else {
+      switch (c) {
+        case '&': os << "&amp;"; break;
+        case '<': os << "&lt;"; break;
+        case '>': os << "&gt;"; break;
+        case '"': os << "&quot;"; break;
+        default: os << c;
+      }
+    }
+  }
+}
+
+// A field's value as a JSON number, or as a string if it isn't numeric
+void XOSink::writeJSONValue(raw_ostream& os, XOField& field) {
+  switch (field.kind) {
+    case XOFieldKind::Integer: os << field.intValue; break;
+    case XOFieldKind::Unsigned: os << field.unsignedValue; break;
+    case XOFieldKind::Real: os << format("%.17g", field.realValue); break;
+    default: {
+      os << "\"";
+      writeEscaped(os, field.text, true);
+      os << "\"";
+    }
+  }
+}
+
+void XOSink::indent(int depth) {
+  out->indent(2*depth);
+}
+
+//
+// Text: literal text and the values of displayed fields
+//
+void XOTextSink::write(XORecord& record) {
+  if (record.kind == XORecordKind::Emit) {
+    for (unsigned i=0; i<record.numFields; i++) {
+      XOField& field = record.fields[i];
+      if (field.display) {
+        *out << field.text;
+      }
+    }
+  }
+}
+
+//
+// JSON: containers and instances are objects, lists are arrays and encoded
+// fields are members.
+//
+void XOJSONSink::beginMember() {
+  if (!started) {
+    *out << "{";
+    Frame root = { false, 0 };
+    frames.push_back(root);
+    started = true;
+  }
+  Frame& frame = frames.back();
+  if (frame.numMembers++ > 0) {
+    *out << ",";
+  }
+  *out << "\n";
+  indent(frames.size());
+}
+
+void XOJSONSink::open(bool isArray) {
+  *out << (isArray ? "[" : "{");
+  Frame frame = { isArray, 0 };
+  frames.push_back(frame);
+}
+
+void XOJSONSink::close() {
+  Frame frame = frames.back();
+  frames.pop_back();
+  if (frame.numMembers > 0) {
+    *out << "\n";
+    indent(frames.size());
+  }
+  *out << (frame.isArray ? "]" : "}");
+}
+
+void XOJSONSink::write(XORecord& record) {
+  switch (record.kind) {
+    case XORecordKind::OpenContainer:
+    case XORecordKind::OpenList:
+    case XORecordKind::OpenInstance: {
+      beginMember();
+      if (!frames.back().isArray) {
+        *out << "\"";
+        writeEscaped(*out, record.name, true);
+        *out << "\": ";
+      }
+      open(record.kind == XORecordKind::OpenList);
+      break;
+    }
+    case XORecordKind::CloseContainer:
+    case XORecordKind::CloseList:
+    case XORecordKind::CloseInstance: {
+      if (frames.size() > 1) {
+        close();
+      }
+      break;
+    }
+    case XORecordKind::Emit: {
+      for (unsigned i=0; i<record.numFields; i++) {
+        XOField& field = record.fields[i];
+        if (!field.encode || field.kind == XOFieldKind::Text) {
+          continue;
+        }
+        beginMember();
+        *out << "\"";
+        writeEscaped(*out, field.name, true);
+        *out << "\": ";
+        writeJSONValue(*out, field);
+      }
+      break;
+    }
+  }
+}
+
+void XOJSONSink::finish() {
+  if (started) {
+    while (!frames.empty()) {
+      close();
+    }
+    *out << "\n";
+  }
+  XOSink::finish();
+}
+
+//
+// NDJSON
+//
+void XONDJSONSink::Builder::beginMember(StringRef name) {
+  if (!frames.empty()) {
+    if (frames.back().second++ > 0) {
+      os << ",";
+    }
+    if (!frames.back().first) {
+      os << "\"";
+      writeEscaped(os, name, true);
+      os << "\":";
+    }
+  }
+}
+
+void XONDJSONSink::Builder::open(StringRef name, bool isArray) {
+  beginMember(name);
+  os << (isArray ? "[" : "{");
+  frames.push_back(make_pair(isArray, 0));
+}
+
+void XONDJSONSink::Builder::close() {
+  os << (frames.back().first ? "]" : "}");
+  frames.pop_back();
+}
+
+void XONDJSONSink::Builder::member(StringRef name, StringRef value) {
+  beginMember(name);
+  os << "\"";
+  writeEscaped(os, value, true);
+  os << "\"";
+}
+
+void XONDJSONSink::Builder::field(XOField& field) {
+  if (field.encode && field.kind != XOFieldKind::Text) {
+    beginMember(field.name);
+    writeJSONValue(os, field);
+  }
+}
+
+void XONDJSONSink::write(XORecord& r) {
+  switch (r.kind) {
+    case XORecordKind::OpenContainer:
+    case XORecordKind::OpenList:
+    case XORecordKind::OpenInstance: {
+      bool isArray = r.kind == XORecordKind::OpenList;
+      if (hoistedRecordDepth != -1) {
+        hoisted.open(r.name, isArray);
+      }
+      else if (hoistDepth != -1) {
+        if (r.kind == XORecordKind::OpenInstance) {
+          hoistedRecordDepth = depth;
+          hoisted.open(r.name, false);
+          hoisted.member("type", listNames.back());
+        }
+      }
+      else if (recordDepth != -1) {
+        if (isArray && r.name == "trace_node") {
+          hoistDepth = depth;
+        }
+        else {
+          record.open(r.name, isArray);
+        }
+      }
+      else if (r.kind == XORecordKind::OpenInstance) {
+        // start of a new top-level record
+        recordDepth = depth;
+        record.open(r.name, false);
+        record.member("type", listNames.empty() ? r.name.str() : listNames.back());
+      }
+      if (isArray) {
+        listNames.push_back(r.name.str());
+      }
+      depth++;
+      break;
+    }
+    case XORecordKind::CloseContainer:
+    case XORecordKind::CloseList:
+    case XORecordKind::CloseInstance: {
+      depth--;
+      if (r.kind == XORecordKind::CloseList && !listNames.empty()) {
+        listNames.pop_back();
+      }
+      if (hoistedRecordDepth != -1) {
+        hoisted.close();
+        if (depth == hoistedRecordDepth) {
+          *out << hoisted.str() << "\n";
+          hoisted.clear();
+          hoistedRecordDepth = -1;
+        }
+      }
+      else if (hoistDepth != -1) {
+        if (depth == hoistDepth) {
+          hoistDepth = -1;
+        }
+      }
+      else if (recordDepth != -1) {
+        record.close();
+        if (depth == recordDepth) {
+          *out << record.str() << "\n";
+          record.clear();
+          recordDepth = -1;
+        }
+      }
+      else if (r.kind == XORecordKind::CloseList) {
+        // the analysis producing this list has finished
+        out->flush();
+      }
+      break;
+    }
+    case XORecordKind::Emit: {
+      Builder& builder = hoistedRecordDepth != -1 ? hoisted : record;
+      if (recordDepth == -1) {
+        // fields outside of any instance become a record of their own
+        bool encoded = false;
+        for (unsigned i=0; i<r.numFields; i++) {
+          encoded |= r.fields[i].encode && r.fields[i].kind != XOFieldKind::Text;
+        }
+        if (!encoded) {
+          break;
+        }
+        builder.open("", false);
+        builder.member("type", listNames.empty() ? "soaap" : listNames.back());
+      }
+      for (unsigned i=0; i<r.numFields; i++) {
+        builder.field(r.fields[i]);
+      }
+      if (recordDepth == -1) {
+        builder.close();
+        *out << builder.str() << "\n";
+        builder.clear();
+      }
+      break;
+    }
+  }
+}
+
+//
+// XML: containers and instances are elements (lists are implicit) and
+// encoded fields are leaf elements.
+//
+void XOXMLSink::write(XORecord& record) {
+  switch (record.kind) {
+    case XORecordKind::OpenContainer:
+    case XORecordKind::OpenInstance: {
+      indent(depth++);
+      *out << "<" << record.name << ">\n";
+      break;
+    }
+    case XORecordKind::CloseContainer:
+    case XORecordKind::CloseInstance: {
+      indent(--depth);
+      *out << "</" << record.name << ">\n";
+      break;
+    }
+    case XORecordKind::OpenList:
+    case XORecordKind::CloseList: {
+      break;
+    }
+    case XORecordKind::Emit: {
+      for (unsigned i=0; i<record.numFields; i++) {
+        XOField& field = record.fields[i];
+        if (!field.encode || field.kind == XOFieldKind::Text) {
+          continue;
+        }
+        indent(depth);
+        *out << "<" << field.name << ">";
+        writeEscaped(*out, field.text, false);
+        *out << "</" << field.name << ">\n";
+      }
+      break;
+    }
+  }
+}
+
+//
+// HTML: a div per line of text output, with displayed fields tagged
+// with their names.
+//
+void XOHTMLSink::beginLine() {
+  if (!inLine) {
+    *out << "<div class=\"line\">\n";
+    inLine = true;
+  }
+}
+
+void XOHTMLSink::endLine() {
+  if (inLine) {
+    *out << "</div>\n";
+    inLine = false;
+  }
+}
+
+void XOHTMLSink::write(XORecord& record) {
+  if (record.kind != XORecordKind::Emit) {
+    return;
+  }
+  for (unsigned i=0; i<record.numFields; i++) {
+    XOField& field = record.fields[i];
+    if (!field.display) {
+      continue;
+    }
+    if (field.kind == XOFieldKind::Text) {
+      // literal text, which may span several lines
+      StringRef text = field.text;
+      while (!text.empty()) {
+        pair<StringRef,StringRef> lineAndRest = text.split('\n');
+        if (!lineAndRest.first.empty()) {
+          beginLine();
+          *out << "  <div class=\"text\">";
+          writeEscaped(*out, lineAndRest.first, false);
+          *out << "</div>\n";
+        }
+        if (lineAndRest.first.size() < text.size()) {
+          // there was a newline
+          beginLine();
+          endLine();
+        }
+        text = lineAndRest.second;
+      }
+    }
+    else {
+      beginLine();
+      *out << "  <div class=\"data\" data-tag=\"" << field.name << "\">";
+      writeEscaped(*out, field.text, false);
+      *out << "</div>\n";
+    }
+  }
+}
+
+void XOHTMLSink::finish() {
+  endLine();
+  XOSink::finish();
+}
+
+//
+// Binary: top-level instances become warnings, with their encoded fields
+// flattened, and trace nodes are gathered into a single table.
+//
+XOBinarySink::XOBinarySink(raw_ostream* out, bool ownsStream)
+  : XOSink(out, ownsStream), strings(1, '\0'), depth(0), warningDepth(-1),
+    traceNodeDepth(-1), traceNodePathBase(0), traceNodeId(-1) {
+  stringOffsets[""] = 0;
+}
+
+uint32_t XOBinarySink::intern(StringRef str) {
+  StringMap<uint32_t>::iterator I = stringOffsets.find(str);
+  if (I != stringOffsets.end()) {
+    return I->getValue();
+  }
+  uint32_t offset = strings.size();
+  strings.append(str.data(), str.size());
+  strings.push_back('\0');
+  stringOffsets[str] = offset;
+  return offset;
+}
+
+string XOBinarySink::qualify(StringRef name, unsigned from) {
+  string qualified;
+  for (unsigned i=from; i<path.size(); i++) {
+    qualified += path[i] + ".";
+  }
+  qualified += name;
+  return qualified;
+}
+
+// The value of an integer field, or def if it isn't one
+static int64_t getInteger(XOField& field, int64_t def) {
+  switch (field.kind) {
+    case XOFieldKind::Integer: return field.intValue;
+    case XOFieldKind::Unsigned: return field.unsignedValue;
+    default: return def;
+  }
+}
+
+void XOBinarySink::addTraceNodeField(StringRef name, XOField& value) {
+  if (name == "id") {
+    traceNodeId = getInteger(value, traceNodeId);
+  }
+  else if (name == "parent") {
+    traceNode.parent = getInteger(value, traceNode.parent);
+  }
+  else if (name == "function") {
+    traceNode.function = intern(value.text);
+  }
+  else if (name == "location.file") {
+    traceNode.file = intern(value.text);
+  }
+  else if (name == "location.line") {
+    traceNode.line = getInteger(value, traceNode.line);
+  }
+  else if (name == "location.library") {
+    traceNode.library = intern(value.text);
+  }
+}
+
+void XOBinarySink::addWarningField(StringRef name, XOField& value) {
+  binary_report::Warning& warning = warnings.back();
+  if (name == "sandbox" && !warning.sandbox) {
+    warning.sandbox = intern(value.text);
+  }
+  else if (name == "location.file" && !warning.file) {
+    warning.file = intern(value.text);
+  }
+  else if (name == "location.line" && !warning.line) {
+    warning.line = getInteger(value, warning.line);
+  }
+  else if (name == "trace_id") {
+    warning.traceId = getInteger(value, warning.traceId);
+  }
+  else if (name == "data_class.name") {
+    addPosting(labelIndex, value.text.str(), warnings.size()-1);
+  }
+  binary_report::Field field = { intern(name), intern(value.text) };
+  fields.push_back(field);
+  warning.numFields++;
+}
+
+void XOBinarySink::write(XORecord& r) {
+  switch (r.kind) {
+    case XORecordKind::OpenContainer:
+    case XORecordKind::OpenList:
+    case XORecordKind::OpenInstance: {
+      bool isArray = r.kind == XORecordKind::OpenList;
+      if (traceNodeDepth != -1) {
+        if (!isArray) {
+          path.push_back(r.name.str());
+        }
+      }
+      else if (warningDepth != -1) {
+        if (r.kind == XORecordKind::OpenInstance && r.name == "trace_node") {
+          traceNodeDepth = depth;
+          traceNodePathBase = path.size();
+          traceNodeId = -1;
+          binary_report::TraceNode node = { binary_report::NoTrace, 0, 0, 0, 0 };
+          traceNode = node;
+        }
+        else if (!isArray) {
+          path.push_back(r.name.str());
+        }
+      }
+      else if (r.kind == XORecordKind::OpenInstance) {
+        // start of a new warning
+        warningDepth = depth;
+        binary_report::Warning warning = {
+          intern(listNames.empty() ? r.name : StringRef(listNames.back())),
+          0, 0, 0, binary_report::NoTrace, (uint32_t)fields.size(), 0
+        };
+        warnings.push_back(warning);
+      }
+      if (isArray) {
+        listNames.push_back(r.name.str());
+      }
+      depth++;
+      break;
+    }
+    case XORecordKind::CloseContainer:
+    case XORecordKind::CloseList:
+    case XORecordKind::CloseInstance: {
+      depth--;
+      bool isArray = r.kind == XORecordKind::CloseList;
+      if (isArray && !listNames.empty()) {
+        listNames.pop_back();
+      }
+      if (traceNodeDepth != -1) {
+        if (depth == traceNodeDepth) {
+          if (traceNodeId >= 0) {
+            if (traceNodes.size() <= (unsigned)traceNodeId) {
+              binary_report::TraceNode missing = { binary_report::NoTrace, 0, 0, 0, 0 };
+              traceNodes.resize(traceNodeId+1, missing);
+            }
+            traceNodes[traceNodeId] = traceNode;
+          }
+          traceNodeDepth = -1;
+        }
+        else if (!isArray) {
+          path.pop_back();
+        }
+      }
+      else if (warningDepth != -1) {
+        if (depth == warningDepth) {
+          warningDepth = -1;
+          path.clear();
+        }
+        else if (!isArray) {
+          path.pop_back();
+        }
+      }
+      break;
+    }
+    case XORecordKind::Emit: {
+      for (unsigned i=0; i<r.numFields; i++) {
+        XOField& field = r.fields[i];
+        if (!field.encode || field.kind == XOFieldKind::Text) {
+          continue;
+        }
+        if (traceNodeDepth != -1) {
+          addTraceNodeField(qualify(field.name, traceNodePathBase), field);
+        }
+        else if (warningDepth != -1) {
+          addWarningField(qualify(field.name, 0), field);
+        }
+      }
+      break;
+    }
+  }
+}
+
+void XOBinarySink::addPosting(Index& index, string key, uint32_t warningIdx) {
+  intern(key);
+  vector<uint32_t>& postings = index[key];
+  if (postings.empty() || postings.back() != warningIdx) {
+    postings.push_back(warningIdx);
+  }
+}
+
+static StringRef baseName(StringRef file) {
+  return file.substr(file.find_last_of('/')+1);
+}
+
+template<typename T>
+static void writeTable(raw_ostream& out, vector<T>& table) {
+  if (!table.empty()) {
+    out.write((const char*)table.data(), table.size()*sizeof(T));
+  }
+}
+
+void XOBinarySink::finish() {
+  // build the indexes. Warnings are visited in order, so each run of
+  // postings is sorted.
+  Index sandboxIndex, functionIndex, fileIndex;
+  for (uint32_t i=0; i<warnings.size(); i++) {
+    binary_report::Warning warning = warnings[i];
+    if (warning.sandbox) {
+      addPosting(sandboxIndex, string(strings.data() + warning.sandbox), i);
+    }
+    if (warning.file) {
+      addPosting(fileIndex, baseName(strings.data() + warning.file).str(), i);
+    }
+    for (int32_t id = warning.traceId; id >= 0 && (unsigned)id < traceNodes.size(); id = traceNodes[id].parent) {
+      binary_report::TraceNode node = traceNodes[id];
+      if (node.function) {
+        addPosting(functionIndex, string(strings.data() + node.function), i);
+      }
+      if (node.file) {
+        addPosting(fileIndex, baseName(strings.data() + node.file).str(), i);
+      }
+    }
+  }
+
+  Index* indexes[] = { &sandboxIndex, &functionIndex, &fileIndex, &labelIndex };
+  vector<binary_report::IndexEntry> entries[4];
+  vector<uint32_t> postings;
+  for (int i=0; i<4; i++) {
+    for (Index::iterator I=indexes[i]->begin(), E=indexes[i]->end(); I!=E; I++) {
+      binary_report::IndexEntry entry = {
+        stringOffsets[I->first], (uint32_t)postings.size(), (uint32_t)I->second.size()
+      };
+      entries[i].push_back(entry);
+      postings.insert(postings.end(), I->second.begin(), I->second.end());
+    }
+  }
+
+  // keep the tables that follow the strings aligned
+  while (strings.size() % 4 != 0) {
+    strings.push_back('\0');
+  }
+
+  binary_report::Header header;
+  memcpy(header.magic, binary_report::Magic, sizeof(header.magic));
+  header.version = binary_report::Version;
+  uint32_t offset = sizeof(header);
+  binary_report::Table* tables[] = {
+    &header.strings, &header.warnings, &header.fields, &header.traceNodes,
+    &header.sandboxIndex, &header.functionIndex, &header.fileIndex,
+    &header.labelIndex, &header.postings
+  };
+  size_t counts[] = {
+    strings.size(), warnings.size(), fields.size(), traceNodes.size(),
+    entries[0].size(), entries[1].size(), entries[2].size(),
+    entries[3].size(), postings.size()
+  };
+  size_t entrySizes[] = {
+    1, sizeof(binary_report::Warning), sizeof(binary_report::Field),
+    sizeof(binary_report::TraceNode), sizeof(binary_report::IndexEntry),
+    sizeof(binary_report::IndexEntry), sizeof(binary_report::IndexEntry),
+    sizeof(binary_report::IndexEntry), sizeof(uint32_t)
+  };
+  for (int i=0; i<9; i++) {
+    tables[i]->offset = offset;
+    tables[i]->count = counts[i];
+    offset += counts[i]*entrySizes[i];
+  }
+
+  out->write((const char*)&header, sizeof(header));
+  out->write(strings.data(), strings.size());
+  writeTable(*out, warnings);
+  writeTable(*out, fields);
+  writeTable(*out, traceNodes);
+  for (int i=0; i<4; i++) {
+    writeTable(*out, entries[i]);
+  }
+  writeTable(*out, postings);
+  XOSink::finish();
+}
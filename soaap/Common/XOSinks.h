@@ -0,0 +1,157 @@
+#ifndef SOAAP_COMMON_XOSINKS_H
+#define SOAAP_COMMON_XOSINKS_H
+
+#include "Common/BinaryReport.h"
+#include "Common/CmdLineOpts.h"
+#include "Common/XO.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Serialises XO records in a particular output format.
+  class XOSink {
+    public:
+      static XOSink* create(ReportOutputFormat format, raw_ostream* out, bool ownsStream);
+      XOSink(raw_ostream* out, bool ownsStream) : out(out), ownsStream(ownsStream) { }
+      virtual ~XOSink();
+
+      // Streaming sinks write each record as soon as it is emitted, rather
+      // than when XO's buffer is flushed.
+      virtual bool isStreaming() { return !ownsStream; }
+      virtual void write(XORecord& record) = 0;
+      virtual void finish() { out->flush(); }
+
+    protected:
+      raw_ostream* out;
+      bool ownsStream;
+      static void writeEscaped(raw_ostream& os, StringRef str, bool json);
+      static void writeJSONValue(raw_ostream& os, XOField& field);
+      void indent(int depth);
+  };
+
+  class XOTextSink : public XOSink {
+    public:
+      XOTextSink(raw_ostream* out, bool ownsStream) : XOSink(out, ownsStream) { }
+      virtual void write(XORecord& record);
+  };
+
+  class XOJSONSink : public XOSink {
+    public:
+      XOJSONSink(raw_ostream* out, bool ownsStream) : XOSink(out, ownsStream), started(false) { }
+      virtual void write(XORecord& record);
+      virtual void finish();
+
+    private:
+      // open objects and arrays, and how many members each has so far
+      struct Frame {
+        bool isArray;
+        int numMembers;
+      };
+      vector<Frame> frames;
+      bool started;
+      void beginMember();
+      void open(bool isArray);
+      void close();
+  };
+
+  // Newline-delimited JSON: one self-contained JSON object per line for each
+  // top-level instance (e.g. warning), with a "type" member naming its list.
+  // Trace nodes are hoisted out into "trace_node" records of their own, which
+  // precede the records that refer to them (by "trace_id"). Records are
+  // written as soon as they are complete so that they can be consumed
+  // incrementally.
+  class XONDJSONSink : public XOSink {
+    public:
+      XONDJSONSink(raw_ostream* out, bool ownsStream) : XOSink(out, ownsStream), depth(0), recordDepth(-1), hoistDepth(-1), hoistedRecordDepth(-1) { }
+      virtual bool isStreaming() { return true; }
+      virtual void write(XORecord& record);
+
+    private:
+      // builds a compact JSON value
+      class Builder {
+        public:
+          string buf;
+          Builder() : os(buf) { }
+          void open(StringRef name, bool isArray);
+          void close();
+          void field(XOField& field);
+          void member(StringRef name, StringRef value);
+          string& str() { return os.str(); }
+          void clear() { os.flush(); buf.clear(); frames.clear(); }
+
+        private:
+          raw_string_ostream os;
+          vector<pair<bool,int> > frames; // isArray, number of members
+          void beginMember(StringRef name);
+      };
+      Builder record;
+      Builder hoisted;
+      vector<string> listNames;
+      int depth;
+      int recordDepth;
+      int hoistDepth;
+      int hoistedRecordDepth;
+  };
+
+  // Indexed binary report (see Common/BinaryReport.h). The tables are built
+  // up as records are flushed and written out, with their indexes, when the
+  // report is finished.
+  class XOBinarySink : public XOSink {
+    public:
+      XOBinarySink(raw_ostream* out, bool ownsStream);
+      virtual void write(XORecord& record);
+      virtual void finish();
+
+    private:
+      typedef map<string, vector<uint32_t> > Index;
+      string strings;
+      StringMap<uint32_t> stringOffsets;
+      vector<binary_report::Warning> warnings;
+      vector<binary_report::Field> fields;
+      vector<binary_report::TraceNode> traceNodes;
+      Index labelIndex;
+      vector<string> listNames;
+      vector<string> path; // containers and instances within the warning
+      int depth;
+      int warningDepth;
+      int traceNodeDepth;
+      unsigned traceNodePathBase;
+      int traceNodeId;
+      binary_report::TraceNode traceNode;
+      uint32_t intern(StringRef str);
+      string qualify(StringRef name, unsigned from);
+      void addTraceNodeField(StringRef name, XOField& value);
+      void addWarningField(StringRef name, XOField& value);
+      void addPosting(Index& index, string key, uint32_t warningIdx);
+  };
+
+  class XOXMLSink : public XOSink {
+    public:
+      XOXMLSink(raw_ostream* out, bool ownsStream) : XOSink(out, ownsStream), depth(0) { }
+      virtual void write(XORecord& record);
+
+    private:
+      int depth;
+  };
+
+  class XOHTMLSink : public XOSink {
+    public:
+      XOHTMLSink(raw_ostream* out, bool ownsStream) : XOSink(out, ownsStream), inLine(false) { }
+      virtual void write(XORecord& record);
+      virtual void finish();
+
+    private:
+      bool inLine;
+      void beginLine();
+      void endLine();
+  };
+}
+
+#endif
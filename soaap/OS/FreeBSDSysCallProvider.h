@@ -5,8 +5,8 @@
 
 namespace soaap {
   class FreeBSDSysCallProvider : public SysCallProvider {
-    public:
-      virtual void initSysCalls();
+    protected:
+      virtual void addSysCalls();
   };
 }
 
@@ -0,0 +1,9 @@
+#include "OS/LinuxSysCallProvider.h"
+
+using namespace soaap;
+
+void LinuxSysCallProvider::addSysCalls() {
+#define SYSCALL(number, name) addSysCall(number, name);
+#define SYSCALL_FD(number, name, fdArgIdx) addSysCall(number, name, true, fdArgIdx);
+#include "OS/LinuxSysCalls.def"
+}
@@ -1,6 +1,41 @@
 #include "OS/Sandbox/Capsicum.h"
 
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+
+#include <map>
+#include <sstream>
+
 using namespace soaap;
+using namespace llvm;
+
+// FreeBSD's values for the mmap(2) and open(2) flags that determine rights
+#define FREEBSD_PROT_READ 0x1
+#define FREEBSD_PROT_WRITE 0x2
+#define FREEBSD_PROT_EXEC 0x4
+#define FREEBSD_MAP_SHARED 0x1
+#define FREEBSD_O_ACCMODE 0x3
+#define FREEBSD_O_RDONLY 0x0
+#define FREEBSD_O_WRONLY 0x1
+#define FREEBSD_O_RDWR 0x2
+#define FREEBSD_O_APPEND 0x8
+#define FREEBSD_O_SHLOCK 0x10
+#define FREEBSD_O_EXLOCK 0x20
+#define FREEBSD_O_FSYNC 0x80
+#define FREEBSD_O_CREAT 0x200
+#define FREEBSD_O_TRUNC 0x400
+#define FREEBSD_O_EXEC 0x40000
+
+// Value of C's argument argIdx, if it is a constant
+static bool getConstantArg(CallInst* C, unsigned argIdx, uint64_t& val) {
+  if (C && argIdx < C->getNumArgOperands()) {
+    if (ConstantInt* CI = dyn_cast<ConstantInt>(C->getArgOperand(argIdx))) {
+      val = CI->getZExtValue();
+      return true;
+    }
+  }
+  return false;
+}
 
 Capsicum::Capsicum() {
   //FreeBSD system calls taken from FreeBSD/sys/kern/capabilities.conf
@@ -670,3 +705,154 @@ Capsicum::Capsicum() {
   ////
   addPermittedSysCall("yield");
 }
+
+bool Capsicum::getRightsForSysCall(string name, CallInst* C, vector<string>& rights) {
+  // Rights for mmap and openat depend on their other arguments, following
+  // kern_mmap and flags_to_rights in the FreeBSD kernel
+  if (name == "mmap") {
+    uint64_t prot, flags;
+    bool protKnown = getConstantArg(C, 2, prot);
+    bool shared = !getConstantArg(C, 3, flags) || (flags & FREEBSD_MAP_SHARED);
+    rights.push_back("CAP_MMAP");
+    if (!protKnown || (prot & FREEBSD_PROT_READ)) {
+      rights.push_back("CAP_MMAP_R");
+    }
+    if ((!protKnown || (prot & FREEBSD_PROT_WRITE)) && shared) {
+      rights.push_back("CAP_MMAP_W");
+    }
+    if (!protKnown || (prot & FREEBSD_PROT_EXEC)) {
+      rights.push_back("CAP_MMAP_X");
+    }
+    return true;
+  }
+  if (name == "openat") {
+    uint64_t flags;
+    rights.push_back("CAP_LOOKUP");
+    if (!getConstantArg(C, 2, flags)) {
+      const char* allRights[] = { "CAP_CREATE", "CAP_FEXECVE", "CAP_FLOCK",
+                                  "CAP_FSYNC", "CAP_FTRUNCATE", "CAP_READ",
+                                  "CAP_SEEK", "CAP_WRITE" };
+      rights.insert(rights.end(), begin(allRights), end(allRights));
+      return true;
+    }
+    if (flags & FREEBSD_O_EXEC) {
+      rights.push_back("CAP_FEXECVE");
+    }
+    else {
+      switch (flags & FREEBSD_O_ACCMODE) {
+        case FREEBSD_O_RDONLY:
+          rights.push_back("CAP_READ");
+          break;
+        case FREEBSD_O_RDWR:
+          rights.push_back("CAP_READ");
+          // fall through
+        case FREEBSD_O_WRONLY:
+          rights.push_back("CAP_WRITE");
+          if (!(flags & (FREEBSD_O_APPEND | FREEBSD_O_TRUNC))) {
+            rights.push_back("CAP_SEEK");
+          }
+          break;
+      }
+    }
+    if (flags & FREEBSD_O_CREAT) {
+      rights.push_back("CAP_CREATE");
+    }
+    if (flags & FREEBSD_O_TRUNC) {
+      rights.push_back("CAP_FTRUNCATE");
+    }
+    if (flags & FREEBSD_O_FSYNC) {
+      rights.push_back("CAP_FSYNC");
+    }
+    if (flags & (FREEBSD_O_EXLOCK | FREEBSD_O_SHLOCK)) {
+      rights.push_back("CAP_FLOCK");
+    }
+    return true;
+  }
+
+  // Taken from the rights required by each system call in rights(4)
+  static map<string,string> sysCallToRights;
+  if (sysCallToRights.empty()) {
+    sysCallToRights["__acl_aclcheck_fd"] = "CAP_ACL_CHECK";
+    sysCallToRights["__acl_delete_fd"] = "CAP_ACL_DELETE";
+    sysCallToRights["__acl_get_fd"] = "CAP_ACL_GET";
+    sysCallToRights["__acl_set_fd"] = "CAP_ACL_SET";
+    sysCallToRights["__mac_get_fd"] = "CAP_MAC_GET";
+    sysCallToRights["__mac_set_fd"] = "CAP_MAC_SET";
+    sysCallToRights["accept"] = "CAP_ACCEPT";
+    sysCallToRights["accept4"] = "CAP_ACCEPT";
+    sysCallToRights["aio_fsync"] = "CAP_FSYNC";
+    sysCallToRights["aio_read"] = "CAP_READ";
+    sysCallToRights["aio_write"] = "CAP_WRITE";
+    sysCallToRights["bind"] = "CAP_BIND";
+    sysCallToRights["bindat"] = "CAP_BINDAT";
+    sysCallToRights["connect"] = "CAP_CONNECT";
+    sysCallToRights["connectat"] = "CAP_CONNECTAT";
+    sysCallToRights["extattr_delete_fd"] = "CAP_EXTATTR_DELETE";
+    sysCallToRights["extattr_get_fd"] = "CAP_EXTATTR_GET";
+    sysCallToRights["extattr_list_fd"] = "CAP_EXTATTR_LIST";
+    sysCallToRights["extattr_set_fd"] = "CAP_EXTATTR_SET";
+    sysCallToRights["faccessat"] = "CAP_FSTAT, CAP_LOOKUP";
+    sysCallToRights["fchdir"] = "CAP_FCHDIR";
+    sysCallToRights["fchflags"] = "CAP_FCHFLAGS";
+    sysCallToRights["fchmod"] = "CAP_FCHMOD";
+    sysCallToRights["fchmodat"] = "CAP_FCHMODAT";
+    sysCallToRights["fchown"] = "CAP_FCHOWN";
+    sysCallToRights["fchownat"] = "CAP_FCHOWNAT";
+    sysCallToRights["fcntl"] = "CAP_FCNTL";
+    sysCallToRights["fexecve"] = "CAP_FEXECVE";
+    sysCallToRights["flock"] = "CAP_FLOCK";
+    sysCallToRights["fpathconf"] = "CAP_FPATHCONF";
+    sysCallToRights["fstat"] = "CAP_FSTAT";
+    sysCallToRights["fstatat"] = "CAP_FSTATAT";
+    sysCallToRights["fstatfs"] = "CAP_FSTATFS";
+    sysCallToRights["fsync"] = "CAP_FSYNC";
+    sysCallToRights["ftruncate"] = "CAP_FTRUNCATE";
+    sysCallToRights["futimes"] = "CAP_FUTIMES";
+    sysCallToRights["futimesat"] = "CAP_FUTIMESAT";
+    sysCallToRights["getdents"] = "CAP_READ";
+    sysCallToRights["getdirentries"] = "CAP_READ";
+    sysCallToRights["getpeername"] = "CAP_GETPEERNAME";
+    sysCallToRights["getsockname"] = "CAP_GETSOCKNAME";
+    sysCallToRights["getsockopt"] = "CAP_GETSOCKOPT";
+    sysCallToRights["ioctl"] = "CAP_IOCTL";
+    sysCallToRights["kevent"] = "CAP_EVENT";
+    sysCallToRights["linkat"] = "CAP_LINKAT_SOURCE";
+    sysCallToRights["listen"] = "CAP_LISTEN";
+    sysCallToRights["lseek"] = "CAP_SEEK";
+    sysCallToRights["mkdirat"] = "CAP_MKDIRAT";
+    sysCallToRights["mkfifoat"] = "CAP_MKFIFOAT";
+    sysCallToRights["mknodat"] = "CAP_MKNODAT";
+    sysCallToRights["posix_fallocate"] = "CAP_WRITE";
+    sysCallToRights["pread"] = "CAP_PREAD";
+    sysCallToRights["preadv"] = "CAP_PREAD";
+    sysCallToRights["pwrite"] = "CAP_PWRITE";
+    sysCallToRights["pwritev"] = "CAP_PWRITE";
+    sysCallToRights["read"] = "CAP_READ";
+    sysCallToRights["readlinkat"] = "CAP_LOOKUP, CAP_READ";
+    sysCallToRights["readv"] = "CAP_READ";
+    sysCallToRights["recv"] = "CAP_RECV";
+    sysCallToRights["recvfrom"] = "CAP_RECV";
+    sysCallToRights["recvmsg"] = "CAP_RECV";
+    sysCallToRights["renameat"] = "CAP_RENAMEAT_SOURCE";
+    sysCallToRights["send"] = "CAP_SEND";
+    sysCallToRights["sendfile"] = "CAP_READ";
+    sysCallToRights["sendmsg"] = "CAP_SEND";
+    sysCallToRights["sendto"] = "CAP_SEND";
+    sysCallToRights["setsockopt"] = "CAP_SETSOCKOPT";
+    sysCallToRights["shutdown"] = "CAP_SHUTDOWN";
+    sysCallToRights["symlinkat"] = "CAP_SYMLINKAT";
+    sysCallToRights["unlinkat"] = "CAP_UNLINKAT";
+    sysCallToRights["write"] = "CAP_WRITE";
+    sysCallToRights["writev"] = "CAP_WRITE";
+  }
+  map<string,string>::iterator I = sysCallToRights.find(name);
+  if (I == sysCallToRights.end()) {
+    return false;
+  }
+  istringstream ss(I->second);
+  string right;
+  while (getline(ss, right, ',')) {
+    rights.push_back(right.substr(right.find_first_not_of(" ")));
+  }
+  return true;
+}
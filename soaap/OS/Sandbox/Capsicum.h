@@ -3,10 +3,20 @@
 
 #include "OS/Sandbox/SandboxPlatform.h"
 
+#include <vector>
+
 namespace soaap {
   class Capsicum : public SandboxPlatform {
     public:
       Capsicum();
+
+      // Capability rights (see rights(4)) that a file descriptor must hold
+      // for system call "name" to be performed on it by call C. Where the
+      // rights depend on other arguments (e.g. mmap's prot), they are
+      // derived from C's arguments if constant, otherwise every right that
+      // could be needed is returned. Returns false if the rights for "name"
+      // are not known.
+      static bool getRightsForSysCall(string name, llvm::CallInst* C, vector<string>& rights);
   };
 }
 
@@ -6,6 +6,10 @@ bool SandboxPlatform::isSysCallPermitted(string name) {
   return permittedSysCalls.count(name) != 0;
 }
 
+bool SandboxPlatform::isSysCallPermittedAtCall(string name, llvm::CallInst* C) {
+  return isSysCallPermitted(name);
+}
+
 bool SandboxPlatform::doesSysCallRequireFDRights(string name) {
   return sysCallsReqFDRights.count(name) != 0;
 }
@@ -6,6 +6,10 @@
 
 using namespace std;
 
+namespace llvm {
+  class CallInst;
+}
+
 namespace soaap {
 
   class SandboxPlatform {
@@ -16,6 +20,10 @@ namespace soaap {
       // doesSysCallRequireFDRights(name).
       virtual bool isSysCallPermitted(string name);
 
+      // As above, but also takes into account any restrictions that the
+      // sandbox platform places on the arguments passed at call site C.
+      virtual bool isSysCallPermittedAtCall(string name, llvm::CallInst* C);
+
       // Sandbox requires rights permitting it to perform system call "name"
       // on its file descriptor argument. The return value only makes sense
       // if isSysCallPermitted(name) returns true.
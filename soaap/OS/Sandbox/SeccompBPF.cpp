@@ -0,0 +1,169 @@
+#include "OS/Sandbox/SeccompBPF.h"
+
+#include "Common/Debug.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace soaap;
+using namespace llvm;
+
+bool SeccompArgPredicate::holds(uint64_t argVal) const {
+  uint64_t width = is32Bit ? 0xffffffffULL : ~0ULL;
+  switch (op) {
+    case SeccompArgOp::Eq: return (argVal & width) == (value & width);
+    case SeccompArgOp::Ne: return (argVal & width) != (value & width);
+    case SeccompArgOp::MaskedEq: return (argVal & mask & width) == (value & width);
+  }
+  return false;
+}
+
+// Values may be negative (e.g. AT_FDCWD), in which case they are stored
+// sign extended to 64 bits.
+static bool parseArgValue(StringRef str, uint64_t& value) {
+  if (str.startswith("-")) {
+    int64_t signedValue;
+    if (str.getAsInteger(0, signedValue)) {
+      return false;
+    }
+    value = signedValue;
+    return true;
+  }
+  return !str.getAsInteger(0, value);
+}
+
+string SeccompArgPredicate::str() const {
+  stringstream ss;
+  ss << "arg" << argIdx << " ";
+  switch (op) {
+    case SeccompArgOp::Eq: ss << "=="; break;
+    case SeccompArgOp::Ne: ss << "!="; break;
+    case SeccompArgOp::MaskedEq: ss << "& 0x" << hex << mask << dec << " =="; break;
+  }
+  ss << " 0x" << hex << value;
+  return ss.str();
+}
+
+SeccompBPF::SeccompBPF(string policyFile) {
+  parsePolicy(policyFile);
+}
+
+void SeccompBPF::parsePolicy(string policyFile) {
+  ifstream in(policyFile.c_str());
+  if (!in) {
+    report_fatal_error("Unable to open seccomp-bpf policy file \"" + policyFile + "\"");
+  }
+
+  string line;
+  int lineNo = 0;
+  while (getline(in, line)) {
+    lineNo++;
+    StringRef lineRef = StringRef(line).split('#').first.trim();
+    if (lineRef.empty()) {
+      continue;
+    }
+
+    // system call name, followed by zero or more "&&"-separated predicates
+    pair<StringRef,StringRef> nameAndPreds = lineRef.split(' ');
+    string name = nameAndPreds.first.str();
+    SeccompRule rule;
+    StringRef preds = nameAndPreds.second.trim();
+    while (!preds.empty()) {
+      pair<StringRef,StringRef> predAndRest = preds.split("&&");
+      StringRef predStr = predAndRest.first.trim();
+      preds = predAndRest.second.trim();
+
+      SmallVector<StringRef,5> tokens;
+      predStr.split(tokens, " ", -1, false);
+      SeccompArgPredicate pred;
+      pred.mask = ~0ULL;
+      pred.is32Bit = false;
+      bool valid = tokens.size() >= 3 && tokens[0].startswith("arg")
+                   && !tokens[0].substr(3).getAsInteger(10, pred.argIdx)
+                   && pred.argIdx >= 0 && pred.argIdx < 6;
+      if (valid && tokens.size() == 3) {
+        // argN == value, argN != value
+        valid = parseArgValue(tokens[2], pred.value);
+        if (tokens[1] == "==") {
+          pred.op = SeccompArgOp::Eq;
+        }
+        else if (tokens[1] == "!=") {
+          pred.op = SeccompArgOp::Ne;
+        }
+        else {
+          valid = false;
+        }
+      }
+      else if (valid && tokens.size() == 5) {
+        // argN & mask == value
+        pred.op = SeccompArgOp::MaskedEq;
+        valid = tokens[1] == "&" && tokens[3] == "=="
+                && !tokens[2].getAsInteger(0, pred.mask)
+                && parseArgValue(tokens[4], pred.value);
+      }
+      else {
+        valid = false;
+      }
+      if (!valid) {
+        report_fatal_error(policyFile + ":" + Twine(lineNo) + ": invalid argument predicate \"" + predStr + "\"");
+      }
+      rule.push_back(pred);
+    }
+
+    SDEBUG("soaap.os.sandbox.seccompbpf", 3, dbgs() << "Permitting " << name << " with " << rule.size() << " arg predicate(s)\n");
+    addPermittedSysCall(name);
+    sysCallToRules[name].push_back(rule);
+  }
+}
+
+bool SeccompBPF::isSysCallPermittedAtCall(string name, CallInst* C) {
+  return !getRulesSatisfiedAtCall(name, C).empty();
+}
+
+SeccompRuleVector SeccompBPF::getRulesSatisfiedAtCall(string name, CallInst* C) {
+  SeccompRuleVector satisfied;
+  map<string,SeccompRuleVector>::iterator I = sysCallToRules.find(name);
+  if (I != sysCallToRules.end()) {
+    for (SeccompRule& rule : I->second) {
+      if (isRuleSatisfiedAtCall(rule, C)) {
+        SeccompRule ruleAtCall = rule;
+        for (SeccompArgPredicate& pred : ruleAtCall) {
+          Type* ArgTy = C->getArgOperand(pred.argIdx)->getType();
+          pred.is32Bit = ArgTy->isIntegerTy() && ArgTy->getIntegerBitWidth() <= 32;
+        }
+        satisfied.push_back(ruleAtCall);
+      }
+    }
+  }
+  return satisfied;
+}
+
+bool SeccompBPF::isRuleSatisfiedAtCall(SeccompRule& rule, CallInst* C) {
+  for (SeccompArgPredicate& pred : rule) {
+    if (pred.argIdx >= C->getNumArgOperands()) {
+      return false;
+    }
+    ConstantInt* CI = dyn_cast<ConstantInt>(C->getArgOperand(pred.argIdx)->stripPointerCasts());
+    if (CI == NULL || CI->getBitWidth() > 64) {
+      // can't prove that the predicate holds
+      SDEBUG("soaap.os.sandbox.seccompbpf", 3, dbgs() << "Non-constant arg for predicate " << pred.str() << " at " << *C << "\n")
+      return false;
+    }
+    // the filter only checks the low word of 32-bit arguments, which are
+    // sign extended so that negative constants such as AT_FDCWD match
+    SeccompArgPredicate predAtCall = pred;
+    predAtCall.is32Bit = CI->getBitWidth() <= 32;
+    uint64_t argVal = CI->getBitWidth() == 1 ? CI->getZExtValue() : CI->getSExtValue();
+    if (!predAtCall.holds(argVal)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef SOAAP_OS_SANDBOX_SECCOMPBPF_H
+#define SOAAP_OS_SANDBOX_SECCOMPBPF_H
+
+#include "OS/Sandbox/SandboxPlatform.h"
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace soaap {
+  enum class SeccompArgOp {
+    Eq, Ne, MaskedEq
+  };
+
+  // A predicate on the value of a single system call argument:
+  //   arg<argIdx> == value
+  //   arg<argIdx> != value
+  //   arg<argIdx> & mask == value
+  //
+  // is32Bit is set for the predicates of rules satisfied at a call site whose
+  // argument is at most 32 bits wide, as only its low word can be checked.
+  struct SeccompArgPredicate {
+    int argIdx;
+    SeccompArgOp op;
+    uint64_t mask;
+    uint64_t value;
+    bool is32Bit;
+
+    // argVal is sign extended from the argument's width. Only the low word
+    // of 32-bit arguments is compared, as in the generated filter.
+    bool holds(uint64_t argVal) const;
+    string str() const;
+  };
+
+  // A rule permits a system call if all of its predicates hold. A rule with
+  // no predicates permits the system call unconditionally.
+  typedef vector<SeccompArgPredicate> SeccompRule;
+  typedef vector<SeccompRule> SeccompRuleVector;
+
+  // Linux seccomp-bpf, as configured by a policy file. Each non-empty line
+  // of the policy permits a system call, optionally subject to predicates on
+  // its arguments (which must all hold). A system call may appear on several
+  // lines, in which case it is permitted if any of them are satisfied:
+  //
+  //   # comment
+  //   read
+  //   write arg0 == 1
+  //   write arg0 == 2
+  //   mmap arg2 & 0x4 == 0 && arg3 != 0x20
+  //   openat arg0 == -100
+  //
+  // As SOAAP has to prove that a call satisfies a rule, predicates can only
+  // be satisfied at call sites that pass constant arguments.
+  class SeccompBPF : public SandboxPlatform {
+    public:
+      SeccompBPF(string policyFile);
+      virtual bool isSysCallPermittedAtCall(string name, llvm::CallInst* C);
+      SeccompRuleVector getRulesSatisfiedAtCall(string name, llvm::CallInst* C);
+
+    private:
+      map<string,SeccompRuleVector> sysCallToRules;
+      void parsePolicy(string policyFile);
+      bool isRuleSatisfiedAtCall(SeccompRule& rule, llvm::CallInst* C);
+  };
+}
+
+#endif
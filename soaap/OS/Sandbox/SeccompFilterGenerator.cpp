@@ -0,0 +1,212 @@
+#include "OS/Sandbox/SeccompFilterGenerator.h"
+
+#include "llvm/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+using namespace soaap;
+using namespace llvm;
+
+#define LD_ARCH "BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch))"
+#define LD_NR "BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr))"
+#define RET_ALLOW "BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)"
+#define RET_KILL "BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL)"
+
+void SeccompFilterGenerator::allowSysCall(int number, string name) {
+  bool exists = sysCalls.find(number) != sysCalls.end();
+  AllowedSysCall& sysCall = sysCalls[number];
+  if (!exists) {
+    sysCall.weight = 0;
+  }
+  sysCall.name = name;
+  sysCall.unconditional = true;
+  sysCall.rules.clear();
+}
+
+void SeccompFilterGenerator::allowSysCall(int number, string name, SeccompRule& rule) {
+  if (rule.empty()) {
+    allowSysCall(number, name);
+    return;
+  }
+  bool exists = sysCalls.find(number) != sysCalls.end();
+  AllowedSysCall& sysCall = sysCalls[number];
+  if (!exists) {
+    sysCall.name = name;
+    sysCall.unconditional = false;
+    sysCall.weight = 0;
+  }
+  if (!sysCall.unconditional) {
+    for (SeccompRule& r : sysCall.rules) {
+      if (r.size() == rule.size() && equal(r.begin(), r.end(), rule.begin(),
+            [](const SeccompArgPredicate& p1, const SeccompArgPredicate& p2) {
+              return p1.argIdx == p2.argIdx && p1.op == p2.op && p1.mask == p2.mask
+                     && p1.value == p2.value && p1.is32Bit == p2.is32Bit;
+            })) {
+        return;
+      }
+    }
+    sysCall.rules.push_back(rule);
+  }
+}
+
+void SeccompFilterGenerator::setWeight(int number, uint64_t weight) {
+  map<int,AllowedSysCall>::iterator I = sysCalls.find(number);
+  if (I != sysCalls.end()) {
+    I->second.weight = weight;
+  }
+}
+
+int SeccompFilterGenerator::newLabel() {
+  labelToInsn.push_back(-1);
+  return labelToInsn.size()-1;
+}
+
+void SeccompFilterGenerator::placeLabel(int label) {
+  labelToInsn[label] = insns.size();
+}
+
+void SeccompFilterGenerator::emitStmt(string code) {
+  Insn insn = { code, false, -1, -1 };
+  insns.push_back(insn);
+}
+
+void SeccompFilterGenerator::emitJump(string code, int jt, int jf) {
+  Insn insn = { code, true, jt, jf };
+  insns.push_back(insn);
+}
+
+void SeccompFilterGenerator::emitPredicate(SeccompArgPredicate& pred, int failLabel) {
+  // Arguments are 64-bit but BPF only operates on 32-bit words, so we compare
+  // the low and high words separately (x86-64 is little endian). The high
+  // word is always checked, even against zero, unless the argument is known
+  // to be 32-bit: then its upper bits are not guaranteed to be zero.
+  stringstream lo, hi;
+  lo << "offsetof(struct seccomp_data, args[" << pred.argIdx << "])";
+  hi << lo.str() << " + 4";
+  uint32_t valueLo = pred.value & 0xffffffff;
+  uint32_t valueHi = pred.value >> 32;
+  uint32_t maskLo = pred.mask & 0xffffffff;
+  uint32_t maskHi = pred.mask >> 32;
+  bool checkHi = !pred.is32Bit
+                 && (pred.op != SeccompArgOp::MaskedEq || maskHi != 0 || valueHi != 0);
+
+  stringstream jeqLo, jeqHi, andLo, andHi;
+  jeqLo << "BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x" << hex << valueLo << ", %d, %d)";
+  jeqHi << "BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x" << hex << valueHi << ", %d, %d)";
+  andLo << "BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x" << hex << maskLo << ")";
+  andHi << "BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x" << hex << maskHi << ")";
+
+  switch (pred.op) {
+    case SeccompArgOp::Eq:
+    case SeccompArgOp::MaskedEq: {
+      if (checkHi) {
+        emitStmt("BPF_STMT(BPF_LD | BPF_W | BPF_ABS, " + hi.str() + ")");
+        if (pred.op == SeccompArgOp::MaskedEq) emitStmt(andHi.str());
+        emitJump(jeqHi.str(), -1, failLabel);
+      }
+      emitStmt("BPF_STMT(BPF_LD | BPF_W | BPF_ABS, " + lo.str() + ")");
+      if (pred.op == SeccompArgOp::MaskedEq) emitStmt(andLo.str());
+      emitJump(jeqLo.str(), -1, failLabel);
+      break;
+    }
+    case SeccompArgOp::Ne: {
+      // fails only if both words are equal
+      int holdsLabel = newLabel();
+      if (checkHi) {
+        emitStmt("BPF_STMT(BPF_LD | BPF_W | BPF_ABS, " + hi.str() + ")");
+        emitJump(jeqHi.str(), -1, holdsLabel);
+      }
+      emitStmt("BPF_STMT(BPF_LD | BPF_W | BPF_ABS, " + lo.str() + ")");
+      emitJump(jeqLo.str(), failLabel, -1);
+      placeLabel(holdsLabel);
+      break;
+    }
+  }
+}
+
+string SeccompFilterGenerator::generate(string filterName) {
+  insns.clear();
+  labelToInsn.clear();
+
+  // check the architecture first, as system call numbers are arch-specific
+  int archOkLabel = newLabel();
+  emitStmt(LD_ARCH);
+  emitJump("BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, %d, %d)", archOkLabel, -1);
+  emitStmt(RET_KILL);
+  placeLabel(archOkLabel);
+  emitStmt(LD_NR);
+
+  // heaviest first, ties are broken by system call number
+  vector<int> order;
+  for (pair<const int,AllowedSysCall>& p : sysCalls) {
+    order.push_back(p.first);
+  }
+  stable_sort(order.begin(), order.end(), [&](int n1, int n2) {
+    return sysCalls[n1].weight > sysCalls[n2].weight;
+  });
+
+  for (int number : order) {
+    AllowedSysCall& sysCall = sysCalls[number];
+    stringstream jeqNr;
+    jeqNr << "BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, " << number << ", %d, %d) /* " << sysCall.name << " */";
+    if (sysCall.unconditional) {
+      int nextLabel = newLabel();
+      emitJump(jeqNr.str(), -1, nextLabel);
+      emitStmt(RET_ALLOW);
+      placeLabel(nextLabel);
+    }
+    else {
+      // The args are loaded into the accumulator, so once we have matched
+      // the system call number we either allow it or kill the process.
+      int nextLabel = newLabel();
+      emitJump(jeqNr.str(), -1, nextLabel);
+      for (SeccompRule& rule : sysCall.rules) {
+        int nextRuleLabel = newLabel();
+        for (SeccompArgPredicate& pred : rule) {
+          emitPredicate(pred, nextRuleLabel);
+        }
+        emitStmt(RET_ALLOW);
+        placeLabel(nextRuleLabel);
+      }
+      emitStmt(RET_KILL);
+      placeLabel(nextLabel);
+    }
+  }
+  emitStmt(RET_KILL);
+
+  // resolve labels to relative jump offsets
+  stringstream ss;
+  ss << "/*\n"
+     << " * seccomp-bpf filter generated by SOAAP. Only permits the system calls\n"
+     << " * (and arguments) that are used by the sandbox.\n"
+     << " */\n"
+     << "#include <stddef.h>\n"
+     << "#include <linux/audit.h>\n"
+     << "#include <linux/filter.h>\n"
+     << "#include <linux/seccomp.h>\n\n"
+     << "static struct sock_filter " << filterName << "_filter[] = {\n";
+  for (int i=0; i<insns.size(); i++) {
+    Insn& insn = insns[i];
+    if (insn.isJump) {
+      int jt = insn.jt == -1 ? 0 : labelToInsn[insn.jt]-i-1;
+      int jf = insn.jf == -1 ? 0 : labelToInsn[insn.jf]-i-1;
+      if (jt > 255 || jf > 255) {
+        report_fatal_error("seccomp-bpf filter for " + filterName + " requires a jump that is too long");
+      }
+      char buf[512];
+      snprintf(buf, sizeof(buf), insn.code.c_str(), jt, jf);
+      ss << "  " << buf << ",\n";
+    }
+    else {
+      ss << "  " << insn.code << ",\n";
+    }
+  }
+  ss << "};\n\n"
+     << "static struct sock_fprog " << filterName << "_prog = {\n"
+     << "  .len = (unsigned short)(sizeof(" << filterName << "_filter)/sizeof(" << filterName << "_filter[0])),\n"
+     << "  .filter = " << filterName << "_filter,\n"
+     << "};\n";
+  return ss.str();
+}
@@ -0,0 +1,52 @@
+#ifndef SOAAP_OS_SANDBOX_SECCOMPFILTERGENERATOR_H
+#define SOAAP_OS_SANDBOX_SECCOMPFILTERGENERATOR_H
+
+#include "OS/Sandbox/SeccompBPF.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace soaap {
+  // Generates a seccomp-bpf filter program (as C source for a struct
+  // sock_fprog) that only permits the system calls, and arguments, that have
+  // been added. Everything else kills the process. System calls are checked
+  // in decreasing order of weight (e.g. expected call frequency), so that the
+  // most common ones pass through the filter with the fewest instructions.
+  class SeccompFilterGenerator {
+    public:
+      void allowSysCall(int number, string name);
+      void allowSysCall(int number, string name, SeccompRule& rule);
+      void setWeight(int number, uint64_t weight);
+      bool empty() { return sysCalls.empty(); }
+      string generate(string filterName);
+
+    private:
+      struct AllowedSysCall {
+        string name;
+        bool unconditional;
+        SeccompRuleVector rules;
+        uint64_t weight;
+      };
+      map<int,AllowedSysCall> sysCalls;
+
+      struct Insn {
+        string code;
+        bool isJump;
+        int jt;   // jump targets are labels, -1 means fall through
+        int jf;
+      };
+      vector<Insn> insns;
+      vector<int> labelToInsn;
+
+      int newLabel();
+      void placeLabel(int label);
+      void emitStmt(string code);
+      void emitJump(string code, int jt, int jf);
+      void emitPredicate(SeccompArgPredicate& pred, int failLabel);
+  };
+}
+
+#endif
@@ -1,34 +1,96 @@
 #include "OS/SysCallProvider.h"
+#include "OS/FreeBSDSysCallProvider.h"
+#include "OS/LinuxSysCallProvider.h"
+
+#include "Common/CmdLineOpts.h"
+
+#include "llvm/Support/ErrorHandling.h"
 
 using namespace soaap;
 
+SysCallProvider* SysCallProvider::getProvider() {
+  static FreeBSDSysCallProvider freeBSDSysCallProvider;
+  static LinuxSysCallProvider linuxSysCallProvider;
+  SysCallProvider* provider = NULL;
+  switch (CmdLineOpts::OperatingSystem) {
+    case OperatingSystemName::FreeBSD: {
+      provider = &freeBSDSysCallProvider;
+      break;
+    }
+    case OperatingSystemName::Linux: {
+      provider = &linuxSysCallProvider;
+      break;
+    }
+    default: {
+      report_fatal_error("Unrecognised operating system");
+    }
+  }
+  provider->initSysCalls();
+  return provider;
+}
+
+void SysCallProvider::initSysCalls() {
+  // The tables are immutable once populated, so only do this once even if
+  // several analyses share the same provider.
+  if (!initialised) {
+    addSysCalls();
+    initialised = true;
+  }
+}
+
 bool SysCallProvider::isSysCall(string sysCall) {
-  return sysCalls.count(sysCall) != 0;
+  return sysCallToIdx.count(sysCall) != 0;
 }
 
 int SysCallProvider::getIdx(string sysCall) {
-  return (sysCallToIdx.find(sysCall) != sysCallToIdx.end()) ? sysCallToIdx[sysCall] : -1;
+  StringMap<int>::iterator I = sysCallToIdx.find(sysCall);
+  return (I != sysCallToIdx.end()) ? I->second : -1;
 }
 
 string SysCallProvider::getSysCall(int idx) {
-  return (idxToSysCall.find(idx) != idxToSysCall.end()) ? idxToSysCall[idx] : "";
+  return (idx >= 0 && idx < idxToSysCall.size()) ? idxToSysCall[idx] : "";
 }
 
-void SysCallProvider::addSysCall(string sysCall, bool hasFdArg, int fdArgIdx) {
-  static int nextIdx = 0;
-  sysCalls.insert(sysCall);
-  sysCallToIdx[sysCall] = nextIdx;
-  idxToSysCall[nextIdx] = sysCall;
-  if (hasFdArg) {
-    sysCallToFdArgIdx[sysCall] = fdArgIdx;
-  }
-  nextIdx++;
+int SysCallProvider::getSysCallNumber(int idx) {
+  return (idx >= 0 && idx < idxToNumber.size()) ? idxToNumber[idx] : -1;
+}
+
+void SysCallProvider::addSysCall(int number, string sysCall, bool hasFdArg, int fdArgIdx) {
+  // indices are dense and per-provider, in the order that system calls are
+  // added, so that they can be used directly as BitVector indices.
+  int idx = idxToSysCall.size();
+  sysCallToIdx[sysCall] = idx;
+  idxToSysCall.push_back(sysCall);
+  idxToNumber.push_back(number);
+  idxToFdArgIdx.push_back(hasFdArg ? fdArgIdx : -1);
 }
 
 bool SysCallProvider::hasFdArg(string sysCall) {
-  return sysCallToFdArgIdx.find(sysCall) != sysCallToFdArgIdx.end();
+  return hasFdArg(getIdx(sysCall));
 }
 
 int SysCallProvider::getFdArgIdx(string sysCall) {
-  return sysCallToFdArgIdx[sysCall];
+  return getFdArgIdx(getIdx(sysCall));
+}
+
+bool SysCallProvider::isSysCall(const Function* F) {
+  return getIdx(F) != -1;
+}
+
+int SysCallProvider::getIdx(const Function* F) {
+  DenseMap<const Function*,int>::iterator I = funcToIdx.find(F);
+  if (I != funcToIdx.end()) {
+    return I->second;
+  }
+  int idx = getIdx(F->getName());
+  funcToIdx[F] = idx;
+  return idx;
+}
+
+bool SysCallProvider::hasFdArg(int idx) {
+  return idx >= 0 && idx < idxToFdArgIdx.size() && idxToFdArgIdx[idx] != -1;
+}
+
+int SysCallProvider::getFdArgIdx(int idx) {
+  return hasFdArg(idx) ? idxToFdArgIdx[idx] : 0;
 }
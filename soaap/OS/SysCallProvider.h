@@ -1,28 +1,52 @@
 #ifndef SOAAP_OS_SYSCALLPROVIDER_H
 #define SOAAP_OS_SYSCALLPROVIDER_H
 
-#include <map>
-#include <unordered_set>
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Function.h"
+
 #include <string>
+#include <vector>
 
+using namespace llvm;
 using namespace std;
 
 namespace soaap {
   class SysCallProvider {
     public:
+      SysCallProvider() : initialised(false) { }
+      virtual ~SysCallProvider() { }
       virtual bool isSysCall(string sysCall);
       virtual int getIdx(string sysCall);
       virtual string getSysCall(int idx);
-      virtual void addSysCall(string sysCall, bool hasFdArg = false, int fdArgIdx = 0); 
+      virtual int getSysCallNumber(int idx);
+      virtual void addSysCall(int number, string sysCall, bool hasFdArg = false, int fdArgIdx = 0); 
       virtual bool hasFdArg(string sysCall);
       virtual int getFdArgIdx(string sysCall);
-      virtual void initSysCalls() = 0;
+      virtual void initSysCalls();
+
+      // Function-based lookups. These cache the index for each Function, so
+      // that analyses can query callees without hashing their names.
+      virtual bool isSysCall(const Function* F);
+      virtual int getIdx(const Function* F);
+      virtual bool hasFdArg(int idx);
+      virtual int getFdArgIdx(int idx);
+      virtual int getNumSysCalls() { return idxToSysCall.size(); }
+      virtual void clearFunctionCache() { funcToIdx.clear(); }
+
+      // provider for the OS selected using -soaap-os
+      static SysCallProvider* getProvider();
     
     protected:
-      unordered_set<string> sysCalls;
-      map<string,int> sysCallToIdx;
-      map<int,string> idxToSysCall;
-      map<string,int> sysCallToFdArgIdx;
+      virtual void addSysCalls() = 0;
+
+    private:
+      bool initialised;
+      StringMap<int> sysCallToIdx;
+      vector<string> idxToSysCall;
+      vector<int> idxToNumber;
+      vector<int> idxToFdArgIdx;  // -1 if the system call has no fd arg
+      DenseMap<const Function*,int> funcToIdx;
   };
 }
 
@@ -1,6 +1,7 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Pass.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include "soaap.h"
@@ -12,6 +13,7 @@
 #include "Common/XO.h"
 #include "Analysis/VulnerabilityAnalysis.h"
 #include "Analysis/PrivilegedCallAnalysis.h"
+#include "Analysis/QueryAnalysis.h"
 #include "Analysis/SandboxedFuncAnalysis.h"
 #include "Analysis/CFGFlow/GlobalVariableAnalysis.h"
 #include "Analysis/CFGFlow/SysCallsAnalysis.h"
@@ -26,11 +28,14 @@
 #include "OS/Sandbox/Capsicum.h"
 #include "OS/Sandbox/SandboxPlatform.h"
 #include "OS/Sandbox/Seccomp.h"
+#include "OS/Sandbox/SeccompBPF.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/ClassHierarchyUtils.h"
 #include "Util/ContextUtils.h"
 #include "Util/LLVMAnalyses.h"
 #include "Util/SandboxUtils.h"
+#include "Util/SliceUtils.h"
+#include "Util/WorklistUtils.h"
 
 #include <cstdio>
 
@@ -48,39 +53,39 @@ bool Soaap::runOnModule(Module& M) {
   if (CmdLineOpts::ContextInsens) {
     outs() << " in context-insensitive mode";
   }
+  if (CmdLineOpts::Worklist != WorklistPolicy::FIFO) {
+    outs() << " with the " << WorklistUtils::stringifyPolicy(CmdLineOpts::Worklist) << " worklist";
+  }
   outs() << "\n";
   
   outs() << "* Processing command-line options\n"; 
   processCmdLineArgs(M);
 
+  // the time and memory budgets are for the whole run, not each solver
+  WorklistUtils::startBudget();
+
   XO::open_container("soaap");
 
   llvm::CallGraph& CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
   LLVMAnalyses::setCallGraphAnalysis(&CG);
-  
-  outs() << "* Finding class hierarchy (if there is one)\n";
-  ClassHierarchyUtils::findClassHierarchy(M);
-
-  outs() << "* Finding sandboxes\n";
-  findSandboxes(M);
 
-  outs() << "* Building basic callgraph\n";
-  CallGraphUtils::buildBasicCallGraph(M, sandboxes);
-  
-  outs() << "* Calculating privileged methods\n";
-  calculatePrivilegedMethods(M);
-
-  outs() << "* Reinitialising sandboxes\n";
-  SandboxUtils::reinitSandboxes(sandboxes);
+  if (prepared) {
+    outs() << "* Reusing the prepared sandboxes and callgraph\n";
+  }
+  else {
+    prepare(M);
+  }
+  sandboxes = preparedSandboxes;
 
-  outs() << "* Adding annotated/inferred call edges to callgraph (if available)\n";
-  CallGraphUtils::loadAnnotatedInferredCallGraphEdges(M, sandboxes);
+  if (CmdLineOpts::PrintCallGraph) {
+    CallGraphUtils::printCallGraph();
+  }
   
   // reobtain privileged methods
   privilegedMethods = SandboxUtils::getPrivilegedMethods(M);
 
   outs() << "* Validating sandbox creation points\n";
-  SandboxUtils::validateSandboxCreations(sandboxes);
+  SandboxUtils::validateSandboxCreations(M, sandboxes);
   
   if (CmdLineOpts::ListAllFuncs) {
     CallGraphUtils::listAllFuncs(M);
@@ -109,7 +114,11 @@ bool Soaap::runOnModule(Module& M) {
     SandboxUtils::outputPrivilegedFunctions();
   }
 
-  if (CmdLineOpts::EmPerf) {
+  if (!CmdLineOpts::Queries.empty()) {
+    outs() << "* Answering queries\n";
+    answerQueries(M);
+  }
+  else if (CmdLineOpts::EmPerf) {
     outs() << "* Instrumenting sandbox emulation calls\n";
     instrumentPerfEmul(M);
   }
@@ -158,12 +167,38 @@ bool Soaap::runOnModule(Module& M) {
 
   }
 
+  WorklistUtils::emitPrecisionLoss();
   XO::close_container("soaap");
   XO::finish();
 
   return false;
 }
 
+void Soaap::prepare(Module& M) {
+  outs() << "* Finding class hierarchy (if there is one)\n";
+  ClassHierarchyUtils::findClassHierarchy(M);
+
+  outs() << "* Finding sandboxes\n";
+  preparedSandboxes = SandboxUtils::findSandboxes(M);
+
+  outs() << "* Slicing module\n";
+  SliceUtils::computeSlice(M, preparedSandboxes);
+
+  outs() << "* Building basic callgraph\n";
+  CallGraphUtils::buildBasicCallGraph(M, preparedSandboxes);
+  
+  outs() << "* Calculating privileged methods\n";
+  SandboxUtils::getPrivilegedMethods(M);
+
+  outs() << "* Reinitialising sandboxes\n";
+  SandboxUtils::reinitSandboxes(preparedSandboxes);
+
+  outs() << "* Adding annotated/inferred call edges to callgraph (if available)\n";
+  CallGraphUtils::loadAnnotatedInferredCallGraphEdges(M, preparedSandboxes);
+
+  prepared = true;
+}
+
 void Soaap::processCmdLineArgs(Module& M) {
   // process ClSandboxPlatform
   switch (CmdLineOpts::SandboxPlatform) {
@@ -184,62 +219,35 @@ void Soaap::processCmdLineArgs(Module& M) {
       sandboxPlatform.reset(new class Seccomp);
       break;
     }
+    case SandboxPlatformName::SeccompBPF: {
+      if (CmdLineOpts::SeccompPolicy.empty()) {
+        report_fatal_error("-soaap-sandbox-platform=seccomp-bpf requires -soaap-seccomp-policy");
+      }
+      if (CmdLineOpts::OperatingSystem != OperatingSystemName::Linux) {
+        errs() << "WARNING: seccomp-bpf is only available on Linux, using Linux system calls\n";
+        CmdLineOpts::OperatingSystem = OperatingSystemName::Linux;
+      }
+      sandboxPlatform.reset(new class SeccompBPF(CmdLineOpts::SeccompPolicy));
+      break;
+    }
     default: {
       errs() << "Unrecognised Sandbox Platform\n";
     }
   }
 
+  // process ClEmitSandboxPolicies. Capsicum rights are emitted directly by
+  // CapabilitySysCallsAnalysis.
+  if (CmdLineOpts::EmitSandboxPolicies && CmdLineOpts::OperatingSystem == OperatingSystemName::Linux) {
+    CmdLineOpts::EmitSeccompFilters = true;
+  }
+
   // process ClReportOutputFormats
   // default value is text
   // TODO: not sure how to specify this in the option itself
   if (CmdLineOpts::ReportOutputFormats.empty()) { 
     CmdLineOpts::ReportOutputFormats.push_back(ReportOutputFormat::Text);
   }
-  for (ReportOutputFormat r : CmdLineOpts::ReportOutputFormats) {
-    switch (r) {
-      case ReportOutputFormat::Text: {
-        SDEBUG("soaap", 3, dbgs() << "Text selected\n");
-        XO::create(XO_STYLE_TEXT, XOF_FLUSH);
-        break;
-      }
-      case ReportOutputFormat::HTML: {
-        SDEBUG("soaap", 3, dbgs() << "HTML selected\n");
-        string filename = CmdLineOpts::ReportFilePrefix + ".html";
-        if (FILE* fp = fopen(filename.c_str(), "w")) {
-          XO::create_to_file(fp, XO_STYLE_HTML, XOF_PRETTY | XOF_FLUSH);
-        }
-        else {
-          errs() << "Error creating JSON report file: " << strerror(errno) << "\n";
-        }
-        break;
-      }
-      case ReportOutputFormat::JSON: {
-        SDEBUG("soaap", 3, dbgs() << "JSON selected\n");
-        string filename = CmdLineOpts::ReportFilePrefix + ".json";
-        SDEBUG("soaap", 3, dbgs() << "Opening file \"" << filename << "\"\n");
-        if (FILE* fp = fopen(filename.c_str(), "w")) {
-          XO::create_to_file(fp, XO_STYLE_JSON, XOF_PRETTY | XOF_FLUSH);
-        }
-        else {
-          errs() << "Error creating JSON report file: " << strerror(errno) << "\n";
-        }
-        break;
-      }
-      case ReportOutputFormat::XML: {
-        SDEBUG("soaap", 3, dbgs() << "XML selected\n");
-        string filename = CmdLineOpts::ReportFilePrefix + ".xml";
-        SDEBUG("soaap", 3, dbgs() << "Opening file \"" << filename << "\"\n");
-        if (FILE* fp = fopen(filename.c_str(), "w")) {
-          XO::create_to_file(fp, XO_STYLE_XML, XOF_PRETTY | XOF_FLUSH);
-        }
-        else {
-          errs() << "Error creating XML report file: " << strerror(errno) << "\n";
-        }
-        break;
-      }
-      default: { }
-    }
-  }
+  XO::create_for_formats(CmdLineOpts::ReportOutputFormats, CmdLineOpts::ReportFilePrefix);
 
   if (CmdLineOpts::OutputTraces.empty()) {
     // "vulnerability" is the default
@@ -305,6 +313,15 @@ void Soaap::checkSandboxedFuncs(Module& M) {
   analysis.doAnalysis(M, sandboxes);
 }
 
+void Soaap::answerQueries(Module& M) {
+  QueryAnalysis analysis(M, sandboxes);
+  XO::open_list("query");
+  for (string query : CmdLineOpts::Queries) {
+    analysis.answer(query);
+  }
+  XO::close_list("query");
+}
+
 void Soaap::checkLeakedRights(Module& M) {
   VulnerabilityAnalysis analysis(privilegedMethods, sandboxPlatform);
   analysis.doAnalysis(M, sandboxes);
@@ -315,10 +332,6 @@ void Soaap::checkOriginOfAccesses(Module& M) {
   analysis.doAnalysis(M, sandboxes);
 }
 
-void Soaap::findSandboxes(Module& M) {
-  sandboxes = SandboxUtils::findSandboxes(M);
-}
-
 void Soaap::checkPropagationOfSandboxPrivateData(Module& M) {
   SandboxPrivateAnalysis analysis(CmdLineOpts::ContextInsens, privilegedMethods);
   analysis.doAnalysis(M, sandboxes);
@@ -341,10 +354,6 @@ void Soaap::checkSysCalls(Module& M) {
   capsAnalysis.doAnalysis(M, sandboxes);
 }
 
-void Soaap::calculatePrivilegedMethods(Module& M) {
-  privilegedMethods = SandboxUtils::getPrivilegedMethods(M);
-}
-
 void Soaap::checkGlobalVariables(Module& M) {
   GlobalVariableAnalysis analysis(privilegedMethods);
   analysis.doAnalysis(M, sandboxes);
@@ -363,5 +372,8 @@ void Soaap::buildRPCGraph(Module& M) {
   }
 }
 
+bool Soaap::prepared = false;
+SandboxVector Soaap::preparedSandboxes;
+
 char Soaap::ID = 0;
 INITIALIZE_PASS(Soaap, "soaap", "Soaap Pass", false, false);
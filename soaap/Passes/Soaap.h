@@ -39,8 +39,15 @@ namespace soaap {
       Soaap() : ModulePass(ID) { }
       virtual void getAnalysisUsage(AnalysisUsage &AU) const;
       virtual bool runOnModule(Module& M);
+      // Find the class hierarchy and sandboxes, slice the module and build
+      // its callgraph, including function-pointer targets. These don't
+      // depend on the options of an individual run, so the daemon prepares
+      // them once, before forking for each request, and runs then reuse them.
+      static void prepare(Module& M);
 
     private:
+      static bool prepared;
+      static SandboxVector preparedSandboxes;
       SandboxVector sandboxes;
       FunctionSet privilegedMethods;
       shared_ptr<SandboxPlatform> sandboxPlatform;
@@ -48,14 +55,13 @@ namespace soaap {
       void checkPrivilegedCalls(Module& M);
       void checkLeakedRights(Module& M);
       void checkOriginOfAccesses(Module& M);
-      void findSandboxes(Module& M);
       void checkPropagationOfSandboxPrivateData(Module& M);
       void checkPropagationOfClassifiedData(Module& M);
       void checkFileDescriptors(Module& M);
       void checkSysCalls(Module& M);
-      void calculatePrivilegedMethods(Module& M);
       void checkGlobalVariables(Module& M);
       void checkSandboxedFuncs(Module& M);
+      void answerQueries(Module& M);
       void instrumentPerfEmul(Module& M);
       void buildRPCGraph(Module& M);
   };
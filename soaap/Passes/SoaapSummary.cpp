@@ -0,0 +1,89 @@
+#include "Passes/SoaapSummary.h"
+
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Common/ModuleSummary.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+#if defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <unistd.h>
+#endif
+
+using namespace soaap;
+using namespace llvm;
+using namespace std;
+
+void SoaapSummary::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+}
+
+bool SoaapSummary::runOnModule(Module& M) {
+  string filename = CmdLineOpts::SummaryFile;
+  if (filename.empty()) {
+    if (outputFilename.empty() || outputFilename == "-") {
+      errs() << "Error writing SOAAP summary file: no output file to name it "
+             << "after (use -soaap-summary-file)\n";
+      return false;
+    }
+    filename = ModuleSummary::getSummaryFilename(outputFilename);
+  }
+  SDEBUG("soaap.passes.summary", 3, dbgs() << "Writing summary of " << M.getModuleIdentifier() << " to " << filename << "\n")
+  unique_ptr<ModuleSummary> summary(ModuleSummary::build(M, M.getModuleIdentifier()));
+  if (error_code EC = summary->write(filename)) {
+    errs() << "Error writing SOAAP summary file: " << EC.message() << "\n";
+  }
+  return false;
+}
+
+char SoaapSummary::ID = 0;
+static RegisterPass<SoaapSummary> X("soaap-summary", "Write a SOAAP summary of the module", false, true);
+
+// The file that the compiler this pass is loaded into (clang -cc1) writes
+// its output to, from its "-o" argument, or empty if that can't be found.
+static string getCompilerOutputFilename() {
+  string args;
+#if defined(__FreeBSD__)
+  int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_ARGS, getpid() };
+  size_t len = 0;
+  if (sysctl(mib, 4, NULL, &len, NULL, 0) == 0) {
+    args.resize(len);
+    if (sysctl(mib, 4, &args[0], &len, NULL, 0) == 0) {
+      args.resize(len);
+    }
+    else {
+      args.clear();
+    }
+  }
+#elif defined(__linux__)
+  ifstream cmdline("/proc/self/cmdline", ios::binary);
+  args.assign(istreambuf_iterator<char>(cmdline), istreambuf_iterator<char>());
+#endif
+  SmallVector<StringRef,32> argv;
+  StringRef(args).split(argv, StringRef("\0", 1));
+  for (unsigned i=0; i+1<argv.size(); i++) {
+    if (argv[i] == "-o") {
+      return argv[i+1].str();
+    }
+  }
+  return "";
+}
+
+// When loaded into clang, e.g.:
+//   clang -Xclang -load -Xclang libSOAAP.so -mllvm -soaap-summary
+// summarise each translation unit once it has been optimised.
+static void addSummaryPass(const PassManagerBuilder &Builder, legacy::PassManagerBase &PM) {
+  if (CmdLineOpts::Summary || !CmdLineOpts::SummaryFile.empty()) {
+    PM.add(new SoaapSummary(getCompilerOutputFilename()));
+  }
+}
+
+static RegisterStandardPasses S(PassManagerBuilder::EP_OptimizerLast, addSummaryPass);
+static RegisterStandardPasses S0(PassManagerBuilder::EP_EnabledOnOptLevel0, addSummaryPass);
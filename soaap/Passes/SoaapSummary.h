@@ -0,0 +1,31 @@
+#ifndef SOAAP_PASSES_SOAAPSUMMARY_H
+#define SOAAP_PASSES_SOAAPSUMMARY_H
+
+#include "llvm/Pass.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Writes a summary of each translation unit (see Common/ModuleSummary.h)
+  // as it is compiled, so that whole-program SOAAP checks can be run on the
+  // summaries at link time (soaap-aggregate) and so that the soaap driver
+  // need not load modules just to summarise them. The summary is written
+  // next to the bitcode file that the module is output to (see
+  // ModuleSummary::getSummaryFilename), unless -soaap-summary-file is given.
+  struct SoaapSummary : public ModulePass {
+    public:
+      static char ID;
+      SoaapSummary(string outputFilename = "") : ModulePass(ID), outputFilename(outputFilename) { }
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+      virtual bool runOnModule(Module& M);
+
+    private:
+      string outputFilename;
+  };
+}
+
+#endif
@@ -5,8 +5,14 @@
 #include "Passes/Soaap.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/ClassHierarchyUtils.h"
+#include "Util/ContextUtils.h"
 #include "Util/LLVMAnalyses.h"
+#include "Util/ModuleUtils.h"
+#include "Util/PointsToUtils.h"
+#include "Util/SandboxUtils.h"
+#include "Util/SliceUtils.h"
 #include "Util/DebugUtils.h"
+#include "Util/WorklistUtils.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/Debug.h"
@@ -27,10 +33,14 @@ map<const Function*, map<Context*, set<CallGraphEdge> > > CallGraphUtils::funcTo
 map<const Function*, map<Context*, CallInstSet> > CallGraphUtils::calleeToCalls;
 bool CallGraphUtils::caching = false;
 map<Function*, map<Function*,InstTrace> > CallGraphUtils::funcToShortestCallPaths;
+TraceTrie CallGraphUtils::traces;
+DenseMap<pair<Function*,Sandbox*>,int> CallGraphUtils::targetToTraceId;
+BitVector CallGraphUtils::emittedTraceNodes;
+BitVector CallGraphUtils::displayedTraceNodes;
 
 void CallGraphUtils::listFPCalls(Module& M, SandboxVector& sandboxes) {
   unsigned long numFPcalls = 0;
-  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+  for (Function* F : SliceUtils::getFunctions(M)) {
     if (F->isDeclaration()) continue;
     bool displayedFuncName = false;
     for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
@@ -65,7 +75,7 @@ void CallGraphUtils::listFPCalls(Module& M, SandboxVector& sandboxes) {
 
 void CallGraphUtils::listFPTargets(Module& M, SandboxVector& sandboxes) {
   unsigned long numFPcalls = 0;
-  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+  for (Function* F : SliceUtils::getFunctions(M)) {
     if (F->isDeclaration()) continue;
     for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
       if (!isa<IntrinsicInst>(&*I)) {
@@ -93,6 +103,23 @@ void CallGraphUtils::listFPTargets(Module& M, SandboxVector& sandboxes) {
                 for (Function* T : getFPInferredTargetsAnalysis().getTargets(C->getCalledValue()->stripPointerCasts(), Ctx)) {
                   outs() << INDENT_5 << T->getName() << " (inferred)\n";
                 }
+                FunctionSet pointsToTargets;
+                if (CmdLineOpts::PointsToFPTargets) {
+                  pointsToTargets = PointsToUtils::getFunctionsPointedTo(C->getCalledValue()->stripPointerCasts());
+                  for (Function* T : pointsToTargets) {
+                    outs() << INDENT_5 << T->getName() << " (points-to)\n";
+                  }
+                }
+                if (CmdLineOpts::FPTypeFallback) {
+                  // targets added for calls that were otherwise unresolved
+                  for (Function* T : callToCallees[C][Ctx]) {
+                    if (getFPAnnotatedTargetsAnalysis().getTargets(C->getCalledValue()->stripPointerCasts(), Ctx).count(T) == 0
+                        && getFPInferredTargetsAnalysis().getTargets(C->getCalledValue()->stripPointerCasts(), Ctx).count(T) == 0
+                        && pointsToTargets.count(T) == 0) {
+                      outs() << INDENT_5 << T->getName() << " (type-compatible)\n";
+                    }
+                  }
+                }
               }
               outs() << "\n";
             }
@@ -115,47 +142,126 @@ void CallGraphUtils::listAllFuncs(Module& M) {
 void CallGraphUtils::loadAnnotatedInferredCallGraphEdges(Module& M, SandboxVector& sandboxes) {
   // Find annotated/inferred function pointers and add edges from the calls of
   // the fp to targets.  
-  if (CmdLineOpts::InferFPTargets) {
+  if (CmdLineOpts::PointsToFPTargets) {
+    SDEBUG("soaap.util.callgraph", 3, dbgs() << "resolving fp targets from points-to sets\n")
+    PointsToUtils::requirePointsTo(M);
+    loadFPCallGraphEdges(M, sandboxes, false);
+  }
+  else if (CmdLineOpts::InferFPTargets) {
     SDEBUG("soaap.util.callgraph", 3, dbgs() << "performing fp target inference\n")
     getFPInferredTargetsAnalysis().doAnalysis(M, sandboxes);
   }
   SDEBUG("soaap.util.callgraph", 3, dbgs() << "finding annotated fp targets\n")
   getFPAnnotatedTargetsAnalysis().doAnalysis(M, sandboxes);
 
-  if (CmdLineOpts::PrintCallGraph) {
-    XO::emit("Outputting Callgraph...\n");
-    map<Function*,map<Function*,int> > funcToCalleeCallCounts;
-    for (pair<const CallInst*, map<Context*, FunctionSet> > p : callToCallees) {
-      const CallInst* C = p.first;
-      Function* F = (Function*)C->getParent()->getParent();
-      for (pair<Context*, FunctionSet> q : p.second) {
-        for (Function* G : q.second) {
-          funcToCalleeCallCounts[F][G]++;
-        }
+  if (CmdLineOpts::FPTypeFallback) {
+    SDEBUG("soaap.util.callgraph", 3, dbgs() << "adding type-compatible targets for unresolved fp calls\n")
+    loadFPCallGraphEdges(M, sandboxes, true);
+  }
+}
+
+void CallGraphUtils::printCallGraph() {
+  XO::emit("Outputting Callgraph...\n");
+  map<Function*,map<Function*,int> > funcToCalleeCallCounts;
+  for (pair<const CallInst*, map<Context*, FunctionSet> > p : callToCallees) {
+    const CallInst* C = p.first;
+    Function* F = (Function*)C->getParent()->getParent();
+    for (pair<Context*, FunctionSet> q : p.second) {
+      for (Function* G : q.second) {
+        funcToCalleeCallCounts[F][G]++;
       }
     }
-    XO::open_list("callgraph_record");
-    for (pair<Function*,map<Function*,int> > p : funcToCalleeCallCounts) {
-      XO::open_instance("callgraph_record");
-      Function* caller = p.first;
-      XO::emit("{:caller/%s}\n", caller->getName().str().c_str());
-      XO::open_list("callee_count");
-      for (pair<Function*,int> p2 : p.second) {
-        XO::open_instance("callee_count");
-        Function* callee = p2.first;
-        int callCount = p2.second;
-        XO::emit("  -> {:callee/%s}, {:call_count/%d}\n",
-                 callee->getName().str().c_str(),
-                 callCount);
-        XO::close_instance("callee_count");
+  }
+  XO::open_list("callgraph_record");
+  for (pair<Function*,map<Function*,int> > p : funcToCalleeCallCounts) {
+    XO::open_instance("callgraph_record");
+    Function* caller = p.first;
+    XO::emit("{:caller/%s}\n", caller->getName().str().c_str());
+    XO::open_list("callee_count");
+    for (pair<Function*,int> p2 : p.second) {
+      XO::open_instance("callee_count");
+      Function* callee = p2.first;
+      int callCount = p2.second;
+      XO::emit("  -> {:callee/%s}, {:call_count/%d}\n",
+               callee->getName().str().c_str(),
+               callCount);
+      XO::close_instance("callee_count");
+    }
+    XO::close_list("callee_count");
+    XO::emit("\n");
+    XO::close_instance("callgraph_record");
+  }
+  XO::close_list("callgraph_record");
+}
+
+// Add edges from each function-pointer call to the functions its called
+// value may point to or, if typeFallback is set, from each call that has no
+// known targets in a context to all address-taken functions of a compatible
+// type. Targets can make more code reachable in each context (including
+// more function-pointer calls), so edges are added until there are no new
+// ones. Once the run is over budget, type-compatible targets are added to
+// every call, so that fewer rounds are needed.
+void CallGraphUtils::loadFPCallGraphEdges(Module& M, SandboxVector& sandboxes, bool typeFallback) {
+  CallInstVector fpCalls;
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    if (F->isDeclaration()) continue;
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      if (CallInst* C = dyn_cast<CallInst>(&*I)) {
+        bool isVCall = C->getMetadata("soaap_defining_vtable_var") != NULL || C->getMetadata("soaap_defining_vtable_name") != NULL;
+        if (!isa<IntrinsicInst>(C) && isIndirectCall(C) && !isVCall) {
+          fpCalls.push_back(C);
+        }
       }
-      XO::close_list("callee_count");
-      XO::emit("\n");
-      XO::close_instance("callgraph_record");
     }
-    XO::close_list("callgraph_record");
   }
 
+  map<Context*,set<Function*> > visited;
+  string budgetExceeded;
+  bool widened = false;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    string budget;
+    if (!typeFallback && budgetExceeded.empty() && WorklistUtils::isOverBudget(budget)) {
+      SDEBUG("soaap.util.callgraph", 1, dbgs() << INDENT_1 << "Over " << budget << " budget, adding type-compatible targets\n")
+      budgetExceeded = budget;
+    }
+    for (CallInst* C : fpCalls) {
+      FunctionSet targets = typeFallback
+        ? getFPAnnotatedTargetsAnalysis().getTypeCompatibleTargets(C)
+        : PointsToUtils::getFunctionsPointedTo(C->getCalledValue()->stripPointerCasts());
+      if (!budgetExceeded.empty()) {
+        for (Function* T : getFPAnnotatedTargetsAnalysis().getTypeCompatibleTargets(C)) {
+          widened |= targets.insert(T).second;
+        }
+      }
+      if (targets.empty()) continue;
+      for (Context* Ctx : ContextUtils::getContextsForInstruction(C, false, sandboxes, M)) {
+        FunctionSet& currentCallees = callToCallees[C][Ctx];
+        if (typeFallback && !currentCallees.empty()) continue;
+        FunctionSet newCallees;
+        for (Function* T : targets) {
+          if (currentCallees.count(T) == 0) {
+            newCallees.insert(T);
+          }
+        }
+        if (newCallees.empty()) continue;
+        SDEBUG("soaap.util.callgraph", 3, dbgs() << INDENT_2 << "New targets for " << *C << ": " << stringifyFunctionSet(newCallees) << "\n")
+        addCallees(C, Ctx, newCallees, false);
+        for (Function* callee : newCallees) {
+          buildBasicCallGraphHelper(M, sandboxes, callee, Ctx, visited[Ctx]);
+        }
+        changed = true;
+      }
+    }
+    if (changed) {
+      SandboxUtils::reinitSandboxes(sandboxes);
+      SandboxUtils::recalculatePrivilegedMethods(M);
+    }
+  }
+  if (widened) {
+    WorklistUtils::noteOverBudget("callgraph", budgetExceeded);
+  }
 }
 
 FunctionSet CallGraphUtils::getCallees(const CallInst* C, Context* Ctx, Module& M) {
@@ -239,6 +345,11 @@ void CallGraphUtils::buildBasicCallGraph(Module& M, SandboxVector& sandboxes) {
 
 void CallGraphUtils::buildBasicCallGraphHelper(Module& M, SandboxVector& sandboxes, Function* F, Context* Ctx, set<Function*>& visited) {
   
+  if (F) {
+    // the module may have been loaded lazily and this body not needed before
+    ModuleUtils::materializeReachable(F);
+  }
+
   if (F && F->isDeclaration()) {
     return;
   }
@@ -335,6 +446,8 @@ void CallGraphUtils::addCallees(CallInst* C, Context* Ctx, FunctionSet& callees,
   FunctionSet& currentCallees = (FunctionSet&)callToCallees[C][Ctx];
   Function* EnclosingFunc = C->getParent()->getParent();
   for (Function* callee : callees) {
+    // analyses that follow call edges need the callee's body
+    ModuleUtils::materializeReachable(callee);
     if (currentCallees.insert(callee).second) {
       SDEBUG("soaap.util.callgraph", 3, dbgs() << INDENT_4 << "Adding: " << callee->getName() << "\n");
       calleeToCalls[callee][Ctx].insert(C);
@@ -416,9 +529,9 @@ void CallGraphUtils::calculateShortestCallPathsFromFunc(Function* F, bool privil
   call[F] = NULL;
 
   SDEBUG("soaap.util.callgraph", 3, dbgs() << INDENT_1 << "setting all distances from main to INT_MAX\n")
-  for (Module::iterator F2 = M.begin(), E = M.end(); F2 != E; ++F2) {
-    if (&*F2 != F) {
-      distanceFromMain[&*F2] = INT_MAX;
+  for (Function* F2 : SliceUtils::getFunctions(M)) {
+    if (F2 != F) {
+      distanceFromMain[F2] = INT_MAX;
     }
   }
 
@@ -437,7 +550,8 @@ void CallGraphUtils::calculateShortestCallPathsFromFunc(Function* F, bool privil
         Function* SuccFunc = E.second;
         // skip non-main root node
         SDEBUG("soaap.util.callgraph", 4, dbgs() << INDENT_3 << "Succ func: " << SuccFunc->getName() << "\n")
-        if (distanceFromMain[SuccFunc] > distanceFromMain[F2]+1) {
+        unordered_map<Function*,int>::iterator DI = distanceFromMain.find(SuccFunc);
+        if (DI == distanceFromMain.end() || DI->second > distanceFromMain[F2]+1) {
           distanceFromMain[SuccFunc] = distanceFromMain[F2]+1;
           pred[SuccFunc] = F2;
           call[SuccFunc] = C;
@@ -449,15 +563,16 @@ void CallGraphUtils::calculateShortestCallPathsFromFunc(Function* F, bool privil
 
   // cache shortest paths for each function
   SDEBUG("soaap.util.callgraph", 3, dbgs() << INDENT_1 << "Caching shortest paths\n")
-  for (Module::iterator F2 = M.begin(), E = M.end(); F2 != E; ++F2) {
-    if (distanceFromMain[F2] < INT_MAX) { // N is reachable from main
+  for (pair<Function* const,int>& p : distanceFromMain) {
+    Function* F2 = p.first;
+    if (p.second < INT_MAX) { // N is reachable from main
       InstTrace path;
-      Function* CurrF = &*F2;
+      Function* CurrF = F2;
       while (CurrF != F) {
         path.push_back(call[CurrF]);
         CurrF = pred[CurrF];
       }
-      funcToShortestCallPaths[F][&*F2] = path;
+      funcToShortestCallPaths[F][F2] = path;
       SDEBUG("soaap.util.callgraph", 3, dbgs() << INDENT_1 << "Paths from " << F->getName() << "() to " << F2->getName() << ": " << path.size() << "\n")
     }
   }
@@ -558,68 +673,112 @@ InstTrace CallGraphUtils::findSandboxedPathToFunction(Function* Target, Sandbox*
   return sboxStack;
 }
 
-void CallGraphUtils::emitCallTrace(Function* Target, Sandbox* S, Module& M) {
-  XO::open_list("trace");
-  XO::emit(" Possible trace ({d:context}):\n", ContextUtils::stringifyContext(S ? S : ContextUtils::PRIV_CONTEXT).c_str());
+int CallGraphUtils::findTraceId(Function* Target, Sandbox* S, Module& M) {
+  pair<Function*,Sandbox*> key(Target, S);
+  DenseMap<pair<Function*,Sandbox*>,int>::iterator I = targetToTraceId.find(key);
+  if (I != targetToTraceId.end()) {
+    return I->second;
+  }
   InstTrace callStack = S
     ? findSandboxedPathToFunction(Target, S, M)
     : findPrivilegedPathToFunction(Target, M);
+  // only calls with debug info can be reported
+  InstTrace reportableCallStack;
+  for (Instruction* I : callStack) {
+    if (I->getMetadata("dbg")) {
+      reportableCallStack.push_back(I);
+    }
+  }
+  int traceId = traces.insert(reportableCallStack);
+  targetToTraceId[key] = traceId;
+  return traceId;
+}
+
+// Traces are stored once, in a trie, and are reconstructed only the first
+// time each Target/S pair is reported. In machine-readable reports, each
+// trace node is defined the first time it is used (parents before children)
+// and warnings refer to their trace by id. In text reports, the trace is
+// displayed in full, unless -soaap-collapse-traces is given, in which case it
+// stops at the first call already displayed in an earlier trace.
+void CallGraphUtils::emitCallTrace(Function* Target, Sandbox* S, Module& M) {
+  int traceId = findTraceId(Target, S, M);
+  vector<int> path; // innermost first
+  for (int id = traceId; id != TraceTrie::ROOT; id = traces.getParent(id)) {
+    path.push_back(id);
+  }
+  if (emittedTraceNodes.size() < traces.size()) {
+    emittedTraceNodes.resize(traces.size());
+    displayedTraceNodes.resize(traces.size());
+  }
+
+  XO::open_list("trace_node");
+  for (vector<int>::reverse_iterator I=path.rbegin(), E=path.rend(); I!=E; I++) {
+    int id = *I;
+    if (emittedTraceNodes.test(id)) {
+      continue;
+    }
+    emittedTraceNodes.set(id);
+    Instruction* C = traces.getInst(id);
+    DILocation Loc(C->getMetadata("dbg"));
+    StringRef File = Loc.getFilename();
+    string library = DebugUtils::getEnclosingLibrary(C);
+    XO::open_instance("trace_node");
+    XO::emit("{e:id/%d}{e:parent/%d}{e:function/%s}",
+              id,
+              traces.getParent(id),
+              C->getParent()->getParent()->getName().str().c_str());
+    XO::open_container("location");
+    XO::emit("{e:file/%s}{e:line/%d}",
+              File.substr(File.find_last_of("/")+1).str().c_str(),
+              Loc.getLineNumber());
+    if (!library.empty()) {
+      XO::emit("{e:library/%s}", library.c_str());
+    }
+    XO::close_container("location");
+    XO::close_instance("trace_node");
+  }
+  XO::close_list("trace_node");
+  XO::emit("{e:trace_id/%d}", traceId);
+
+  XO::emit(" Possible trace ({d:context}):\n", ContextUtils::stringifyContext(S ? S : ContextUtils::PRIV_CONTEXT).c_str());
   int currInstIdx = 0;
   bool shownDots = false;
-  for (Instruction* I : callStack) {
-    if (MDNode *N = I->getMetadata("dbg")) {
-      DILocation Loc(N);
-      Function* EnclosingFunc = I->getParent()->getParent();
-      unsigned Line = Loc.getLineNumber();
+  for (int id : path) {
+    Instruction* C = traces.getInst(id);
+    Function* EnclosingFunc = C->getParent()->getParent();
+    if (CmdLineOpts::CollapseTraces && currInstIdx > 0 && displayedTraceNodes.test(id)) {
+      // the remainder of this trace has already been displayed
+      XO::emit("      {d:function/%s} ... (continues as in an earlier trace)\n",
+                EnclosingFunc->getName().str().c_str());
+      break;
+    }
+    bool printCall = CmdLineOpts::SummariseTraces <= 0
+                      || currInstIdx < CmdLineOpts::SummariseTraces
+                      || (path.size()-(currInstIdx+1))
+                          < CmdLineOpts::SummariseTraces;
+    if (printCall) {
+      displayedTraceNodes.set(id);
+      DILocation Loc(C->getMetadata("dbg"));
       StringRef File = Loc.getFilename();
-      unsigned FileOnlyIdx = File.find_last_of("/");
-      StringRef FileOnly = FileOnlyIdx == -1 ? File : File.substr(FileOnlyIdx+1);
-      string library = DebugUtils::getEnclosingLibrary(I);
-
-      XO::open_instance("trace");
-      bool printCall = CmdLineOpts::SummariseTraces <= 0
-                        || currInstIdx < CmdLineOpts::SummariseTraces
-                        || (callStack.size()-(currInstIdx+1))
-                            < CmdLineOpts::SummariseTraces;
-      if (printCall) {
-        XO::emit("      {:function/%s} ",
-                  EnclosingFunc->getName().str().c_str());
-        XO::open_container("location");
-        XO::emit("({:file/%s}:{:line/%d})",
-                  FileOnly.str().c_str(),
-                  Line);
-        if (!library.empty()) {
-          XO::emit(" [{:library/%s} library]", library.c_str());
-        }
-        XO::emit("\n");
-        XO::close_container("location");
+      string library = DebugUtils::getEnclosingLibrary(C);
+      XO::emit("      {d:function/%s} ({d:file/%s}:{d:line/%d})",
+                EnclosingFunc->getName().str().c_str(),
+                File.substr(File.find_last_of("/")+1).str().c_str(),
+                Loc.getLineNumber());
+      if (!library.empty()) {
+        XO::emit(" [{d:library/%s} library]", library.c_str());
       }
-      else {
-        // output call only in machine-readable reports, and
-        // three lines of "..." otherwise
-        if (!shownDots) {
-          XO::emit("      ...\n");
-          XO::emit("      ...\n");
-          XO::emit("      ...\n");
-          shownDots = true;
-        }
-        XO::emit("{e:function/%s}",
-                  EnclosingFunc->getName().str().c_str());
-        XO::open_container("location");
-        XO::emit("{e:file/%s}{e:line/%d}",
-                  FileOnly.str().c_str(),
-                  Line);
-        if (!library.empty()) {
-          XO::emit("{e:library/%s}", library.c_str());
-        }
-        XO::close_container("location");
-      }
-      XO::close_instance("trace");
+      XO::emit("\n");
+    }
+    else if (!shownDots) {
+      // three lines of "..." for the calls that are omitted
+      XO::emit("      ...\n");
+      XO::emit("      ...\n");
+      XO::emit("      ...\n");
+      shownDots = true;
     }
     currInstIdx++;
   }
-  //XO::emit("\n\n");
-  XO::close_list("trace");
 }
 
 FPTargetsAnalysis& CallGraphUtils::getFPInferredTargetsAnalysis() {
@@ -5,6 +5,7 @@
 #include "llvm/Support/GraphWriter.h"
 
 #include "Common/Sandbox.h"
+#include "Common/TraceTrie.h"
 #include "Common/Typedefs.h"
 
 using namespace llvm;
@@ -15,6 +16,7 @@ namespace soaap {
     public:
       static void buildBasicCallGraph(Module& M, SandboxVector& sandboxes);
       static void loadAnnotatedInferredCallGraphEdges(Module& M, SandboxVector& sandboxes);
+      static void printCallGraph();
       static void listFPCalls(Module& M, SandboxVector& sandboxes);
       static void listFPTargets(Module& M, SandboxVector& sandboxes);
       static void listAllFuncs(Module& M);
@@ -43,6 +45,12 @@ namespace soaap {
       static map<const Function*, map<Context*, CallInstSet> > calleeToCalls;
       static map<Function*, map<Function*,InstTrace> > funcToShortestCallPaths; //TODO: check
       static bool caching;
+      static TraceTrie traces;
+      static DenseMap<pair<Function*,Sandbox*>,int> targetToTraceId;
+      static BitVector emittedTraceNodes;
+      static BitVector displayedTraceNodes;
+      static int findTraceId(Function* Target, Sandbox* S, Module& M);
+      static void loadFPCallGraphEdges(Module& M, SandboxVector& sandboxes, bool typeFallback);
       static void buildBasicCallGraphHelper(Module& M, SandboxVector& sandboxes, Function* F, Context* Ctx, set<Function*>& visited);
       static void calculateShortestCallPathsFromFunc(Function* F, bool privileged, Sandbox* S, Module& M);
       static bool isReachableFromHelper(Function* Source, Function* Curr, Function* Dest, Sandbox* Ctx, set<Function*>& visited, Module& M);
@@ -2,6 +2,8 @@
 #include "Util/CallGraphUtils.h"
 #include "Util/ClassHierarchyUtils.h"
 #include "Util/DebugUtils.h"
+#include "Util/ParallelUtils.h"
+#include "Util/SliceUtils.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/InstIterator.h"
@@ -12,6 +14,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Local.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -28,16 +31,32 @@ using namespace llvm;
 using namespace std;
 
 GlobalVariableVector ClassHierarchyUtils::classes;
+DenseMap<GlobalVariable*,int> ClassHierarchyUtils::classToId;
 ClassHierarchy ClassHierarchyUtils::classToSubclasses;
-map<CallInst*,FunctionSet> ClassHierarchyUtils::callToCalleesCache;
-map<GlobalVariable*,GlobalVariable*> ClassHierarchyUtils::typeInfoToVTable;
-map<GlobalVariable*,GlobalVariable*> ClassHierarchyUtils::vTableToTypeInfo;
-map<GlobalVariable*,map<int,int> > ClassHierarchyUtils::vTableToSecondaryVTableMaps;
-map<GlobalVariable*,map<GlobalVariable*,int> > ClassHierarchyUtils::classToBaseOffset;
-map<GlobalVariable*,map<GlobalVariable*,int> > ClassHierarchyUtils::classToVBaseOffsetOffset;
+vector<int> ClassHierarchyUtils::classToPreOrder;
+vector<ClassIntervalVector> ClassHierarchyUtils::classToDescendentIntervals;
+DenseMap<GlobalVariable*,GlobalVariable*> ClassHierarchyUtils::typeInfoToVTable;
+DenseMap<GlobalVariable*,GlobalVariable*> ClassHierarchyUtils::vTableToTypeInfo;
+StringMap<GlobalVariable*> ClassHierarchyUtils::typeInfoNameToVar;
+vector<FunctionSet> ClassHierarchyUtils::calleeSets;
+map<vector<Function*>,int> ClassHierarchyUtils::calleeSetToHandle;
+DenseMap<CallInst*,int> ClassHierarchyUtils::callToCalleeSet;
+DenseMap<GlobalVariable*,map<int,int> > ClassHierarchyUtils::vTableToSecondaryVTableMaps;
+DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> > ClassHierarchyUtils::classToBaseOffset;
+DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> > ClassHierarchyUtils::classToVBaseOffsetOffset;
+bool ClassHierarchyUtils::hierarchyFound = false;
 bool ClassHierarchyUtils::cachingDone = false;
+unsigned ClassHierarchyUtils::definingVTableVarKind;
+unsigned ClassHierarchyUtils::definingVTableNameKind;
+unsigned ClassHierarchyUtils::staticVTableVarKind;
+unsigned ClassHierarchyUtils::staticVTableNameKind;
 
 void ClassHierarchyUtils::findClassHierarchy(Module& M) {
+  if (hierarchyFound) {
+    return; // e.g. found by the daemon before it forked
+  }
+  hierarchyFound = true;
+
   // Extract class hierarchy using std::type_info structures rather than debug
   // info. The former works even for when there are anonymous namespaces.
   // (for more info, see http://mentorembedded.github.io/cxx-abi/abi.html)
@@ -88,16 +107,44 @@ void ClassHierarchyUtils::findClassHierarchy(Module& M) {
     GlobalVariable* G = &*I;
     if (G->getName().startswith("_ZTI")) {
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Found type_info: " << G->getName() << "\n");
+      // Index by mangled class name so that v-calls annotated with a vtable
+      // name can find the corresponding type_info without building the
+      // _ZTI name. Only externally-visible ones can be found by name.
+      if (!G->hasLocalLinkage()) {
+        typeInfoNameToVar[G->getName().substr(4)] = G;
+      }
       processTypeInfo(G, M);
     }
   }
 
+  numberClassHierarchy();
+
   SDEBUG("soaap.util.classhierarchy", 3, ppClassHierarchy(classToSubclasses));
 }
 
+void ClassHierarchyUtils::reset() {
+  classes.clear();
+  classToId.clear();
+  classToSubclasses.clear();
+  classToPreOrder.clear();
+  classToDescendentIntervals.clear();
+  typeInfoToVTable.clear();
+  vTableToTypeInfo.clear();
+  typeInfoNameToVar.clear();
+  calleeSets.clear();
+  calleeSetToHandle.clear();
+  callToCalleeSet.clear();
+  vTableToSecondaryVTableMaps.clear();
+  classToBaseOffset.clear();
+  classToVBaseOffsetOffset.clear();
+  hierarchyFound = false;
+  cachingDone = false;
+}
+
 void ClassHierarchyUtils::processTypeInfo(GlobalVariable* TI, Module& M) {
-  if (find(classes.begin(), classes.end(), TI) == classes.end()) {
+  if (classToId.find(TI) == classToId.end()) {
     SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Adding class " << TI->getName() << "\n");
+    classToId[TI] = classes.size();
     classes.push_back(TI);
 
     // First process the correspoding virtual table. We store the indexes of the primary
@@ -218,6 +265,85 @@ void ClassHierarchyUtils::processTypeInfo(GlobalVariable* TI, Module& M) {
   }
 }
 
+void ClassHierarchyUtils::numberClassHierarchy() {
+  // Number classes in DFS pre-order, starting from the roots of the
+  // hierarchy. The descendents of a class then occupy the pre-order range of
+  // its DFS subtree plus, in the presence of multiple inheritance, the ranges
+  // of subclasses that were first reached through another base. The latter
+  // are merged in on the way back up, which is safe because the hierarchy is
+  // acyclic and so they will have already been completely numbered.
+  int numClasses = classes.size();
+  classToPreOrder.assign(numClasses, -1);
+  classToDescendentIntervals.assign(numClasses, ClassIntervalVector());
+
+  vector<bool> hasBase(numClasses, false);
+  for (ClassHierarchy::iterator I=classToSubclasses.begin(), E=classToSubclasses.end(); I != E; I++) {
+    for (GlobalVariable* sc : I->second) {
+      hasBase[classToId.lookup(sc)] = true;
+    }
+  }
+
+  int nextPreOrder = 0;
+  for (int id=0; id<numClasses; id++) {
+    if (!hasBase[id]) {
+      numberClassHierarchyHelper(id, nextPreOrder);
+    }
+  }
+  SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Numbered " << nextPreOrder << " classes\n");
+}
+
+void ClassHierarchyUtils::numberClassHierarchyHelper(int id, int& nextPreOrder) {
+  int preOrder = nextPreOrder++;
+  classToPreOrder[id] = preOrder;
+
+  SmallVector<int,8> subclassIds;
+  ClassHierarchy::iterator I = classToSubclasses.find(classes[id]);
+  if (I != classToSubclasses.end()) {
+    for (GlobalVariable* sc : I->second) {
+      int scId = classToId.lookup(sc);
+      if (classToPreOrder[scId] == -1) {
+        numberClassHierarchyHelper(scId, nextPreOrder);
+      }
+      subclassIds.push_back(scId);
+    }
+  }
+
+  ClassIntervalVector intervals;
+  intervals.push_back(ClassInterval(preOrder, nextPreOrder-1));
+  for (int scId : subclassIds) {
+    for (ClassInterval& interval : classToDescendentIntervals[scId]) {
+      intervals.push_back(interval);
+    }
+  }
+
+  // coalesce overlapping and adjacent intervals
+  sort(intervals.begin(), intervals.end());
+  ClassIntervalVector& merged = classToDescendentIntervals[id];
+  for (ClassInterval& interval : intervals) {
+    if (!merged.empty() && interval.first <= merged.back().second+1) {
+      merged.back().second = max(merged.back().second, interval.second);
+    }
+    else {
+      merged.push_back(interval);
+    }
+  }
+}
+
+bool ClassHierarchyUtils::isSubclassOf(GlobalVariable* subTI, GlobalVariable* TI) {
+  DenseMap<GlobalVariable*,int>::iterator SI = classToId.find(subTI);
+  DenseMap<GlobalVariable*,int>::iterator I = classToId.find(TI);
+  if (SI == classToId.end() || I == classToId.end()) {
+    return subTI == TI;
+  }
+  int preOrder = classToPreOrder[SI->second];
+  for (ClassInterval& interval : classToDescendentIntervals[I->second]) {
+    if (preOrder >= interval.first && preOrder <= interval.second) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ClassHierarchyUtils::ppClassHierarchy(ClassHierarchy& classHierarchy) {
   // first find all classes that do not have subclasses
   GlobalVariableVector baseClasses = classes;
@@ -245,121 +371,200 @@ void ClassHierarchyUtils::ppClassHierarchyHelper(GlobalVariable* c, ClassHierarc
 
   char* demangled = abi::__cxa_demangle(cName.replace(0, 4, "_Z").c_str(), 0, 0, &status);
   dbgs() << (status == 0 ? demangled : cName) << "\n";
-  for (GlobalVariable* sc : classHierarchy[c]) {
-    ppClassHierarchyHelper(sc, classHierarchy, nesting+1);
+  ClassHierarchy::iterator I = classHierarchy.find(c);
+  if (I != classHierarchy.end()) {
+    for (GlobalVariable* sc : I->second) {
+      ppClassHierarchyHelper(sc, classHierarchy, nesting+1);
+    }
   }
 }
 
 void ClassHierarchyUtils::cacheAllCalleesForVirtualCalls(Module& M) {
   if (!cachingDone) {
-    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
-      if (F->isDeclaration()) continue;
-      SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Processing " << F->getName() << "\n");
-      for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
-        if (CallInst* C = dyn_cast<CallInst>(&*I)) {
-          GlobalVariable* definingTypeVTableVar = NULL;
-          GlobalVariable* definingTypeTIVar = NULL;
-          GlobalVariable* staticTypeVTableVar = NULL;
-          GlobalVariable* staticTypeTIVar = NULL;
-          bool hasMetadata = false;
-          // All relevant virtual calls will have metadata that we have
-          // inserted during compilation to IR in clang. The defining type
-          // gives us the vtable index and the relevant subobject that contains
-          // the function at this index. The static type gives us the class
-          // that we start finding callees from, as the possible callee could
-          // be from this class or any subclass.
-          if (MDNode* N = I->getMetadata("soaap_defining_vtable_var")) {
-            SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_defining_vtable_var\n");
-            definingTypeVTableVar = cast<GlobalVariable>(getMDNodeOperandValue(N, 0));
-            definingTypeTIVar = vTableToTypeInfo[definingTypeVTableVar];
-            hasMetadata = true;
-          }
-          else if (MDNode* N = I->getMetadata("soaap_defining_vtable_name")) {
-            SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_defining_vtable_name\n");
-
-            ConstantDataArray* definingTypeVTableConstant = cast<ConstantDataArray>(getMDNodeOperandValue(N, 0));
-            string definingTypeVTableConstantStr = definingTypeVTableConstant->getAsString().str();
-            string definingTypeTIStr = "_ZTI" + definingTypeVTableConstantStr.substr(4);
-            definingTypeTIVar = M.getGlobalVariable(definingTypeTIStr);
-            /*definingTypeVTableVar = M.getGlobalVariable(definingTypeVTableConstantStr, true);
-            if (definingTypeVTableVar == NULL) {
-              definingTypeTIVar = M.getGlobalVariable(definingTypeTIStr);
-              dbgs() << "definingTypeVTableVar is null: " << definingTypeVTableConstantStr << "\n";
-              dbgs() << "definingTypeTIStr: " << definingTypeTIStr << "\n";
-
-              if (MDNode* N2 = I->getMetadata("dbg")) {
-                DILocation loc(N2);
-                dbgs() << "location - " << loc.getFilename() << ":" << loc.getLineNumber() << "\n";
-              }
-            }*/
-            hasMetadata = true;
-          }
-          if (MDNode* N = I->getMetadata("soaap_static_vtable_var")) {
-            SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_static_vtable_var\n");
-            staticTypeVTableVar = cast<GlobalVariable>(getMDNodeOperandValue(N, 0));
-            staticTypeTIVar = vTableToTypeInfo[staticTypeVTableVar];
-            hasMetadata = true;
+    // callee-set handle 0 is always the empty set
+    calleeSets.push_back(FunctionSet());
+    calleeSetToHandle[vector<Function*>()] = 0;
+
+    // Metadata kinds are registered in the LLVMContext on first lookup, which
+    // is not thread-safe, so obtain their ids up front.
+    definingVTableVarKind = M.getMDKindID("soaap_defining_vtable_var");
+    definingVTableNameKind = M.getMDKindID("soaap_defining_vtable_name");
+    staticVTableVarKind = M.getMDKindID("soaap_static_vtable_var");
+    staticVTableNameKind = M.getMDKindID("soaap_static_vtable_name");
+
+    // Find all v-calls, scanning functions in parallel. Each worker only
+    // writes to the entry of funcVCalls for the function it is scanning.
+    FunctionVector funcs;
+    for (Function* F : SliceUtils::getFunctions(M)) {
+      if (!F->isDeclaration()) {
+        funcs.push_back(F);
+      }
+    }
+    vector<VirtualCallVector> funcVCalls(funcs.size());
+    ParallelUtils::parallelFor(funcs.size(), [&](int i) {
+      findVirtualCalls(funcs[i], funcVCalls[i]);
+    });
+
+    // The callees only depend on the defining type, static type and vtable
+    // idx, so we group v-calls by this slot and only resolve each slot once.
+    vector<VirtualCall*> slotVCalls;
+    map<VTableSlot,int> slotToIdx;
+    vector<pair<CallInst*,int> > callToSlotIdx;
+    for (VirtualCallVector& vcalls : funcVCalls) {
+      for (VirtualCall& vcall : vcalls) {
+        DenseMap<GlobalVariable*,int>::iterator DI = classToId.find(vcall.definingTypeTI);
+        DenseMap<GlobalVariable*,int>::iterator SI = classToId.find(vcall.staticTypeTI);
+        int slotIdx = slotVCalls.size();
+        if (DI != classToId.end() && SI != classToId.end()) {
+          VTableSlot slot(DI->second, SI->second, vcall.vtableIdx);
+          map<VTableSlot,int>::iterator I = slotToIdx.find(slot);
+          if (I != slotToIdx.end()) {
+            slotIdx = I->second;
           }
-          else if (MDNode* N = I->getMetadata("soaap_static_vtable_name")) {
-            SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_static_vtable_name\n");
-            ConstantDataArray* staticTypeVTableConstant = cast<ConstantDataArray>(getMDNodeOperandValue(N, 0));
-            string staticTypeVTableConstantStr = staticTypeVTableConstant->getAsString().str();
-            string staticTypeTIStr = "_ZTI" + staticTypeVTableConstantStr.substr(4);
-            staticTypeTIVar = M.getGlobalVariable(staticTypeTIStr);
-            //dbgs() << "staticTypeVTableConstantStr: " << staticTypeVTableConstantStr << "\n";
-            /*staticTypeVTableVar = M.getGlobalVariable(staticTypeVTableConstantStr, true);
-            if (staticTypeVTableVar == NULL) {
-              string staticTypeTIStr = "_ZTI" + staticTypeVTableConstantStr.substr(4);
-              staticTypeTIVar = M.getGlobalVariable(staticTypeTIStr);
-              dbgs() << "staticTypeVTableVar is null: " << staticTypeVTableConstantStr << "\n";
-              dbgs() << "staticTypeTIStr: " << staticTypeTIStr << "\n";
-              if (MDNode* N2 = I->getMetadata("dbg")) {
-                DILocation loc(N2);
-                dbgs() << "location - " << loc.getFilename() << ":" << loc.getLineNumber() << "\n";
-              }
-            }*/
-            hasMetadata = true;
+          else {
+            slotToIdx[slot] = slotIdx;
           }
-          if (hasMetadata) {
-            if (definingTypeTIVar == NULL || staticTypeTIVar == NULL) {
-              SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "definingTypeTIVar or staticTypeTIVar is NULL\n");
-              bool debug = false;
-              SDEBUG("soaap.util.classhierarchy", 3, debug = true);
-              if (debug) {
-                if (definingTypeTIVar != NULL) {
-                  dbgs() << "   definingTypeTIVar is: " << definingTypeTIVar->getName() << "\n";
-                }
-                if (staticTypeTIVar != NULL) {
-                  dbgs() << "   staticTypeTIVar is: " << staticTypeTIVar->getName() << "\n";
-                }
-                if (MDNode* N = I->getMetadata("dbg")) {
-                  DILocation loc(N);
-                  dbgs() << "   location: " << loc.getFilename() << ":" << loc.getLineNumber() << "\n";
-                }
-              }
+        }
+        if (slotIdx == slotVCalls.size()) {
+          slotVCalls.push_back(&vcall);
+        }
+        callToSlotIdx.push_back(make_pair(vcall.call, slotIdx));
+      }
+    }
+    SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Resolving " << callToSlotIdx.size() << " v-calls using " << slotVCalls.size() << " distinct vtable slots\n");
+
+    // Resolve all slots as one parallel batch. The class hierarchy is
+    // read-only from here on and each slot's callees are written to their
+    // own element of slotCallees, so no locking is needed.
+    vector<FunctionSet> slotCallees(slotVCalls.size());
+    ParallelUtils::parallelFor(slotVCalls.size(), [&](int i) {
+      VirtualCall* vcall = slotVCalls[i];
+      findAllCalleesInSubClasses(vcall->call, vcall->definingTypeTI, vcall->staticTypeTI, vcall->vtableIdx, slotCallees[i]);
+    });
+
+    // Finally, dedup the callee sets and fill in the cache
+    vector<int> slotHandles(slotVCalls.size());
+    for (int i=0; i<slotVCalls.size(); i++) {
+      slotHandles[i] = getCalleeSetHandle(slotCallees[i]);
+      SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Callees: " << stringifyCalleeSet(slotHandles[i]) << "\n");
+    }
+    for (pair<CallInst*,int>& callSlot : callToSlotIdx) {
+      callToCalleeSet[callSlot.first] = slotHandles[callSlot.second];
+    }
+    cachingDone = true;
+  }
+}
+
+void ClassHierarchyUtils::findVirtualCalls(Function* F, VirtualCallVector& vcalls) {
+  SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "Processing " << F->getName() << "\n");
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    if (CallInst* C = dyn_cast<CallInst>(&*I)) {
+      GlobalVariable* definingTypeTIVar = NULL;
+      GlobalVariable* staticTypeTIVar = NULL;
+      bool hasMetadata = false;
+      // All relevant virtual calls will have metadata that we have
+      // inserted during compilation to IR in clang. The defining type
+      // gives us the vtable index and the relevant subobject that contains
+      // the function at this index. The static type gives us the class
+      // that we start finding callees from, as the possible callee could
+      // be from this class or any subclass.
+      if (MDNode* N = C->getMetadata(definingVTableVarKind)) {
+        SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_defining_vtable_var\n");
+        definingTypeTIVar = vTableToTypeInfo.lookup(cast<GlobalVariable>(getMDNodeOperandValue(N, 0)));
+        hasMetadata = true;
+      }
+      else if (MDNode* N = C->getMetadata(definingVTableNameKind)) {
+        SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_defining_vtable_name\n");
+        definingTypeTIVar = getTypeInfoForVTableName(N);
+        hasMetadata = true;
+      }
+      if (MDNode* N = C->getMetadata(staticVTableVarKind)) {
+        SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_static_vtable_var\n");
+        staticTypeTIVar = vTableToTypeInfo.lookup(cast<GlobalVariable>(getMDNodeOperandValue(N, 0)));
+        hasMetadata = true;
+      }
+      else if (MDNode* N = C->getMetadata(staticVTableNameKind)) {
+        SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "soaap_static_vtable_name\n");
+        staticTypeTIVar = getTypeInfoForVTableName(N);
+        hasMetadata = true;
+      }
+      if (hasMetadata) {
+        if (definingTypeTIVar == NULL || staticTypeTIVar == NULL) {
+          SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "definingTypeTIVar or staticTypeTIVar is NULL\n");
+          bool debug = false;
+          SDEBUG("soaap.util.classhierarchy", 3, debug = true);
+          if (debug) {
+            if (definingTypeTIVar != NULL) {
+              dbgs() << "   definingTypeTIVar is: " << definingTypeTIVar->getName() << "\n";
             }
-            else {
-              callToCalleesCache[C] = findAllCalleesForVirtualCall(C, definingTypeTIVar, staticTypeTIVar, M);
+            if (staticTypeTIVar != NULL) {
+              dbgs() << "   staticTypeTIVar is: " << staticTypeTIVar->getName() << "\n";
+            }
+            if (MDNode* N = I->getMetadata("dbg")) {
+              DILocation loc(N);
+              dbgs() << "   location: " << loc.getFilename() << ":" << loc.getLineNumber() << "\n";
             }
           }
         }
+        else {
+          VirtualCall vcall;
+          vcall.call = C;
+          vcall.definingTypeTI = definingTypeTIVar;
+          vcall.staticTypeTI = staticTypeTIVar;
+          vcall.vtableIdx = findVTableIdxForVirtualCall(C);
+          vcalls.push_back(vcall);
+        }
       }
     }
-    cachingDone = true;
   }
 }
 
-FunctionSet ClassHierarchyUtils::getCalleesForVirtualCall(CallInst* C, Module& M) {
+GlobalVariable* ClassHierarchyUtils::getTypeInfoForVTableName(MDNode* N) {
+  // The vtable name is of the form _ZTV<class>, and the corresponding
+  // type_info is _ZTI<class>, so we look up the latter by <class> directly.
+  ConstantDataArray* vTableNameConstant = cast<ConstantDataArray>(getMDNodeOperandValue(N, 0));
+  StringRef vTableName = vTableNameConstant->getAsString();
+  return typeInfoNameToVar.lookup(vTableName.substr(4));
+}
+
+FunctionSet& ClassHierarchyUtils::getCalleesForVirtualCall(CallInst* C, Module& M) {
   if (!cachingDone) {
     cacheAllCalleesForVirtualCalls(M);
   }
-  return callToCalleesCache[C];
+  // calls that were not resolved map to the empty set (handle 0)
+  return calleeSets[callToCalleeSet.lookup(C)];
+}
+
+int ClassHierarchyUtils::getCalleeSetHandle(FunctionSet& callees) {
+  // Many v-call sites, and vtable slots, resolve to exactly the same set of
+  // callees, so we only store each distinct set once.
+  vector<Function*> key(callees.begin(), callees.end());
+  sort(key.begin(), key.end());
+  map<vector<Function*>,int>::iterator I = calleeSetToHandle.find(key);
+  if (I != calleeSetToHandle.end()) {
+    return I->second;
+  }
+  int handle = calleeSets.size();
+  calleeSets.push_back(callees);
+  calleeSetToHandle[key] = handle;
+  return handle;
 }
 
+string ClassHierarchyUtils::stringifyCalleeSet(int handle) {
+  string calleesStr = "[";
+  int i = 0;
+  for (Function* F : calleeSets[handle]) {
+    calleesStr += F->getName().str();
+    if (i < calleeSets[handle].size()-1)
+      calleesStr += ",";
+    i++;
+  }
+  return calleesStr + "]";
+}
 
-FunctionSet ClassHierarchyUtils::findAllCalleesForVirtualCall(CallInst* C, GlobalVariable* definingTypeTIVar, GlobalVariable* staticTypeTIVar, Module& M) {
+int ClassHierarchyUtils::findVTableIdxForVirtualCall(CallInst* C) {
   
-  FunctionSet callees;
+  int cVTableIdx = 0;
 
   // We know this is a virtual call, as it has already been annotated with
   // debugging metadata by clang.
@@ -386,32 +591,8 @@ FunctionSet ClassHierarchyUtils::findAllCalleesForVirtualCall(CallInst* C, Globa
   if (LoadInst* calledVal = dyn_cast<LoadInst>(C->getCalledValue())) {
     if (GetElementPtrInst* gep = dyn_cast<GetElementPtrInst>(calledVal->getPointerOperand())) {
       if (ConstantInt* cVTableIdxVal = dyn_cast<ConstantInt>(gep->getOperand(1))) {
-        int cVTableIdx = cVTableIdxVal->getSExtValue();
+        cVTableIdx = cVTableIdxVal->getSExtValue();
         SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "relative cVTableIdx: " << cVTableIdx << "\n");
-        // Find all implementations in reciever's class (corresponding to the
-        // static type) as well as all descendent classes. VTables are built 
-        // inductively from the vtables of base classes. This allows an object
-        // of a type D to be treated as an object of type B, just by passing a
-        // pointer to B's subojbect within D. Thus, 
-
-
-        // special case for virtual base classes, which will come after all
-        // non-virtual classes in the vtable and will only appear once
-        findAllCalleesInSubClasses(C, definingTypeTIVar, staticTypeTIVar, cVTableIdx, callees);
-        SDEBUG("soaap.util.classhierarchy", 4, dbgs() << "Num of callees: " << callToCalleesCache[C].size() << "\n");
-        /*
-        dbgs() << "Num of callees: " << callees.size() << "\n";
-        if (callees.empty()) {
-          dbgs() << "  definingTypeTI: " << definingTypeTIVar->getName() << "\n";
-          dbgs() << "  staticTypeTI: " << staticTypeTIVar->getName() << "\n";
-          dbgs() << "  vtableIdx: " << cVTableIdx << "\n";
-          if (MDNode* N = C->getMetadata("dbg")) {
-            DILocation loc(N);
-            dbgs() << "  location: " << loc.getFilename() << ":" << loc.getLineNumber() << "\n";
-          }
-          dbgs() << "\n";
-        }
-        */
       }
       else {
         SDEBUG("soaap.util.classhierarchy", 3, C->dump());
@@ -435,22 +616,7 @@ FunctionSet ClassHierarchyUtils::findAllCalleesForVirtualCall(CallInst* C, Globa
     report_fatal_error("V-call sequence does not have a loadinst where expected");
   }
 
-  // debugging
-  bool dbg = false;
-  SDEBUG("soaap.util.classhierarchy", 3, dbg = true);
-  if (dbg) {
-    dbgs() << "Callees: [";
-    int i = 0;
-    for (Function* F : callees) {
-      dbgs() << F->getName();
-      if (i < callees.size()-1)
-        dbgs() << ",";
-      i++;
-    }
-    dbgs() << "]\n";
-  }
-
-  return callees;
+  return cVTableIdx;
 }
 
 void ClassHierarchyUtils::findAllCalleesInSubClasses(CallInst* C, GlobalVariable* definingTypeTI, GlobalVariable* staticTypeTI, int vtableIdx, FunctionSet& callees) {
@@ -508,7 +674,7 @@ void ClassHierarchyUtils::findAllCalleesInSubClassesHelper(CallInst* C, GlobalVa
       collectingCallees = true;
     }
 
-    if (GlobalVariable* VT = typeInfoToVTable[TI]) {
+    if (GlobalVariable* VT = typeInfoToVTable.lookup(TI)) {
       // Obtain start-of-vtable index for subobject within VT
       ConstantArray* VTinit = cast<ConstantArray>(VT->getInitializer());
       // It's possible that TI is a superclass that doesn't contain the
@@ -523,8 +689,14 @@ void ClassHierarchyUtils::findAllCalleesInSubClassesHelper(CallInst* C, GlobalVa
       // We cannot reliably detect downcasts however as the function may have
       // been introduced in-between TI and the casted-to type and so we may
       // infer more callees.
-      if (vTableToSecondaryVTableMaps[VT].find(subObjOffset) != vTableToSecondaryVTableMaps[VT].end()) {
-        int vtableOffset = vTableToSecondaryVTableMaps[VT][subObjOffset];
+      //
+      // (Only read-only lookups are performed here, as v-call slots are
+      // resolved concurrently.)
+      DenseMap<GlobalVariable*,map<int,int> >::iterator VI = vTableToSecondaryVTableMaps.find(VT);
+      map<int,int>::iterator OI;
+      if (VI != vTableToSecondaryVTableMaps.end() && (OI = VI->second.find(subObjOffset)) != VI->second.end()) {
+        map<int,int>& secondaryVTables = VI->second;
+        int vtableOffset = OI->second;
         SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "absolute vtable index: " << (vtableOffset+vtableIdx) << "\n");
         if (vbaseOffsetOffset != INT_MAX) {
           // function is in a virtual base vtable, so we need to obtain the
@@ -551,10 +723,11 @@ void ClassHierarchyUtils::findAllCalleesInSubClassesHelper(CallInst* C, GlobalVa
           // object, so get the actual offset by adding vbaseSubObjOffset
           SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "adjusting vbaseOffset to " << (vbaseOffset+vbaseSubObjOffset) << "\n");
           int objOffset = vbaseOffset+vbaseSubObjOffset;
-          if (vTableToSecondaryVTableMaps[VT].find(objOffset) == vTableToSecondaryVTableMaps[VT].end()) {
+          OI = secondaryVTables.find(objOffset);
+          if (OI == secondaryVTables.end()) {
             report_fatal_error("Secondary VTable at offset " + Twine(objOffset) + " does not exist in " + VT->getName());
           }
-          vtableOffset = vTableToSecondaryVTableMaps[VT][vbaseOffset+vbaseSubObjOffset];
+          vtableOffset = OI->second;
           SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "vtableOffset for vbase in " << TI->getName() << " is " << vtableOffset << "\n");
         }
         if ((vtableOffset+vtableIdx) < VTinit->getNumOperands()) {
@@ -597,16 +770,25 @@ void ClassHierarchyUtils::findAllCalleesInSubClassesHelper(CallInst* C, GlobalVa
   else {
     SDEBUG("soaap.util.classhierarchy", 3, dbgs() << TI->getName() << " != " << staticTypeTI->getName() << "\n");
   }
-  // recurse on subclasses
-  for (GlobalVariable* subTI : classToSubclasses[TI]) {
+  // recurse on subclasses. Until we have reached the static type, we only
+  // need to walk down those subclasses that the static type descends from.
+  ClassHierarchy::iterator I = classToSubclasses.find(TI);
+  if (I == classToSubclasses.end()) {
+    return;
+  }
+  for (GlobalVariable* subTI : I->second) {
+    if (!collectingCallees && !isSubclassOf(staticTypeTI, subTI)) {
+      SDEBUG("soaap.util.classhierarchy", 4, dbgs() << "------> pruning " << subTI->getName() << "\n");
+      continue;
+    }
     SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "------> recursing on " << subTI->getName() << "\n");
-    if (classToVBaseOffsetOffset[subTI].find(TI) != classToVBaseOffsetOffset[subTI].end()) {
+    int vbaseOffOff = getBaseOffset(classToVBaseOffsetOffset, subTI, TI, INT_MAX);
+    if (vbaseOffOff != INT_MAX) {
       if (vbaseOffsetOffset != INT_MAX) {
         report_fatal_error("discovered another virtual base class on this path!");
       }
       // TI is a virtual base of subTI
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << TI->getName() << " is a virtual base of " << subTI->getName() << "\n");
-      int vbaseOffOff = classToVBaseOffsetOffset[subTI][TI];
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "vbaseOffsetOffset: " << vbaseOffOff << "\n");
       // subObjOffset now becomes the vbaseSubObjOffset and subObjOffset is 0
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "vbaseSubObjOffset: " << subObjOffset << ", subObjOffset: 0\n");
@@ -615,7 +797,7 @@ void ClassHierarchyUtils::findAllCalleesInSubClassesHelper(CallInst* C, GlobalVa
     else {
       // update subObjOffset by adding the offset for TI in subTI
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << TI->getName() << " is a non-virtual base of " << subTI->getName() << "\n");
-      int subObjOff = subObjOffset + (skip ? 0 : classToBaseOffset[subTI][TI]);
+      int subObjOff = subObjOffset + (skip ? 0 : getBaseOffset(classToBaseOffset, subTI, TI, 0));
       SDEBUG("soaap.util.classhierarchy", 3, dbgs() << "subObjOffset: " << subObjOff << "\n");
       findAllCalleesInSubClassesHelper(C, subTI, staticTypeTI, vtableIdx, vbaseOffsetOffset, subObjOff, vbaseSubObjOffset, collectingCallees, callees);
     }
@@ -642,6 +824,17 @@ Function* ClassHierarchyUtils::extractFunctionFromThunk(Function* F) {
   return F;
 }
 
+int ClassHierarchyUtils::getBaseOffset(DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> >& offsets, GlobalVariable* TI, GlobalVariable* baseTI, int defaultOffset) {
+  DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> >::iterator I = offsets.find(TI);
+  if (I != offsets.end()) {
+    DenseMap<GlobalVariable*,int>::iterator BI = I->second.find(baseTI);
+    if (BI != I->second.end()) {
+      return BI->second;
+    }
+  }
+  return defaultOffset;
+}
+
 Value* ClassHierarchyUtils::getMDNodeOperandValue(MDNode* N, unsigned I) {
   Metadata* MD = N->getOperand(I);
   ValueAsMetadata* VMD = cast<ValueAsMetadata>(MD);
@@ -1,37 +1,77 @@
 #ifndef SOAAP_UTILS_CLASSHIERARCHYUTILS_H
 #define SOAAP_UTILS_CLASSHIERARCHYUTILS_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Module.h"
 #include "Common/Typedefs.h"
 
+#include <tuple>
+
 using namespace llvm;
 
 namespace soaap {
-  typedef map<GlobalVariable*,GlobalVariableVector> ClassHierarchy;
+  typedef DenseMap<GlobalVariable*,GlobalVariableVector> ClassHierarchy;
+  // [first, last] range of pre-order numbers. A class's descendents are
+  // described by a small list of these (exactly one unless there is multiple
+  // inheritance below it).
+  typedef pair<int,int> ClassInterval;
+  typedef SmallVector<ClassInterval,1> ClassIntervalVector;
+  // (defining class id, static class id, vtable idx)
+  typedef tuple<int,int,int> VTableSlot;
+  struct VirtualCall {
+    CallInst* call;
+    GlobalVariable* definingTypeTI;
+    GlobalVariable* staticTypeTI;
+    int vtableIdx;
+  };
+  typedef vector<VirtualCall> VirtualCallVector;
+
   class ClassHierarchyUtils {
     public:
       static void findClassHierarchy(Module& M);
       static void cacheAllCalleesForVirtualCalls(Module& M);
-      static FunctionSet getCalleesForVirtualCall(CallInst* C, Module& M);
+      static FunctionSet& getCalleesForVirtualCall(CallInst* C, Module& M);
+      static bool isSubclassOf(GlobalVariable* subTI, GlobalVariable* TI);
+      // Forget the class hierarchy and cached v-call callees, e.g. before
+      // the module is reloaded.
+      static void reset();
     
     private:
-      static GlobalVariableVector classes;
+      static GlobalVariableVector classes;   // indexed by class id
+      static DenseMap<GlobalVariable*,int> classToId;
       static ClassHierarchy classToSubclasses;
-      static map<GlobalVariable*,GlobalVariable*> typeInfoToVTable;
-      static map<GlobalVariable*,GlobalVariable*> vTableToTypeInfo;
-      static map<CallInst*,FunctionSet> callToCalleesCache;
-      static map<GlobalVariable*,map<int,int> > vTableToSecondaryVTableMaps;
-      static map<GlobalVariable*,map<GlobalVariable*,int> > classToBaseOffset;
-      static map<GlobalVariable*,map<GlobalVariable*,int> > classToVBaseOffsetOffset;
+      static vector<int> classToPreOrder;
+      static vector<ClassIntervalVector> classToDescendentIntervals;
+      static DenseMap<GlobalVariable*,GlobalVariable*> typeInfoToVTable;
+      static DenseMap<GlobalVariable*,GlobalVariable*> vTableToTypeInfo;
+      static StringMap<GlobalVariable*> typeInfoNameToVar;
+      static vector<FunctionSet> calleeSets; // indexed by callee-set handle
+      static map<vector<Function*>,int> calleeSetToHandle;
+      static DenseMap<CallInst*,int> callToCalleeSet;
+      static DenseMap<GlobalVariable*,map<int,int> > vTableToSecondaryVTableMaps;
+      static DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> > classToBaseOffset;
+      static DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> > classToVBaseOffsetOffset;
+      static bool hierarchyFound;
       static bool cachingDone;
+      static unsigned definingVTableVarKind;
+      static unsigned definingVTableNameKind;
+      static unsigned staticVTableVarKind;
+      static unsigned staticVTableNameKind;
 
       static void processTypeInfo(GlobalVariable* TI, Module& M);
-      static FunctionSet findAllCalleesForVirtualCall(CallInst* C, GlobalVariable* definingTypeTIVar, GlobalVariable* staticTypeTIVar, Module& M);
+      static void numberClassHierarchy();
+      static void numberClassHierarchyHelper(int id, int& nextPreOrder);
+      static int getCalleeSetHandle(FunctionSet& callees);
+      static string stringifyCalleeSet(int handle);
+      static void findVirtualCalls(Function* F, VirtualCallVector& vcalls);
+      static GlobalVariable* getTypeInfoForVTableName(MDNode* N);
+      static int findVTableIdxForVirtualCall(CallInst* C);
       static void findAllCalleesInSubClasses(CallInst* C, GlobalVariable* definingTypeTI, GlobalVariable* staticTypeTI, int vtableIdx, FunctionSet& callees);
       static void findAllCalleesInSubClassesHelper(CallInst* C, GlobalVariable* TI, GlobalVariable* staticTypeTI, int vtableIdx, int vbaseOffsetOffset, int subObjOffset, int vbaseSubObjOffset, bool collectingCallees, FunctionSet& callees);
       static Function* extractFunctionFromThunk(Function* F);
       static void ppClassHierarchy(ClassHierarchy& classHierarchy);
       static void ppClassHierarchyHelper(GlobalVariable* c, ClassHierarchy& classHierarchy, int nesting);
+      static int getBaseOffset(DenseMap<GlobalVariable*,DenseMap<GlobalVariable*,int> >& offsets, GlobalVariable* TI, GlobalVariable* baseTI, int defaultOffset);
       static Value* getMDNodeOperandValue(MDNode* N, unsigned I);
   };
 }
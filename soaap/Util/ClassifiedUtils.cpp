@@ -50,3 +50,7 @@ void ClassifiedUtils::assignBitIdxToClassName(string className) {
 int ClassifiedUtils::getBitIdxFromClassName(string className) {
   return classNameToBitIdx[className];
 }
+
+int ClassifiedUtils::getAllClassNames() {
+  return (1 << nextClassNameBitIdx) - 1;
+}
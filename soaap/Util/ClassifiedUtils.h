@@ -15,6 +15,7 @@ namespace soaap {
       static int getBitIdxFromClassName(string className);
       static string stringifyClassNames(int classNames);
       static StringVector convertNamesToVector(int classNames);
+      static int getAllClassNames();
     
     private:
       static map<string,int> classNameToBitIdx;
@@ -1,7 +1,9 @@
+#include "Common/CmdLineOpts.h"
 #include "Common/Debug.h"
 #include "Util/ContextUtils.h"
 #include "Util/SandboxUtils.h"
 
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -10,6 +12,8 @@ using namespace soaap;
 Context* const ContextUtils::NO_CONTEXT = new Context();
 Context* const ContextUtils::PRIV_CONTEXT = new Context();
 Context* const ContextUtils::SINGLE_CONTEXT = new Context();
+FoldingSet<CallStringContext> ContextUtils::callStringContexts;
+int ContextUtils::numCallStringContexts = 0;
 
 Context* ContextUtils::calleeContext(Context* C, bool contextInsensitive, Function* callee, SandboxVector& sandboxes, Module& M) {
   // callee context is the same sandbox, another sandbox or callgate (privileged)
@@ -19,7 +23,7 @@ Context* ContextUtils::calleeContext(Context* C, bool contextInsensitive, Functi
   else if (SandboxUtils::isSandboxEntryPoint(M, callee)) {
     return SandboxUtils::getSandboxForEntryPoint(callee, sandboxes);
   }
-  else if (Sandbox* S = dyn_cast<Sandbox>(C)) {
+  else if (Sandbox* S = dyn_cast<Sandbox>(getBaseContext(C))) {
     // C is a Sandbox 
     if (S->isCallgate(callee)) {
       return PRIV_CONTEXT;
@@ -34,6 +38,13 @@ ContextVector ContextUtils::callerContexts(ReturnInst* RI, CallInst* CI, Context
   if (contextInsensitive) {
     return ContextVector(1, SINGLE_CONTEXT);
   }
+  else if (CallStringContext* CS = dyn_cast<CallStringContext>(C)) {
+    // return only to the call that the callee was entered through
+    if (CS->getLastCall() != CI) {
+      return ContextVector();
+    }
+    return ContextVector(1, popCallString(CS));
+  }
   else {
     Function* enclosingFunc = RI->getParent()->getParent();
     if (SandboxUtils::isSandboxEntryPoint(M, enclosingFunc)) {
@@ -79,6 +90,7 @@ ContextVector ContextUtils::getContextsForInstruction(Instruction* I, bool conte
 }
 
 bool ContextUtils::isInContext(Instruction* I, Context* C, bool contextInsensitive, SandboxVector& sandboxes, Module& M) {
+  C = getBaseContext(C);
   ContextVector Cs = getContextsForInstruction(I, contextInsensitive, sandboxes, M);
   SDEBUG("soaap.util.context", 5, dbgs() << "Looking for " << stringifyContext(C) << " amongst " << Cs.size() << " contexts\n");
   SDEBUG("soaap.util.context", 5, dbgs() << "sandboxes.size(): " << sandboxes.size() << "\n");
@@ -99,6 +111,22 @@ string ContextUtils::stringifyContext(Context* C) {
     // sandbox
     return "[" + S->getName() + "]";
   }
+  else if (CallStringContext* CS = dyn_cast<CallStringContext>(C)) {
+    string result = stringifyContext(CS->getBase()) + " via ";
+    bool first = true;
+    for (CallInst* CI : CS->getCalls()) {
+      if (!first) {
+        result += " > ";
+      }
+      first = false;
+      result += CI->getParent()->getParent()->getName().str();
+      if (MDNode* N = CI->getMetadata("dbg")) {
+        DILocation loc(N);
+        result += ":" + to_string(loc.getLineNumber());
+      }
+    }
+    return result;
+  }
   return "null";
 }
 
@@ -109,3 +137,52 @@ ContextVector ContextUtils::getAllContexts(SandboxVector& sandboxes) {
   Cs.insert(Cs.end(), sandboxes.begin(), sandboxes.end());
   return Cs;
 }
+
+Context* ContextUtils::getBaseContext(Context* C) {
+  if (CallStringContext* CS = dyn_cast_or_null<CallStringContext>(C)) {
+    return CS->getBase();
+  }
+  return C;
+}
+
+// The context of a callee called by CI in context C, when the callee runs
+// in the same sandbox (or privileged) context as CI. Only the most recent
+// -soaap-call-string-depth calls are kept.
+Context* ContextUtils::pushCallString(Context* C, CallInst* CI) {
+  int k = CmdLineOpts::CallStringDepth;
+  if (k <= 0) {
+    return C;
+  }
+  SmallVector<CallInst*,4> calls;
+  if (CallStringContext* CS = dyn_cast<CallStringContext>(C)) {
+    ArrayRef<CallInst*> prev = CS->getCalls();
+    if ((int)prev.size() >= k) {
+      prev = prev.slice(prev.size()-k+1);
+    }
+    calls.append(prev.begin(), prev.end());
+  }
+  calls.push_back(CI);
+  return getCallStringContext(getBaseContext(C), calls);
+}
+
+// The context of the caller that C was entered from: C without its last call
+Context* ContextUtils::popCallString(CallStringContext* C) {
+  ArrayRef<CallInst*> calls = C->getCalls().drop_back();
+  if (calls.empty()) {
+    return C->getBase();
+  }
+  return getCallStringContext(C->getBase(), calls);
+}
+
+Context* ContextUtils::getCallStringContext(Context* base, ArrayRef<CallInst*> calls) {
+  FoldingSetNodeID ID;
+  CallStringContext::Profile(ID, base, calls);
+  void* insertPos;
+  if (CallStringContext* CS = callStringContexts.FindNodeOrInsertPos(ID, insertPos)) {
+    return CS;
+  }
+  CallStringContext* CS = new CallStringContext(base, calls);
+  callStringContexts.InsertNode(CS, insertPos);
+  numCallStringContexts++;
+  return CS;
+}
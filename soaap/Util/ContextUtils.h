@@ -1,6 +1,7 @@
 #ifndef SOAAP_UTILS_CONTEXTUTILS_H
 #define SOAAP_UTILS_CONTEXTUTILS_H
 
+#include "llvm/ADT/FoldingSet.h"
 #include "llvm/IR/Function.h"
 #include "Common/Typedefs.h"
 #include "Common/Sandbox.h"
@@ -24,6 +25,17 @@ namespace soaap {
       static bool isInContext(Instruction* I, Context* C, bool contextInsensitive, SandboxVector& sandboxes, Module& M);
       static string stringifyContext(Context* C);
       static ContextVector getAllContexts(SandboxVector& sandboxes);
+
+      // Call-string contexts (see -soaap-call-string-depth)
+      static Context* getBaseContext(Context* C);
+      static Context* pushCallString(Context* C, CallInst* CI);
+      static Context* popCallString(CallStringContext* C);
+      static int getNumCallStringContexts() { return numCallStringContexts; }
+
+    private:
+      static FoldingSet<CallStringContext> callStringContexts;
+      static int numCallStringContexts;
+      static Context* getCallStringContext(Context* base, ArrayRef<CallInst*> calls);
   };
 }
 
@@ -0,0 +1,254 @@
+#include "Util/ModuleUtils.h"
+
+#include "Common/Debug.h"
+#include "Util/ParallelUtils.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "soaap.h"
+
+using namespace soaap;
+
+unique_ptr<Module> ModuleUtils::loadModules(const vector<string>& filenames, LLVMContext& C, string& error) {
+  int n = filenames.size();
+
+  // Summarise each module concurrently. The summary written when it was
+  // compiled is reused if it is up to date. Otherwise the module is loaded
+  // lazily into its own context, and both are released once it has been
+  // summarised, so at most one module per worker thread is resident.
+  vector<ModuleSummary*> summaries(n, NULL);
+  vector<string> errors(n);
+  ParallelUtils::parallelFor(n, [&](int i) {
+    string summaryFilename = ModuleSummary::getSummaryFilename(filenames[i]);
+    if (isUpToDate(summaryFilename, filenames[i])) {
+      string readError;
+      if ((summaries[i] = ModuleSummary::read(summaryFilename, filenames[i], readError))) {
+        return;
+      }
+      errs() << "WARNING: " << readError << "\n";
+    }
+    LLVMContext Context;
+    SMDiagnostic Err;
+    unique_ptr<Module> M = getLazyIRFileModule(filenames[i], Err, Context);
+    if (!M) {
+      raw_string_ostream os(errors[i]);
+      Err.print("soaap", os);
+      return;
+    }
+    summaries[i] = ModuleSummary::build(*M, filenames[i]);
+  });
+
+  SummaryGraph graph;
+  for (int i=0; i<n; i++) {
+    if (summaries[i]) {
+      graph.add(*summaries[i]);
+    }
+    error += errors[i];
+  }
+  vector<bool> needed(n, false);
+  if (error.empty()) {
+    graph.computeLiveFunctions();
+    SDEBUG("soaap.util.module", 3, dbgs() << graph.getNumLiveFunctions() << " live functions in " << n << " modules\n")
+    for (int i=0; i<n; i++) {
+      // the first is always linked, so that there is a module to link into
+      needed[i] = i == 0 || isNeeded(*summaries[i], graph);
+    }
+  }
+  for (ModuleSummary* summary : summaries) {
+    delete summary;
+  }
+  if (!error.empty()) {
+    return nullptr;
+  }
+
+  // reload the modules that contribute anything, and link their live parts
+  // into the first one. Each is released once linked, so only the
+  // composite and one other module are resident.
+  unique_ptr<Module> Composite;
+  for (int i=0; i<n; i++) {
+    if (!needed[i]) {
+      SDEBUG("soaap.util.module", 3, dbgs() << "Skipping " << filenames[i] << ", which has nothing live\n")
+      continue;
+    }
+    SDEBUG("soaap.util.module", 3, dbgs() << "Linking " << filenames[i] << "\n")
+    SMDiagnostic Err;
+    unique_ptr<Module> M = getLazyIRFileModule(filenames[i], Err, C);
+    if (!M) {
+      raw_string_ostream os(error);
+      Err.print("soaap", os);
+      return nullptr;
+    }
+    pruneDeadFunctions(*M, filenames[i], graph);
+    if (error_code EC = M->materializeAllPermanently()) {
+      error = filenames[i] + ": " + EC.message() + "\n";
+      return nullptr;
+    }
+    if (!Composite) {
+      Composite = move(M);
+    }
+    else if (Linker::LinkModules(Composite.get(), M.get())) {
+      error = "error linking " + filenames[i] + "\n";
+      return nullptr;
+    }
+  }
+  return Composite;
+}
+
+// A module is linked if it defines a live function, or a global that other
+// modules may refer to, or annotates anything. Its local globals can only
+// be used by its own (dead) functions.
+bool ModuleUtils::isNeeded(ModuleSummary& summary, SummaryGraph& graph) {
+  if (summary.definesMain || !summary.annotations.empty() || !summary.callgates.empty()) {
+    return true;
+  }
+  for (StringMap<string>::iterator I=summary.definedFunctions.begin(), E=summary.definedFunctions.end(); I!=E; I++) {
+    if (graph.isLive(I->getKey())) {
+      return true;
+    }
+  }
+  for (StringSet<>::iterator I=summary.definedGlobals.begin(), E=summary.definedGlobals.end(); I!=E; I++) {
+    if (I->getKey().find(':') == StringRef::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Add the functions referred to by C (looking through constant expressions
+// and aggregates, but not other globals) to funcs.
+static void addReferencedFunctions(Constant* C, SmallVectorImpl<Function*>& funcs) {
+  SmallPtrSet<Constant*,16> visited;
+  SmallVector<Constant*,16> worklist;
+  worklist.push_back(C);
+  while (!worklist.empty()) {
+    Constant* Curr = worklist.pop_back_val();
+    if (!visited.insert(Curr).second) {
+      continue;
+    }
+    if (Function* F = dyn_cast<Function>(Curr)) {
+      funcs.push_back(F);
+    }
+    else if (!isa<GlobalValue>(Curr)) {
+      for (Use& U : Curr->operands()) {
+        if (Constant* Op = dyn_cast<Constant>(U.get())) {
+          worklist.push_back(Op);
+        }
+      }
+    }
+  }
+}
+
+// Add the functions named in __soaap_fp annotations, which are only
+// referred to by name, to funcs. The annotation strings are globals, so
+// this also finds annotations in bodies that are yet to be materialized.
+static void addAnnotatedFPTargets(Module& M, SmallVectorImpl<Function*>& funcs) {
+  for (GlobalVariable& G : M.getGlobalList()) {
+    ConstantDataArray* CDA = G.hasInitializer() ? dyn_cast<ConstantDataArray>(G.getInitializer()) : NULL;
+    if (!CDA || !CDA->isCString() || !CDA->getAsCString().startswith(SOAAP_FP)) {
+      continue;
+    }
+    SmallVector<StringRef,8> names;
+    CDA->getAsCString().substr(strlen(SOAAP_FP)+1).split(names, ",");
+    for (StringRef name : names) {
+      if (Function* F = M.getFunction(name.trim())) {
+        funcs.push_back(F);
+      }
+    }
+  }
+}
+
+// Materialize the functions in worklist and every function reachable from
+// them. Returns the number of bodies materialized.
+static int materializeWorklist(Module& M, SmallVectorImpl<Function*>& worklist) {
+  int numMaterialized = 0;
+  while (!worklist.empty()) {
+    Function* F = worklist.pop_back_val();
+    if (!F->isMaterializable()) {
+      continue; // already materialized, or a declaration
+    }
+    if (error_code EC = M.materialize(F)) {
+      errs() << "WARNING: could not materialize \"" << F->getName() << "\": " << EC.message() << "\n";
+      continue;
+    }
+    numMaterialized++;
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      for (Use& U : I->operands()) {
+        if (Constant* C = dyn_cast<Constant>(U.get()->stripPointerCasts())) {
+          addReferencedFunctions(C, worklist);
+        }
+      }
+    }
+  }
+  return numMaterialized;
+}
+
+void ModuleUtils::materializeReachable(Module& M) {
+  SmallVector<Function*,64> worklist;
+  if (Function* MainFn = M.getFunction("main")) {
+    worklist.push_back(MainFn);
+  }
+  for (Function& F : M.getFunctionList()) {
+    if (F.getName().startswith("__soaap_declare_callgates_")) {
+      worklist.push_back(&F);
+    }
+  }
+  // llvm.global.annotations holds the function-level sandbox annotations
+  for (GlobalVariable& G : M.getGlobalList()) {
+    if (G.hasInitializer()) {
+      addReferencedFunctions(G.getInitializer(), worklist);
+    }
+  }
+  for (GlobalAlias& A : M.getAliasList()) {
+    if (Constant* Aliasee = A.getAliasee()) {
+      addReferencedFunctions(Aliasee, worklist);
+    }
+  }
+  addAnnotatedFPTargets(M, worklist);
+
+  int numMaterialized = materializeWorklist(M, worklist);
+  SDEBUG("soaap.util.module", 3, dbgs() << "Materialized " << numMaterialized << " of " << M.size() << " functions\n")
+}
+
+void ModuleUtils::materializeReachable(Function* F) {
+  if (!F->isMaterializable()) {
+    return;
+  }
+  SmallVector<Function*,16> worklist;
+  worklist.push_back(F);
+  int numMaterialized = materializeWorklist(*F->getParent(), worklist);
+  SDEBUG("soaap.util.module", 3, dbgs() << "Materialized " << numMaterialized << " functions reachable from " << F->getName() << "\n")
+}
+
+bool ModuleUtils::isUpToDate(const string& filename, const string& sourceFilename) {
+  sys::fs::file_status status, sourceStatus;
+  if (sys::fs::status(filename, status) || sys::fs::status(sourceFilename, sourceStatus)) {
+    return false;
+  }
+  return sys::fs::exists(status)
+         && status.getLastModificationTime() >= sourceStatus.getLastModificationTime();
+}
+
+// Drop the (not yet materialized) bodies of functions that cannot be reached
+// from main() or an escaping function. As their callers are also dead, they
+// have no uses unless another module refers to them in a way the summaries
+// don't capture, in which case they are kept.
+void ModuleUtils::pruneDeadFunctions(Module& M, StringRef moduleId, SummaryGraph& graph) {
+  vector<Function*> dead;
+  for (Function& F : M.getFunctionList()) {
+    if (!F.isDeclaration() && F.use_empty() && !graph.isLive(&F, moduleId)) {
+      dead.push_back(&F);
+    }
+  }
+  SDEBUG("soaap.util.module", 3, dbgs() << "Pruning " << dead.size() << " dead functions from " << moduleId << "\n")
+  for (Function* F : dead) {
+    F->eraseFromParent();
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef SOAAP_UTILS_MODULEUTILS_H
+#define SOAAP_UTILS_MODULEUTILS_H
+
+#include "Common/ModuleSummary.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  class ModuleUtils {
+    public:
+      // Load a whole program from many bitcode (or IR) files without linking
+      // them all first. Each module is summarised, in parallel and in a
+      // context of its own that is released again, unless the summary
+      // written at compile time (by the soaap-summary pass, to
+      // <file>.soaap.summary) is up to date. The merged summaries determine
+      // which function bodies are live, and then the modules that have
+      // anything live are reloaded into C and linked one at a time, with
+      // only their live function bodies materialized. The SOAAP analyses
+      // run on IR, so the result is still one module holding the whole live
+      // program.
+      //
+      // Liveness is found from main(), and from functions whose address
+      // escapes. If no module defines main() then the input is a library,
+      // any of whose externally visible functions may be called, so only
+      // local functions that none of these reach are pruned. Returns null,
+      // and sets error, on failure.
+      static unique_ptr<Module> loadModules(const vector<string>& filenames, LLVMContext& C, string& error);
+
+      // Materialize the bodies of a lazily-loaded module's functions that can
+      // be reached from main(), from the sandboxes and callgates (which are
+      // annotated) or from a global initialiser (e.g. vtables, constructors).
+      // Functions whose address is taken in a reached body, or that are
+      // named in a __soaap_fp annotation, are reached too. The rest are left
+      // unparsed.
+      static void materializeReachable(Module& M);
+
+      // Materialize F, if it hasn't been, and every function reachable from
+      // it. Every function that the call graph reaches must be materialized:
+      // until then it has no body, but is not a declaration either.
+      static void materializeReachable(Function* F);
+
+    private:
+      static bool isUpToDate(const string& filename, const string& sourceFilename);
+      static bool isNeeded(ModuleSummary& summary, SummaryGraph& graph);
+      static void pruneDeadFunctions(Module& M, StringRef moduleId, SummaryGraph& graph);
+  };
+}
+
+#endif
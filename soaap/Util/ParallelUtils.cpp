@@ -0,0 +1,46 @@
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Util/ParallelUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace soaap;
+
+int ParallelUtils::getNumThreads() {
+  // Debug output is not thread-safe, so don't run in parallel when debugging
+  if (!CmdLineOpts::DebugModule.empty()) {
+    return 1;
+  }
+  if (CmdLineOpts::Threads > 0) {
+    return CmdLineOpts::Threads;
+  }
+  int hwThreads = thread::hardware_concurrency();
+  return hwThreads > 0 ? hwThreads : 1;
+}
+
+void ParallelUtils::parallelFor(int n, function<void(int)> body) {
+  int numThreads = min(getNumThreads(), n);
+  if (numThreads <= 1) {
+    for (int i=0; i<n; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  SDEBUG("soaap.util.parallel", 3, dbgs() << "Running " << n << " iterations on " << numThreads << " threads\n");
+  atomic<int> nextIdx(0);
+  vector<thread> workers;
+  for (int t=0; t<numThreads; t++) {
+    workers.push_back(thread([&]() {
+      for (int i = nextIdx++; i < n; i = nextIdx++) {
+        body(i);
+      }
+    }));
+  }
+  for (thread& worker : workers) {
+    worker.join();
+  }
+}
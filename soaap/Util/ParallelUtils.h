@@ -0,0 +1,19 @@
+#ifndef SOAAP_UTILS_PARALLELUTILS_H
+#define SOAAP_UTILS_PARALLELUTILS_H
+
+#include <functional>
+
+using namespace std;
+
+namespace soaap {
+  class ParallelUtils {
+    public:
+      // Calls body(i) for every i in [0, n) using a pool of worker threads.
+      // Iterations are handed out dynamically, so body must only write to
+      // state that is private to iteration i.
+      static void parallelFor(int n, function<void(int)> body);
+      static int getNumThreads();
+  };
+}
+
+#endif
@@ -0,0 +1,770 @@
+#include "Util/PointsToUtils.h"
+
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Util/CallGraphUtils.h"
+#include "Util/DebugUtils.h"
+#include "Util/SliceUtils.h"
+#include "Util/WorklistUtils.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+
+using namespace soaap;
+
+bool PointsToUtils::computed = false;
+vector<AbstractLocation> PointsToUtils::locations;
+DenseMap<const Value*,unsigned> PointsToUtils::objectToLocation;
+DenseMap<pair<unsigned,unsigned>,unsigned> PointsToUtils::fieldToLocation;
+DenseMap<const Value*,LocationSet> PointsToUtils::pointsTo;
+vector<PointerVector> PointsToUtils::locationToPointers;
+
+namespace {
+  // Inclusion-based (Andersen-style) solver. Each pointer value, and the
+  // contents of each abstract location, is a node whose points-to set
+  // flows along copy edges. Loads, stores and field offsets add edges (or
+  // locations) as the points-to sets of their pointer operands grow.
+  //
+  // Only the locations added to a node since it was last visited are
+  // propagated (difference propagation), and cycles of copy edges are
+  // collapsed into a single node as they are found (lazy cycle detection:
+  // a cycle is searched for when propagating along an edge leaves both
+  // ends with the same points-to set).
+  //
+  // Pointers cast to integers are all merged into one node, which pointers
+  // cast back from integers may point to anything in. Aggregate values
+  // (insertvalue, extractvalue, and loads and stores of whole structs) are
+  // not split into fields.
+  //
+  // Once the run is over budget, every node dequeued is unified into one
+  // (as in Steensgaard's analysis), which bounds the remaining work.
+  class PointsToSolver {
+    public:
+      PointsToSolver(Module& M) : M(M), intNode(newNode()), numCollapsed(0), numPopped(0), numWidened(0) { }
+      void addConstraints();
+      void solve();
+      DenseMap<const Value*,unsigned>& getValueNodes() { return valueNodes; }
+      LocationSet& getPointsTo(unsigned n) { return nodes[find(n)].pts; }
+      unsigned getNumNodes() { return nodes.size(); }
+      unsigned getNumCollapsed() { return numCollapsed; }
+      // Over which budget nodes were unified, if any
+      string getBudgetWidened() { return numWidened > 0 ? budgetExceeded : ""; }
+
+    private:
+      typedef SmallVector<unsigned,4> FieldPath;
+
+      struct Node {
+        LocationSet pts;
+        LocationSet done; // locations already propagated
+        SmallVector<unsigned,4> copyTo;
+        SmallVector<unsigned,2> loadTo;
+        SmallVector<unsigned,2> storeFrom;
+        SmallVector<pair<unsigned,FieldPath>,2> fieldsTo;
+        SmallVector<CallInst*,1> indirectCalls;
+      };
+
+      Module& M;
+      // a deque, so that references to nodes survive adding new ones
+      deque<Node> nodes;
+      vector<unsigned> rep; // union-find of collapsed nodes
+      DenseMap<const Value*,unsigned> valueNodes;
+      DenseMap<unsigned,unsigned> contentNodes;
+      DenseSet<pair<unsigned,unsigned> > copyEdges;
+      DenseSet<pair<unsigned,unsigned> > cycleCheckedEdges;
+      SmallVector<unsigned,8> cycleCandidates;
+      DenseSet<pair<const CallInst*,const Function*> > linkedCalls;
+      deque<unsigned> worklist;
+      vector<bool> queued;
+      unsigned intNode; // what integers cast from pointers may point to
+      // source and destination nodes of memcpy and memmove
+      SmallVector<pair<unsigned,unsigned>,8> memCopies;
+      // pointer and value nodes of loads and stores of aggregates
+      SmallVector<pair<unsigned,unsigned>,8> aggregateLoads;
+      SmallVector<pair<unsigned,unsigned>,8> aggregateStores;
+      unsigned numCollapsed;
+      unsigned numPopped;
+      unsigned widenedNode; // what nodes are unified into once over budget
+      unsigned numWidened;
+      string budgetExceeded;
+
+      unsigned newNode();
+      unsigned find(unsigned n);
+      void enqueue(unsigned n);
+      void unify(unsigned n, unsigned m);
+      void collapseCycles(unsigned root);
+      unsigned getNode(const Value* V);
+      unsigned getContentNode(unsigned L);
+      void addLocation(unsigned n, unsigned L);
+      bool addCopy(unsigned from, unsigned to);
+      bool addMemCopy(unsigned L, unsigned L2);
+      bool applyMemCopies();
+      void propagate();
+      void addConstantLocations(const Constant* C, LocationSet& locs);
+      void addInitialiser(unsigned L, const Constant* C);
+      void addConstraints(Instruction* I);
+      void linkCall(CallInst* C, Function* F);
+      static void getFieldPath(const User* GEP, FieldPath& path);
+      static unsigned getFieldLocation(unsigned L, FieldPath& path);
+  };
+}
+
+unsigned PointsToSolver::newNode() {
+  unsigned n = nodes.size();
+  nodes.push_back(Node());
+  rep.push_back(n);
+  queued.push_back(false);
+  return n;
+}
+
+unsigned PointsToSolver::find(unsigned n) {
+  while (rep[n] != n) {
+    rep[n] = rep[rep[n]];
+    n = rep[n];
+  }
+  return n;
+}
+
+void PointsToSolver::enqueue(unsigned n) {
+  if (!queued[n]) {
+    queued[n] = true;
+    worklist.push_back(n);
+  }
+}
+
+// Merge node m into node n. All of n's locations are then propagated again,
+// as they have not been through m's constraints.
+void PointsToSolver::unify(unsigned n, unsigned m) {
+  n = find(n);
+  m = find(m);
+  if (n == m) {
+    return;
+  }
+  Node& N = nodes[n];
+  Node& Mn = nodes[m];
+  rep[m] = n;
+  N.pts |= Mn.pts;
+  N.done.clear();
+  N.copyTo.append(Mn.copyTo.begin(), Mn.copyTo.end());
+  N.loadTo.append(Mn.loadTo.begin(), Mn.loadTo.end());
+  N.storeFrom.append(Mn.storeFrom.begin(), Mn.storeFrom.end());
+  N.fieldsTo.append(Mn.fieldsTo.begin(), Mn.fieldsTo.end());
+  N.indirectCalls.append(Mn.indirectCalls.begin(), Mn.indirectCalls.end());
+  Mn = Node();
+  numCollapsed++;
+  enqueue(n);
+}
+
+// Tarjan's algorithm over the copy edges reachable from root, collapsing
+// each strongly-connected component found.
+void PointsToSolver::collapseCycles(unsigned root) {
+  DenseMap<unsigned,unsigned> index;
+  DenseMap<unsigned,unsigned> lowlink;
+  SmallVector<unsigned,32> stack;
+  DenseSet<unsigned> onStack;
+  SmallVector<pair<unsigned,unsigned>,32> dfs; // node, next copy edge
+  unsigned nextIndex = 0;
+
+  root = find(root);
+  index[root] = lowlink[root] = nextIndex++;
+  stack.push_back(root);
+  onStack.insert(root);
+  dfs.push_back(make_pair(root, 0));
+  while (!dfs.empty()) {
+    unsigned n = dfs.back().first;
+    unsigned e = dfs.back().second;
+    if (e < nodes[n].copyTo.size()) {
+      dfs.back().second++;
+      unsigned m = find(nodes[n].copyTo[e]);
+      if (m == n) {
+        continue;
+      }
+      if (index.count(m) == 0) {
+        index[m] = lowlink[m] = nextIndex++;
+        stack.push_back(m);
+        onStack.insert(m);
+        dfs.push_back(make_pair(m, 0));
+      }
+      else if (onStack.count(m)) {
+        lowlink[n] = min(lowlink[n], index[m]);
+      }
+    }
+    else {
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        unsigned parent = dfs.back().first;
+        lowlink[parent] = min(lowlink[parent], lowlink[n]);
+      }
+      if (lowlink[n] == index[n]) {
+        unsigned m;
+        do {
+          m = stack.pop_back_val();
+          onStack.erase(m);
+          unify(n, m);
+        } while (m != n);
+      }
+    }
+  }
+}
+
+unsigned PointsToSolver::getNode(const Value* V) {
+  DenseMap<const Value*,unsigned>::iterator I = valueNodes.find(V);
+  if (I != valueNodes.end()) {
+    return find(I->second);
+  }
+  unsigned n = newNode();
+  valueNodes[V] = n;
+  if (const Constant* C = dyn_cast<Constant>(V)) {
+    addConstantLocations(C, nodes[n].pts);
+  }
+  else if (const Argument* A = dyn_cast<Argument>(V)) {
+    // memory passed in by callers we may not see
+    if (A->getType()->isPointerTy()) {
+      nodes[n].pts.set(PointsToUtils::getObjectLocation(A));
+    }
+  }
+  return n;
+}
+
+unsigned PointsToSolver::getContentNode(unsigned L) {
+  DenseMap<unsigned,unsigned>::iterator I = contentNodes.find(L);
+  if (I != contentNodes.end()) {
+    return find(I->second);
+  }
+  unsigned n = newNode();
+  contentNodes[L] = n;
+  return n;
+}
+
+void PointsToSolver::addLocation(unsigned n, unsigned L) {
+  n = find(n);
+  LocationSet& pts = nodes[n].pts;
+  if (!pts.test(L)) {
+    pts.set(L);
+    enqueue(n);
+  }
+}
+
+// Returns whether a new edge was added
+bool PointsToSolver::addCopy(unsigned from, unsigned to) {
+  from = find(from);
+  to = find(to);
+  if (from == to || !copyEdges.insert(make_pair(from, to)).second) {
+    return false;
+  }
+  nodes[from].copyTo.push_back(to);
+  if (nodes[to].pts |= nodes[from].pts) {
+    enqueue(to);
+  }
+  return true;
+}
+
+// The contents of location L, and of each field within it, are copied to
+// the same field of L2
+bool PointsToSolver::addMemCopy(unsigned L, unsigned L2) {
+  bool changed = addCopy(getContentNode(L), getContentNode(L2));
+  SmallVector<unsigned,4> children = PointsToUtils::getLocation(L).children;
+  for (unsigned child : children) {
+    unsigned field = PointsToUtils::getLocation(child).field;
+    changed |= addMemCopy(child, PointsToUtils::getFieldLocation(L2, field));
+  }
+  return changed;
+}
+
+// Fields are only created as they are accessed, so memcpys, and loads and
+// stores of aggregates (which read or write every field), are applied again
+// each time the other constraints have been solved, until no new edges are
+// added
+bool PointsToSolver::applyMemCopies() {
+  bool changed = false;
+  for (pair<unsigned,unsigned>& P : aggregateLoads) {
+    LocationSet locs = nodes[find(P.first)].pts;
+    LocationSet within;
+    for (unsigned L : locs) {
+      PointsToUtils::addLocationsWithin(L, within);
+    }
+    for (unsigned L2 : within) {
+      changed |= addCopy(getContentNode(L2), P.second);
+    }
+  }
+  for (pair<unsigned,unsigned>& P : aggregateStores) {
+    LocationSet locs = nodes[find(P.first)].pts;
+    LocationSet within;
+    for (unsigned L : locs) {
+      PointsToUtils::addLocationsWithin(L, within);
+    }
+    for (unsigned L2 : within) {
+      changed |= addCopy(P.second, getContentNode(L2));
+    }
+  }
+  for (pair<unsigned,unsigned>& P : memCopies) {
+    LocationSet srcLocs = nodes[find(P.first)].pts;
+    LocationSet dstLocs = nodes[find(P.second)].pts;
+    for (unsigned L : srcLocs) {
+      for (unsigned L2 : dstLocs) {
+        if (L != L2) {
+          changed |= addMemCopy(L, L2);
+        }
+      }
+    }
+  }
+  return changed;
+}
+
+void PointsToSolver::getFieldPath(const User* GEP, FieldPath& path) {
+  for (gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP); GTI != GTE; ++GTI) {
+    if (isa<StructType>(*GTI)) {
+      path.push_back(cast<ConstantInt>(GTI.getOperand())->getZExtValue());
+    }
+  }
+}
+
+unsigned PointsToSolver::getFieldLocation(unsigned L, FieldPath& path) {
+  for (unsigned field : path) {
+    L = PointsToUtils::getFieldLocation(L, field);
+  }
+  return L;
+}
+
+void PointsToSolver::addConstantLocations(const Constant* C, LocationSet& locs) {
+  if (const GlobalAlias* GA = dyn_cast<GlobalAlias>(C)) {
+    addConstantLocations(GA->getAliasee(), locs);
+  }
+  else if (isa<GlobalValue>(C)) {
+    locs.set(PointsToUtils::getObjectLocation(C));
+  }
+  else if (const ConstantExpr* CE = dyn_cast<ConstantExpr>(C)) {
+    switch (CE->getOpcode()) {
+      case Instruction::BitCast:
+      case Instruction::AddrSpaceCast: {
+        addConstantLocations(CE->getOperand(0), locs);
+        break;
+      }
+      case Instruction::GetElementPtr: {
+        LocationSet baseLocs;
+        addConstantLocations(CE->getOperand(0), baseLocs);
+        FieldPath path;
+        getFieldPath(CE, path);
+        for (unsigned L : baseLocs) {
+          locs.set(getFieldLocation(L, path));
+        }
+        break;
+      }
+      case Instruction::Select: {
+        addConstantLocations(CE->getOperand(1), locs);
+        addConstantLocations(CE->getOperand(2), locs);
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+  }
+}
+
+// Record the pointers that the initialiser C stores in location L (and its
+// fields).
+void PointsToSolver::addInitialiser(unsigned L, const Constant* C) {
+  if (isa<ConstantStruct>(C)) {
+    for (unsigned i=0; i<C->getNumOperands(); i++) {
+      addInitialiser(PointsToUtils::getFieldLocation(L, i), cast<Constant>(C->getOperand(i)));
+    }
+  }
+  else if (isa<ConstantArray>(C) || isa<ConstantVector>(C)) {
+    for (unsigned i=0; i<C->getNumOperands(); i++) {
+      addInitialiser(L, cast<Constant>(C->getOperand(i)));
+    }
+  }
+  else if (C->getType()->isPointerTy()) {
+    unsigned n = getContentNode(L);
+    LocationSet locs;
+    addConstantLocations(C, locs);
+    if (nodes[n].pts |= locs) {
+      enqueue(n);
+    }
+  }
+}
+
+void PointsToSolver::addConstraints() {
+  for (GlobalVariable& G : M.getGlobalList()) {
+    if (G.hasInitializer()) {
+      addInitialiser(PointsToUtils::getObjectLocation(&G), G.getInitializer());
+    }
+  }
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    if (F->isDeclaration()) continue;
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      addConstraints(&*I);
+    }
+  }
+  // constraints may have been added to nodes whose points-to sets were
+  // already seeded (e.g. constants and parameters)
+  for (unsigned n=0; n<nodes.size(); n++) {
+    if (!nodes[n].pts.empty()) {
+      enqueue(n);
+    }
+  }
+}
+
+void PointsToSolver::addConstraints(Instruction* I) {
+  for (Use& U : I->operands()) {
+    if (ConstantExpr* CE = dyn_cast<ConstantExpr>(U.get())) {
+      if (CE->getOpcode() == Instruction::PtrToInt) {
+        addCopy(getNode(CE->getOperand(0)), intNode);
+      }
+    }
+  }
+  if (isa<AllocaInst>(I)) {
+    addLocation(getNode(I), PointsToUtils::getObjectLocation(I));
+  }
+  else if (LoadInst* LI = dyn_cast<LoadInst>(I)) {
+    if (LI->getType()->isPointerTy()) {
+      nodes[getNode(LI->getPointerOperand())].loadTo.push_back(getNode(LI));
+    }
+    else if (LI->getType()->isAggregateType()) {
+      aggregateLoads.push_back(make_pair(getNode(LI->getPointerOperand()), getNode(LI)));
+    }
+  }
+  else if (StoreInst* SI = dyn_cast<StoreInst>(I)) {
+    if (SI->getValueOperand()->getType()->isPointerTy()) {
+      unsigned from = getNode(SI->getValueOperand());
+      nodes[getNode(SI->getPointerOperand())].storeFrom.push_back(from);
+    }
+    else if (SI->getValueOperand()->getType()->isAggregateType()) {
+      aggregateStores.push_back(make_pair(getNode(SI->getPointerOperand()), getNode(SI->getValueOperand())));
+    }
+  }
+  else if (GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(I)) {
+    FieldPath path;
+    getFieldPath(GEP, path);
+    unsigned to = getNode(GEP);
+    nodes[getNode(GEP->getPointerOperand())].fieldsTo.push_back(make_pair(to, path));
+  }
+  else if (isa<BitCastInst>(I) || isa<AddrSpaceCastInst>(I)) {
+    addCopy(getNode(I->getOperand(0)), getNode(I));
+  }
+  else if (isa<PtrToIntInst>(I)) {
+    addCopy(getNode(I->getOperand(0)), intNode);
+  }
+  else if (isa<IntToPtrInst>(I)) {
+    addCopy(intNode, getNode(I));
+  }
+  else if (InsertValueInst* IV = dyn_cast<InsertValueInst>(I)) {
+    addCopy(getNode(IV->getAggregateOperand()), getNode(IV));
+    addCopy(getNode(IV->getInsertedValueOperand()), getNode(IV));
+  }
+  else if (ExtractValueInst* EV = dyn_cast<ExtractValueInst>(I)) {
+    addCopy(getNode(EV->getAggregateOperand()), getNode(EV));
+  }
+  else if (PHINode* PHI = dyn_cast<PHINode>(I)) {
+    if (PHI->getType()->isPointerTy() || PHI->getType()->isAggregateType()) {
+      for (unsigned i=0; i<PHI->getNumIncomingValues(); i++) {
+        addCopy(getNode(PHI->getIncomingValue(i)), getNode(PHI));
+      }
+    }
+  }
+  else if (SelectInst* Sel = dyn_cast<SelectInst>(I)) {
+    if (Sel->getType()->isPointerTy()) {
+      addCopy(getNode(Sel->getTrueValue()), getNode(Sel));
+      addCopy(getNode(Sel->getFalseValue()), getNode(Sel));
+    }
+  }
+  else if (IntrinsicInst* II = dyn_cast<IntrinsicInst>(I)) {
+    if (II->getIntrinsicID() == Intrinsic::ptr_annotation) {
+      addCopy(getNode(II->getArgOperand(0)), getNode(II));
+    }
+    else if (MemTransferInst* MT = dyn_cast<MemTransferInst>(II)) { // memcpy and memmove
+      memCopies.push_back(make_pair(getNode(MT->getRawSource()), getNode(MT->getRawDest())));
+    }
+  }
+  else if (CallInst* C = dyn_cast<CallInst>(I)) {
+    if (Function* F = CallGraphUtils::getDirectCallee(C)) {
+      linkCall(C, F);
+    }
+    else {
+      nodes[getNode(C->getCalledValue())].indirectCalls.push_back(C);
+    }
+  }
+}
+
+void PointsToSolver::linkCall(CallInst* C, Function* F) {
+  if (!linkedCalls.insert(make_pair(C, F)).second) {
+    return;
+  }
+  if (F->isDeclaration()) {
+    StringRef name = F->getName();
+    if ((name == "memcpy" || name == "memmove") && C->getNumArgOperands() > 1) {
+      memCopies.push_back(make_pair(getNode(C->getArgOperand(1)), getNode(C->getArgOperand(0))));
+    }
+    // each call to an external function returning a pointer is treated as
+    // an allocation site, except for those that return their first argument
+    if (C->getType()->isPointerTy()) {
+      if ((name == "strcpy" || name == "strncpy" || name == "strcat" || name == "strncat"
+          || name == "memcpy" || name == "memmove" || name == "memset") && C->getNumArgOperands() > 0) {
+        addCopy(getNode(C->getArgOperand(0)), getNode(C));
+      }
+      else {
+        addLocation(getNode(C), PointsToUtils::getObjectLocation(C));
+      }
+    }
+    return;
+  }
+  Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+  for (unsigned i=0; i<C->getNumArgOperands() && AI != AE; i++, ++AI) {
+    Value* arg = C->getArgOperand(i);
+    if ((arg->getType()->isPointerTy() && AI->getType()->isPointerTy())
+        || (arg->getType()->isAggregateType() && arg->getType() == AI->getType())) {
+      addCopy(getNode(arg), getNode(&*AI));
+    }
+  }
+  if (C->getType()->isPointerTy() || C->getType()->isAggregateType()) {
+    for (BasicBlock& BB : *F) {
+      if (ReturnInst* RI = dyn_cast<ReturnInst>(BB.getTerminator())) {
+        if (Value* RetVal = RI->getReturnValue()) {
+          addCopy(getNode(RetVal), getNode(C));
+        }
+      }
+    }
+  }
+}
+
+void PointsToSolver::solve() {
+  do {
+    propagate();
+  } while (applyMemCopies());
+}
+
+void PointsToSolver::propagate() {
+  while (!worklist.empty()) {
+    unsigned n = worklist.front();
+    worklist.pop_front();
+    queued[n] = false;
+    if (find(n) != n) {
+      continue; // collapsed into another node, which will have been queued
+    }
+    string budget;
+    if (numPopped++ % 1024 == 0 && budgetExceeded.empty()
+        && WorklistUtils::isOverBudget(budget)) {
+      SDEBUG("soaap.util.pointsto", 1, dbgs() << INDENT_1 << "Over " << budget << " budget with " << worklist.size() << " nodes on the worklist, unifying\n")
+      budgetExceeded = budget;
+      widenedNode = n;
+    }
+    if (!budgetExceeded.empty() && find(widenedNode) != n) {
+      unify(widenedNode, n);
+      numWidened++;
+      continue;
+    }
+    Node& N = nodes[n];
+    LocationSet diff = N.pts;
+    diff.intersectWithComplement(N.done);
+    if (diff.empty()) {
+      continue;
+    }
+    N.done |= diff;
+
+    for (unsigned L : diff) {
+      for (unsigned i=0; i<N.loadTo.size(); i++) {
+        addCopy(getContentNode(L), N.loadTo[i]);
+      }
+      for (unsigned i=0; i<N.storeFrom.size(); i++) {
+        addCopy(N.storeFrom[i], getContentNode(L));
+      }
+      for (unsigned i=0; i<N.fieldsTo.size(); i++) {
+        addLocation(N.fieldsTo[i].first, getFieldLocation(L, N.fieldsTo[i].second));
+      }
+      if (!N.indirectCalls.empty()) {
+        const AbstractLocation& Loc = PointsToUtils::getLocation(L);
+        if (Loc.parent == -1) {
+          if (const Function* F = dyn_cast<Function>(Loc.object)) {
+            for (unsigned i=0; i<N.indirectCalls.size(); i++) {
+              linkCall(N.indirectCalls[i], (Function*)F);
+            }
+          }
+        }
+      }
+    }
+
+    // copy edges added above have already been given all of N's locations
+    for (unsigned i=0; i<N.copyTo.size(); i++) {
+      unsigned to = find(N.copyTo[i]);
+      if (to == n) {
+        continue;
+      }
+      if (nodes[to].pts |= diff) {
+        enqueue(to);
+      }
+      if (nodes[to].pts == N.pts && cycleCheckedEdges.insert(make_pair(n, to)).second) {
+        cycleCandidates.push_back(n);
+      }
+    }
+
+    while (!cycleCandidates.empty()) {
+      collapseCycles(cycleCandidates.pop_back_val());
+    }
+  }
+}
+
+void PointsToUtils::requirePointsTo(Module& M) {
+  if (!computed) {
+    computePointsTo(M);
+  }
+}
+
+void PointsToUtils::reset() {
+  locations.clear();
+  objectToLocation.clear();
+  fieldToLocation.clear();
+  pointsTo.clear();
+  locationToPointers.clear();
+  computed = false;
+}
+
+void PointsToUtils::computePointsTo(Module& M) {
+  reset();
+  computed = true;
+
+  PointsToSolver solver(M);
+  solver.addConstraints();
+  solver.solve();
+  SDEBUG("soaap.util.pointsto", 3, dbgs() << INDENT_1 << "Solved " << solver.getNumNodes() << " nodes ("
+                                          << solver.getNumCollapsed() << " collapsed into cycles)\n")
+  string budget = solver.getBudgetWidened();
+  if (!budget.empty()) {
+    WorklistUtils::noteOverBudget("points-to", budget);
+  }
+
+  locationToPointers.resize(locations.size());
+  unsigned numPointers = 0;
+  for (pair<const Value*,unsigned> P : solver.getValueNodes()) {
+    const Value* V = P.first;
+    LocationSet& pts = solver.getPointsTo(P.second);
+    if (pts.empty() || isa<Function>(V)) {
+      continue;
+    }
+    pointsTo[V] = pts;
+    for (unsigned L : pts) {
+      locationToPointers[L].push_back(V);
+    }
+    numPointers++;
+  }
+
+  SDEBUG("soaap.util.pointsto", 3, dbgs() << INDENT_1 << numPointers << " pointers to "
+                                          << locations.size() << " abstract locations\n")
+}
+
+const LocationSet& PointsToUtils::getPointsTo(const Value* V) {
+  static LocationSet empty;
+  DenseMap<const Value*,LocationSet>::iterator I = pointsTo.find(V);
+  return I == pointsTo.end() ? empty : I->second;
+}
+
+LocationSet PointsToUtils::getLocationsWithin(const Value* V) {
+  LocationSet result;
+  for (unsigned L : getPointsTo(V)) {
+    addLocationsWithin(L, result);
+  }
+  return result;
+}
+
+void PointsToUtils::addLocationsWithin(unsigned L, LocationSet& locs) {
+  SmallVector<unsigned,16> worklist;
+  worklist.push_back(L);
+  while (!worklist.empty()) {
+    L = worklist.pop_back_val();
+    if (locs.test(L)) {
+      continue;
+    }
+    locs.set(L);
+    for (unsigned child : locations[L].children) {
+      worklist.push_back(child);
+    }
+  }
+}
+
+LocationSet PointsToUtils::getEnclosingLocations(const Value* V) {
+  LocationSet result;
+  for (unsigned L : getPointsTo(V)) {
+    for (int A = locations[L].parent; A != -1 && !result.test(A); A = locations[A].parent) {
+      result.set(A);
+    }
+  }
+  return result;
+}
+
+const PointerVector& PointsToUtils::getPointersTo(unsigned L) {
+  static PointerVector empty;
+  return L < locationToPointers.size() ? locationToPointers[L] : empty;
+}
+
+FunctionSet PointsToUtils::getFunctionsPointedTo(const Value* V) {
+  FunctionSet funcs;
+  for (unsigned L : getPointsTo(V)) {
+    const AbstractLocation& Loc = locations[L];
+    if (Loc.parent == -1) {
+      if (const Function* F = dyn_cast<Function>(Loc.object)) {
+        funcs.insert((Function*)F);
+      }
+    }
+  }
+  return funcs;
+}
+
+unsigned PointsToUtils::getObjectLocation(const Value* object) {
+  DenseMap<const Value*,unsigned>::iterator I = objectToLocation.find(object);
+  if (I != objectToLocation.end()) {
+    return I->second;
+  }
+  unsigned L = locations.size();
+  AbstractLocation Loc;
+  Loc.object = object;
+  Loc.parent = -1;
+  Loc.field = 0;
+  Loc.depth = 0;
+  locations.push_back(Loc);
+  objectToLocation[object] = L;
+  return L;
+}
+
+unsigned PointsToUtils::getFieldLocation(unsigned L, unsigned field) {
+  if (locations[L].depth >= (unsigned)CmdLineOpts::MaxFieldDepth) {
+    return L;
+  }
+  pair<unsigned,unsigned> key = make_pair(L, field);
+  DenseMap<pair<unsigned,unsigned>,unsigned>::iterator I = fieldToLocation.find(key);
+  if (I != fieldToLocation.end()) {
+    return I->second;
+  }
+  unsigned F = locations.size();
+  AbstractLocation Loc;
+  Loc.object = locations[L].object;
+  Loc.parent = L;
+  Loc.field = field;
+  Loc.depth = locations[L].depth + 1;
+  locations.push_back(Loc);
+  locations[L].children.push_back(F);
+  fieldToLocation[key] = F;
+  return F;
+}
+
+string PointsToUtils::stringifyLocation(unsigned L) {
+  const AbstractLocation& Loc = locations[L];
+  if (Loc.parent != -1) {
+    return stringifyLocation(Loc.parent) + "." + to_string(Loc.field);
+  }
+  string result;
+  raw_string_ostream ss(result);
+  if (isa<GlobalValue>(Loc.object) || isa<Argument>(Loc.object)) {
+    ss << Loc.object->getName();
+  }
+  else if (const Instruction* I = dyn_cast<Instruction>(Loc.object)) {
+    ss << I->getParent()->getParent()->getName() << ":";
+    Loc.object->printAsOperand(ss, false);
+  }
+  return ss.str();
+}
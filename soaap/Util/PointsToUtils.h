@@ -0,0 +1,76 @@
+#ifndef SOAAP_UTILS_POINTSTOUTILS_H
+#define SOAAP_UTILS_POINTSTOUTILS_H
+
+#include "Common/Typedefs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  typedef SparseBitVector<> LocationSet;
+  typedef vector<const Value*> PointerVector;
+
+  // An abstract memory location: an allocation site (an alloca, global,
+  // function, pointer parameter or call to an external function returning a
+  // pointer) or a struct field within the location parent. Array elements
+  // are not distinguished, and fields nested deeper than
+  // -soaap-max-field-depth are folded into their ancestor at that depth.
+  struct AbstractLocation {
+    const Value* object;
+    int parent; // -1 for the allocation site itself
+    unsigned field;
+    unsigned depth;
+    SmallVector<unsigned,4> children;
+  };
+
+  // Flow- and context-insensitive, field-sensitive points-to analysis of the
+  // slice, so that the information-flow analyses can tell which pointers may
+  // refer to the memory that a store writes to. Indirect calls are resolved
+  // on the fly from the points-to sets of their called values. It is
+  // computed once, when first required by an information-flow analysis, a
+  // query or -soaap-points-to-fp-targets, so runs that need none of these
+  // don't pay for it.
+  class PointsToUtils {
+    public:
+      static void computePointsTo(Module& M);
+      // Compute the points-to sets, unless they already have been.
+      static void requirePointsTo(Module& M);
+      static void reset();
+      static const LocationSet& getPointsTo(const Value* V);
+      // The locations V may point to, and every field within them.
+      static LocationSet getLocationsWithin(const Value* V);
+      // Add L and every field within it to locs.
+      static void addLocationsWithin(unsigned L, LocationSet& locs);
+      // The locations that enclose those V may point to (i.e. the structs
+      // and allocation sites that they are fields of).
+      static LocationSet getEnclosingLocations(const Value* V);
+      // The pointers (instructions, arguments, globals and constant
+      // expressions) that may point to location L.
+      static const PointerVector& getPointersTo(unsigned L);
+      // The functions whose addresses V may hold.
+      static FunctionSet getFunctionsPointedTo(const Value* V);
+      static const AbstractLocation& getLocation(unsigned L) { return locations[L]; }
+      static unsigned getNumLocations() { return locations.size(); }
+      static string stringifyLocation(unsigned L);
+
+      // Used while solving.
+      static unsigned getObjectLocation(const Value* object);
+      static unsigned getFieldLocation(unsigned L, unsigned field);
+
+    private:
+      static bool computed;
+      static vector<AbstractLocation> locations;
+      static DenseMap<const Value*,unsigned> objectToLocation;
+      static DenseMap<pair<unsigned,unsigned>,unsigned> fieldToLocation;
+      static DenseMap<const Value*,LocationSet> pointsTo;
+      static vector<PointerVector> locationToPointers;
+  };
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include "Common/CmdLineOpts.h"
 #include "Common/Debug.h"
 #include "Util/CallGraphUtils.h"
 #include "Util/ClassifiedUtils.h"
@@ -5,7 +6,13 @@
 #include "Util/DebugUtils.h"
 #include "Util/SandboxUtils.h"
 #include "Util/LLVMAnalyses.h"
+#include "Util/PrettyPrinters.h"
+#include "Util/SliceUtils.h"
 #include "soaap.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/Support/Debug.h"
@@ -15,6 +22,7 @@
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IntrinsicInst.h"
 
+#include <cctype>
 #include <sstream>
 
 using namespace soaap;
@@ -45,6 +53,10 @@ string SandboxUtils::stringifySandboxNames(int sandboxNames) {
   return sandboxNamesStr;
 }
 
+int SandboxUtils::getAllSandboxNames() {
+  return (1 << nextSandboxNameBitIdx) - 1;
+}
+
 SandboxVector SandboxUtils::convertNamesToVector(int sandboxNames, SandboxVector& sandboxes) {
   SandboxVector vec;
   int currIdx = 0;
@@ -71,6 +83,22 @@ string SandboxUtils::stringifySandboxVector(SandboxVector& sandboxes) {
   return sandboxNamesStr;
 }
 
+// Sandbox names are arbitrary strings, so replace anything that can't
+// appear in a C identifier (or filename) with an underscore.
+string SandboxUtils::getIdentifierForSandbox(Sandbox* S) {
+  string id = S->getName();
+  for (char& c : id) {
+    if (!isalnum(c)) {
+      c = '_';
+    }
+  }
+  return id;
+}
+
+string SandboxUtils::getPolicyFilename(Sandbox* S, string suffix) {
+  return CmdLineOpts::ReportFilePrefix + "." + getIdentifierForSandbox(S) + "." + suffix;
+}
+
 int SandboxUtils::assignBitIdxToSandboxName(string sandboxName) {
   if (sandboxNameToBitIdx.find(sandboxName) == sandboxNameToBitIdx.end()) {
     outs() << "    Assigning index " << nextSandboxNameBitIdx << " to sandbox name \"" << sandboxName << "\"\n";
@@ -175,10 +203,11 @@ SandboxVector SandboxUtils::findSandboxes(Module& M) {
         if (annotationStrValCString.startswith(SOAAP_SANDBOX_REGION_START)) {
           StringRef sandboxName = annotationStrValCString.substr(strlen(SOAAP_SANDBOX_REGION_START)+1); //+1 because of _
           SDEBUG("soaap.util.sandbox", 3, dbgs() << INDENT_3 << "Found start of sandboxed code region: "; annotCall->dump(););
-          InstVector sandboxedInsts;
-          findAllSandboxedInstructions(annotCall, sandboxName, sandboxedInsts);
+          CodeRegion region(annotCall, [&](Instruction* I) {
+            return isSandboxedRegionEnd(I, sandboxName);
+          });
           int idx = assignBitIdxToSandboxName(sandboxName);
-          sandboxes.push_back(new Sandbox(sandboxName, idx, sandboxedInsts, false, M)); //TODO: obtain persistent/ephemeral information in a better way (currently we obtain it from the creation point)
+          sandboxes.push_back(new Sandbox(sandboxName, idx, region, false, M)); //TODO: obtain persistent/ephemeral information in a better way (currently we obtain it from the creation point)
         }
       }
     }
@@ -268,44 +297,25 @@ void SandboxUtils::createEmptySandboxIfNew(string name, SandboxVector& sandboxes
   if (!getSandboxWithName(name, sandboxes)) {
     outs() << INDENT_1 << "No scope exists for referenced sandbox \"" << name << "\", creating empty sandbox\n";
     int idx = assignBitIdxToSandboxName(name);
-    InstVector region;
+    CodeRegion region;
     sandboxes.push_back(new Sandbox(name, idx, region, true, M));
   }
 }
 
-void SandboxUtils::findAllSandboxedInstructions(Instruction* I, string startSandboxName, InstVector& insts) {
-  BasicBlock* BB = I->getParent();
-  
-  // If I is not the start of BB, then fast-forward iterator to it
-  BasicBlock::iterator BI = BB->begin();
-  while (&*BI != I) { BI++; }
-
-  for (BasicBlock::iterator BE = BB->end(); BI != BE; BI++) {
-    // If I is the end_sandboxed_code() annotation then we stop
-    I = &*BI;
-    SDEBUG("soaap.util.sandbox", 3, I->dump());
-    insts.push_back(I);
-    if (isa<IntrinsicInst>(I)) {
-      GlobalVariable* annotationStrVar = dyn_cast<GlobalVariable>(I->getOperand(1)->stripPointerCasts());
+bool SandboxUtils::isSandboxedRegionEnd(Instruction* I, StringRef sandboxName) {
+  if (IntrinsicInst* II = dyn_cast<IntrinsicInst>(I)) {
+    if (II->getIntrinsicID() == Intrinsic::annotation) {
+      GlobalVariable* annotationStrVar = dyn_cast<GlobalVariable>(II->getOperand(1)->stripPointerCasts());
       ConstantDataArray* annotationStrValArray = dyn_cast<ConstantDataArray>(annotationStrVar->getInitializer());
       StringRef annotationStrValCString = annotationStrValArray->getAsCString();
-      
       if (annotationStrValCString.startswith(SOAAP_SANDBOX_REGION_END)) {
         StringRef endSandboxName = annotationStrValCString.substr(strlen(SOAAP_SANDBOX_REGION_END)+1); //+1 because of _
         SDEBUG("soaap.util.sandbox", 3, dbgs() << INDENT_3 << "Found end of sandboxed code region: "; I->dump());
-        if (endSandboxName == startSandboxName) {
-          // we have found the end of the region
-          return;
-        }
+        return endSandboxName == sandboxName;
       }
     }
   }
-
-  // recurse on successor BBs
-  for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; SI++) {
-    BasicBlock* SBB = *SI;
-    findAllSandboxedInstructions(SBB->begin(), startSandboxName, insts);
-  }
+  return false;
 }
 
 FunctionSet SandboxUtils::getPrivilegedMethods(Module& M) {
@@ -457,19 +467,209 @@ void SandboxUtils::recalculatePrivilegedMethods(Module& M) {
   calculatePrivilegedMethods(M);
 }
 
-void SandboxUtils::validateSandboxCreations(SandboxVector& sandboxes) {
-  for (Sandbox* S : sandboxes) {
-    S->validateCreationPoints();
+namespace {
+  // Checks that every privileged call to a sandbox entrypoint is preceded by
+  // the creation of its sandbox, for all sandboxes at once. Sandbox i is bit
+  // i of a BitVector and the state at each program point is the set of
+  // sandboxes created on every path from main() to it (so states meet by
+  // intersection). Each function is first summarised by the sandboxes it
+  // creates on every path through it, after which states are propagated
+  // from main() into callees. States only ever shrink, so each block and
+  // function is revisited at most once per sandbox.
+  class CreationPointValidator {
+    public:
+      CreationPointValidator(Module& M, SandboxVector& sandboxes)
+        : M(M), sandboxes(sandboxes), numSandboxes(sandboxes.size()) { }
+      void run();
+
+    private:
+      typedef SetVector<Function*> FunctionWorklist;
+
+      Module& M;
+      SandboxVector& sandboxes;
+      unsigned numSandboxes;
+      DenseMap<Instruction*,BitVector> creationPointToSandboxes;
+      DenseMap<Function*,BitVector> entryPointToSandboxes;
+      DenseMap<Function*,BitVector> summaries;
+      DenseMap<Function*,BitVector> entryStates;
+      DenseMap<Function*,SetVector<Function*> > callers;
+      DenseSet<CallInst*> reported;
+
+      BitVector analyseFunction(Function* F, const BitVector& entryState, FunctionWorklist* worklist);
+      void meetInto(DenseMap<Function*,BitVector>& states, Function* F, const BitVector& state, FunctionWorklist& worklist);
+      void reportViolation(CallInst* C, Function* entryPoint);
+  };
+}
+
+void CreationPointValidator::meetInto(DenseMap<Function*,BitVector>& states, Function* F, const BitVector& state, FunctionWorklist& worklist) {
+  DenseMap<Function*,BitVector>::iterator I = states.find(F);
+  if (I == states.end()) {
+    states[F] = state;
+    worklist.insert(F);
+  }
+  else {
+    BitVector old = I->second;
+    I->second &= state;
+    if (I->second != old) {
+      worklist.insert(F);
+    }
+  }
+}
+
+// Runs the intraprocedural dataflow over F starting from entryState and
+// returns the state on exit from F. When a worklist is given, calls to
+// sandbox entrypoints are checked and the state at each call is propagated
+// to the entry of its callees (queueing those whose entry state changed),
+// otherwise the callers of each callee are recorded. Code reached through a
+// sandbox entrypoint runs in the sandbox, so we don't descend into it.
+BitVector CreationPointValidator::analyseFunction(Function* F, const BitVector& entryState, FunctionWorklist* worklist) {
+  BitVector exitState(numSandboxes, true);
+  DenseMap<BasicBlock*,BitVector> blockStates;
+  SetVector<BasicBlock*> blockWorklist;
+  blockStates[&F->getEntryBlock()] = entryState;
+  blockWorklist.insert(&F->getEntryBlock());
+
+  while (!blockWorklist.empty()) {
+    BasicBlock* BB = blockWorklist.pop_back_val();
+    BitVector state = blockStates[BB];
+    for (Instruction& I : *BB) {
+      DenseMap<Instruction*,BitVector>::iterator CPI = creationPointToSandboxes.find(&I);
+      if (CPI != creationPointToSandboxes.end()) {
+        state |= CPI->second;
+      }
+      else if (CallInst* C = dyn_cast<CallInst>(&I)) {
+        if (isa<IntrinsicInst>(C)) {
+          continue;
+        }
+        // sandboxes created on every path through every callee
+        BitVector created(numSandboxes, true);
+        bool descended = false;
+        for (Function* callee : CallGraphUtils::getCallees(C, ContextUtils::PRIV_CONTEXT, M)) {
+          DenseMap<Function*,BitVector>::iterator EPI = entryPointToSandboxes.find(callee);
+          if (EPI != entryPointToSandboxes.end()) {
+            BitVector missing = EPI->second;
+            missing.reset(state);
+            if (worklist && missing.any()) {
+              reportViolation(C, callee);
+            }
+          }
+          else if (!callee->isDeclaration()) {
+            if (worklist) {
+              meetInto(entryStates, callee, state, *worklist);
+            }
+            else {
+              callers[callee].insert(F);
+            }
+            created &= summaries[callee];
+            descended = true;
+          }
+        }
+        if (descended) {
+          state |= created;
+        }
+      }
+    }
+
+    TerminatorInst* T = BB->getTerminator();
+    if (isa<ReturnInst>(T)) {
+      exitState &= state;
+    }
+    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI) {
+      BasicBlock* SuccBB = *SI;
+      DenseMap<BasicBlock*,BitVector>::iterator BSI = blockStates.find(SuccBB);
+      if (BSI == blockStates.end()) {
+        blockStates[SuccBB] = state;
+        blockWorklist.insert(SuccBB);
+      }
+      else {
+        BitVector old = BSI->second;
+        BSI->second &= state;
+        if (BSI->second != old) {
+          blockWorklist.insert(SuccBB);
+        }
+      }
+    }
+  }
+  return exitState;
+}
+
+void CreationPointValidator::reportViolation(CallInst* C, Function* entryPoint) {
+  if (!reported.insert(C).second) {
+    return;
   }
+  InstTrace trace = CallGraphUtils::findPrivilegedPathToFunction(C->getParent()->getParent(), M);
+  trace.push_front(C);
+  outs() << "\n";
+  outs() << " *** Found call to sandbox entrypoint \"" << entryPoint->getName() << "\" that is not preceded by sandbox creation\n";
+  outs() << " Possible trace:\n";
+  PrettyPrinters::ppTrace(trace);
+  outs() << "\n";
+}
+
+void CreationPointValidator::run() {
+  Function* MainFunc = M.getFunction("main");
+  if (!MainFunc || MainFunc->isDeclaration()) {
+    return;
+  }
+  for (unsigned i=0; i<numSandboxes; i++) {
+    Sandbox* S = sandboxes[i];
+    if (Function* entryPoint = S->getEntryPoint()) {
+      BitVector& bits = entryPointToSandboxes[entryPoint];
+      bits.resize(numSandboxes);
+      bits.set(i);
+    }
+    for (CallInst* C : S->getCreationPoints()) {
+      BitVector& bits = creationPointToSandboxes[C];
+      bits.resize(numSandboxes);
+      bits.set(i);
+    }
+  }
+  if (entryPointToSandboxes.empty()) {
+    return;
+  }
+
+  // Summarise each function by the sandboxes created on every path through
+  // it. Summaries start from all sandboxes and shrink to a (greatest)
+  // fixpoint, so that recursion does not lose creation points.
+  FunctionWorklist worklist;
+  BitVector empty(numSandboxes);
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    if (!F->isDeclaration()) {
+      summaries[F] = BitVector(numSandboxes, true);
+      worklist.insert(F);
+    }
+  }
+  while (!worklist.empty()) {
+    Function* F = worklist.pop_back_val();
+    BitVector summary = analyseFunction(F, empty, nullptr);
+    if (summary != summaries[F]) {
+      summaries[F] = summary;
+      for (Function* caller : callers[F]) {
+        worklist.insert(caller);
+      }
+    }
+  }
+  SDEBUG("soaap.util.sandbox", 3, dbgs() << "Summarised sandbox creations of " << summaries.size() << " functions\n")
+
+  // Propagate the sandboxes created before entering each function from
+  // main(), checking entrypoint calls as we go.
+  entryStates[MainFunc] = empty;
+  worklist.insert(MainFunc);
+  while (!worklist.empty()) {
+    Function* F = worklist.pop_back_val();
+    SDEBUG("soaap.util.sandbox", 4, dbgs() << "Validating creation points in " << F->getName() << "\n")
+    analyseFunction(F, entryStates[F], &worklist);
+  }
+}
+
+void SandboxUtils::validateSandboxCreations(Module& M, SandboxVector& sandboxes) {
+  CreationPointValidator(M, sandboxes).run();
 }
 
 bool SandboxUtils::isWithinSandboxedRegion(Instruction* I, SandboxVector& sandboxes) {
   for (Sandbox* S : sandboxes) {
-    if (S->getEntryPoint() == NULL) {
-      InstVector region = S->getRegion();
-      if (find(region.begin(), region.end(), I) != region.end()) {
-        return true;
-      }
+    if (S->isInRegion(I)) {
+      return true;
     }
   }
   return false;
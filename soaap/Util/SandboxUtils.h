@@ -19,6 +19,8 @@ namespace soaap {
       static void reinitSandboxes(SandboxVector& sandboxes);
       static string stringifySandboxNames(int sandboxNames);
       static string stringifySandboxVector(SandboxVector& sandboxes);
+      static string getIdentifierForSandbox(Sandbox* S);
+      static string getPolicyFilename(Sandbox* S, string suffix);
       static bool isSandboxEntryPoint(Module& M, Function* F);
       static bool isWithinSandboxedRegion(Instruction* I, SandboxVector& sandboxes);
       static Sandbox* getSandboxForEntryPoint(Function* F, SandboxVector& sandboxes);
@@ -29,7 +31,8 @@ namespace soaap {
       static void outputPrivilegedFunctions();
       static bool isSandboxedFunction(Function* F, SandboxVector& sandboxes);
       static SandboxVector convertNamesToVector(int sandboxNames, SandboxVector& sandboxes);
-      static void validateSandboxCreations(SandboxVector& sandboxes);
+      static int getAllSandboxNames();
+      static void validateSandboxCreations(Module& M, SandboxVector& sandboxes);
       
       static FunctionSet getPrivilegedMethods(Module& M);
       static void recalculatePrivilegedMethods(Module& M);
@@ -47,7 +50,7 @@ namespace soaap {
       static void calculateSandboxedMethods(Function* F, Sandbox* S, FunctionVector& sandboxedMethods);
       static void calculatePrivilegedMethods(Module& M);
       static void calculatePrivilegedMethodsHelper(Module& M, Function* F);
-      static void findAllSandboxedInstructions(Instruction* I, string sboxName, InstVector& insts);
+      static bool isSandboxedRegionEnd(Instruction* I, StringRef sandboxName);
   };
 }
 
@@ -0,0 +1,131 @@
+#include "Util/SliceUtils.h"
+
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Util/DebugUtils.h"
+#include "Util/ModuleUtils.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace soaap;
+
+bool SliceUtils::computed = false;
+bool SliceUtils::wholeModule = false;
+FunctionVector SliceUtils::sliceFuncs;
+SmallPtrSet<const Function*,64> SliceUtils::sliceFuncSet;
+
+void SliceUtils::computeSlice(Module& M, SandboxVector& sandboxes) {
+  computed = true;
+  sliceFuncs.clear();
+  sliceFuncSet.clear();
+
+  Function* MainFn = M.getFunction("main");
+  wholeModule = CmdLineOpts::NoSlicing || MainFn == NULL || MainFn->isDeclaration();
+  if (wholeModule) {
+    addWholeModule(M);
+    return;
+  }
+
+  SmallVector<Function*,64> worklist;
+  worklist.push_back(MainFn);
+  for (Sandbox* S : sandboxes) {
+    if (Function* F = S->getEntryPoint()) {
+      worklist.push_back(F);
+    }
+    if (Function* F = S->getEnclosingFunc()) {
+      worklist.push_back(F);
+    }
+    for (Function* F : S->getCallgates()) {
+      worklist.push_back(F);
+    }
+  }
+
+  SmallPtrSet<const Value*,64> visited;
+  // virtual calls are resolved using the whole class hierarchy, so every
+  // virtual function is a potential callee
+  for (GlobalVariable& G : M.getGlobalList()) {
+    if (G.getName().startswith("_ZTV")) {
+      addReferences(&G, visited, worklist);
+    }
+  }
+
+  while (!worklist.empty()) {
+    Function* F = worklist.pop_back_val();
+    if (F == NULL || !sliceFuncSet.insert(F).second) {
+      continue;
+    }
+    ModuleUtils::materializeReachable(F);
+    for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+      for (Use& U : I->operands()) {
+        addReferences(U.get(), visited, worklist);
+      }
+    }
+  }
+
+  // keep module order, so that the analyses visit functions in the same
+  // order as without slicing
+  for (Function& F : M.getFunctionList()) {
+    if (sliceFuncSet.count(&F)) {
+      sliceFuncs.push_back(&F);
+    }
+  }
+
+  outs() << INDENT_1 << "Sliced " << sliceFuncs.size() << " of " << M.size() << " functions\n";
+}
+
+void SliceUtils::addReferences(Value* V, SmallPtrSet<const Value*,64>& visited, SmallVectorImpl<Function*>& worklist) {
+  if (!isa<Constant>(V) || !visited.insert(V).second) {
+    return;
+  }
+  if (Function* F = dyn_cast<Function>(V)) {
+    worklist.push_back(F);
+  }
+  else if (GlobalVariable* G = dyn_cast<GlobalVariable>(V)) {
+    // e.g. vtables and tables of function pointers
+    if (G->hasInitializer()) {
+      addReferences(G->getInitializer(), visited, worklist);
+    }
+  }
+  else if (GlobalAlias* A = dyn_cast<GlobalAlias>(V)) {
+    addReferences(A->getAliasee(), visited, worklist);
+  }
+  else {
+    for (Use& U : cast<Constant>(V)->operands()) {
+      addReferences(U.get(), visited, worklist);
+    }
+  }
+}
+
+void SliceUtils::addWholeModule(Module& M) {
+  // every function may be analysed, so every body is needed
+  if (error_code EC = M.materializeAll()) {
+    errs() << "WARNING: could not materialize the module: " << EC.message() << "\n";
+  }
+  for (Function& F : M.getFunctionList()) {
+    sliceFuncs.push_back(&F);
+    sliceFuncSet.insert(&F);
+  }
+}
+
+FunctionVector& SliceUtils::getFunctions(Module& M) {
+  if (!computed) {
+    // used before the slicing stage, so cover the whole module. Bodies that
+    // a lazily-loaded module hasn't materialized yet can't be reached, and
+    // are left out rather than parsed.
+    sliceFuncs.clear();
+    sliceFuncSet.clear();
+    for (Function& F : M.getFunctionList()) {
+      if (!F.isMaterializable()) {
+        sliceFuncs.push_back(&F);
+        sliceFuncSet.insert(&F);
+      }
+    }
+  }
+  return sliceFuncs;
+}
+
+bool SliceUtils::isInSlice(const Function* F) {
+  return !computed || wholeModule || sliceFuncSet.count(F);
+}
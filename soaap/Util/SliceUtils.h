@@ -0,0 +1,38 @@
+#ifndef SOAAP_UTILS_SLICEUTILS_H
+#define SOAAP_UTILS_SLICEUTILS_H
+
+#include "Common/Sandbox.h"
+#include "Common/Typedefs.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+
+namespace soaap {
+  // The slice of the module that SOAAP analyses: the functions that can be
+  // reached from main(), the sandboxes and their callgates. A function is
+  // reached if it is referred to (called, or its address taken) by a reached
+  // function or by the initialiser of a global that a reached function refers
+  // to. This over-approximates the call graph, including its function-pointer
+  // and virtual call edges, without having to build it first, so the phases
+  // that build it can already be restricted to the slice.
+  //
+  // If the module has no main() (e.g. it is a library), or slicing was
+  // disabled with -soaap-no-slicing, the slice is the whole module.
+  class SliceUtils {
+    public:
+      static void computeSlice(Module& M, SandboxVector& sandboxes);
+      // Functions (including declarations) in the slice, in module order.
+      static FunctionVector& getFunctions(Module& M);
+      static bool isInSlice(const Function* F);
+
+    private:
+      static bool computed;
+      static bool wholeModule;
+      static FunctionVector sliceFuncs;
+      static SmallPtrSet<const Function*,64> sliceFuncSet;
+      static void addWholeModule(Module& M);
+      static void addReferences(Value* V, SmallPtrSet<const Value*,64>& visited, SmallVectorImpl<Function*>& worklist);
+  };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "Util/TaintUtils.h"
+
+#include "Common/Debug.h"
+#include "Util/CallGraphUtils.h"
+#include "Util/DebugUtils.h"
+#include "Util/PointsToUtils.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace soaap;
+
+DenseSet<const Value*> TaintUtils::flowsToSink;
+
+void TaintUtils::getPredecessors(Value* V, SmallVectorImpl<Value*>& preds, Module& M) {
+  if (Argument* A = dyn_cast<Argument>(V)) {
+    for (CallInst* C : CallGraphUtils::getCallers(A->getParent(), NULL, M)) {
+      if (A->getArgNo() < C->getNumArgOperands()) {
+        preds.push_back(C->getArgOperand(A->getArgNo()));
+      }
+    }
+  }
+  else if (CallInst* C = dyn_cast<CallInst>(V)) {
+    if (isa<IntrinsicInst>(C)) {
+      for (Use& U : C->arg_operands()) {
+        preds.push_back(U.get());
+      }
+    }
+    else {
+      for (Function* Callee : CallGraphUtils::getCallees(C, NULL, M)) {
+        if (Callee->isDeclaration()) {
+          // see InfoFlowAnalysis::propagateForExternCall
+          for (Use& U : C->arg_operands()) {
+            preds.push_back(U.get());
+          }
+          continue;
+        }
+        for (inst_iterator I = inst_begin(Callee), E = inst_end(Callee); I != E; ++I) {
+          if (ReturnInst* R = dyn_cast<ReturnInst>(&*I)) {
+            if (Value* RV = R->getReturnValue()) {
+              preds.push_back(RV);
+            }
+          }
+        }
+      }
+    }
+  }
+  else if (AllocaInst* AI = dyn_cast<AllocaInst>(V)) {
+    // varargs are propagated to the callee's va_list
+    if (ArrayType* AT = dyn_cast<ArrayType>(AI->getAllocatedType())) {
+      if (StructType* ST = dyn_cast<StructType>(AT->getElementType())) {
+        if (ST->hasName() && ST->getName() == "struct.__va_list_tag") {
+          Function* F = AI->getParent()->getParent();
+          for (CallInst* C : CallGraphUtils::getCallers(F, NULL, M)) {
+            for (unsigned i=F->arg_size(); i<C->getNumArgOperands(); i++) {
+              preds.push_back(C->getArgOperand(i));
+            }
+          }
+        }
+      }
+    }
+  }
+  else if (Instruction* I = dyn_cast<Instruction>(V)) {
+    // e.g. loads, casts, GEPs, binary operators, PHIs and selects
+    for (Use& U : I->operands()) {
+      if (!isa<BasicBlock>(U.get())) {
+        preds.push_back(U.get());
+      }
+    }
+  }
+  else if (Constant* C = dyn_cast<Constant>(V)) {
+    // constant expressions, aggregates and global initialisers
+    for (Use& U : C->operands()) {
+      preds.push_back(U.get());
+    }
+  }
+
+  // values stored to V, memory copied to V, and the args of extern calls
+  // that write to V
+  for (User* U : V->users()) {
+    if (StoreInst* S = dyn_cast<StoreInst>(U)) {
+      if (S->getPointerOperand() == V) {
+        preds.push_back(S->getValueOperand());
+      }
+    }
+    else if (MemTransferInst* MT = dyn_cast<MemTransferInst>(U)) {
+      if (MT->getRawDest() == V) {
+        preds.push_back(MT->getRawSource());
+      }
+    }
+    else if (CallInst* C = dyn_cast<CallInst>(U)) {
+      if (!isa<IntrinsicInst>(C) && CallGraphUtils::isExternCall(C)
+          && C->getNumArgOperands() > 0 && C->getArgOperand(0) == V) {
+        for (Use& U2 : C->arg_operands()) {
+          if (U2.get() != V) {
+            preds.push_back(U2.get());
+          }
+        }
+      }
+    }
+  }
+
+  // values stored through pointers to the memory that V may point to, to
+  // memory enclosing it, or to fields within it (see
+  // InfoFlowAnalysis::propagateToMemory)
+  if (V->getType()->isPointerTy()) {
+    LocationSet locs = PointsToUtils::getLocationsWithin(V);
+    locs |= PointsToUtils::getEnclosingLocations(V);
+    for (unsigned L : locs) {
+      for (const Value* Ptr : PointsToUtils::getPointersTo(L)) {
+        if (Ptr != V) {
+          preds.push_back((Value*)Ptr);
+        }
+      }
+    }
+  }
+}
+
+void TaintUtils::findValuesFlowingTo(ValueSet& sinks, Module& M) {
+  SmallVector<Value*,32> worklist;
+  for (Value* V : sinks) {
+    worklist.push_back(V);
+  }
+  int numFound = 0;
+  while (!worklist.empty()) {
+    Value* V = worklist.pop_back_val();
+    if (!flowsToSink.insert(V).second) {
+      continue;
+    }
+    numFound++;
+    getPredecessors(V, worklist, M);
+  }
+  SDEBUG("soaap.util.taint", 3, dbgs() << "Found " << numFound << " new values flowing to " << sinks.size() << " sinks (" << flowsToSink.size() << " in total)\n")
+}
@@ -0,0 +1,37 @@
+#ifndef SOAAP_UTILS_TAINTUTILS_H
+#define SOAAP_UTILS_TAINTUTILS_H
+
+#include "Common/Typedefs.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Backward queries over the flows that the information-flow analyses
+  // propagate along, used to find the part of the program that can affect
+  // a set of sinks before propagating forwards from the sources. Flows are
+  // over-approximated (context-insensitively, and without declassification)
+  // so that restricting a forward analysis to the values found gives the
+  // same facts at the sinks.
+  class TaintUtils {
+    public:
+      // The values that V's fact may be propagated from in one step:
+      // operands, values stored to V (or to memory that V may point to),
+      // args passed to parameters, and the return values of callees.
+      static void getPredecessors(Value* V, SmallVectorImpl<Value*>& preds, Module& M);
+
+      // Find the values that may flow to one of sinks. The values found are
+      // remembered between queries: a value found by an earlier query is
+      // not explored again, as everything that flows to it has been found.
+      static void findValuesFlowingTo(ValueSet& sinks, Module& M);
+      static bool mayFlowToSink(const Value* V) { return flowsToSink.count(V) != 0; }
+      static int getNumValuesFlowingToSinks() { return flowsToSink.size(); }
+
+    private:
+      static DenseSet<const Value*> flowsToSink;
+  };
+}
+
+#endif
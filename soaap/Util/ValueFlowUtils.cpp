@@ -0,0 +1,142 @@
+#include "Util/ValueFlowUtils.h"
+
+#include "Common/Debug.h"
+#include "Util/CallGraphUtils.h"
+#include "Util/PointsToUtils.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace soaap;
+
+vector<FlowEdge> ValueFlowUtils::edges;
+DenseMap<const Value*,EdgeRange> ValueFlowUtils::valueToEdges;
+vector<MemoryEdge> ValueFlowUtils::memoryEdges;
+DenseMap<const Value*,EdgeRange> ValueFlowUtils::pointerToAliases;
+
+EdgeRange ValueFlowUtils::getSuccessors(const Value* V) {
+  DenseMap<const Value*,EdgeRange>::iterator I = valueToEdges.find(V);
+  if (I != valueToEdges.end()) {
+    return I->second;
+  }
+  unsigned first = edges.size();
+  for (User* U : ((Value*)V)->users()) {
+    edges.push_back(classifyUse(V, U));
+  }
+  EdgeRange R = make_pair(first, (unsigned)edges.size());
+  valueToEdges[V] = R;
+  return R;
+}
+
+// Mirrors how InfoFlowAnalysis treated each kind of user before the graph
+FlowEdge ValueFlowUtils::classifyUse(const Value* V, User* U) {
+  FlowEdge E = { NULL, NULL, FlowNone };
+  if (Constant* CS = dyn_cast<Constant>(U)) {
+    E.to = CS;
+    E.kind = FlowConstant;
+    return E;
+  }
+  Instruction* I = dyn_cast<Instruction>(U);
+  if (I == NULL) {
+    return E;
+  }
+  E.user = I;
+  if (StoreInst* SI = dyn_cast<StoreInst>(I)) {
+    // storing to V does not change V's fact
+    if (V != SI->getPointerOperand()) {
+      E.to = SI->getPointerOperand();
+      E.kind = FlowStore;
+    }
+  }
+  else if (IntrinsicInst* II = dyn_cast<IntrinsicInst>(I)) {
+    if (II->getIntrinsicID() == Intrinsic::ptr_annotation) { // covers llvm.ptr.annotation.p0i8
+      E.to = II;
+      E.kind = FlowCopy;
+    }
+    else if (MemTransferInst* MT = dyn_cast<MemTransferInst>(II)) {
+      // memcpy and memmove (e.g. struct assignment) copy the memory V points to
+      if (MT->getRawSource() == V) {
+        E.to = MT->getRawDest();
+        E.kind = FlowStore;
+      }
+    }
+  }
+  else if (CallInst* CI = dyn_cast<CallInst>(I)) {
+    E.to = CI;
+    E.kind = CallGraphUtils::isExternCall(CI) ? FlowExternCall : FlowCall;
+  }
+  else if (ReturnInst* RI = dyn_cast<ReturnInst>(I)) {
+    if (Value* RetVal = RI->getReturnValue()) {
+      E.to = RetVal;
+      E.kind = FlowReturn;
+    }
+  }
+  else if (I->isBinaryOp()) {
+    E.to = I;
+    E.kind = FlowBottom;
+  }
+  else if (isa<PHINode>(I) || isa<SelectInst>(I)) {
+    E.to = I;
+    E.kind = FlowMerge;
+  }
+  else if (GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(I)) {
+    E.to = I;
+    E.kind = FlowCopy;
+    if (GEP->getPointerOperand() == V) {
+      for (gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP); GTI != GTE; ++GTI) {
+        if (isa<StructType>(*GTI)) {
+          E.kind = FlowField;
+          break;
+        }
+      }
+    }
+  }
+  else {
+    E.to = I;
+    E.kind = FlowCopy;
+  }
+  return E;
+}
+
+EdgeRange ValueFlowUtils::getAliases(const Value* Ptr) {
+  DenseMap<const Value*,EdgeRange>::iterator I = pointerToAliases.find(Ptr);
+  if (I != pointerToAliases.end()) {
+    return I->second;
+  }
+  const Function* PtrFunc = NULL;
+  if (const Instruction* PtrInst = dyn_cast<Instruction>(Ptr)) {
+    PtrFunc = PtrInst->getParent()->getParent();
+  }
+  else if (const Argument* A = dyn_cast<Argument>(Ptr)) {
+    PtrFunc = A->getParent();
+  }
+  unsigned first = memoryEdges.size();
+  SmallPtrSet<const Value*,32> seen;
+  // pointers to the memory itself (or fields within it) come first, so that
+  // a pointer to both is not treated as only pointing to an enclosing object
+  LocationSet within = PointsToUtils::getLocationsWithin(Ptr);
+  LocationSet enclosing = PointsToUtils::getEnclosingLocations(Ptr);
+  for (int pass = 0; pass < 2; pass++) {
+    for (unsigned L : pass == 0 ? within : enclosing) {
+      for (const Value* Alias : PointsToUtils::getPointersTo(L)) {
+        if (Alias == Ptr || !seen.insert(Alias).second) continue;
+        MemoryEdge E = { Alias, NULL, false, pass == 1 };
+        if (const Instruction* AliasInst = dyn_cast<Instruction>(Alias)) {
+          E.aliasInst = (Instruction*)AliasInst;
+        }
+        else if (const Argument* A = dyn_cast<Argument>(Alias)) {
+          E.aliasInst = (Instruction*)&*A->getParent()->getEntryBlock().begin();
+        }
+        E.sameFunction = E.aliasInst != NULL && E.aliasInst->getParent()->getParent() == PtrFunc;
+        memoryEdges.push_back(E);
+      }
+    }
+  }
+  EdgeRange R = make_pair(first, (unsigned)memoryEdges.size());
+  pointerToAliases[Ptr] = R;
+  SDEBUG("soaap.util.valueflow", 4, dbgs() << "Memory edges for " << *Ptr << ": " << (R.second - R.first) << "\n")
+  return R;
+}
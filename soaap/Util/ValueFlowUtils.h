@@ -0,0 +1,74 @@
+#ifndef SOAAP_UTILS_VALUEFLOWUTILS_H
+#define SOAAP_UTILS_VALUEFLOWUTILS_H
+
+#include "Common/Typedefs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Module.h"
+
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // How a fact flows along an edge of the value-flow graph
+  enum FlowKind {
+    FlowNone,      // no flow, but user may move the value into new contexts
+    FlowConstant,  // to a constant using the value, in the same context
+    FlowCopy,      // to user (e.g. a load, cast, GEP or ptr annotation)
+    FlowField,     // to a GEP selecting a struct field within what V points to
+    FlowStore,     // to the pointer stored to, and memory that it may alias
+    FlowMerge,     // to a PHI or select, which must analyses meet over
+    FlowBottom,    // to a binary operator, which does not combine facts
+    FlowCall,      // to the params of the callees of a call, per context
+    FlowExternCall,// to the results of a call to an extern function
+    FlowReturn     // to the calls of the returning function, per context
+  };
+
+  struct FlowEdge {
+    const Value* to;
+    Instruction* user; // NULL for constant users
+    FlowKind kind;
+  };
+
+  // A pointer that may point to the same memory as another pointer
+  struct MemoryEdge {
+    const Value* alias;
+    Instruction* aliasInst; // where the alias is defined, or NULL if global
+    bool sameFunction;      // whether it is defined in the same function
+    bool enclosing;         // whether it points to an object enclosing the memory
+  };
+
+  typedef pair<unsigned,unsigned> EdgeRange; // [first, second)
+
+  // Sparse value-flow graph over which InfoFlowAnalysis propagates facts.
+  // Each value's out-edges are its def-use edges, classified once by the
+  // kind of flow along them, and each pointer's memory edges are the other
+  // pointers that may point to the same memory, fields within it or the
+  // objects enclosing it, from PointsToUtils. Edges are built the first
+  // time a value is visited and are stored contiguously, so each later
+  // visit is a scan over an array.
+  //
+  // Call and return edges only record the call or return: their targets
+  // are looked up per context, as the call graph differs between contexts
+  // and grows while function-pointer targets are being found.
+  class ValueFlowUtils {
+    public:
+      static EdgeRange getSuccessors(const Value* V);
+      static const FlowEdge& getEdge(unsigned i) { return edges[i]; }
+      static EdgeRange getAliases(const Value* Ptr);
+      static const MemoryEdge& getMemoryEdge(unsigned i) { return memoryEdges[i]; }
+      static int getNumEdges() { return edges.size(); }
+      static int getNumMemoryEdges() { return memoryEdges.size(); }
+
+    private:
+      static vector<FlowEdge> edges;
+      static DenseMap<const Value*,EdgeRange> valueToEdges;
+      static vector<MemoryEdge> memoryEdges;
+      static DenseMap<const Value*,EdgeRange> pointerToAliases;
+      static FlowEdge classifyUse(const Value* V, User* U);
+  };
+}
+
+#endif
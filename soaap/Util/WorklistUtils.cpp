@@ -0,0 +1,362 @@
+#include "Util/WorklistUtils.h"
+
+#include "Common/CmdLineOpts.h"
+#include "Common/Debug.h"
+#include "Common/XO.h"
+#include "Util/CallGraphUtils.h"
+#include "Util/SandboxUtils.h"
+#include "Util/SliceUtils.h"
+#include "Util/ValueFlowUtils.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <functional>
+#include <sys/resource.h>
+
+#define DEBUG_TYPE "soaap"
+
+using namespace soaap;
+
+STATISTIC(NumWorklistEnqueued, "Number of elements enqueued on data-flow analysis worklists");
+STATISTIC(NumWorklistDequeued, "Number of elements dequeued from data-flow analysis worklists");
+STATISTIC(NumWidenedFacts, "Number of data-flow facts widened to a conservative summary");
+
+double WorklistUtils::budgetStart = 0;
+string WorklistUtils::budgetExceeded;
+vector<WorklistUtils::PrecisionLoss> WorklistUtils::precisionLosses;
+DenseMap<const Value*,unsigned> WorklistUtils::valueRPO;
+DenseMap<const BasicBlock*,unsigned> WorklistUtils::blockRPO;
+DenseMap<const Value*,unsigned> WorklistUtils::valueTopo;
+DenseMap<const BasicBlock*,unsigned> WorklistUtils::blockTopo;
+
+namespace {
+  // Number the nodes reachable from roots by the topological order of their
+  // strongly connected components (iterative Tarjan's algorithm, which
+  // finds the components in reverse topological order)
+  template<typename NodeT>
+  void computeTopologicalOrder(const vector<NodeT>& roots, function<void(NodeT, SmallVectorImpl<NodeT>&)> succs, DenseMap<NodeT,unsigned>& order) {
+    struct Frame {
+      NodeT node;
+      SmallVector<NodeT,8> succs;
+      unsigned next;
+    };
+    DenseMap<NodeT,unsigned> index;
+    DenseMap<NodeT,unsigned> lowlink;
+    DenseSet<NodeT> onStack;
+    vector<NodeT> stack;
+    vector<Frame> callStack;
+    DenseMap<NodeT,unsigned> component;
+    unsigned nextIndex = 0;
+    unsigned numComponents = 0;
+
+    function<void(NodeT)> visit = [&](NodeT N) {
+      index[N] = lowlink[N] = nextIndex++;
+      stack.push_back(N);
+      onStack.insert(N);
+      Frame F;
+      F.node = N;
+      F.next = 0;
+      succs(N, F.succs);
+      callStack.push_back(F);
+    };
+
+    for (NodeT R : roots) {
+      if (index.count(R)) continue;
+      visit(R);
+      while (!callStack.empty()) {
+        Frame& F = callStack.back();
+        if (F.next < F.succs.size()) {
+          NodeT W = F.succs[F.next++];
+          NodeT N = F.node;
+          if (!index.count(W)) {
+            visit(W); // invalidates F
+          }
+          else if (onStack.count(W)) {
+            lowlink[N] = min(lowlink[N], index[W]);
+          }
+          continue;
+        }
+        NodeT N = F.node;
+        if (lowlink[N] == index[N]) {
+          NodeT W;
+          do {
+            W = stack.back();
+            stack.pop_back();
+            onStack.erase(W);
+            component[W] = numComponents;
+          } while (W != N);
+          numComponents++;
+        }
+        callStack.pop_back();
+        if (!callStack.empty()) {
+          NodeT P = callStack.back().node;
+          lowlink[P] = min(lowlink[P], lowlink[N]);
+        }
+      }
+    }
+
+    for (typename DenseMap<NodeT,unsigned>::iterator I = component.begin(), E = component.end(); I != E; ++I) {
+      order[I->first] = numComponents - 1 - I->second;
+    }
+  }
+}
+
+unsigned WorklistUtils::getPriority(const Value* V, Module& M) {
+  if (CmdLineOpts::Worklist == WorklistPolicy::SCC) {
+    if (valueTopo.empty()) {
+      computeValueTopologicalOrder(M);
+    }
+    DenseMap<const Value*,unsigned>::iterator I = valueTopo.find(V);
+    return I == valueTopo.end() ? 0 : I->second;
+  }
+  if (const Instruction* Inst = dyn_cast<Instruction>(V)) {
+    DenseMap<const Value*,unsigned>::iterator I = valueRPO.find(Inst);
+    if (I == valueRPO.end()) {
+      numberFunction(Inst->getParent()->getParent());
+      I = valueRPO.find(Inst);
+    }
+    return I == valueRPO.end() ? 0 : I->second; // 0 if unreachable
+  }
+  return 0; // arguments, globals and constants come first
+}
+
+unsigned WorklistUtils::getPriority(const BasicBlock* BB, Module& M) {
+  if (CmdLineOpts::Worklist == WorklistPolicy::SCC) {
+    if (blockTopo.empty()) {
+      computeBlockTopologicalOrder(M);
+    }
+    DenseMap<const BasicBlock*,unsigned>::iterator I = blockTopo.find(BB);
+    return I == blockTopo.end() ? 0 : I->second;
+  }
+  DenseMap<const BasicBlock*,unsigned>::iterator I = blockRPO.find(BB);
+  if (I == blockRPO.end()) {
+    numberFunction(BB->getParent());
+    I = blockRPO.find(BB);
+  }
+  return I == blockRPO.end() ? 0 : I->second;
+}
+
+void WorklistUtils::numberFunction(const Function* F) {
+  if (F->isDeclaration() || blockRPO.count(&F->getEntryBlock())) {
+    return;
+  }
+  unsigned blockIdx = 0;
+  unsigned instIdx = 0;
+  ReversePostOrderTraversal<const Function*> RPOT(F);
+  for (ReversePostOrderTraversal<const Function*>::rpo_iterator I = RPOT.begin(), E = RPOT.end(); I != E; ++I) {
+    const BasicBlock* BB = *I;
+    blockRPO[BB] = blockIdx++;
+    for (const Instruction& Inst : *BB) {
+      valueRPO[&Inst] = instIdx++;
+    }
+  }
+}
+
+// Successors in the value-flow graph (see InfoFlowAnalysis), with calls and
+// returns resolved in any context
+void WorklistUtils::computeValueTopologicalOrder(Module& M) {
+  vector<const Value*> roots;
+  for (GlobalVariable& G : M.globals()) {
+    roots.push_back(&G);
+  }
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    for (Argument& A : F->getArgumentList()) {
+      roots.push_back(&A);
+    }
+    for (BasicBlock& BB : *F) {
+      for (Instruction& I : BB) {
+        roots.push_back(&I);
+      }
+    }
+  }
+  function<void(const Value*, SmallVectorImpl<const Value*>&)> succs = [&M](const Value* V, SmallVectorImpl<const Value*>& result) {
+    EdgeRange R = ValueFlowUtils::getSuccessors(V);
+    for (unsigned i = R.first; i != R.second; i++) {
+      FlowEdge E = ValueFlowUtils::getEdge(i);
+      switch (E.kind) {
+        case FlowNone:
+          break;
+        case FlowCall: {
+          CallInst* CI = cast<CallInst>(E.user);
+          for (Function* Callee : CallGraphUtils::getCallees(CI, NULL, M)) {
+            for (Argument& A : Callee->getArgumentList()) {
+              result.push_back(&A);
+            }
+          }
+          break;
+        }
+        case FlowReturn:
+          for (CallInst* CI : CallGraphUtils::getCallers(E.user->getParent()->getParent(), NULL, M)) {
+            result.push_back(CI);
+          }
+          break;
+        case FlowExternCall: {
+          CallInst* CI = cast<CallInst>(E.user);
+          result.push_back(CI);
+          if (CI->getNumArgOperands() > 0) {
+            result.push_back(CI->getArgOperand(0));
+          }
+          break;
+        }
+        default:
+          result.push_back(E.to);
+          if (E.kind == FlowStore) {
+            EdgeRange A = ValueFlowUtils::getAliases(E.to);
+            for (unsigned j = A.first; j != A.second; j++) {
+              result.push_back(ValueFlowUtils::getMemoryEdge(j).alias);
+            }
+          }
+          break;
+      }
+    }
+  };
+  computeTopologicalOrder<const Value*>(roots, succs, valueTopo);
+  SDEBUG("soaap.util.worklist", 3, dbgs() << "Numbered " << valueTopo.size() << " values in topological order\n")
+}
+
+// Successors in the interprocedural CFG (see CFGFlowAnalysis)
+void WorklistUtils::computeBlockTopologicalOrder(Module& M) {
+  vector<const BasicBlock*> roots;
+  if (Function* MainFn = M.getFunction("main")) {
+    if (!MainFn->isDeclaration()) {
+      roots.push_back(&MainFn->getEntryBlock());
+    }
+  }
+  for (Function* F : SliceUtils::getFunctions(M)) {
+    for (BasicBlock& BB : *F) {
+      roots.push_back(&BB);
+    }
+  }
+  function<void(const BasicBlock*, SmallVectorImpl<const BasicBlock*>&)> succs = [&M](const BasicBlock* BB, SmallVectorImpl<const BasicBlock*>& result) {
+    for (succ_const_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI) {
+      result.push_back(*SI);
+    }
+    for (const Instruction& I : *BB) {
+      if (const CallInst* CI = dyn_cast<CallInst>(&I)) {
+        if (isa<IntrinsicInst>(CI)) continue;
+        for (Function* Callee : CallGraphUtils::getCallees(CI, NULL, M)) {
+          if (!Callee->isDeclaration() && !SandboxUtils::isSandboxEntryPoint(M, Callee)) {
+            result.push_back(&Callee->getEntryBlock());
+          }
+        }
+      }
+      else if (isa<ReturnInst>(&I)) {
+        for (CallInst* CI : CallGraphUtils::getCallers(BB->getParent(), NULL, M)) {
+          result.push_back(CI->getParent());
+        }
+      }
+    }
+  };
+  computeTopologicalOrder<const BasicBlock*>(roots, succs, blockTopo);
+  SDEBUG("soaap.util.worklist", 3, dbgs() << "Numbered " << blockTopo.size() << " basic blocks in topological order\n")
+}
+
+string WorklistUtils::stringifyPolicy(WorklistPolicy policy) {
+  switch (policy) {
+    case WorklistPolicy::FIFO: return "fifo";
+    case WorklistPolicy::LIFO: return "lifo";
+    case WorklistPolicy::Hybrid: return "hybrid";
+    case WorklistPolicy::RPO: return "rpo";
+    case WorklistPolicy::SCC: return "scc";
+  }
+  return "unknown";
+}
+
+void WorklistUtils::recordStats(WorklistPolicy policy, unsigned enqueued, unsigned dequeued) {
+  NumWorklistEnqueued += enqueued;
+  NumWorklistDequeued += dequeued;
+  SDEBUG("soaap.util.worklist", 1, dbgs() << "Fixpoint reached after " << dequeued << " dequeues (" << enqueued << " enqueues, " << stringifyPolicy(policy) << " worklist)\n")
+}
+
+void WorklistUtils::recordWidened(unsigned widened) {
+  NumWidenedFacts += widened;
+}
+
+static double getTime() {
+  return TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+// Peak resident set size of the process in bytes. Heap statistics (e.g.
+// mallinfo) wrap above 2 GB on glibc, and don't count jemalloc's heap on
+// FreeBSD.
+static uint64_t getPeakResidentMemory() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+void WorklistUtils::startBudget() {
+  budgetStart = getTime();
+  budgetExceeded.clear();
+}
+
+bool WorklistUtils::isOverBudget(string& budget) {
+  if (budgetExceeded.empty()) {
+    if (CmdLineOpts::TimeBudget > 0 && getTime() - budgetStart > (double)CmdLineOpts::TimeBudget) {
+      budgetExceeded = "time";
+    }
+    else if (CmdLineOpts::MemoryBudget > 0 && getPeakResidentMemory() > (uint64_t)CmdLineOpts::MemoryBudget * 1024 * 1024) {
+      budgetExceeded = "memory";
+    }
+    else {
+      return false;
+    }
+    SDEBUG("soaap.util.worklist", 1, dbgs() << "Over " << budgetExceeded << " budget\n")
+  }
+  budget = budgetExceeded;
+  return true;
+}
+
+void WorklistUtils::noteOverBudget(string analysis, string budget) {
+  PrecisionLoss loss;
+  loss.analysis = analysis;
+  loss.budget = budget;
+  loss.numValues = 0;
+  precisionLosses.push_back(loss);
+}
+
+void WorklistUtils::noteWidened(string analysis, string function, int numValues) {
+  PrecisionLoss loss;
+  loss.analysis = analysis;
+  loss.function = function;
+  loss.numValues = numValues;
+  precisionLosses.push_back(loss);
+}
+
+void WorklistUtils::emitPrecisionLoss() {
+  if (precisionLosses.empty()) {
+    return;
+  }
+  XO::open_list("precision_loss");
+  for (PrecisionLoss& loss : precisionLosses) {
+    XO::open_instance("precision_loss");
+    if (!loss.budget.empty()) {
+      XO::emit(" *** The {:analysis/%s} analysis ran over the {:budget/%s} budget "
+               "and widened every pending fact and every fact updated since\n",
+               loss.analysis.c_str(), loss.budget.c_str());
+    }
+    else if (loss.function.empty()) {
+      XO::emit(" *** Facts for {:num_values/%d} global value(s) were widened by "
+               "the {:analysis/%s} analysis\n", loss.numValues, loss.analysis.c_str());
+    }
+    else {
+      XO::emit(" *** Facts for {:num_values/%d} value(s) in function \"{:function/%s}\" "
+               "were widened by the {:analysis/%s} analysis\n", loss.numValues,
+               loss.function.c_str(), loss.analysis.c_str());
+    }
+    XO::close_instance("precision_loss");
+  }
+  XO::close_list("precision_loss");
+  precisionLosses.clear();
+}
@@ -0,0 +1,67 @@
+#ifndef SOAAP_UTILS_WORKLISTUTILS_H
+#define SOAAP_UTILS_WORKLISTUTILS_H
+
+#include "ADT/QueueSet.h"
+#include "Common/Typedefs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Module.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace std;
+
+namespace soaap {
+  // Priorities for the RPO and SCC worklist policies (see QueueSet),
+  // statistics about how many elements the analyses' worklists needed to
+  // reach their fixpoints, and the time and memory budgets they must reach
+  // them within.
+  class WorklistUtils {
+    public:
+      // Position of V in its function (in reverse post-order of its basic
+      // blocks) under the RPO policy, or topological index of V's strongly
+      // connected component of the value-flow graph under the SCC policy.
+      static unsigned getPriority(const Value* V, Module& M);
+      // As above, but of BB in its function's CFG, or in the
+      // interprocedural CFG.
+      static unsigned getPriority(const BasicBlock* BB, Module& M);
+      static string stringifyPolicy(WorklistPolicy policy);
+      static void recordStats(WorklistPolicy policy, unsigned enqueued, unsigned dequeued);
+      static void recordWidened(unsigned widened);
+      // Start the time budget of a run. Every solver in the run shares it.
+      static void startBudget();
+      // Whether the run has gone over -soaap-time-budget or
+      // -soaap-memory-budget. If so, budget is set to "time" or "memory".
+      // Once over, it stays over until the next startBudget.
+      static bool isOverBudget(string& budget);
+      // Note that the named analysis lost precision by running over budget,
+      // or by widening the facts of numValues values in function (global
+      // values if function is empty).
+      static void noteOverBudget(string analysis, string budget);
+      static void noteWidened(string analysis, string function, int numValues);
+      // Report the precision lost during the run as one list, so that
+      // warnings caused by it can be told apart.
+      static void emitPrecisionLoss();
+
+    private:
+      struct PrecisionLoss {
+        string analysis;
+        string budget; // empty if values were widened
+        string function;
+        int numValues;
+      };
+      static double budgetStart;
+      static string budgetExceeded;
+      static vector<PrecisionLoss> precisionLosses;
+      static DenseMap<const Value*,unsigned> valueRPO;
+      static DenseMap<const BasicBlock*,unsigned> blockRPO;
+      static DenseMap<const Value*,unsigned> valueTopo;
+      static DenseMap<const BasicBlock*,unsigned> blockTopo;
+      static void numberFunction(const Function* F);
+      static void computeValueTopologicalOrder(Module& M);
+      static void computeBlockTopologicalOrder(Module& M);
+  };
+}
+
+#endif
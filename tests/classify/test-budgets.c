@@ -0,0 +1,38 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-time-budget=3600 -o %t.soaap.ll %t.ll > %t.time.out
+ * RUN: FileCheck %s -check-prefix=TIME -input-file %t.time.out
+ * RUN: soaap --soaap-memory-budget=1 -o %t.soaap.ll %t.ll > %t.memory.out
+ * RUN: FileCheck %s -check-prefix=MEMORY -input-file %t.memory.out
+ *
+ * Within budget, the results are as precise as without one. SOAAP's
+ * resident set is always more than a megabyte (on every platform), so with
+ * that budget every fact is widened as soon as the analyses start, and the
+ * report says so.
+ *
+ * TIME-NOT: ran over the
+ * TIME: data value of class: [secret] but
+ * TIME-NOT: ran over the
+ *
+ * MEMORY: data value of class: [{{secret,other|other,secret}}] but
+ * MEMORY: *** The classified analysis ran over the memory budget and widened every pending fact and every fact updated since
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+int unrelated __soaap_classify("other");
+
+void dostuff();
+
+int main() {
+  sensitive = 25;
+  unrelated = 42;
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  int s = sensitive;
+  int y = s;
+}
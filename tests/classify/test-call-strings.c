@@ -0,0 +1,37 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-call-string-depth=1 -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * id() is called twice within the same sandbox. With call strings, the
+ * private value passed to the first call is only returned to that call.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: may leak private data through global variable x
+ * CHECK-NOT: may leak private data through global variable w
+ */
+#include "soaap.h"
+
+int x;
+int w;
+
+void dostuff();
+
+int id(int p) {
+  return p;
+}
+
+int main() {
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  int y __soaap_private("network");
+  y = 25;
+  int z = id(y);
+  int v = id(0);
+  x = z;
+  w = v;
+}
@@ -0,0 +1,46 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll %t.ll > %t.full.out
+ * RUN: soaap --soaap-demand-driven -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ * RUN: grep -e '\*\*\*' -e '+++' %t.full.out > %t.full.warnings
+ * RUN: grep -e '\*\*\*' -e '+++' %t.out > %t.warnings
+ * RUN: diff %t.full.warnings %t.warnings
+ *
+ * Classified and sandbox-private data that reaches a sandbox is still found
+ * when only values flowing to the checked loads, stores and calls are
+ * propagated, and the warnings are the same as when every value is. The
+ * classified "unused" never reaches one.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK-NOT: class: [unused]
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+int unused __soaap_classify("unused");
+int x;
+
+void dostuff();
+
+int main() {
+  sensitive = 25;
+  unused = 42;
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  /*
+   * CHECK: *** Sandboxed method "dostuff" read
+   * CHECK:     data value of class: [secret] but
+   * CHECK:     only has clearances for: []
+   */
+  int s = sensitive;
+  int y __soaap_private("network");
+  y = s;
+  int z = y;
+  // CHECK: [network] may leak private data through global variable x
+  x = z;
+}
@@ -0,0 +1,39 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+#include <stdio.h>
+
+struct creds {
+  int uid;
+  char* password;
+};
+
+void dostuff();
+
+int main() {
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("box")
+void dostuff() {
+  char* password __soaap_private("box");
+  struct creds c;
+  password = "mypass";
+  c.uid = 0;
+  c.password = password;
+
+  // the other fields of the struct are not private
+  // CHECK-NOT: through the extern function "printf"
+  printf("uid is: %d\n", c.uid);
+
+  // but the struct as a whole is
+  // CHECK: "dostuff" executing in sandboxes: [box]
+  // CHECK: may leak private data through the extern function "fwrite"
+  fwrite(&c, sizeof(c), 1, stdout);
+}
@@ -0,0 +1,72 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -check-prefix=PRECISE -input-file %t.out
+ * RUN: soaap --soaap-widen-after=1 -o %t.soaap.ll %t.ll > %t.widened.out
+ * RUN: FileCheck %s -input-file %t.widened.out
+ * RUN: soaap --soaap-widen-after=1 --soaap-report-output-formats=json --soaap-report-file-prefix=%t -o %t.soaap.ll %t.ll > /dev/null
+ * RUN: FileCheck %s -check-prefix=JSON -input-file %t.json
+ *
+ * The secret moves around the loop from r to s to t and back, so their
+ * facts change on several visits. Widening after a single update makes
+ * every value that classified data reaches hold data of every class, and
+ * the report says where this happened.
+ *
+ * PRECISE: data value of class: [secret] but
+ * PRECISE-NOT: were widened
+ *
+ * Every analysis's precision loss is reported in a single list.
+ *
+ * JSON: "precision_loss": [
+ * JSON: "analysis": "classified"
+ * JSON-NOT: "precision_loss"
+ *
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+int unrelated __soaap_classify("other");
+
+void dostuff();
+
+int oscillate(int a, int n) {
+  int r = a;
+  int s = 0;
+  int t = 0;
+  for (int i = 0; i < n; i++) {
+    switch (i % 3) {
+      case 0:
+        s = r;
+        break;
+      case 1:
+        t = s;
+        break;
+      default:
+        r = t;
+        break;
+    }
+  }
+  return r;
+}
+
+int main() {
+  sensitive = 25;
+  unrelated = 42;
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  /*
+   * CHECK: *** Sandboxed method "dostuff" read
+   * CHECK:     data value of class: [{{secret,other|other,secret}}] but
+   * CHECK:     only has clearances for: []
+   */
+  int s = oscillate(sensitive, 6);
+  int y = s;
+}
+
+// CHECK-DAG: *** Facts for {{[0-9]+}} value(s) in function "oscillate" were widened by the classified analysis
+// CHECK-DAG: *** Facts for {{[0-9]+}} value(s) in function "dostuff" were widened by the classified analysis
@@ -0,0 +1,58 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-worklist=lifo -o %t.soaap.ll %t.ll > %t.lifo.out
+ * RUN: FileCheck %s -input-file %t.lifo.out
+ * RUN: FileCheck %s -check-prefix=LIFO -input-file %t.lifo.out
+ * RUN: soaap --soaap-worklist=hybrid -o %t.soaap.ll %t.ll > %t.hybrid.out
+ * RUN: FileCheck %s -input-file %t.hybrid.out
+ * RUN: soaap --soaap-worklist=rpo -o %t.soaap.ll %t.ll > %t.rpo.out
+ * RUN: FileCheck %s -input-file %t.rpo.out
+ * RUN: soaap --soaap-worklist=scc -o %t.soaap.ll %t.ll > %t.scc.out
+ * RUN: FileCheck %s -input-file %t.scc.out
+ *
+ * The order in which worklists are visited does not change the fixpoint,
+ * only the work done to reach it (see test-worklist-statistics.c).
+ *
+ * LIFO: Running Soaap Pass with the lifo worklist
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+int x;
+
+void dostuff();
+
+// the secret rotates through the loop's values, so it takes several visits
+// of the loop to reach r
+int rotate(int a, int b, int c, int n) {
+  int r = 0;
+  while (n-- > 0) {
+    int t = a;
+    a = b;
+    b = c;
+    c = t;
+    r = a;
+  }
+  return r;
+}
+
+int main() {
+  sensitive = 25;
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  /*
+   * CHECK: *** Sandboxed method "dostuff" read
+   * CHECK:     data value of class: [secret] but
+   * CHECK:     only has clearances for: []
+   */
+  int s = rotate(0, 0, sensitive, 3);
+  int y __soaap_private("network");
+  y = s;
+  // CHECK: [network] may leak private data through global variable x
+  x = y;
+}
@@ -0,0 +1,42 @@
+/*
+ * REQUIRES: asserts
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -stats --soaap-worklist=lifo -o %t.soaap.ll %t.ll 2> %t.lifo.stats
+ * RUN: FileCheck %s -input-file %t.lifo.stats
+ * RUN: soaap -stats --soaap-worklist=hybrid -o %t.soaap.ll %t.ll 2> %t.hybrid.stats
+ * RUN: FileCheck %s -input-file %t.hybrid.stats
+ * RUN: soaap -stats --soaap-worklist=rpo -o %t.soaap.ll %t.ll 2> %t.rpo.stats
+ * RUN: FileCheck %s -input-file %t.rpo.stats
+ * RUN: soaap -stats --soaap-worklist=scc -o %t.soaap.ll %t.ll 2> %t.scc.stats
+ * RUN: FileCheck %s -input-file %t.scc.stats
+ *
+ * Every worklist policy counts the elements it visits. LLVM only keeps
+ * statistics in builds with assertions.
+ *
+ * CHECK: {{[1-9][0-9]*}} soaap - Number of elements dequeued from data-flow analysis worklists
+ * CHECK: {{[1-9][0-9]*}} soaap - Number of elements enqueued on data-flow analysis worklists
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+
+void dostuff();
+
+int sum(int a, int n) {
+  int r = 0;
+  while (n-- > 0) {
+    r += a;
+  }
+  return r;
+}
+
+int main() {
+  sensitive = 25;
+  dostuff();
+  return 0;
+}
+
+__soaap_sandbox_persistent("network")
+void dostuff() {
+  int s = sum(sensitive, 3);
+}
@@ -0,0 +1,63 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: rm -f %t.sock
+ * RUN: sh -c 'soaap -soaap-pedantic -soaap-daemon=%t.sock %t.ll > %t.daemon.out 2>&1 & echo $! > %t.pid'
+ * RUN: sh -c 'i=0; while [ ! -S %t.sock ] && [ $i -lt 300 ]; do sleep 0.1; i=$((i+1)); done'
+ * RUN: soaap-client %t.sock -soaap-analyses=globals > %t.globals.out
+ * RUN: soaap-client %t.sock -soaap-analyses=privcalls > %t.privcalls.out
+ * RUN: not soaap-client %t.sock -soaap-pedantic > %t.repeated.out
+ * RUN: not soaap-client %t.sock %t.ll > %t.input.out
+ * RUN: not soaap-client %t.sock -soaap-context-insens > %t.prepared.out
+ * RUN: touch -t 203001010000 %t.ll
+ * RUN: soaap-client %t.sock -soaap-analyses=globals > %t.reloaded.out
+ * RUN: kill `cat %t.pid`
+ * RUN: FileCheck %s -check-prefix=GLOBALS -input-file %t.globals.out
+ * RUN: FileCheck %s -check-prefix=PRIVCALLS -input-file %t.privcalls.out
+ * RUN: FileCheck %s -check-prefix=REPEATED -input-file %t.repeated.out
+ * RUN: FileCheck %s -check-prefix=INPUT -input-file %t.input.out
+ * RUN: FileCheck %s -check-prefix=PREPARED -input-file %t.prepared.out
+ * RUN: FileCheck %s -check-prefix=GLOBALS -input-file %t.reloaded.out
+ * RUN: FileCheck %s -check-prefix=DAEMON -input-file %t.daemon.out
+ *
+ * Each request runs only the analyses it asks for, on top of the options
+ * that the daemon was started with and the callgraph that it prepared. The
+ * daemon re-executes itself to reload its input once it has changed.
+ *
+ * GLOBALS: Running Soaap Pass
+ * GLOBALS: Reusing the prepared sandboxes and callgraph
+ * GLOBALS: *** Sandboxed method "foo" [sandbox] wrote to global variable "x"
+ * GLOBALS-NOT: calls privileged function
+ *
+ * PRIVCALLS: Running Soaap Pass
+ * PRIVCALLS-NOT: global variable "x"
+ * PRIVCALLS: *** Sandbox "sandbox" calls privileged function "bar"
+ *
+ * REPEATED: option was already given when the daemon was started: "-soaap-pedantic"
+ * INPUT: input files are fixed by the daemon
+ * PREPARED: option changes the callgraph that the daemon prepares, so must be given when it is started: "-soaap-context-insens"
+ *
+ * DAEMON: Finding sandboxes
+ * DAEMON: Serving requests on
+ * DAEMON: Reloading changed input
+ * DAEMON: Finding sandboxes
+ * DAEMON: Serving requests on
+ */
+#include "soaap.h"
+
+int x = 0;
+
+__soaap_privileged
+void bar() {
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  x = 1;
+  bar();
+}
+
+int main(int argc, char** argv) {
+  __soaap_create_persistent_sandbox("sandbox");
+  foo();
+  return 0;
+}
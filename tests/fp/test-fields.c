@@ -0,0 +1,53 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-infer-fp-targets --soaap-list-fp-targets %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * Function pointers stored in different fields of the same struct do not
+ * flow into each other, even when the struct is accessed through a
+ * pointer in another function.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: Function "call_a"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: {{.*}}:
+ * CHECK-NEXT: fa (inferred)
+ * CHECK-NOT: fb (inferred)
+ * CHECK: Function "call_b"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: {{.*}}:
+ * CHECK-NEXT: fb (inferred)
+ * CHECK-NOT: fa (inferred)
+ * CHECK: 2 function-pointer calls in total
+ */
+#include "soaap.h"
+
+struct ops {
+  void (*a)(void);
+  void (*b)(void);
+};
+
+void fa(void) {
+}
+
+void fb(void) {
+}
+
+void call_a(struct ops* o) {
+  o->a();
+}
+
+void call_b(struct ops* o) {
+  o->b();
+}
+
+int main(int argc, char** argv) {
+  struct ops o;
+  o.a = fa;
+  o.b = fb;
+  call_a(&o);
+  call_b(&o);
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-points-to-fp-targets --soaap-list-fp-targets %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * Targets are resolved through a struct assignment (llvm.memcpy), a
+ * round trip through an integer and a struct returned by value.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: Function "call_copy"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: [<privileged>]:
+ * CHECK-NEXT: fa (points-to)
+ * CHECK-NOT: fb (points-to)
+ * CHECK: Function "call_int"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: [<privileged>]:
+ * CHECK-NEXT: fb (points-to)
+ * CHECK: Function "main"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: [<privileged>]:
+ * CHECK-NEXT: fc (points-to)
+ * CHECK: 3 function-pointer calls in total
+ */
+#include "soaap.h"
+#include <stdint.h>
+
+struct ops {
+  void (*a)(void);
+  void (*b)(void);
+};
+
+struct pair {
+  void (*fn)(void);
+  long n;
+};
+
+void fa(void) {
+}
+
+void fb(void) {
+}
+
+void fc(void) {
+}
+
+void call_copy(struct ops* o) {
+  o->a();
+}
+
+void call_int(uintptr_t p) {
+  ((void (*)(void))p)();
+}
+
+struct pair make_pair(void) {
+  struct pair p = { fc, 0 };
+  return p;
+}
+
+int main(int argc, char** argv) {
+  struct ops o, copy;
+  o.a = fa;
+  o.b = fb;
+  copy = o;
+  call_copy(&copy);
+  call_int((uintptr_t)fb);
+  make_pair().fn();
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-points-to-fp-targets --soaap-list-fp-targets %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * Targets are resolved through a global table of handlers and a function
+ * returning one of them.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: Function "main"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: [<privileged>]:
+ * CHECK-DAG: fa (points-to)
+ * CHECK-DAG: fb (points-to)
+ * CHECK-NOT: fc (points-to)
+ * CHECK: 1 function-pointer calls in total
+ */
+#include "soaap.h"
+
+struct handler {
+  const char* name;
+  void (*fn)(void);
+};
+
+void fa(void) {
+}
+
+void fb(void) {
+}
+
+void fc(void) {
+}
+
+static struct handler handlers[] = {
+  { "a", fa },
+  { "b", fb }
+};
+
+void (*unused)(void) = fc;
+
+void (*lookup(int i))(void) {
+  return handlers[i].fn;
+}
+
+int main(int argc, char** argv) {
+  void (*f)(void) = lookup(argc);
+  f();
+  return 0;
+}
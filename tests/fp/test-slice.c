@@ -0,0 +1,44 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-infer-fp-targets --soaap-list-fp-calls %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ * RUN: soaap --soaap-infer-fp-targets --soaap-list-fp-calls --soaap-no-slicing %t.ll > %t.noslice.out
+ * RUN: FileCheck %s -check-prefix=NOSLICE -input-file %t.noslice.out
+ *
+ * unreachable() can't be reached from main() or the sandbox, so it is sliced
+ * away before the function-pointer calls are listed.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: Sliced
+ * CHECK: call:
+ * CHECK-NOT: unreachable
+ * CHECK: 1 function-pointer calls in total
+ *
+ * NOSLICE: unreachable:
+ * NOSLICE: 2 function-pointer calls in total
+ */
+#include "soaap.h"
+
+void (*myfp)();
+
+void f1() {
+}
+
+void call() {
+  myfp();
+}
+
+void unreachable() {
+  myfp();
+}
+
+__soaap_sandbox_persistent("box")
+void sandbox() {
+  call();
+}
+
+int main(int argc, char** argv) {
+  myfp = f1;
+  sandbox();
+  return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-fp-type-fallback --soaap-list-fp-targets %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * The handler is read from memory that no analysis tracks, so the call falls
+ * back to the address-taken functions of the same type.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: Function "main"
+ * CHECK-NEXT: Call at
+ * CHECK-NEXT: Targets:
+ * CHECK-NEXT: [<privileged>]:
+ * CHECK-DAG: fa (type-compatible)
+ * CHECK-DAG: fb (type-compatible)
+ * CHECK-NOT: fc (type-compatible)
+ * CHECK: 1 function-pointer calls in total
+ */
+#include "soaap.h"
+
+extern void* lookup(int i);
+
+void fa(int x) {
+}
+
+void fb(int x) {
+}
+
+int fc(void) {
+  return 0;
+}
+
+void (*ha)(int) = fa;
+void (*hb)(int) = fb;
+int (*hc)(void) = fc;
+
+int main(int argc, char** argv) {
+  void (*f)(int) = (void (*)(int))lookup(argc);
+  f(argc);
+  return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll --soaap-analyses=infoflow --soaap-report-output-formats=binary --soaap-report-file-prefix=%t %t.ll > %t.out
+ * RUN: soaap-query -label=secret %t.soaap.bin | FileCheck %s
+ * RUN: soaap-query -label=other -count %t.soaap.bin | FileCheck %s -check-prefix=OTHER
+ * RUN: soaap-query -label=unused -count %t.soaap.bin | FileCheck %s -check-prefix=NONE
+ *
+ * Warnings are indexed by each class of data that they report.
+ *
+ * CHECK: classified_warning at {{.*}}binary-labels.c:35
+ * CHECK-NEXT:   function: dostuff
+ * CHECK: data_class.name: secret
+ * CHECK-NOT: classified_warning
+ *
+ * OTHER: 1
+ * NONE: 0
+ */
+#include "soaap.h"
+
+int sensitive __soaap_classify("secret");
+int unrelated __soaap_classify("other");
+
+void dostuff();
+void other();
+
+int main(int argc, char** argv) {
+  sensitive = argc;
+  unrelated = argc;
+  dostuff();
+  other();
+  return 0;
+}
+
+__soaap_sandbox_persistent("box")
+void dostuff() {
+  int y = sensitive;
+}
+
+__soaap_sandbox_persistent("otherbox")
+void other() {
+  int z = unrelated;
+}
@@ -0,0 +1,34 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll --soaap-analyses=syscalls --soaap-output-traces=syscalls --soaap-report-output-formats=binary --soaap-report-file-prefix=%t %t.ll > %t.out
+ * RUN: soaap-query -sandbox=sandbox -traces %t.soaap.bin | FileCheck %s
+ * RUN: soaap-query -function=main -file=binary.c -count %t.soaap.bin | FileCheck %s -check-prefix=MATCH
+ * RUN: soaap-query -sandbox=sandbox -function=bar -count %t.soaap.bin | FileCheck %s -check-prefix=NOMATCH
+ *
+ * CHECK: syscall_warning in sandbox "sandbox" at {{.*}}binary.c:33
+ * CHECK-NEXT:   sandbox: sandbox
+ * CHECK-NEXT:   syscall: open
+ * CHECK-NEXT:   location.line: 33
+ * CHECK-NEXT:   location.file: {{.*}}binary.c
+ * CHECK-NEXT:   trace_id: 1
+ * CHECK-NEXT:   trace:
+ * CHECK-NEXT:     foo (binary.c:33)
+ * CHECK-NEXT:     main (binary.c:27)
+ *
+ * MATCH: 1
+ * NOMATCH: 0
+ */
+#include "soaap.h"
+#include <fcntl.h>
+
+void foo();
+
+int main(int argc, char** argv) {
+  foo();
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  open("somefile", O_RDONLY);
+}
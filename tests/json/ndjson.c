@@ -0,0 +1,26 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll --soaap-analyses=syscalls --soaap-output-traces=syscalls --soaap-report-output-formats=ndjson --soaap-report-file-prefix=%t %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.ndjson
+ *
+ * Each warning is a single line, and the nodes of its trace are separate
+ * records that precede it.
+ *
+ * CHECK: {"type":"trace_node","id":0,"parent":-1,"function":"main","location":{"file":"ndjson.c","line":19}}
+ * CHECK-NEXT: {"type":"trace_node","id":1,"parent":0,"function":"foo","location":{"file":"ndjson.c","line":25}}
+ * CHECK-NEXT: {"type":"syscall_warning","sandbox":"sandbox","syscall":"open","location":{"line":25,"file":"{{.*}}ndjson.c"},"trace_id":1}
+ */
+#include "soaap.h"
+#include <fcntl.h>
+
+void foo();
+
+int main(int argc, char** argv) {
+  foo();
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  open("somefile", O_RDONLY);
+}
@@ -0,0 +1,9 @@
+#include <fcntl.h>
+
+void bar() {
+  open("somefile", O_CREAT);
+}
+
+void unused() {
+  open("otherfile", O_CREAT);
+}
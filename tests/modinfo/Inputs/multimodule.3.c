@@ -0,0 +1,7 @@
+#include <fcntl.h>
+
+static const char* path = "thirdfile";
+
+void alsounused() {
+  open(path, O_CREAT);
+}
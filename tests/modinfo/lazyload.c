@@ -0,0 +1,43 @@
+/*
+ * RUN: clang %cflags -emit-llvm -c %s -o %t.bc
+ * RUN: soaap --soaap-sandbox-platform=annotated -S -o %t.ll %t.bc > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ * RUN: FileCheck %s -check-prefix=OUTPUT -input-file %t.ll
+ *
+ * Only the bodies reachable from main() are parsed before the analysis runs,
+ * but the written module still contains unused(). handler() is only named in
+ * an annotation, so its body is parsed once it becomes a callee of fp.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK-DAG: *** Sandbox "sandbox" performs system call "open" but it is not allowed to,
+ * CHECK-DAG: *** Sandbox "sandbox" performs system call "getpid" but it is not allowed to,
+ *
+ * OUTPUT: define {{.*}}@unused(
+ */
+#include "soaap.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+void foo();
+extern void (*callback)(void);
+
+int main(int argc, char** argv) {
+  foo();
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  __soaap_limit_syscalls(read, write);
+  open("file", O_RDONLY);
+  __soaap_fp(handler) void (*fp)(void) = callback;
+  fp();
+}
+
+void handler(void) {
+  getpid();
+}
+
+int unused(int x) {
+  return x + 1;
+}
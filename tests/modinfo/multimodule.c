@@ -0,0 +1,41 @@
+/*
+ * RUN: clang %cflags -emit-llvm -c %s -o %t.1.bc
+ * RUN: clang %cflags -emit-llvm -c %S/Inputs/multimodule.2.c -o %t.2.bc
+ * RUN: clang %cflags -emit-llvm -c %S/Inputs/multimodule.3.c -o %t.3.bc
+ * RUN: soaap --soaap-sandbox-platform=annotated %t.1.bc %t.2.bc %t.3.bc > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ * RUN: echo %t.1.bc %t.2.bc > %t.rsp
+ * RUN: soaap --soaap-sandbox-platform=annotated @%t.rsp > %t.rsp.out
+ * RUN: FileCheck %s -input-file %t.rsp.out
+ * RUN: soaap --soaap-list-all-funcs %t.1.bc %t.2.bc %t.3.bc > %t.funcs
+ * RUN: FileCheck %s -check-prefix=FUNCS -input-file %t.funcs
+ *
+ * The modules are linked by soaap itself, so the system call made by bar()
+ * in the other module is found. unused() is never called, so its body is
+ * dropped before linking. Nothing in the third module is live, so it isn't
+ * linked at all.
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: *** Sandbox "sandbox" performs system call "open" but it is not allowed to,
+ * CHECK: +++ Line 4 of file {{.*}}multimodule.2.c
+ *
+ * FUNCS: Running Soaap Pass
+ * FUNCS-NOT: {{^}}{{unused|alsounused}}{{$}}
+ * FUNCS: {{^}}bar{{$}}
+ * FUNCS-NOT: {{^}}{{unused|alsounused}}{{$}}
+ */
+#include "soaap.h"
+
+void foo();
+void bar();
+
+int main(int argc, char** argv) {
+  foo();
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  __soaap_limit_syscalls(read, write);
+  bar();
+}
@@ -0,0 +1,54 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-sandbox-platform=annotated --soaap-query=sandboxes:helper --soaap-query=syscalls:box --soaap-query=classified:query.c:52 --soaap-query=path:box:helper %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * CHECK: Running Soaap Pass
+ * CHECK: * Answering queries
+ * CHECK: Query "sandboxes:helper":
+ * CHECK:  Function "helper" can run in 1 sandbox(es)
+ * CHECK:    box
+ * CHECK: Query "syscalls:box":
+ * CHECK:  Sandbox "box" performs 1 system call(s):
+ * CHECK:    read
+ * CHECK:  File descriptors used:
+ * CHECK:    "fd" passed to read
+ * CHECK: Query "classified:query.c:52":
+ * CHECK:  Classified data that can flow to line 52 of file query.c: [secret]
+ * CHECK: Query "path:box:helper":
+ * CHECK:  Shortest path to "helper"
+ * CHECK: Possible trace ([box]):
+ * CHECK-NOT: *** Sandboxed method
+ */
+#include "soaap.h"
+#include <unistd.h>
+
+int sensitive __soaap_classify("secret");
+int fd;
+
+void sandboxed();
+int helper(int x);
+int leak();
+
+int main(int argc, char** argv) {
+  sensitive = argc;
+  sandboxed();
+  leak();
+  return 0;
+}
+
+__soaap_sandbox_persistent("box")
+void sandboxed() {
+  char buf[16];
+  read(fd, buf, sizeof(buf));
+  helper(1);
+}
+
+int helper(int x) {
+  return x + 1;
+}
+
+int leak() {
+  int y = sensitive;
+  return helper(y);
+}
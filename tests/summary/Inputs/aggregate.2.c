@@ -0,0 +1,18 @@
+#include "soaap.h"
+#include <fcntl.h>
+
+int x = 0;
+
+__soaap_privileged
+void bar() {
+}
+
+void logmsg() {
+  open("/var/log/messages", O_WRONLY);
+}
+
+static void notify(void) {
+  open("/dev/console", O_WRONLY);
+}
+
+void (*notifier)(void) = notify;
@@ -0,0 +1,54 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.1.ll
+ * RUN: clang %cflags -emit-llvm -S %S/Inputs/aggregate.2.c -o %t.2.ll
+ * RUN: soaap --soaap-summary-file=%t.1.summary %t.1.ll > /dev/null
+ * RUN: soaap --soaap-summary %t.2.ll > /dev/null
+ * RUN: soaap-aggregate %t.1.summary %t.2.ll.soaap.summary | FileCheck %s
+ * RUN: soaap-aggregate -soaap-sandbox-platform=capsicum %t.1.summary %t.2.ll.soaap.summary 2>&1 | FileCheck %s -check-prefix=CAPSICUM
+ *
+ * Without -soaap-summary-file, the summary is written next to the module's
+ * file, where the soaap driver also looks for it.
+ *
+ * The global, the privileged function and the system calls are in the other
+ * translation unit, so are only found by combining the summaries. "y" is
+ * defined in neither, so writes to it are not reported. notify() is only
+ * called through a function pointer, so is found from its type, while no
+ * function of validator's type escapes, so its call is reported as
+ * unresolved.
+ *
+ * CHECK: Found sandbox "sandbox" (entrypoint foo)
+ * CHECK-NOT: global variable "y"
+ * CHECK: *** Sandboxed method "foo" [sandbox] wrote to global variable "x"
+ * CHECK: +++ Line 45 of file {{.*}}aggregate.c
+ * CHECK-NOT: global variable "y"
+ * CHECK: *** Sandbox "sandbox" calls privileged function "bar"
+ * CHECK: +++ Line 47 of file {{.*}}aggregate.c
+ * CHECK-NOT: Checking system calls
+ *
+ * CAPSICUM: WARNING: 1 indirect call(s) in sandbox "sandbox" have no known targets
+ * CAPSICUM: Checking system calls made by sandboxes
+ * CAPSICUM-DAG: +++ Line 11 of file {{.*}}aggregate.2.c
+ * CAPSICUM-DAG: +++ Line 15 of file {{.*}}aggregate.2.c
+ */
+#include "soaap.h"
+
+extern int x;
+extern int y;
+void bar();
+void logmsg();
+extern void (*notifier)(void);
+extern int (*validator)(int);
+
+int main(int argc, char** argv) {
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo() {
+  x = 1;
+  y = 1;
+  bar();
+  logmsg();
+  notifier();
+  validator(1);
+}
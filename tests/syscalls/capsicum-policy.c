@@ -0,0 +1,59 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-os=freebsd --soaap-emit-sandbox-policies --soaap-report-file-prefix=%t -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.sandbox.capsicum.h
+ *
+ * Descriptors passed to a function within the sandbox are traced back to
+ * the caller's descriptor, so bar's fsync on its parameter "in" needs
+ * CAP_FSYNC on foo's "out" rather than on foo's "in". Rights for mmap and
+ * openat are derived from their prot and flags arguments when constant.
+ *
+ * CHECK: Capsicum rights generated by SOAAP for sandbox "sandbox"
+ * CHECK: #include <sys/capsicum.h>
+ */
+#include "soaap.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+void foo(int in, int out, int dir);
+void bar(int in);
+
+int main(int argc, char** argv) {
+  int in = open("/etc/passwd", O_RDONLY);
+  int out = open("/tmp/out", O_WRONLY);
+  int dir = open("/tmp", O_RDONLY | O_DIRECTORY);
+  foo(in, out, dir);
+  return 0;
+}
+
+void bar(int in) {
+  fsync(in);
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo(int in, int out, int dir) {
+  char buf[10];
+  // CHECK: /* openat */
+  // CHECK-NEXT: static inline int soaap_sandbox_limit_dir(int fd) {
+  // CHECK-NEXT: cap_rights_t rights;
+  // CHECK-NEXT: cap_rights_init(&rights, CAP_LOOKUP, CAP_SEEK, CAP_WRITE);
+  openat(dir, "log", O_WRONLY);
+
+  // CHECK: /* lseek mmap read */
+  // CHECK-NEXT: static inline int soaap_sandbox_limit_in(int fd) {
+  // CHECK-NEXT: cap_rights_t rights;
+  // CHECK-NEXT: cap_rights_init(&rights, CAP_MMAP, CAP_MMAP_R, CAP_READ, CAP_SEEK);
+  // CHECK-NEXT: return cap_rights_limit(fd, &rights);
+  read(in, buf, sizeof(buf));
+  lseek(in, 0, SEEK_SET);
+  mmap(NULL, sizeof(buf), PROT_READ, MAP_SHARED, in, 0);
+
+  // CHECK: /* fsync write */
+  // CHECK-NEXT: static inline int soaap_sandbox_limit_out(int fd) {
+  // CHECK-NEXT: cap_rights_t rights;
+  // CHECK-NEXT: cap_rights_init(&rights, CAP_FSYNC, CAP_WRITE);
+  // CHECK-NOT: soaap_sandbox_limit_
+  write(out, buf, sizeof(buf));
+  bar(out);
+}
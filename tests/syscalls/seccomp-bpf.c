@@ -0,0 +1,83 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-os=linux --soaap-sandbox-platform=seccomp-bpf --soaap-seccomp-policy=%p/Inputs/seccomp-bpf.policy --soaap-emit-seccomp-filters --soaap-report-file-prefix=%t -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ * RUN: FileCheck %s -check-prefix=FILTER -input-file %t.sandbox.seccomp.h
+ *
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+void foo(int fd);
+
+int main(int argc, char** argv) {
+  foo(argc);
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo(int fd) {
+  char buf[10];
+
+  // CHECK-NOT: performs system call "read" but
+  read(fd, buf, sizeof(buf));
+
+  // CHECK-NOT: +++ Line 28 of file
+  write(1, buf, sizeof(buf));
+
+  // CHECK: *** Sandbox "sandbox" performs system call "write" but it is not allowed to,
+  // CHECK-NEXT: *** based on the current sandboxing restrictions.
+  // CHECK-NEXT: +++ Line 33 of file {{.*}}
+  write(2, buf, sizeof(buf));
+
+  // CHECK-NOT: +++ Line 36 of file
+  open("somefile", O_RDONLY);
+
+  // CHECK: *** Sandbox "sandbox" performs system call "open" but it is not allowed to,
+  // CHECK-NEXT: *** based on the current sandboxing restrictions.
+  // CHECK-NEXT: +++ Line 41 of file {{.*}}
+  open("somefile", O_RDWR);
+
+  // the offset is 64-bit, so both of its words are checked
+  lseek(fd, 0, SEEK_SET);
+
+  // AT_FDCWD is negative, so is sign extended to match the policy
+  // CHECK-NOT: performs system call "openat" but
+  openat(AT_FDCWD, "somefile", O_RDONLY);
+}
+
+// FILTER: AUDIT_ARCH_X86_64
+// open is made by libc as openat, so the predicate is moved to arg2. With
+// the direct call, openat has the most call sites so is checked first.
+// FILTER: /* openat */
+// FILTER-NEXT: offsetof(struct seccomp_data, args[2])
+// FILTER-NEXT: BPF_ALU | BPF_AND | BPF_K, 0x3
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0, 0, 1)
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER-NEXT: offsetof(struct seccomp_data, args[0])
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0xffffff9c, 0, 1)
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER-NEXT: SECCOMP_RET_KILL
+// FILTER: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1) /* read */
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER: /* write */
+// FILTER-NEXT: offsetof(struct seccomp_data, args[0])
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x1, 0, 1)
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER-NEXT: SECCOMP_RET_KILL
+// FILTER: /* open */
+// FILTER-NEXT: offsetof(struct seccomp_data, args[1])
+// FILTER-NEXT: BPF_ALU | BPF_AND | BPF_K, 0x3
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0, 0, 1)
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER-NEXT: SECCOMP_RET_KILL
+// FILTER: /* lseek */
+// FILTER-NEXT: offsetof(struct seccomp_data, args[1]) + 4
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0, 0, 3)
+// FILTER-NEXT: offsetof(struct seccomp_data, args[1])
+// FILTER-NEXT: BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x0, 0, 1)
+// FILTER-NEXT: SECCOMP_RET_ALLOW
+// FILTER-NEXT: SECCOMP_RET_KILL
+// FILTER: struct sock_fprog soaap_sandbox_prog
@@ -0,0 +1,33 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-os=linux --soaap-sandbox-platform=annotated --soaap-emit-sandbox-policies --soaap-syscall-profile=%p/Inputs/syscall-profile.txt --soaap-report-file-prefix=%t -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.sandbox.seccomp.h
+ *
+ * System calls that occur most often in the profile are checked first,
+ * and those that don't occur at all are checked last.
+ */
+#include "soaap.h"
+#include <unistd.h>
+
+void foo(int fd);
+
+int main(int argc, char** argv) {
+  foo(argc);
+  return 0;
+}
+
+__soaap_sandbox_persistent("sandbox")
+void foo(int fd) {
+  char buf[10];
+  // CHECK: AUDIT_ARCH_X86_64
+  // CHECK: /* write */
+  // CHECK-NEXT: SECCOMP_RET_ALLOW
+  // CHECK-NEXT: /* read */
+  // CHECK-NEXT: SECCOMP_RET_ALLOW
+  // CHECK-NEXT: /* close */
+  // CHECK-NEXT: SECCOMP_RET_ALLOW
+  // CHECK-NEXT: SECCOMP_RET_KILL
+  close(fd);
+  read(fd, buf, sizeof(buf));
+  write(fd, buf, sizeof(buf));
+}
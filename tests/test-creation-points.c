@@ -0,0 +1,58 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+
+void create_a(void);
+void fa(void);
+void fb(void);
+void fc(void);
+
+int main(int argc, char** argv) {
+  // the creation point for "a" is in a callee, and dominates the call
+  create_a();
+  // CHECK-NOT: Found call to sandbox entrypoint "fa"
+  fa();
+
+  // "b" is only created on some paths
+  if (argc > 1) {
+    __soaap_create_persistent_sandbox("b");
+  }
+  /*
+   * CHECK: *** Found call to sandbox entrypoint "fb" that is not preceded by sandbox creation
+   * CHECK-NEXT: Possible trace:
+   * CHECK-NEXT:   main(test-creation-points.c:{{[0-9]+}})
+   */
+  fb();
+
+  // "c" is created on every path
+  if (argc > 2) {
+    __soaap_create_persistent_sandbox("c");
+  }
+  else {
+    __soaap_create_ephemeral_sandbox("c");
+  }
+  // CHECK-NOT: Found call to sandbox entrypoint "fc"
+  fc();
+  return 0;
+}
+
+void create_a(void) {
+  __soaap_create_persistent_sandbox("a");
+}
+
+__soaap_sandbox_persistent("a")
+void fa(void) {
+}
+
+__soaap_sandbox_persistent("b")
+void fb(void) {
+}
+
+__soaap_sandbox_persistent("c")
+void fc(void) {
+}
@@ -0,0 +1,48 @@
+/*
+ * RUN: clang %cflags -emit-llvm -S %s -o %t.ll
+ * RUN: soaap --soaap-list-priv-funcs -o %t.soaap.ll %t.ll > %t.out
+ * RUN: FileCheck %s -input-file %t.out
+ *
+ * The region contains loops and branches that rejoin, so its blocks are
+ * reached along many paths but must each be visited once.
+ *
+ * CHECK: Running Soaap Pass
+ */
+#include "soaap.h"
+
+void bar() { }
+
+void baz() { }
+
+void m() { }
+
+void foo(int n) {
+  int i, j;
+  __soaap_sandboxed_region_start("auth");
+  for (i=0; i<n; i++) {
+    for (j=0; j<n; j++) {
+      if (i & j) {
+        bar();
+      }
+      else {
+        baz();
+      }
+      if (i | j) {
+        bar();
+      }
+    }
+  }
+  __soaap_sandboxed_region_end("auth");
+  m();
+}
+
+int main(int argc, char** argv) {
+  foo(argc);
+  return 0;
+}
+// CHECK-DAG:  Privileged methods:
+// CHECK-DAG:   main
+// CHECK-DAG:   foo
+// CHECK-DAG:   m
+// CHECK-NOT:   bar
+// CHECK-NOT:   baz
@@ -0,0 +1,58 @@
+//===- soaap-aggregate.cpp - Run SOAAP checks on module summaries ---------===//
+//
+// Link-time counterpart of the soaap-summary pass: combines the summaries
+// written for each translation unit as it was compiled and runs the SOAAP
+// checks that can be answered from them, without loading any IR.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "Analysis/SummaryAnalysis.h"
+#include "Common/CmdLineOpts.h"
+#include "Common/ModuleSummary.h"
+#include "Common/XO.h"
+
+#include <memory>
+
+using namespace llvm;
+using namespace soaap;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::desc("<summary files>"), cl::OneOrMore,
+    cl::value_desc("filenames"));
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  llvm::PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  cl::ParseCommandLineOptions(argc, argv,
+    "SOAAP summary aggregator (summaries may also be listed in a response file, @file)\n");
+
+  SummaryAnalysis analysis;
+  for (std::string& filename : InputFilenames) {
+    std::string error;
+    // each summary is its own module, so local keys stay distinct
+    std::unique_ptr<ModuleSummary> summary(ModuleSummary::read(filename, filename, error));
+    if (!summary) {
+      errs() << argv[0] << ": " << error << "\n";
+      return 1;
+    }
+    analysis.add(*summary);
+  }
+
+  if (CmdLineOpts::ReportOutputFormats.empty()) {
+    CmdLineOpts::ReportOutputFormats.push_back(ReportOutputFormat::Text);
+  }
+  XO::create_for_formats(CmdLineOpts::ReportOutputFormats, CmdLineOpts::ReportFilePrefix);
+  outs() << "* Running SOAAP checks on " << InputFilenames.size() << " summaries\n";
+  XO::open_container("soaap");
+  analysis.doAnalysis();
+  XO::close_container("soaap");
+  XO::finish();
+  return 0;
+}
@@ -0,0 +1,102 @@
+//===- soaap-client.cpp - Send requests to a SOAAP daemon -----------------===//
+//
+// Runs SOAAP with the given options in a daemon started with
+// soaap -soaap-daemon=<socket> <input files>, printing its output:
+//
+//   soaap-client <socket> [soaap options...]
+//
+// The daemon has already loaded and prepared the input, so only the analyses
+// themselves are run. Options must be given as -option=value and can't be
+// ones that the daemon was started with. The exit status is that of the
+// request.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool writeAll(int fd, const string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data()+written, data.size()-written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += n;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <socket> [soaap options...]\n", argv[0]);
+    return 1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "%s: socket path is too long: %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path)-1);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+    return 1;
+  }
+
+  // one argument per line, ended by an empty line
+  string request;
+  for (int i=2; i<argc; i++) {
+    if (strchr(argv[i], '\n') != NULL || argv[i][0] == '\0') {
+      fprintf(stderr, "%s: arguments can't be empty or contain newlines\n", argv[0]);
+      return 1;
+    }
+    request += argv[i];
+    request += "\n";
+  }
+  request += "\n";
+  if (!writeAll(fd, request)) {
+    fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+    return 1;
+  }
+  shutdown(fd, SHUT_WR);
+
+  // the last byte of the response is the exit status, so each byte is only
+  // printed once another has followed it
+  char buf[4096];
+  ssize_t n;
+  int last = -1;
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+      return 1;
+    }
+    if (last != -1) {
+      fputc(last, stdout);
+    }
+    fwrite(buf, 1, n-1, stdout);
+    last = (unsigned char)buf[n-1];
+  }
+  close(fd);
+  if (last == -1) {
+    fprintf(stderr, "%s: %s: the daemon closed the connection without a response\n", argv[0], argv[1]);
+    return 1;
+  }
+  return last;
+}
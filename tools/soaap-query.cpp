@@ -0,0 +1,255 @@
+//===- soaap-query.cpp - Query SOAAP's binary reports ---------------------===//
+//
+// Answers filtered queries (e.g. all warnings for a given sandbox whose traces
+// pass through a given function, or that report data of a given class) over
+// the binary report written by -soaap-report-output-formats=binary. The
+// report is mapped into memory and only the index entries and warnings that
+// are needed are touched, so queries do not depend on the size of the report.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "Common/BinaryReport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+using namespace llvm;
+using namespace soaap;
+using namespace std;
+
+static cl::opt<string>
+InputFilename(cl::Positional, cl::desc("<binary report>"), cl::Required,
+    cl::value_desc("filename"));
+
+static cl::opt<string>
+SandboxName("sandbox", cl::desc("Only show warnings for this sandbox"),
+    cl::value_desc("name"));
+
+static cl::opt<string>
+FunctionName("function", cl::desc("Only show warnings whose trace passes through this function"),
+    cl::value_desc("name"));
+
+static cl::opt<string>
+FileName("file", cl::desc("Only show warnings located in, or whose trace passes through, this file"),
+    cl::value_desc("base name"));
+
+static cl::opt<string>
+LabelName("label", cl::desc("Only show warnings about classified data of this class"),
+    cl::value_desc("class"));
+
+static cl::opt<string>
+WarningType("type", cl::desc("Only show warnings of this type (e.g. syscall_warning)"),
+    cl::value_desc("type"));
+
+static cl::opt<bool>
+ShowTraces("traces", cl::desc("Show the trace of each warning"));
+
+static cl::opt<bool>
+CountOnly("count", cl::desc("Only show the number of matching warnings"));
+
+namespace {
+  class Report {
+    public:
+      Report(MemoryBuffer& buffer) : buffer(buffer) { }
+
+      bool validate(string& error) {
+        if (buffer.getBufferSize() < sizeof(binary_report::Header)) {
+          error = "file is too small";
+          return false;
+        }
+        header = (const binary_report::Header*)buffer.getBufferStart();
+        if (memcmp(header->magic, binary_report::Magic, sizeof(header->magic)) != 0) {
+          error = "not a SOAAP binary report";
+          return false;
+        }
+        if (header->version != binary_report::Version) {
+          error = "unsupported version";
+          return false;
+        }
+        if (!inBounds(header->strings, 1)
+            || !inBounds(header->warnings, sizeof(binary_report::Warning))
+            || !inBounds(header->fields, sizeof(binary_report::Field))
+            || !inBounds(header->traceNodes, sizeof(binary_report::TraceNode))
+            || !inBounds(header->sandboxIndex, sizeof(binary_report::IndexEntry))
+            || !inBounds(header->functionIndex, sizeof(binary_report::IndexEntry))
+            || !inBounds(header->fileIndex, sizeof(binary_report::IndexEntry))
+            || !inBounds(header->labelIndex, sizeof(binary_report::IndexEntry))
+            || !inBounds(header->postings, sizeof(uint32_t))) {
+          error = "table extends beyond the end of the file";
+          return false;
+        }
+        if (header->strings.count == 0
+            || buffer.getBufferStart()[header->strings.offset + header->strings.count - 1] != '\0') {
+          error = "malformed string table";
+          return false;
+        }
+        return true;
+      }
+
+      const char* str(uint32_t offset) {
+        if (offset >= header->strings.count) {
+          return "";
+        }
+        return buffer.getBufferStart() + header->strings.offset + offset;
+      }
+
+      template<typename T>
+      const T* table(const binary_report::Table& t) {
+        return (const T*)(buffer.getBufferStart() + t.offset);
+      }
+
+      uint32_t numWarnings() { return header->warnings.count; }
+
+      const binary_report::Warning& warning(uint32_t idx) {
+        return table<binary_report::Warning>(header->warnings)[idx];
+      }
+
+      // Binary search the given index for key, returning its postings (an
+      // ascending list of warning indices).
+      vector<uint32_t> lookup(const binary_report::Table& index, StringRef key) {
+        const binary_report::IndexEntry* entries = table<binary_report::IndexEntry>(index);
+        uint32_t lo = 0, hi = index.count;
+        while (lo < hi) {
+          uint32_t mid = lo + (hi - lo) / 2;
+          int cmp = StringRef(str(entries[mid].key)).compare(key);
+          if (cmp == 0) {
+            const binary_report::IndexEntry& entry = entries[mid];
+            if ((uint64_t)entry.firstPosting + entry.numPostings > header->postings.count) {
+              break;
+            }
+            const uint32_t* postings = table<uint32_t>(header->postings) + entry.firstPosting;
+            return vector<uint32_t>(postings, postings + entry.numPostings);
+          }
+          else if (cmp < 0) {
+            lo = mid + 1;
+          }
+          else {
+            hi = mid;
+          }
+        }
+        return vector<uint32_t>();
+      }
+
+      void print(raw_ostream& os, uint32_t idx) {
+        const binary_report::Warning& w = warning(idx);
+        os << str(w.type);
+        if (w.sandbox) {
+          os << " in sandbox \"" << str(w.sandbox) << "\"";
+        }
+        if (w.file) {
+          os << " at " << str(w.file) << ":" << w.line;
+        }
+        os << "\n";
+        const binary_report::Field* fields = table<binary_report::Field>(header->fields);
+        for (uint32_t i=w.firstField; i<w.firstField+w.numFields && i<header->fields.count; i++) {
+          os << "  " << str(fields[i].name) << ": " << str(fields[i].value) << "\n";
+        }
+        if (ShowTraces && w.traceId != binary_report::NoTrace) {
+          os << "  trace:\n";
+          const binary_report::TraceNode* nodes = table<binary_report::TraceNode>(header->traceNodes);
+          uint32_t depth = 0;
+          for (int32_t id = w.traceId; id >= 0 && (uint32_t)id < header->traceNodes.count && depth++ < header->traceNodes.count; id = nodes[id].parent) {
+            const binary_report::TraceNode& node = nodes[id];
+            os << "    " << str(node.function) << " (" << str(node.file) << ":" << node.line;
+            if (node.library) {
+              os << ", " << str(node.library) << " library";
+            }
+            os << ")\n";
+          }
+        }
+      }
+
+      const binary_report::Header* header;
+
+    private:
+      MemoryBuffer& buffer;
+
+      bool inBounds(const binary_report::Table& t, size_t entrySize) {
+        return (uint64_t)t.offset + (uint64_t)t.count*entrySize <= buffer.getBufferSize();
+      }
+  };
+}
+
+// Intersect the candidate warnings with the postings for key, if a key was
+// given.
+static void restrictCandidates(Report& report, const binary_report::Table& index, StringRef key,
+                               bool& restricted, vector<uint32_t>& candidates) {
+  if (key.empty()) {
+    return;
+  }
+  vector<uint32_t> postings = report.lookup(index, key);
+  if (!restricted) {
+    candidates = postings;
+    restricted = true;
+  }
+  else {
+    vector<uint32_t> intersection;
+    set_intersection(candidates.begin(), candidates.end(),
+                     postings.begin(), postings.end(),
+                     back_inserter(intersection));
+    candidates = intersection;
+  }
+}
+
+int main(int argc, char** argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  cl::ParseCommandLineOptions(argc, argv, "SOAAP binary report query tool\n");
+
+  // don't require a null terminator, so that the file can be mapped rather
+  // than read (small files are still read into memory)
+  ErrorOr<unique_ptr<MemoryBuffer> > bufferOrErr =
+    MemoryBuffer::getFile(InputFilename, -1, false);
+  if (error_code EC = bufferOrErr.getError()) {
+    errs() << argv[0] << ": " << InputFilename << ": " << EC.message() << "\n";
+    return 1;
+  }
+  Report report(*bufferOrErr.get());
+  string error;
+  if (!report.validate(error)) {
+    errs() << argv[0] << ": " << InputFilename << ": " << error << "\n";
+    return 1;
+  }
+
+  bool restricted = false;
+  vector<uint32_t> candidates;
+  restrictCandidates(report, report.header->sandboxIndex, SandboxName, restricted, candidates);
+  restrictCandidates(report, report.header->functionIndex, FunctionName, restricted, candidates);
+  restrictCandidates(report, report.header->fileIndex, FileName, restricted, candidates);
+  restrictCandidates(report, report.header->labelIndex, LabelName, restricted, candidates);
+  if (!restricted) {
+    for (uint32_t i=0; i<report.numWarnings(); i++) {
+      candidates.push_back(i);
+    }
+  }
+
+  unsigned count = 0;
+  for (uint32_t idx : candidates) {
+    if (idx >= report.numWarnings()) {
+      continue;
+    }
+    if (!WarningType.empty() && WarningType != report.str(report.warning(idx).type)) {
+      continue;
+    }
+    count++;
+    if (!CountOnly) {
+      report.print(outs(), idx);
+    }
+  }
+  if (CountOnly) {
+    outs() << count << "\n";
+  }
+  return 0;
+}
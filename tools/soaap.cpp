@@ -41,22 +41,38 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
 #include <memory>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Common/CmdLineOpts.h"
 #include "Passes/Soaap.h"
+#include "Passes/SoaapSummary.h"
+#include "Util/ClassHierarchyUtils.h"
+#include "Util/ModuleUtils.h"
+#include "Util/PointsToUtils.h"
+#include "Util/WorklistUtils.h"
 
 using namespace llvm;
 
 // Other command line options...
 //
-static cl::opt<std::string>
-InputFilename(cl::Positional, cl::desc("<input bitcode file>"),
-    cl::init("-"), cl::value_desc("filename"));
+// Many modules may be given (or listed in a response file, @file), in which
+// case they are linked by SOAAP rather than beforehand.
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::desc("<input bitcode files>"),
+    cl::ZeroOrMore, cl::value_desc("filenames"));
 
 static cl::opt<std::string>
 OutputFilename("o", cl::desc("Override output filename"),
@@ -68,42 +84,57 @@ OutputAssembly("S", cl::desc("Write output as LLVM assembly"));
 static cl::opt<bool>
 Verify("verify", cl::desc("Verify result module"), cl::Hidden);
 
-int main(int argc, char **argv) {
-  sys::PrintStackTraceOnErrorSignal();
-  llvm::PrettyStackTraceProgram X(argc, argv);
+static cl::opt<bool>
+EagerLoad("soaap-eager-load", cl::desc("Parse every function body up front, "
+    "rather than only those reachable from main() and the sandboxes"));
 
-  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
-  LLVMContext &Context = getGlobalContext();
+// In daemon mode, the module is loaded once, and its class hierarchy,
+// sandboxes, callgraph and points-to sets are computed up front (see
+// Soaap::prepare). Each connection to the socket is then a request to run
+// SOAAP with the options it sends (see soaap-client). Each request is run in
+// a child process forked from the daemon, so it starts from the daemon's warm
+// state and its options and analysis results don't outlive it. The response
+// is the request's output followed by a byte holding its exit status. If
+// input files have changed since they were loaded, the daemon re-executes
+// itself before the next request, so that it starts again from a clean state.
+static cl::opt<std::string>
+DaemonSocket("soaap-daemon", cl::desc("Serve analysis requests on this UNIX "
+    "domain socket instead of running once"), cl::value_desc("path"));
 
-  //InitializeAllTargets();
-  //InitializeAllTargetMCs();
+// Passed by the daemon to itself when it re-executes: the socket it is
+// listening on, and a connection whose request hasn't been read yet.
+static cl::opt<int>
+DaemonListenFd("soaap-daemon-listen-fd", cl::Hidden, cl::init(-1));
 
-  // Initialize passes
-  PassRegistry &Registry = *PassRegistry::getPassRegistry();
-  initializeCore(Registry);
-  initializeScalarOpts(Registry);
-  initializeObjCARCOpts(Registry);
-  initializeVectorization(Registry);
-  initializeIPO(Registry);
-  initializeAnalysis(Registry);
-  initializeIPA(Registry);
-  initializeTransformUtils(Registry);
-  initializeInstCombine(Registry);
-  initializeInstrumentation(Registry);
-  initializeTarget(Registry);
-  initializeSoaapPass(Registry);
-
-  cl::ParseCommandLineOptions(argc, argv,
-    "llvm .bc -> .bc modular optimizer and analysis printer\n");
+static cl::opt<int>
+DaemonPendingFd("soaap-daemon-pending-fd", cl::Hidden, cl::init(-1));
 
+static std::unique_ptr<Module> loadInput(LLVMContext& Context, const char* argv0) {
   SMDiagnostic Err;
-
-  // Load the input module...
-  std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
-
-  if (!M.get()) {
-    Err.print(argv[0], errs());
-    return 1;
+  std::unique_ptr<Module> M;
+  if (InputFilenames.size() == 1) {
+    if (EagerLoad) {
+      M = parseIRFile(InputFilenames[0], Err, Context);
+    }
+    else {
+      // function bodies are only parsed if they can be reached
+      M = getLazyIRFileModule(InputFilenames[0], Err, Context);
+      if (M.get()) {
+        soaap::ModuleUtils::materializeReachable(*M);
+      }
+    }
+    if (!M.get()) {
+      Err.print(argv0, errs());
+      return nullptr;
+    }
+  }
+  else {
+    std::string Error;
+    M = soaap::ModuleUtils::loadModules(InputFilenames, Context, Error);
+    if (!M.get()) {
+      errs() << Error;
+      return nullptr;
+    }
   }
   
   // Warn if M doesn't have debug info
@@ -112,7 +143,10 @@ int main(int argc, char **argv) {
     errs() << "WARNING: Input IR file does not contain debug information\n";
     errs() << "**********************************************************\n";
   }
-  
+  return M;
+}
+
+static int runPasses(Module& M, const char* argv0) {
   // Figure out what stream we are supposed to write to...
   std::unique_ptr<tool_output_file> Out;
   if (!OutputFilename.empty()) {
@@ -128,23 +162,41 @@ int main(int argc, char **argv) {
   // about to build.
   //
   legacy::PassManager Passes;
+  if (soaap::CmdLineOpts::Summary || !soaap::CmdLineOpts::SummaryFile.empty()) {
+    // the summary describes the module that is output, or else the one that
+    // was input, and is named after that file
+    std::string summarised = OutputFilename;
+    if (summarised.empty() && InputFilenames.size() == 1) {
+      summarised = InputFilenames[0];
+    }
+    Passes.add(new soaap::SoaapSummary(summarised));
+  }
   Passes.add(new soaap::Soaap);
 
+  // Now that we have all of the passes ready, run them.
+  Passes.run(M);
+
   // Check that the module is well formed on completion of optimization
   if (!OutputFilename.empty()) {
+    // the output must contain every function body, including those that
+    // SOAAP didn't need
+    if (std::error_code EC = M.materializeAllPermanently()) {
+      errs() << argv0 << ": " << EC.message() << "\n";
+      return 1;
+    }
+
+    legacy::PassManager OutputPasses;
     if (Verify)
-      Passes.add(createVerifierPass());
+      OutputPasses.add(createVerifierPass());
 
     // Pass to create output
     if (OutputAssembly)
-      Passes.add(createPrintModulePass(Out->os()));
+      OutputPasses.add(createPrintModulePass(Out->os()));
     else
-      Passes.add(createBitcodeWriterPass(Out->os()));
+      OutputPasses.add(createBitcodeWriterPass(Out->os()));
+    OutputPasses.run(M);
   }
 
-  // Now that we have all of the passes ready, run them.
-  Passes.run(*M.get());
-
   // Declare success.
   if (!OutputFilename.empty()) {
     Out->keep();
@@ -153,3 +205,333 @@ int main(int argc, char **argv) {
   return 0;
 }
 
+// Load the input and do the option-independent preparation that requests
+// would otherwise repeat.
+static std::unique_ptr<Module> prepareDaemonModule(LLVMContext& Context, const char* argv0,
+                                                   std::vector<sys::TimeValue>& loadTimes) {
+  loadTimes.clear();
+  for (std::string& filename : InputFilenames) {
+    sys::fs::file_status status;
+    sys::fs::status(filename, status);
+    loadTimes.push_back(status.getLastModificationTime());
+  }
+  std::unique_ptr<Module> M = loadInput(Context, argv0);
+  if (!M.get()) {
+    return nullptr;
+  }
+  // requests run with different options, so parse every body now rather
+  // than in each request
+  if (std::error_code EC = M->materializeAllPermanently()) {
+    errs() << argv0 << ": " << EC.message() << "\n";
+    return nullptr;
+  }
+  soaap::ClassHierarchyUtils::findClassHierarchy(*M);
+  soaap::ClassHierarchyUtils::cacheAllCalleesForVirtualCalls(*M);
+  soaap::WorklistUtils::startBudget();
+  soaap::Soaap::prepare(*M);
+  soaap::PointsToUtils::requirePointsTo(*M);
+  return M;
+}
+
+// Options that change what the daemon prepares before forking, so can only
+// be given when it is started.
+static const char* const PreparedOptions[] = {
+  "soaap-context-insens", "soaap-infer-fp-targets", "soaap-points-to-fp-targets",
+  "soaap-fp-type-fallback", "soaap-no-slicing", "soaap-max-field-depth"
+};
+
+// Options of the information-flow solver, which also runs while preparing if
+// function-pointer targets are inferred.
+static const char* const SolverOptions[] = {
+  "soaap-call-string-depth", "soaap-worklist", "soaap-widen-after",
+  "soaap-time-budget", "soaap-memory-budget"
+};
+
+static bool isPreparedOption(StringRef name) {
+  for (const char* prepared : PreparedOptions) {
+    if (name == prepared) {
+      return true;
+    }
+  }
+  if (soaap::CmdLineOpts::InferFPTargets) {
+    for (const char* solver : SolverOptions) {
+      if (name == solver) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Options given when the daemon was started are already set in the forked
+// child, and LLVM can't reset an option once it has been parsed: re-parsing
+// them would append to lists or fail as repeated occurrences. A request may
+// therefore only give SOAAP's own options (and the output file), in
+// -option=value form, that the daemon wasn't started with. Input files are
+// fixed by the daemon.
+static bool checkRequest(std::vector<std::string>& args, std::string& error) {
+  StringMap<cl::Option*> options;
+  cl::getRegisteredOptions(options);
+  for (std::string& arg : args) {
+    StringRef name = StringRef(arg).split('=').first;
+    if (!name.startswith("-")) {
+      error = "input files are fixed by the daemon, and option values must be given as -option=value: \"" + arg + "\"";
+      return false;
+    }
+    name = name.ltrim('-');
+    StringMap<cl::Option*>::iterator I = options.find(name);
+    if (I == options.end()) {
+      error = "unknown option: \"" + arg + "\"";
+      return false;
+    }
+    cl::Option* O = I->getValue();
+    if (O->Category != &soaap::CmdLineOpts::SoaapCategory && name != "o" && name != "S") {
+      error = "option can't be changed per request: \"" + arg + "\"";
+      return false;
+    }
+    if (O->getNumOccurrences() > 0) {
+      error = "option was already given when the daemon was started: \"" + arg + "\"";
+      return false;
+    }
+    if (isPreparedOption(name)) {
+      error = "option changes the callgraph that the daemon prepares, so must be given when it is started: \"" + arg + "\"";
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool inputChanged(std::vector<sys::TimeValue>& loadTimes) {
+  for (unsigned i=0; i<InputFilenames.size(); i++) {
+    sys::fs::file_status status;
+    if (!sys::fs::status(InputFilenames[i], status)
+        && status.getLastModificationTime() != loadTimes[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A request is the arguments to run SOAAP with, one per line, ended by an
+// empty line.
+static bool readRequest(int fd, std::vector<std::string>& args) {
+  std::string request;
+  char buf[4096];
+  while (request != "\n" && !StringRef(request).endswith("\n\n")) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      return false;
+    }
+    request.append(buf, n);
+  }
+  StringRef rest = StringRef(request).drop_back(request.size() > 1 ? 2 : 1);
+  while (!rest.empty()) {
+    std::pair<StringRef,StringRef> p = rest.split('\n');
+    args.push_back(p.first);
+    rest = p.second;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, const char* buf, size_t n) {
+  while (n > 0) {
+    ssize_t written = write(fd, buf, n);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    buf += written;
+    n -= written;
+  }
+  return true;
+}
+
+// Reload the input by re-executing the daemon with the same arguments, which
+// is simpler and more robust than resetting every cached analysis result.
+// The listening socket and the connection waiting for a response are
+// inherited. Only returns if exec fails.
+static void reexec(int argc, char** argv, int listenFd, int conn) {
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    StringRef name = StringRef(argv[i]).split('=').first.ltrim('-');
+    if (name != DaemonListenFd.ArgStr && name != DaemonPendingFd.ArgStr) {
+      args.push_back(argv[i]);
+    }
+  }
+  args.push_back("-" + std::string(DaemonListenFd.ArgStr) + "=" + std::to_string(listenFd));
+  args.push_back("-" + std::string(DaemonPendingFd.ArgStr) + "=" + std::to_string(conn));
+  std::vector<char*> argvs;
+  argvs.push_back(argv[0]);
+  for (std::string& arg : args) {
+    argvs.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argvs.push_back(NULL);
+  outs().flush();
+  errs().flush();
+  execvp(argv[0], argvs.data());
+}
+
+static void sendError(int conn, const char* argv0, StringRef msg) {
+  // the last byte sent is the exit status
+  std::string response = msg.str() + "\1";
+  if (!writeAll(conn, response.data(), response.size())) {
+    errs() << argv0 << ": write: " << strerror(errno) << "\n";
+  }
+}
+
+static int serve(LLVMContext& Context, int argc, char** argv) {
+  const char* argv0 = argv[0];
+  int pending = DaemonPendingFd;
+  std::vector<sys::TimeValue> loadTimes;
+  std::unique_ptr<Module> M = prepareDaemonModule(Context, argv0, loadTimes);
+  if (!M.get()) {
+    if (pending >= 0) {
+      sendError(pending, argv0, "ERROR: could not reload the input\n");
+    }
+    return 1;
+  }
+
+  int listenFd = DaemonListenFd;
+  if (listenFd < 0) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (DaemonSocket.size() >= sizeof(addr.sun_path)) {
+      errs() << argv0 << ": socket path is too long: " << DaemonSocket << "\n";
+      return 1;
+    }
+    strncpy(addr.sun_path, DaemonSocket.c_str(), sizeof(addr.sun_path)-1);
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(DaemonSocket.c_str());
+    if (listenFd < 0
+        || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+        || listen(listenFd, 8) < 0) {
+      errs() << argv0 << ": " << DaemonSocket << ": " << strerror(errno) << "\n";
+      return 1;
+    }
+  }
+  outs() << "* Serving requests on " << DaemonSocket << "\n";
+
+  // a client that goes away mustn't take the daemon with it
+  signal(SIGPIPE, SIG_IGN);
+
+  while (true) {
+    outs().flush();
+    int conn = pending;
+    pending = -1;
+    if (conn < 0) {
+      conn = accept(listenFd, NULL, NULL);
+    }
+    if (conn < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      errs() << argv0 << ": accept: " << strerror(errno) << "\n";
+      return 1;
+    }
+
+    if (inputChanged(loadTimes)) {
+      outs() << "* Reloading changed input\n";
+      reexec(argc, argv, listenFd, conn);
+      errs() << argv0 << ": exec: " << strerror(errno) << "\n";
+      sendError(conn, argv0, "ERROR: could not reload the input\n");
+      close(conn);
+      return 1;
+    }
+
+    std::vector<std::string> args;
+    if (!readRequest(conn, args)) {
+      close(conn);
+      continue;
+    }
+
+    outs().flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listenFd);
+      dup2(conn, STDOUT_FILENO);
+      dup2(conn, STDERR_FILENO);
+      close(conn);
+      std::string error;
+      if (!checkRequest(args, error)) {
+        errs() << argv0 << ": " << error << "\n";
+        _exit(1);
+      }
+      std::vector<const char*> argvs;
+      argvs.push_back(argv0);
+      for (std::string& arg : args) {
+        argvs.push_back(arg.c_str());
+      }
+      cl::ParseCommandLineOptions(argvs.size(), argvs.data());
+      int status = runPasses(*M, argv0);
+      outs().flush();
+      _exit(status);
+    }
+    unsigned char exitStatus = 1;
+    if (pid < 0) {
+      errs() << argv0 << ": fork: " << strerror(errno) << "\n";
+    }
+    else {
+      int status;
+      while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+      if (WIFEXITED(status)) {
+        exitStatus = WEXITSTATUS(status);
+      }
+      else if (WIFSIGNALED(status)) {
+        exitStatus = 128 + WTERMSIG(status);
+      }
+    }
+    // the last byte sent is the request's exit status. A client that has
+    // gone away only loses its own response.
+    if (!writeAll(conn, (const char*)&exitStatus, 1)) {
+      errs() << argv0 << ": write: " << strerror(errno) << "\n";
+    }
+    close(conn);
+  }
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  llvm::PrettyStackTraceProgram X(argc, argv);
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  LLVMContext &Context = getGlobalContext();
+
+  //InitializeAllTargets();
+  //InitializeAllTargetMCs();
+
+  // Initialize passes
+  PassRegistry &Registry = *PassRegistry::getPassRegistry();
+  initializeCore(Registry);
+  initializeScalarOpts(Registry);
+  initializeObjCARCOpts(Registry);
+  initializeVectorization(Registry);
+  initializeIPO(Registry);
+  initializeAnalysis(Registry);
+  initializeIPA(Registry);
+  initializeTransformUtils(Registry);
+  initializeInstCombine(Registry);
+  initializeInstrumentation(Registry);
+  initializeTarget(Registry);
+  initializeSoaapPass(Registry);
+
+  cl::ParseCommandLineOptions(argc, argv,
+    "llvm .bc -> .bc modular optimizer and analysis printer\n");
+
+  // Load the input module(s)...
+  if (InputFilenames.empty()) {
+    InputFilenames.push_back("-");
+  }
+
+  if (!DaemonSocket.empty()) {
+    return serve(Context, argc, argv);
+  }
+
+  std::unique_ptr<Module> M = loadInput(Context, argv[0]);
+  if (!M.get()) {
+    return 1;
+  }
+  return runPasses(*M, argv[0]);
+}